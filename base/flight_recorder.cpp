@@ -0,0 +1,138 @@
+#include "flight_recorder.h"
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "signal_safe.h"
+
+namespace base {
+
+/// Recorders walked by the crash handler, free slots are null.
+static std::atomic<FlightRecorder *> s_recorders[FlightRecorder::kMaxRecorders];
+
+static thread_local uint32_t t_tid = 0;
+
+static const char *event_name(FlightEvent event) {
+    switch (event) {
+        case FlightEvent::Queue:
+            return "queue";
+        case FlightEvent::Done:
+            return "done";
+        case FlightEvent::Drop:
+            return "drop";
+        case FlightEvent::Error:
+            return "error";
+        case FlightEvent::State:
+            return "state";
+    }
+    return "?";
+}
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+FlightRecorder::FlightRecorder() : _next(0) {
+    _name[0] = '\0';
+    for (Entry &entry : _entries) {
+        entry.sequence.store(0, std::memory_order_relaxed);
+    }
+
+    for (auto &slot : s_recorders) {
+        FlightRecorder *expected = nullptr;
+        if (slot.compare_exchange_strong(expected, this)) {
+            break;
+        }
+    }
+}
+
+FlightRecorder::~FlightRecorder() {
+    for (auto &slot : s_recorders) {
+        FlightRecorder *expected = this;
+        if (slot.compare_exchange_strong(expected, nullptr)) {
+            break;
+        }
+    }
+}
+
+void FlightRecorder::set_name(const char *name) {
+    size_t idx = 0;
+    for (; name != nullptr && name[idx] != '\0' && idx + 1 < kNameSize; idx++) {
+        _name[idx] = name[idx];
+    }
+    _name[idx] = '\0';
+}
+
+void FlightRecorder::record(FlightEvent event, uint64_t index, uint64_t value, const char *label) {
+    if (t_tid == 0) {
+        t_tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    }
+
+    uint64_t position = _next.fetch_add(1, std::memory_order_relaxed);
+    Entry &entry = _entries[position % kEntries];
+
+    entry.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.time.store(monotonic_ns(), std::memory_order_relaxed);
+    entry.index.store(index, std::memory_order_relaxed);
+    entry.value.store(value, std::memory_order_relaxed);
+    entry.label.store(label, std::memory_order_relaxed);
+    entry.event.store(event, std::memory_order_relaxed);
+    entry.tid.store(t_tid, std::memory_order_relaxed);
+    entry.sequence.store(2 * position + 2, std::memory_order_release);
+}
+
+void FlightRecorder::dump(int fd, uint64_t now) const {
+    SafeString line;
+    uint64_t next = _next.load(std::memory_order_acquire);
+    uint64_t first = (next > kEntries) ? next - kEntries : 0;
+
+    line.append("recorder ").append(_name).append(", ").append_uint(next).append(" events\n");
+    line.flush(fd);
+
+    for (uint64_t position = first; position < next; position++) {
+        const Entry &entry = _entries[position % kEntries];
+        if (entry.sequence.load(std::memory_order_acquire) != 2 * position + 2) {
+            // Being written when the signal arrived, or already overwritten.
+            line.append("  #").append_uint(position).append(" incomplete\n");
+            line.flush(fd);
+            continue;
+        }
+
+        uint64_t time = entry.time.load(std::memory_order_relaxed);
+        uint64_t value = entry.value.load(std::memory_order_relaxed);
+        const char *label = entry.label.load(std::memory_order_relaxed);
+        FlightEvent event = entry.event.load(std::memory_order_relaxed);
+        uint64_t age = (now > time) ? (now - time) / 1000 : 0;
+
+        line.append("  #").append_uint(position).append(" -").append_uint(age).append(" us tid ");
+        line.append_uint(entry.tid.load(std::memory_order_relaxed)).append(" ");
+        line.append(event_name(event));
+        if (event != FlightEvent::State) {
+            line.append(" frame ").append_uint(entry.index.load(std::memory_order_relaxed));
+        }
+        if (value != 0) {
+            line.append(" value ").append_uint(value);
+        }
+        if (label != nullptr) {
+            line.append(" ").append(label);
+        }
+        line.append("\n");
+        line.flush(fd);
+    }
+}
+
+void FlightRecorder::dump_all(int fd) {
+    uint64_t now = monotonic_ns();
+    for (auto &slot : s_recorders) {
+        FlightRecorder *recorder = slot.load(std::memory_order_acquire);
+        if (recorder != nullptr) {
+            recorder->dump(fd, now);
+        }
+    }
+}
+
+}  // namespace base
@@ -0,0 +1,81 @@
+/**
+ * @brief always-on ring of the last per-frame events, dumped on crash
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace base {
+
+enum class FlightEvent : uint32_t {
+    Queue,
+    Done,
+    Drop,
+    Error,
+    /// Lifecycle change, described by the label.
+    State
+};
+
+/**
+ * @brief Fixed size ring of the last events of one component instance.
+ * Recording takes no lock and never allocates; recorders register themselves
+ * in a static table the crash handler walks with async-signal-safe calls only.
+*/
+class FlightRecorder {
+public:
+    static const uint32_t kEntries = 256;
+    static const uint32_t kMaxRecorders = 64;
+    static const uint32_t kNameSize = 48;
+
+    FlightRecorder();
+    ~FlightRecorder();
+
+    /**
+     * @brief name shown in the dump, truncated to kNameSize - 1 characters
+    */
+    void set_name(const char *name);
+
+    /**
+     * @brief append an event, overwriting the oldest one
+     * @param event kind of event
+     * @param index frame index, 0 for state changes
+     * @param value event detail, e.g. output bytes or error code
+     * @param label static string, e.g. the new state or the drop reason
+    */
+    void record(FlightEvent event, uint64_t index, uint64_t value = 0,
+                const char *label = nullptr);
+
+    /**
+     * @brief write the events oldest first, async-signal-safe
+    */
+    void dump(int fd, uint64_t now) const;
+
+    /**
+     * @brief dump every registered recorder, async-signal-safe
+    */
+    static void dump_all(int fd);
+
+    FlightRecorder(const FlightRecorder &) = delete;
+    void operator=(const FlightRecorder &) = delete;
+private:
+    struct Entry {
+        /// 2 * position + 1 while written, 2 * position + 2 once complete.
+        std::atomic<uint64_t> sequence;
+        /// Relaxed atomics, writers lapping the ring may share an entry.
+        std::atomic<uint64_t> time;
+        std::atomic<uint64_t> index;
+        std::atomic<uint64_t> value;
+        std::atomic<const char *> label;
+        std::atomic<FlightEvent> event;
+        std::atomic<uint32_t> tid;
+    };
+
+    Entry _entries[kEntries];
+    std::atomic<uint64_t> _next;
+    char _name[kNameSize];
+};
+
+}  // namespace base
@@ -1,34 +1,49 @@
-
 #include "signal_monitor.h"
 
 #include <assert.h>
 #include <execinfo.h>  //backtrace
+#include <fcntl.h>
 #include <signal.h>
+#include <stdio.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
-#include <string>
-
+#include "flight_recorder.h"
 #include "log.h"
+#include "signal_safe.h"
 
 namespace base {
 
 #define gettid() ::syscall(SYS_gettid)
 
-static std::string s_dump_path = "/data/dump";
+/// Everything below is prepared at registration, the handler only uses
+/// async-signal-safe calls: open, read, write, readlink, getdents64, close.
+static char s_dump_path[256] = "/data/dump";
 
 static int SIG_MONITOR_SIZE = 8;
-static int MAX_TRACES = 100;
+static const int MAX_TRACES = 100;
 static const int STACK_BODY_SIZE = (64 * 1024);
+static const int COPY_BUFFER_SIZE = 4096;
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
 
-static void signal_handler(int signal_number);
-static int dump_stack(char *file_name);
+static void signal_handler(int signal_number, siginfo_t *info, void *context);
 
 void register_signal_monitor(const char *dump_path) {
     if (dump_path != NULL) {
-        s_dump_path = dump_path;
+        snprintf(s_dump_path, sizeof(s_dump_path), "%s", dump_path);
     }
 
+    /// backtrace() loads libgcc lazily on first use, which is not safe in the handler
+    void *frames[1];
+    backtrace(frames, 1);
+
     int sigArray[SIG_MONITOR_SIZE] = {
         SIGINT,   // 2
         SIGILL,   // 4
@@ -50,8 +65,8 @@ void register_signal_monitor(const char *dump_path) {
 
     /// Regiser handler of sigaction
     static struct sigaction sig;
-    sig.sa_handler = signal_handler;
-    sig.sa_flags = SA_ONSTACK;
+    sig.sa_sigaction = signal_handler;
+    sig.sa_flags = SA_ONSTACK | SA_SIGINFO;
 
     /// Add blocking signals
     /// TODO: still can not block signal SIGSEGV ?
@@ -70,100 +85,148 @@ void register_signal_monitor(const char *dump_path) {
     base::LogInfo() << "Monitoring signal";
 }
 
-void signal_handler(int signal_number) {
-    /// Use static flag to avoid being called repeatedly.
-    static volatile bool is_handling[SIGALRM + 1] = {false};
-    if (is_handling[signal_number] == true) {
+/**
+ * @brief create <dump_path>/<prefix>_<pid>[<signal>].txt
+*/
+static int open_dump(const char *prefix, int signal_number) {
+    SafeString file_name;
+    file_name.append(s_dump_path).append("/").append(prefix).append("_");
+    file_name.append_uint(getpid()).append("[").append_uint(signal_number).append("].txt");
+    return open(file_name.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+static void copy_file(const char *path, int fd) {
+    int source = open(path, O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
         return;
     }
 
-    base::LogInfo() << "=========>>>catch signal " << signal_number
-                    << "<<< from tid:" << (int)gettid() << "====== \n";
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t size;
+    while ((size = read(source, buffer, sizeof(buffer))) > 0) {
+        if (write(fd, buffer, size) != size) {
+            break;
+        }
+    }
+    close(source);
+}
 
-    is_handling[signal_number] = true;
+/**
+ * @brief call entry for every name in a directory but . and ..
+*/
+static void list_directory(const char *path, void (*entry)(const char *name, int fd), int fd) {
+    int directory = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory < 0) {
+        return;
+    }
 
-    if (signal_number == SIGINT) {
-        _exit(0);
+    char buffer[COPY_BUFFER_SIZE];
+    long size;
+    while ((size = syscall(SYS_getdents64, directory, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < size;) {
+            linux_dirent64 *dirent = reinterpret_cast<linux_dirent64 *>(buffer + offset);
+            offset += dirent->d_reclen;
+            if (dirent->d_name[0] != '.') {
+                entry(dirent->d_name, fd);
+            }
+        }
     }
+    close(directory);
+}
 
-    char file_name[128] = {0x00};
-    char buffer[256] = {0x00};
+static void dump_fd_entry(const char *name, int fd) {
+    SafeString path;
+    path.append("/proc/self/fd/").append(name);
 
-    /// Dump trace and r-xp maps
-    snprintf(file_name, sizeof(file_name), "%s/trace_%d[%d].txt", s_dump_path.c_str(), getpid(),
-             signal_number);
+    char target[256];
+    ssize_t size = readlink(path.c_str(), target, sizeof(target));
 
-    snprintf(buffer, sizeof(buffer), "cat /proc/%d/maps | grep '/usr' | grep 'r-xp' | tee %s",
-             getpid(), file_name);
-    base::LogDebug() << "Run cmd: " << buffer;
-    [[maybe_unused]] int result = system((const char *)buffer);
+    SafeString line;
+    line.append(name).append(" -> ").append(target, size > 0 ? size : 0).append("\n");
+    line.flush(fd);
+}
 
-    base::LogDebug() << "Dump stack start... \n";
-    dump_stack(file_name);
-    base::LogDebug() << "Dump stack end... \n";
+static void dump_thread_entry(const char *name, int fd) {
+    SafeString line;
+    line.append(name).append(" ");
+    line.flush(fd);
 
-    /// Dump fd
-    snprintf(file_name, sizeof(file_name), "%s/fd_%d[%d].txt", s_dump_path.c_str(), getpid(),
-             signal_number);
-    snprintf(buffer, sizeof(buffer), "ls -l /proc/%d/fd > %s", getpid(), file_name);
-    base::LogDebug() << "Run cmd: " << buffer;
-    result = system((const char *)buffer);
+    SafeString path;
+    path.append("/proc/self/task/").append(name).append("/comm");
+    copy_file(path.c_str(), fd);
+}
 
-    /// Dump whole maps
-    snprintf(file_name, sizeof(file_name), "%s/maps_%d[%d].txt", s_dump_path.c_str(), getpid(),
-             signal_number);
-    snprintf(buffer, sizeof(buffer), "cat /proc/%d/maps > %s", getpid(), file_name);
-    base::LogDebug() << "Run cmd: " << buffer;
-    result = system((const char *)buffer);
+static void dump_stack(int fd) {
+    void *buffer[MAX_TRACES];
+    int nptrs = backtrace(buffer, MAX_TRACES);
+    backtrace_symbols_fd(buffer, nptrs, fd);
+}
 
-    /// Dump meminfo
-    snprintf(file_name, sizeof(file_name), "%s/meminfo_%d[%d].txt", s_dump_path.c_str(), getpid(),
-             signal_number);
-    snprintf(buffer, sizeof(buffer), "cat /proc/meminfo > %s", file_name);
-    base::LogDebug() << "Run cmd: " << buffer;
-    result = system((const char *)buffer);
-
-    /// Dump ps
-    snprintf(file_name, sizeof(file_name), "%s/ps_%d[%d].txt", s_dump_path.c_str(), getpid(),
-             signal_number);
-    snprintf(buffer, sizeof(buffer), "ps -T > %s", file_name);
-    base::LogDebug() << "Run cmd: " << buffer;
-    result = system((const char *)buffer);
-
-    /// Dump top
-    snprintf(file_name, sizeof(file_name), "%s/top_%d[%d].txt", s_dump_path.c_str(), getpid(),
-             signal_number);
-    snprintf(buffer, sizeof(buffer), "top -b -n 1 > %s", file_name);
-    base::LogDebug() << "Run cmd: " << buffer;
-    result = system((const char *)buffer);
+void signal_handler(int signal_number, siginfo_t *info, void *context) {
+    /// Use static flag to avoid being called repeatedly.
+    static volatile sig_atomic_t is_handling[SIGALRM + 1] = {0};
+    if (is_handling[signal_number]) {
+        return;
+    }
+    is_handling[signal_number] = 1;
 
-    _exit(0);
-}
+    SafeString message;
+    message.append("=========>>>catch signal ").append_uint(signal_number);
+    message.append("<<< from tid:").append_uint(gettid()).append(" addr:");
+    message.append_hex(reinterpret_cast<uintptr_t>(info->si_addr)).append("====== \n");
+    message.flush(STDERR_FILENO);
 
-int dump_stack(char *file_name) {
-    void *buffer[MAX_TRACES];
+    if (signal_number == SIGINT) {
+        _exit(0);
+    }
 
-    int nptrs = backtrace(buffer, MAX_TRACES);
-    base::LogDebug() << "backtrace() returned " << nptrs << " addresses";
+    /// Dump trace and flight recorders
+    int fd = open_dump("trace", signal_number);
+    if (fd >= 0) {
+        message.append("signal ").append_uint(signal_number).append(" code ");
+        message.append_uint(info->si_code).append(" addr ");
+        message.append_hex(reinterpret_cast<uintptr_t>(info->si_addr)).append(" tid ");
+        message.append_uint(gettid()).append("\n\nbacktrace:\n");
+        message.flush(fd);
+        dump_stack(fd);
+
+        message.append("\nflight recorders:\n");
+        message.flush(fd);
+        FlightRecorder::dump_all(fd);
+        close(fd);
+    }
 
-    char **strings = backtrace_symbols(buffer, nptrs);
-    if (strings == NULL) {
-        perror("backtrace_symbols");
-        _exit(EXIT_FAILURE);
+    /// Dump fd
+    if ((fd = open_dump("fd", signal_number)) >= 0) {
+        list_directory("/proc/self/fd", dump_fd_entry, fd);
+        close(fd);
     }
 
-    for (int i = 0; i < nptrs; i++) {
-        // QCAMX_PRINT("[%02d] %s \n", i, strings[i]);
-        if (file_name != NULL) {
-            char buff[256] = {0x00};
-            snprintf(buff, sizeof(buff), "echo \"%s\" >> %s", strings[i], file_name);
-            [[maybe_unused]] int result = system((const char *)buff);
-        }
+    /// Dump whole maps
+    if ((fd = open_dump("maps", signal_number)) >= 0) {
+        copy_file("/proc/self/maps", fd);
+        close(fd);
     }
 
-    free(strings);
+    /// Dump meminfo
+    if ((fd = open_dump("meminfo", signal_number)) >= 0) {
+        copy_file("/proc/meminfo", fd);
+        close(fd);
+    }
 
-    return 0;
+    /// Dump threads, replaces ps -T
+    if ((fd = open_dump("threads", signal_number)) >= 0) {
+        list_directory("/proc/self/task", dump_thread_entry, fd);
+        close(fd);
+    }
+
+    /// Dump process status, replaces top
+    if ((fd = open_dump("status", signal_number)) >= 0) {
+        copy_file("/proc/self/status", fd);
+        close(fd);
+    }
+
+    _exit(0);
 }
 
-}  // namespace base
\ No newline at end of file
+}  // namespace base
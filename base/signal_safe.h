@@ -0,0 +1,97 @@
+/**
+ * @brief string formatting usable inside signal handlers
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace base {
+
+/**
+ * @brief Fixed capacity string built without allocation, locale or stdio, so
+ * it may be used from a signal handler. Text beyond the capacity is dropped.
+*/
+class SafeString {
+public:
+    static const size_t kCapacity = 512;
+
+    SafeString() : _size(0) { _data[0] = '\0'; }
+
+    SafeString &append(const char *text) {
+        for (; text != nullptr && *text != '\0' && _size + 1 < kCapacity; text++) {
+            _data[_size++] = *text;
+        }
+        _data[_size] = '\0';
+        return *this;
+    }
+
+    SafeString &append(const char *text, size_t length) {
+        for (size_t idx = 0; idx < length && _size + 1 < kCapacity; idx++) {
+            _data[_size++] = text[idx];
+        }
+        _data[_size] = '\0';
+        return *this;
+    }
+
+    SafeString &append_uint(uint64_t value) {
+        char digits[20];
+        size_t count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count > 0 && _size + 1 < kCapacity) {
+            _data[_size++] = digits[--count];
+        }
+        _data[_size] = '\0';
+        return *this;
+    }
+
+    SafeString &append_hex(uint64_t value) {
+        static const char kDigits[] = "0123456789abcdef";
+        append("0x");
+        bool leading = true;
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            uint32_t digit = (value >> shift) & 0xf;
+            if (leading && digit == 0 && shift != 0) {
+                continue;
+            }
+            leading = false;
+            char c[2] = {kDigits[digit], '\0'};
+            append(c);
+        }
+        return *this;
+    }
+
+    const char *c_str() const { return _data; }
+    size_t size() const { return _size; }
+
+    void clear() {
+        _size = 0;
+        _data[0] = '\0';
+    }
+
+    /**
+     * @brief write the whole string to fd and clear it
+    */
+    bool flush(int fd) {
+        size_t written = 0;
+        while (written < _size) {
+            ssize_t result = ::write(fd, _data + written, _size - written);
+            if (result <= 0) {
+                break;
+            }
+            written += result;
+        }
+        bool ok = written == _size;
+        clear();
+        return ok;
+    }
+private:
+    char _data[kCapacity];
+    size_t _size;
+};
+
+}  // namespace base
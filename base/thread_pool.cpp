@@ -0,0 +1,83 @@
+#include "thread_pool.h"
+
+namespace base {
+
+ThreadPool::ThreadPool(size_t workers)
+    : _task(nullptr), _count(0), _next(0), _remaining(0), _generation(0), _stop(false) {
+    for (size_t idx = 0; idx < workers; idx++) {
+        _workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        _stop = true;
+    }
+    _wakeup.notify_all();
+
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+bool ThreadPool::take_task(size_t &index) {
+    if (_task == nullptr || _next >= _count) {
+        return false;
+    }
+    index = _next++;
+    return true;
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)> &task) {
+    if (count == 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lk(_lock);
+    _task = &task;
+    _count = count;
+    _next = 0;
+    _remaining = count;
+    _generation++;
+    _wakeup.notify_all();
+
+    // The caller works on the batch too instead of only waiting.
+    size_t index = 0;
+    while (take_task(index)) {
+        lk.unlock();
+        task(index);
+        lk.lock();
+        _remaining--;
+    }
+
+    _done.wait(lk, [this]() { return _remaining == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::worker_loop() {
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lk(_lock);
+
+    while (true) {
+        _wakeup.wait(lk, [&]() { return _stop || (_generation != generation && _task); });
+        if (_stop) {
+            return;
+        }
+        generation = _generation;
+
+        size_t index = 0;
+        while (take_task(index)) {
+            const std::function<void(size_t)> &task = *_task;
+            lk.unlock();
+            task(index);
+            lk.lock();
+
+            if (--_remaining == 0) {
+                _done.notify_all();
+            }
+        }
+    }
+}
+
+}  // namespace base
@@ -0,0 +1,60 @@
+/**
+ * @brief fixed size worker thread pool
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+/**
+ * @brief Runs batches of indexed tasks on a fixed set of worker threads.
+ * The calling thread takes part in each batch, so a pool of 0 workers runs
+ * everything inline.
+*/
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    /**
+     * @brief Run task(0) ... task(count - 1) and wait for all of them.
+     * @param count number of tasks in the batch
+     * @param task callable receiving the task index
+    */
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+    /**
+     * @brief number of threads executing a batch, including the caller
+    */
+    size_t size() const { return _workers.size() + 1; }
+
+    ThreadPool(const ThreadPool &) = delete;
+    void operator=(const ThreadPool &) = delete;
+private:
+    void worker_loop();
+    bool take_task(size_t &index);
+
+    std::vector<std::thread> _workers;
+    std::mutex _lock;
+    std::condition_variable _wakeup;
+    std::condition_variable _done;
+
+    /// Current batch, only valid while _remaining > 0.
+    const std::function<void(size_t)> *_task;
+    size_t _count;
+    size_t _next;
+    size_t _remaining;
+    /// Incremented for every batch so idle workers notice new work.
+    uint64_t _generation;
+    bool _stop;
+};
+
+}  // namespace base
@@ -0,0 +1,416 @@
+#include "trace.h"
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "log.h"
+
+namespace base {
+
+namespace {
+
+struct TraceEvent {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t id;
+    const char *name;
+    uint32_t track;
+    trace_detail::EventType type;
+};
+
+/**
+ * @brief events of one thread, written by that thread only and published
+ * through count, so exporting never blocks the writer
+*/
+struct ThreadBuffer {
+    std::vector<TraceEvent> events;
+    std::atomic<uint32_t> count{0};
+    /// Capture the events belong to, 0 while the owner resets the buffer.
+    std::atomic<uint64_t> session{0};
+    std::atomic<uint64_t> lost{0};
+    uint32_t tid = 0;
+};
+
+/// Span with both ends known, as laid out in the Perfetto export.
+struct TraceSpan {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t id;
+    const char *name;
+    uint64_t uuid;
+};
+
+std::mutex g_lock;
+std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;
+std::vector<std::string> g_tracks = {"c2"};
+std::atomic<uint64_t> g_session{0};
+std::atomic<size_t> g_capacity{0};
+
+thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+
+ThreadBuffer *thread_buffer() {
+    if (!t_buffer) {
+        t_buffer = std::make_shared<ThreadBuffer>();
+        t_buffer->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_buffers.push_back(t_buffer);
+    }
+    return t_buffer.get();
+}
+
+/// Events of the current capture and the thread that recorded them.
+std::vector<std::pair<uint32_t, TraceEvent>> collect(std::vector<std::string> &tracks) {
+    std::vector<std::pair<uint32_t, TraceEvent>> events;
+
+    std::lock_guard<std::mutex> lk(g_lock);
+    tracks = g_tracks;
+    uint64_t session = g_session.load(std::memory_order_acquire);
+    for (auto &buffer : g_buffers) {
+        if (buffer->session.load(std::memory_order_acquire) != session) {
+            continue;
+        }
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t idx = 0; idx < count; idx++) {
+            events.emplace_back(buffer->tid, buffer->events[idx]);
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const auto &a, const auto &b) {
+        return a.second.begin < b.second.begin;
+    });
+    return events;
+}
+
+std::string escape(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+bool export_chrome(std::ofstream &out) {
+    std::vector<std::string> tracks;
+    std::vector<std::pair<uint32_t, TraceEvent>> events = collect(tracks);
+    uint64_t origin = events.empty() ? 0 : events.front().second.begin;
+    char line[512];
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t track = 0; track < tracks.size(); track++) {
+        out << (track == 0 ? "\n" : ",\n") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"
+            << track << ",\"args\":{\"name\":\"" << escape(tracks[track]) << "\"}}";
+    }
+
+    for (auto &entry : events) {
+        const TraceEvent &event = entry.second;
+        double ts = (event.begin - origin) / 1000.0;
+
+        if (event.type == trace_detail::EventType::Complete) {
+            snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"%s\",\"cat\":\"c2\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+                     "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%" PRIu64 "}}",
+                     event.name, event.track, entry.first, ts,
+                     (event.end - event.begin) / 1000.0, event.id);
+        } else {
+            // Ids are local to the track, frame indexes repeat across engines.
+            bool begin = event.type == trace_detail::EventType::AsyncBegin;
+            snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"%s\",\"cat\":\"c2\",\"ph\":\"%s\",\"pid\":%u,\"tid\":%u,"
+                     "\"ts\":%.3f,\"id2\":{\"local\":\"0x%" PRIx64 "\"},\"args\":{\"frame\":%"
+                     PRIu64 "}}",
+                     event.name, begin ? "b" : "e", event.track, entry.first, ts, event.id,
+                     event.id);
+        }
+        out << line;
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+/**
+ * @brief minimal protobuf encoder for the few Perfetto messages written
+*/
+class ProtoWriter {
+public:
+    void varint(uint32_t field, uint64_t value) {
+        tag(field, 0);
+        raw_varint(value);
+    }
+
+    void bytes(uint32_t field, const std::string &value) {
+        tag(field, 2);
+        raw_varint(value.size());
+        _data += value;
+    }
+
+    void message(uint32_t field, const ProtoWriter &nested) { bytes(field, nested._data); }
+
+    const std::string &data() const { return _data; }
+private:
+    void tag(uint32_t field, uint32_t wire_type) { raw_varint((field << 3) | wire_type); }
+
+    void raw_varint(uint64_t value) {
+        while (value >= 0x80) {
+            _data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        _data.push_back(static_cast<char>(value));
+    }
+
+    std::string _data;
+};
+
+// Field numbers of perfetto/trace/trace_packet.proto and track_event/*.proto.
+#define TRACE_PACKET 1
+#define PACKET_TIMESTAMP 8
+#define PACKET_SEQUENCE_ID 10
+#define PACKET_TRACK_EVENT 11
+#define PACKET_SEQUENCE_FLAGS 13
+#define PACKET_TRACK_DESCRIPTOR 60
+#define DESCRIPTOR_UUID 1
+#define DESCRIPTOR_NAME 2
+#define DESCRIPTOR_PARENT_UUID 5
+#define EVENT_DEBUG_ANNOTATION 4
+#define EVENT_TYPE 9
+#define EVENT_TRACK_UUID 11
+#define EVENT_NAME 23
+#define ANNOTATION_UINT_VALUE 3
+#define ANNOTATION_NAME 10
+#define TYPE_SLICE_BEGIN 1
+#define TYPE_SLICE_END 2
+#define SEQUENCE_ID 1
+#define SEQ_INCREMENTAL_STATE_CLEARED 1
+
+void write_packet(std::ofstream &out, ProtoWriter &packet, bool first) {
+    packet.varint(PACKET_SEQUENCE_ID, SEQUENCE_ID);
+    if (first) {
+        packet.varint(PACKET_SEQUENCE_FLAGS, SEQ_INCREMENTAL_STATE_CLEARED);
+    }
+
+    ProtoWriter trace;
+    trace.message(TRACE_PACKET, packet);
+    out.write(trace.data().data(), trace.data().size());
+}
+
+void write_descriptor(std::ofstream &out, uint64_t uuid, uint64_t parent,
+                      const std::string &name, bool first) {
+    ProtoWriter descriptor;
+    descriptor.varint(DESCRIPTOR_UUID, uuid);
+    descriptor.bytes(DESCRIPTOR_NAME, name);
+    if (parent != 0) {
+        descriptor.varint(DESCRIPTOR_PARENT_UUID, parent);
+    }
+
+    ProtoWriter packet;
+    packet.message(PACKET_TRACK_DESCRIPTOR, descriptor);
+    write_packet(out, packet, first);
+}
+
+bool export_perfetto(std::ofstream &out) {
+    std::vector<std::string> tracks;
+    std::vector<std::pair<uint32_t, TraceEvent>> events = collect(tracks);
+
+    // One parent track per registered track, the uuids of children follow.
+    uint64_t next_uuid = tracks.size() + 1;
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> thread_tracks;
+    std::map<std::tuple<uint32_t, std::string, size_t>, uint64_t> lane_tracks;
+    std::map<std::pair<uint32_t, std::string>, std::vector<uint64_t>> lane_ends;
+    std::map<std::tuple<uint32_t, std::string, uint64_t>, uint64_t> open;
+    std::vector<TraceSpan> spans;
+
+    bool first = true;
+    for (size_t track = 0; track < tracks.size(); track++) {
+        write_descriptor(out, track + 1, 0, tracks[track], first);
+        first = false;
+    }
+
+    for (auto &entry : events) {
+        const TraceEvent &event = entry.second;
+        uint32_t track = std::min<uint32_t>(event.track, tracks.size() - 1);
+
+        if (event.type == trace_detail::EventType::Complete) {
+            auto key = std::make_pair(track, entry.first);
+            if (thread_tracks.find(key) == thread_tracks.end()) {
+                thread_tracks[key] = next_uuid;
+                write_descriptor(out, next_uuid++, track + 1,
+                                 "thread " + std::to_string(entry.first), false);
+            }
+            spans.push_back({event.begin, event.end, event.id, event.name, thread_tracks[key]});
+            continue;
+        }
+
+        auto key = std::make_tuple(track, std::string(event.name), event.id);
+        if (event.type == trace_detail::EventType::AsyncBegin) {
+            open[key] = event.begin;
+            continue;
+        }
+        auto it = open.find(key);
+        if (it == open.end()) {
+            continue;
+        }
+        uint64_t begin = it->second;
+        open.erase(it);
+
+        // Frames overlap, each stage gets as many lanes as it has frames in flight.
+        std::vector<uint64_t> &ends = lane_ends[std::make_pair(track, event.name)];
+        size_t lane = 0;
+        while (lane < ends.size() && ends[lane] > begin) {
+            lane++;
+        }
+        if (lane == ends.size()) {
+            ends.push_back(0);
+        }
+        ends[lane] = event.end;
+
+        auto lane_key = std::make_tuple(track, std::string(event.name), lane);
+        if (lane_tracks.find(lane_key) == lane_tracks.end()) {
+            lane_tracks[lane_key] = next_uuid;
+            write_descriptor(out, next_uuid++, track + 1,
+                             std::string(event.name) + " " + std::to_string(lane), false);
+        }
+        spans.push_back({begin, event.end, event.id, event.name, lane_tracks[lane_key]});
+    }
+
+    // Slice ends before begins at the same time, enclosing slices around nested ones.
+    struct SliceEdge {
+        uint64_t ts;
+        bool begin;
+        uint64_t duration;
+        const TraceSpan *span;
+    };
+    std::vector<SliceEdge> edges;
+    for (const TraceSpan &span : spans) {
+        edges.push_back({span.begin, true, span.end - span.begin, &span});
+        edges.push_back({span.end, false, span.end - span.begin, &span});
+    }
+    std::sort(edges.begin(), edges.end(), [](const SliceEdge &a, const SliceEdge &b) {
+        if (a.ts != b.ts) {
+            return a.ts < b.ts;
+        }
+        if (a.begin != b.begin) {
+            return !a.begin;
+        }
+        return a.begin ? (a.duration > b.duration) : (a.duration < b.duration);
+    });
+
+    for (const SliceEdge &edge : edges) {
+        ProtoWriter event;
+        event.varint(EVENT_TYPE, edge.begin ? TYPE_SLICE_BEGIN : TYPE_SLICE_END);
+        event.varint(EVENT_TRACK_UUID, edge.span->uuid);
+        if (edge.begin) {
+            ProtoWriter annotation;
+            annotation.bytes(ANNOTATION_NAME, "frame");
+            annotation.varint(ANNOTATION_UINT_VALUE, edge.span->id);
+            event.message(EVENT_DEBUG_ANNOTATION, annotation);
+            event.bytes(EVENT_NAME, edge.span->name);
+        }
+
+        ProtoWriter packet;
+        packet.varint(PACKET_TIMESTAMP, edge.ts);
+        packet.message(PACKET_TRACK_EVENT, event);
+        write_packet(out, packet, false);
+    }
+    return out.good();
+}
+
+}  // namespace
+
+namespace trace_detail {
+
+std::atomic<bool> active{false};
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void record(EventType type, const char *name, uint32_t track, uint64_t id, uint64_t begin,
+            uint64_t end) {
+    ThreadBuffer *buffer = thread_buffer();
+
+    // The first event of a new capture resets the buffer, hidden from export meanwhile.
+    uint64_t session = g_session.load(std::memory_order_acquire);
+    if (buffer->session.load(std::memory_order_relaxed) != session) {
+        buffer->session.store(0, std::memory_order_release);
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->lost.store(0, std::memory_order_relaxed);
+        buffer->events.resize(g_capacity.load(std::memory_order_relaxed));
+        buffer->session.store(session, std::memory_order_release);
+    }
+
+    uint32_t count = buffer->count.load(std::memory_order_relaxed);
+    if (count >= buffer->events.size()) {
+        buffer->lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[count] = {begin, end, id, name, track, type};
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+}  // namespace trace_detail
+
+uint32_t trace_register_track(const std::string &name) {
+    std::lock_guard<std::mutex> lk(g_lock);
+    uint32_t track = g_tracks.size();
+    g_tracks.push_back(name + " #" + std::to_string(track));
+    return track;
+}
+
+void trace_start(size_t events_per_thread) {
+    std::lock_guard<std::mutex> lk(g_lock);
+
+    // Buffers only referenced from here belong to threads that exited.
+    g_buffers.erase(std::remove_if(g_buffers.begin(), g_buffers.end(),
+                                   [](const auto &buffer) { return buffer.use_count() == 1; }),
+                    g_buffers.end());
+
+    g_capacity = events_per_thread;
+    g_session++;
+    trace_detail::active = true;
+}
+
+void trace_stop() {
+    trace_detail::active = false;
+}
+
+uint64_t trace_lost() {
+    std::lock_guard<std::mutex> lk(g_lock);
+    uint64_t lost = 0;
+    for (auto &buffer : g_buffers) {
+        if (buffer->session.load(std::memory_order_acquire) == g_session) {
+            lost += buffer->lost.load(std::memory_order_relaxed);
+        }
+    }
+    return lost;
+}
+
+bool trace_export(const std::string &path, TraceFormat format) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LogError() << "Cannot open trace output " << path;
+        return false;
+    }
+
+    bool ok = (format == TraceFormat::Chrome) ? export_chrome(out) : export_perfetto(out);
+    if (!ok) {
+        LogError() << "Failed to write trace " << path;
+    }
+    return ok;
+}
+
+}  // namespace base
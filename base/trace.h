@@ -0,0 +1,137 @@
+/**
+ * @brief frame lifecycle tracing exported to trace viewers
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace base {
+
+enum class TraceFormat {
+    /// Chrome trace event JSON, opened by chrome://tracing and ui.perfetto.dev.
+    Chrome,
+    /// Perfetto protobuf trace.
+    Perfetto
+};
+
+namespace trace_detail {
+extern std::atomic<bool> active;
+
+enum class EventType : uint8_t {
+    Complete,
+    AsyncBegin,
+    AsyncEnd
+};
+
+uint64_t now_ns();
+void record(EventType type, const char *name, uint32_t track, uint64_t id, uint64_t begin,
+            uint64_t end);
+}  // namespace trace_detail
+
+/**
+ * @brief register a named track the spans of one component instance are grouped on
+ * @param name track name, suffixed with the track id
+ * @return track id, 0 is the default track
+*/
+uint32_t trace_register_track(const std::string &name);
+
+/**
+ * @brief discard the previous capture and start recording
+ * @param events_per_thread events buffered by each thread, further events are counted as lost
+*/
+void trace_start(size_t events_per_thread);
+
+/**
+ * @brief stop recording, the capture is kept for export
+*/
+void trace_stop();
+
+inline bool trace_active() {
+    return trace_detail::active.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief number of events lost to full thread buffers in the current capture
+*/
+uint64_t trace_lost();
+
+/**
+ * @brief write the current capture, best called after trace_stop()
+ * @param path output file
+ * @param format Chrome JSON or Perfetto protobuf
+ * @return false if the file cannot be written
+*/
+bool trace_export(const std::string &path, TraceFormat format);
+
+/**
+ * @brief begin/end of a span crossing threads, matched by name, track and id
+ * @param name static string naming the stage
+ * @param track track id from trace_register_track()
+ * @param id frame the span belongs to
+*/
+inline void trace_begin(const char *name, uint32_t track, uint64_t id) {
+    if (trace_active()) {
+        uint64_t now = trace_detail::now_ns();
+        trace_detail::record(trace_detail::EventType::AsyncBegin, name, track, id, now, now);
+    }
+}
+
+inline void trace_end(const char *name, uint32_t track, uint64_t id) {
+    if (trace_active()) {
+        uint64_t now = trace_detail::now_ns();
+        trace_detail::record(trace_detail::EventType::AsyncEnd, name, track, id, now, now);
+    }
+}
+
+/**
+ * @brief span covering the lifetime of the scope on the current thread
+*/
+class TraceScope {
+public:
+    TraceScope(const char *name, uint32_t track, uint64_t id)
+        : _name(name),
+          _track(track),
+          _id(id),
+          _begin(trace_active() ? trace_detail::now_ns() : 0) {}
+
+    ~TraceScope() {
+        if (_begin != 0 && trace_active()) {
+            trace_detail::record(trace_detail::EventType::Complete, _name, _track, _id, _begin,
+                                 trace_detail::now_ns());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    void operator=(const TraceScope &) = delete;
+private:
+    const char *_name;
+    uint32_t _track;
+    uint64_t _id;
+    uint64_t _begin;
+};
+
+}  // namespace base
+
+// Instrumentation points, compiled out unless ENABLE_C2_TRACE is defined.
+#if defined(ENABLE_C2_TRACE)
+#define C2_TRACE_CONCAT_INNER(a, b) a##b
+#define C2_TRACE_CONCAT(a, b) C2_TRACE_CONCAT_INNER(a, b)
+#define C2_TRACE_SCOPE(name, track, id) \
+    base::TraceScope C2_TRACE_CONCAT(_trace_scope_, __LINE__)(name, track, id)
+#define C2_TRACE_BEGIN(name, track, id) base::trace_begin(name, track, id)
+#define C2_TRACE_END(name, track, id) base::trace_end(name, track, id)
+#else
+#define C2_TRACE_SCOPE(name, track, id) \
+    do {                                \
+    } while (0)
+#define C2_TRACE_BEGIN(name, track, id) \
+    do {                                \
+    } while (0)
+#define C2_TRACE_END(name, track, id) \
+    do {                              \
+    } while (0)
+#endif
@@ -0,0 +1,338 @@
+#include "c2_buffer_broker.h"
+
+#include <C2Buffer.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "base/log.h"
+#include "c2_stats.h"
+
+/// Alignment assumed for the size of a block never allocated before.
+#define ESTIMATE_ALIGNMENT 128
+
+/// Size of a block before the first allocation of its geometry tells the real one.
+static size_t estimate_size(uint32_t width, uint32_t height, C2PixelFormat format) {
+    size_t aligned_width = (width + ESTIMATE_ALIGNMENT - 1) & ~(ESTIMATE_ALIGNMENT - 1);
+    size_t aligned_height = (height + ESTIMATE_ALIGNMENT - 1) & ~(ESTIMATE_ALIGNMENT - 1);
+    size_t pixels = aligned_width * aligned_height;
+
+    switch (format) {
+        case C2PixelFormat::kRGBA:
+        case C2PixelFormat::kRGBA_UBWC:
+            return pixels * 4;
+        case C2PixelFormat::kP010:
+        case C2PixelFormat::kTP10UBWC:
+            return pixels * 3;
+        default:
+            return pixels * 3 / 2;
+    }
+}
+
+static void on_buffer_destroyed(const C2Buffer *buffer, void *arg) {
+    delete static_cast<std::shared_ptr<C2GraphicBlock> *>(arg);
+}
+
+bool C2BufferBroker::Key::operator<(const Key &other) const {
+    if (width != other.width) {
+        return width < other.width;
+    }
+    if (height != other.height) {
+        return height < other.height;
+    }
+    if (format != other.format) {
+        return format < other.format;
+    }
+    return usage < other.usage;
+}
+
+C2BufferBroker &C2BufferBroker::Instance() {
+    // Never destroyed, blocks may be released by buffers outliving static destruction.
+    static C2BufferBroker *broker = new C2BufferBroker();
+    return *broker;
+}
+
+C2BufferBroker::C2BufferBroker()
+    : next_client_(1),
+      priority_waiters_(0),
+      allocated_(0),
+      cached_(0),
+      peak_(0),
+      hits_(0),
+      misses_(0),
+      evictions_(0),
+      waits_(0),
+      failures_(0) {}
+
+void C2BufferBroker::Configure(const C2BrokerConfig &config) {
+    std::vector<std::shared_ptr<C2GraphicBlock>> freed;
+    std::lock_guard<std::mutex> lk(lock_);
+
+    config_ = config;
+    if (config_.budget_bytes != 0 && allocated_ > config_.budget_bytes) {
+        Evict(allocated_ - config_.budget_bytes, freed);
+    }
+    released_.notify_all();
+}
+
+uint32_t C2BufferBroker::Register(const std::string &name) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    uint32_t id = next_client_++;
+    clients_[id] = {name, 0, 0, 0};
+    return id;
+}
+
+void C2BufferBroker::Unregister(uint32_t client) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    clients_.erase(client);
+    // The quota of the others grows.
+    released_.notify_all();
+}
+
+size_t C2BufferBroker::Quota() const {
+    if (config_.budget_bytes == 0) {
+        return 0;
+    }
+    return config_.budget_bytes / std::max<size_t>(clients_.size(), 1);
+}
+
+void C2BufferBroker::Charge(uint32_t client, size_t size, bool acquire) {
+    auto it = clients_.find(client);
+    if (it != clients_.end()) {
+        it->second.bytes = acquire ? (it->second.bytes + size) : (it->second.bytes - size);
+        it->second.peak = std::max(it->second.peak, it->second.bytes);
+    }
+    peak_ = std::max(peak_, allocated_);
+}
+
+size_t C2BufferBroker::Evict(size_t needed,
+                             std::vector<std::shared_ptr<C2GraphicBlock>> &freed) {
+    uint64_t now = C2Stats::Now();
+    uint64_t idle = config_.idle_ms * 1000ull;
+    size_t bytes = 0;
+
+    auto evict = [&](std::multimap<Key, Cached>::iterator it) {
+        bytes += it->second.size;
+        allocated_ -= it->second.size;
+        cached_ -= it->second.size;
+        evictions_++;
+        freed.push_back(std::move(it->second.block));
+        return cache_.erase(it);
+    };
+
+    for (auto it = cache_.begin(); it != cache_.end();) {
+        it = (now - it->second.released >= idle) ? evict(it) : std::next(it);
+    }
+
+    // Then the least recently released blocks until there is room.
+    while (bytes < needed && !cache_.empty()) {
+        evict(std::min_element(cache_.begin(), cache_.end(), [](const auto &a, const auto &b) {
+            return a.second.released < b.second.released;
+        }));
+    }
+
+    return bytes;
+}
+
+std::shared_ptr<C2GraphicBlock> C2BufferBroker::Acquire(uint32_t client, uint32_t width,
+                                                        uint32_t height, C2PixelFormat format,
+                                                        uint32_t usage,
+                                                        const Allocator &allocate) {
+    Key key = {width, height, format, usage};
+    // Declared ahead of the lock so that evicted blocks are freed after unlocking.
+    std::vector<std::shared_ptr<C2GraphicBlock>> freed;
+    std::unique_lock<std::mutex> lk(lock_);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.wait_ms);
+    bool waited = false;
+    bool priority = false;
+
+    // Waiters over their quota only need a wakeup once no priority waiter is left,
+    // waking them on every change would have the waiters wake each other in turn.
+    auto leave_priority = [this, &priority]() {
+        if (priority) {
+            priority = false;
+            if (--priority_waiters_ == 0) {
+                released_.notify_all();
+            }
+        }
+    };
+
+    // Blocks of the same key are allocated with the same size.
+    auto known = sizes_.find(key);
+    size_t estimate =
+        (known != sizes_.end()) ? known->second : estimate_size(width, height, format);
+
+    while (true) {
+        auto self = clients_.find(client);
+        if (self == clients_.end()) {
+            base::LogError() << "Graphic block fetch from unregistered client " << client;
+            leave_priority();
+            return nullptr;
+        }
+
+        Evict(0, freed);
+
+        // The most recently released block of the key is the most likely to be cache warm.
+        auto range = cache_.equal_range(key);
+        if (range.first != range.second) {
+            auto newest = std::prev(range.second);
+            std::shared_ptr<C2GraphicBlock> block = std::move(newest->second.block);
+            size_t size = newest->second.size;
+            cache_.erase(newest);
+
+            cached_ -= size;
+            hits_++;
+            Charge(client, size);
+            leave_priority();
+            lk.unlock();
+            return Wrap(client, key, block, size);
+        }
+
+        size_t budget = config_.budget_bytes;
+        size_t quota = Quota();
+        bool over_quota = quota != 0 && self->second.bytes + estimate > quota;
+        bool fits = budget == 0 || allocated_ + estimate <= budget;
+        if (!fits) {
+            Evict(allocated_ + estimate - budget, freed);
+            fits = allocated_ + estimate <= budget;
+        }
+
+        if (over_quota) {
+            // The quota shrinks as clients register.
+            leave_priority();
+        }
+        if (fits && !(over_quota && priority_waiters_ > 0)) {
+            leave_priority();
+            break;
+        }
+
+        // Backpressure until blocks are released.
+        if (!waited) {
+            waits_++;
+            self->second.waits++;
+            waited = true;
+        }
+
+        if (!over_quota && !priority) {
+            priority = true;
+            priority_waiters_++;
+        }
+        std::cv_status status = released_.wait_until(lk, deadline);
+
+        if (status == std::cv_status::timeout) {
+            leave_priority();
+            failures_++;
+            base::LogWarn() << "Graphic memory budget of " << budget << " bytes exhausted, "
+                            << allocated_ << " bytes allocated";
+            return nullptr;
+        }
+    }
+
+    // Reserve the estimate, the allocation itself runs without the lock.
+    allocated_ += estimate;
+    misses_++;
+    Charge(client, estimate);
+    lk.unlock();
+
+    size_t size = 0;
+    std::shared_ptr<C2GraphicBlock> block;
+    try {
+        block = allocate(size);
+    } catch (...) {
+        lk.lock();
+        allocated_ -= estimate;
+        Charge(client, estimate, false);
+        released_.notify_all();
+        throw;
+    }
+
+    lk.lock();
+    if (!block) {
+        allocated_ -= estimate;
+        Charge(client, estimate, false);
+        released_.notify_all();
+        return nullptr;
+    }
+
+    if (size == 0) {
+        size = estimate;
+    }
+    sizes_[key] = size;
+    allocated_ = allocated_ - estimate + size;
+    Charge(client, estimate, false);
+    Charge(client, size);
+    lk.unlock();
+
+    return Wrap(client, key, block, size);
+}
+
+std::shared_ptr<C2GraphicBlock> C2BufferBroker::Wrap(uint32_t client, const Key &key,
+                                                     std::shared_ptr<C2GraphicBlock> block,
+                                                     size_t size) {
+    // The handed out pointer returns the block to the cache instead of freeing it.
+    C2GraphicBlock *raw = block.get();
+    return std::shared_ptr<C2GraphicBlock>(raw, [this, client, key, block, size](C2GraphicBlock *) {
+        Release(client, key, block, size);
+    });
+}
+
+void C2BufferBroker::Release(uint32_t client, const Key &key,
+                             std::shared_ptr<C2GraphicBlock> block, size_t size) {
+    std::vector<std::shared_ptr<C2GraphicBlock>> freed;
+    std::lock_guard<std::mutex> lk(lock_);
+
+    Charge(client, size, false);
+
+    if (config_.budget_bytes != 0 && allocated_ > config_.budget_bytes) {
+        // Over budget after a reconfiguration, give the memory back.
+        allocated_ -= size;
+        evictions_++;
+        freed.push_back(std::move(block));
+    } else {
+        cache_.insert({key, {std::move(block), size, C2Stats::Now()}});
+        cached_ += size;
+    }
+
+    released_.notify_all();
+}
+
+bool C2BufferBroker::HoldUntilReleased(std::shared_ptr<C2Buffer> &buffer,
+                                       std::shared_ptr<C2GraphicBlock> block) {
+    auto holder = new std::shared_ptr<C2GraphicBlock>(std::move(block));
+    if (buffer->registerOnDestroyNotify(on_buffer_destroyed, holder) != C2_OK) {
+        base::LogError() << "Failed to track the release of a graphic buffer";
+        delete holder;
+        return false;
+    }
+    return true;
+}
+
+size_t C2BufferBroker::Trim() {
+    std::vector<std::shared_ptr<C2GraphicBlock>> freed;
+    std::lock_guard<std::mutex> lk(lock_);
+    return Evict(SIZE_MAX, freed);
+}
+
+void C2BufferBroker::GetUsage(C2BrokerUsage &usage) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    usage.budget = config_.budget_bytes;
+    usage.current = allocated_;
+    usage.peak = peak_;
+    usage.in_use = allocated_ - cached_;
+    usage.cached = cached_;
+    usage.hits = hits_;
+    usage.misses = misses_;
+    usage.evictions = evictions_;
+    usage.waits = waits_;
+    usage.failures = failures_;
+
+    usage.clients.clear();
+    for (auto &entry : clients_) {
+        usage.clients.push_back({entry.first, entry.second.name, entry.second.bytes,
+                                 entry.second.peak, Quota(), entry.second.waits});
+    }
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "c2_common.h"
+
+class C2Buffer;
+class C2GraphicBlock;
+
+struct C2BrokerConfig {
+    /// Graphic memory allowed for all engines together, in use and cached. 0 for no limit.
+    size_t budget_bytes = 0;
+    /// Cached blocks unused for longer than this are freed.
+    uint32_t idle_ms = 2000;
+    /// Longest wait for memory when over budget before the fetch fails.
+    uint32_t wait_ms = 200;
+};
+
+struct C2BrokerClientUsage {
+    uint32_t id;
+    std::string name;
+    /// Bytes of the blocks held by the client and the highest value seen.
+    size_t bytes;
+    size_t peak;
+    /// Fair share of the budget, 0 without budget.
+    size_t quota;
+    uint64_t waits;
+};
+
+/** C2BrokerUsage
+ *
+ * Graphic memory accounted by the broker, allocated bytes are the blocks in
+ * use plus the cached ones.
+ **/
+struct C2BrokerUsage {
+    size_t budget;
+    size_t current;
+    size_t peak;
+    size_t in_use;
+    size_t cached;
+    /// Fetches served from the cache and fetches which allocated.
+    uint64_t hits;
+    uint64_t misses;
+    /// Cached blocks freed to make room or because they were idle.
+    uint64_t evictions;
+    /// Fetches which waited for memory and fetches which failed after waiting.
+    uint64_t waits;
+    uint64_t failures;
+    std::vector<C2BrokerClientUsage> clients;
+};
+
+/** C2BufferBroker
+ *
+ * Process wide cache of graphic blocks shared by the engines. A block is
+ * returned to the cache when the Codec2 buffer wrapping it is destroyed, i.e.
+ * once the component is done with it, and handed to the next fetch of the
+ * same geometry and format from any engine.
+ *
+ * New allocations are charged to a global budget. When a fetch does not fit,
+ * idle cached blocks are freed first, oldest first, then the fetch waits for
+ * blocks to be released. Clients below their fair share (budget divided by the
+ * number of clients) are served before clients above it.
+ **/
+class C2BufferBroker {
+public:
+    /**
+     * @brief Allocate a new block, setting size to its allocated bytes.
+     */
+    typedef std::function<std::shared_ptr<C2GraphicBlock>(size_t &size)> Allocator;
+
+    static C2BufferBroker &Instance();
+
+    void Configure(const C2BrokerConfig &config);
+
+    /**
+     * @brief Add a client, e.g. an engine, returns its ID.
+     */
+    uint32_t Register(const std::string &name);
+    /**
+     * @brief Remove a client, blocks it still holds are cached when released.
+     */
+    void Unregister(uint32_t client);
+
+    /**
+     * @brief Get a block from the cache or allocate one within the budget.
+     * @param client: ID returned by Register().
+     * @param width: Block width in pixels.
+     * @param height: Block height in pixels.
+     * @param format: Block pixel format.
+     * @param usage: Additional allocation flags, blocks are only shared when equal.
+     * @param allocate: Called without lock when no cached block matches.
+     *
+     * @return: Empty shared pointer if no memory was available in time.
+     */
+    std::shared_ptr<C2GraphicBlock> Acquire(uint32_t client, uint32_t width, uint32_t height,
+                                            C2PixelFormat format, uint32_t usage,
+                                            const Allocator &allocate);
+
+    /**
+     * @brief Keep the block referenced until the buffer wrapping it is
+     * destroyed, so that it is not cached while the component reads it.
+     *
+     * @return: false if the release of the buffer cannot be tracked.
+     */
+    static bool HoldUntilReleased(std::shared_ptr<C2Buffer> &buffer,
+                                  std::shared_ptr<C2GraphicBlock> block);
+
+    /**
+     * @brief Free every cached block.
+     * @return: Number of bytes freed.
+     */
+    size_t Trim();
+
+    void GetUsage(C2BrokerUsage &usage);
+private:
+    struct Key {
+        uint32_t width;
+        uint32_t height;
+        C2PixelFormat format;
+        uint32_t usage;
+
+        bool operator<(const Key &other) const;
+    };
+
+    struct Cached {
+        std::shared_ptr<C2GraphicBlock> block;
+        size_t size;
+        uint64_t released;
+    };
+
+    struct Client {
+        std::string name;
+        size_t bytes;
+        size_t peak;
+        uint64_t waits;
+    };
+
+    C2BufferBroker();
+
+    std::shared_ptr<C2GraphicBlock> Wrap(uint32_t client, const Key &key,
+                                         std::shared_ptr<C2GraphicBlock> block, size_t size);
+    void Release(uint32_t client, const Key &key, std::shared_ptr<C2GraphicBlock> block,
+                 size_t size);
+    /// Add or remove bytes held by a client, updating the peaks.
+    void Charge(uint32_t client, size_t size, bool acquire = true);
+    /// Free cached blocks, oldest first, until needed bytes are freed or the
+    /// cache is empty. Blocks idle for too long are always freed.
+    size_t Evict(size_t needed, std::vector<std::shared_ptr<C2GraphicBlock>> &freed);
+    size_t Quota() const;
+
+    C2BrokerConfig config_;
+
+    std::mutex lock_;
+    std::condition_variable released_;
+    std::multimap<Key, Cached> cache_;
+    /// Allocated size of each key seen, used to check the budget before allocating.
+    std::map<Key, size_t> sizes_;
+    std::map<uint32_t, Client> clients_;
+    uint32_t next_client_;
+    /// Waiting fetches of clients below their quota, served first.
+    uint32_t priority_waiters_;
+
+    size_t allocated_;
+    size_t cached_;
+    size_t peak_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+    uint64_t waits_;
+    uint64_t failures_;
+};
@@ -0,0 +1,393 @@
+#include "c2_capabilities.h"
+
+#include <C2Config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+
+#include "base/log.h"
+#include "c2_module.h"
+
+#define CACHE_LIBRARY_SIZE 256
+#define CACHE_NAME_SIZE 64
+#define CACHE_MAX_PROFILES 16
+#define CACHE_MAX_LEVELS 32
+
+/// Start of the cache file, followed by one record per component.
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    char library[CACHE_LIBRARY_SIZE];
+};
+
+struct CacheRecord {
+    char name[CACHE_NAME_SIZE];
+    /// Minimum, maximum and step of the width, height and bitrate.
+    uint32_t width[3];
+    uint32_t height[3];
+    uint32_t bitrate[3];
+    float max_framerate;
+    uint32_t profile_count;
+    uint32_t level_count;
+    uint32_t profiles[CACHE_MAX_PROFILES];
+    uint32_t levels[CACHE_MAX_LEVELS];
+};
+
+/// Fields queried from the component, in query order.
+enum ProbedField {
+    kWidth,
+    kHeight,
+    kBitrate,
+    kFramerate,
+    kProfile,
+    kLevel,
+};
+
+static C2ValueRange to_range(const C2FieldSupportedValuesQuery &query) {
+    C2ValueRange range;
+    if (query.status != C2_OK) {
+        return range;
+    }
+
+    const C2FieldSupportedValues &values = query.values;
+    if (values.type == C2FieldSupportedValues::RANGE) {
+        range.min = values.range.min.u32;
+        range.max = values.range.max.u32;
+        range.step = values.range.step.u32;
+    } else if (values.type == C2FieldSupportedValues::VALUES && !values.values.empty()) {
+        range.min = values.values.front().u32;
+        range.max = values.values.front().u32;
+        for (const C2Value::Primitive &value : values.values) {
+            range.min = std::min(range.min, value.u32);
+            range.max = std::max(range.max, value.u32);
+        }
+    }
+    return range;
+}
+
+static std::vector<uint32_t> to_values(const C2FieldSupportedValuesQuery &query) {
+    std::vector<uint32_t> result;
+    if (query.status == C2_OK && query.values.type == C2FieldSupportedValues::VALUES) {
+        for (const C2Value::Primitive &value : query.values.values) {
+            result.push_back(value.u32);
+        }
+    }
+    return result;
+}
+
+static float max_float(const C2FieldSupportedValuesQuery &query) {
+    float result = 0;
+    if (query.status != C2_OK) {
+        return result;
+    }
+    if (query.values.type == C2FieldSupportedValues::RANGE) {
+        result = query.values.range.max.fp;
+    } else if (query.values.type == C2FieldSupportedValues::VALUES) {
+        for (const C2Value::Primitive &value : query.values.values) {
+            result = std::max(result, value.fp);
+        }
+    }
+    return result;
+}
+
+/// Reflect the supported values of the stream parameters, all in one round trip.
+static bool query_capabilities(C2Module &module, C2Capabilities &caps) {
+    C2StreamPictureSizeInfo::input size;
+    C2StreamBitrateInfo::output bitrate;
+    C2StreamFrameRateInfo::output framerate;
+    C2StreamProfileLevelInfo::output profile_level;
+
+    std::vector<C2FieldSupportedValuesQuery> fields = {
+        C2FieldSupportedValuesQuery::Possible(C2ParamField(&size, &size.width)),
+        C2FieldSupportedValuesQuery::Possible(C2ParamField(&size, &size.height)),
+        C2FieldSupportedValuesQuery::Possible(C2ParamField(&bitrate, &bitrate.value)),
+        C2FieldSupportedValuesQuery::Possible(C2ParamField(&framerate, &framerate.value)),
+        C2FieldSupportedValuesQuery::Possible(
+            C2ParamField(&profile_level, &profile_level.profile)),
+        C2FieldSupportedValuesQuery::Possible(C2ParamField(&profile_level, &profile_level.level)),
+    };
+
+    // Fields the component does not know about fail on their own, the others
+    // still carry their values.
+    c2_status_t status = module.QuerySupportedValues(fields);
+    if (status != C2_OK) {
+        base::LogDebug() << "Supported values of " << caps.name << " partially reported, error "
+                         << status;
+    }
+
+    caps.width = to_range(fields[kWidth]);
+    caps.height = to_range(fields[kHeight]);
+    caps.bitrate = to_range(fields[kBitrate]);
+    caps.max_framerate = max_float(fields[kFramerate]);
+    caps.profiles = to_values(fields[kProfile]);
+    caps.levels = to_values(fields[kLevel]);
+
+    return caps.IsReported();
+}
+
+static void store_range(const C2ValueRange &range, uint32_t (&stored)[3]) {
+    stored[0] = range.min;
+    stored[1] = range.max;
+    stored[2] = range.step;
+}
+
+static C2ValueRange load_range(const uint32_t (&stored)[3]) {
+    C2ValueRange range;
+    range.min = stored[0];
+    range.max = stored[1];
+    range.step = stored[2];
+    return range;
+}
+
+bool C2ValueRange::Contains(uint32_t value) const {
+    return value >= min && value <= max && (step <= 1 || (value - min) % step == 0);
+}
+
+bool C2Capabilities::IsReported() const {
+    return width.IsKnown() || height.IsKnown() || bitrate.IsKnown() || max_framerate > 0 ||
+           !profiles.empty() || !levels.empty();
+}
+
+C2CapabilityCache &C2CapabilityCache::Instance() {
+    static C2CapabilityCache *cache = new C2CapabilityCache();
+    return *cache;
+}
+
+C2CapabilityCache::C2CapabilityCache() : loaded_(false), probes_(0) {}
+
+void C2CapabilityCache::Configure(const C2CapabilityCacheConfig &config) {
+    std::lock_guard<std::mutex> lk(lock_);
+    config_ = config;
+    capabilities_.clear();
+    overrides_.clear();
+    version_.clear();
+    loaded_ = false;
+}
+
+std::map<std::string, C2Capabilities> &C2CapabilityCache::Entries(bool stand_in) {
+    return (stand_in && !config_.save_overrides) ? overrides_ : capabilities_;
+}
+
+bool C2CapabilityCache::Lookup(const std::string &name, C2Capabilities &caps) {
+    bool stand_in = C2Factory::HasComponentCreator();
+
+    std::lock_guard<std::mutex> lk(lock_);
+    if (!loaded_) {
+        Load();
+    }
+
+    std::map<std::string, C2Capabilities> &entries = Entries(stand_in);
+    auto it = entries.find(name);
+    if (it == entries.end()) {
+        return false;
+    }
+    caps = it->second;
+    return true;
+}
+
+bool C2CapabilityCache::Probe(const std::string &name, C2Module &module, C2Capabilities &caps) {
+    if (Lookup(name, caps)) {
+        return caps.IsReported();
+    }
+
+    // Queried without lock, the vendor stack may take a while to answer. A
+    // component reporting nothing is cached as well, so it is not queried again.
+    C2Capabilities probed;
+    probed.name = name;
+    bool reported = query_capabilities(module, probed);
+
+    // Stand-in components carry real component names, they must not end up
+    // in the cache of the real ones.
+    bool stand_in = C2Factory::HasComponentCreator();
+
+    std::lock_guard<std::mutex> lk(lock_);
+    std::map<std::string, C2Capabilities> &entries = Entries(stand_in);
+    entries[name] = probed;
+    probes_++;
+    if (&entries == &capabilities_) {
+        Save();
+    }
+
+    caps = probed;
+    if (!reported) {
+        base::LogInfo() << "Component " << name << " does not report its capabilities";
+        return false;
+    }
+
+    base::LogInfo() << "Probed capabilities of " << name << ": " << caps.width.max << "x"
+                    << caps.height.max << ", " << caps.profiles.size() << " profiles";
+    return true;
+}
+
+bool C2CapabilityCache::Probe(const std::string &name, C2ModeType mode, C2Capabilities &caps) {
+    if (Lookup(name, caps)) {
+        return caps.IsReported();
+    }
+
+    std::unique_ptr<C2Module> module;
+    try {
+        module.reset(C2Factory::GetModule(name, mode));
+    } catch (std::exception &e) {
+        base::LogError() << "Failed to create " << name << " for probing, error: " << e.what();
+        return false;
+    }
+
+    bool ok = Probe(name, *module, caps);
+    try {
+        module->Release();
+    } catch (std::exception &e) {
+        base::LogWarn() << "Failed to release probed component, error: " << e.what();
+    }
+    return ok;
+}
+
+bool C2CapabilityCache::Validate(const C2Capabilities &caps, const C2EngineConfig &config,
+                                 std::string &error) {
+    std::ostringstream reason;
+
+    if (caps.width.IsKnown() && !caps.width.Contains(config.width)) {
+        reason << "width " << config.width << " outside of " << caps.width.min << "-"
+               << caps.width.max << " step " << caps.width.step;
+    } else if (caps.height.IsKnown() && !caps.height.Contains(config.height)) {
+        reason << "height " << config.height << " outside of " << caps.height.min << "-"
+               << caps.height.max << " step " << caps.height.step;
+    } else if (config.bitrate > 0 && caps.bitrate.IsKnown() &&
+               !caps.bitrate.Contains(config.bitrate)) {
+        reason << "bitrate " << config.bitrate << " outside of " << caps.bitrate.min << "-"
+               << caps.bitrate.max;
+    } else if (caps.max_framerate > 0 && config.framerate > caps.max_framerate) {
+        reason << "frame rate " << config.framerate << " above " << caps.max_framerate;
+    }
+
+    error = reason.str();
+    return error.empty();
+}
+
+uint64_t C2CapabilityCache::GetProbes() {
+    std::lock_guard<std::mutex> lk(lock_);
+    return probes_;
+}
+
+const std::string &C2CapabilityCache::Version() {
+    if (!config_.version.empty()) {
+        return config_.version;
+    }
+    // Encoders and their capabilities come from the video store library.
+    if (version_.empty()) {
+        version_ = C2Factory::GetLibraryVersion(C2ModeType::VideoEncode);
+    }
+    return version_;
+}
+
+void C2CapabilityCache::Load() {
+    loaded_ = true;
+    if (config_.path.empty()) {
+        return;
+    }
+
+    FILE *file = fopen(config_.path.c_str(), "rb");
+    if (file == nullptr) {
+        // First start, nothing probed yet.
+        return;
+    }
+
+    CacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              header.magic == C2_CAPABILITY_CACHE_MAGIC &&
+              header.version == C2_CAPABILITY_CACHE_VERSION &&
+              header.header_size == sizeof(CacheHeader) &&
+              header.record_size == sizeof(CacheRecord);
+    header.library[CACHE_LIBRARY_SIZE - 1] = '\0';
+
+    if (ok && (Version().empty() || Version() != header.library)) {
+        base::LogInfo() << "Capability cache " << config_.path << " is for library "
+                        << header.library << ", probing again";
+        fclose(file);
+        return;
+    }
+
+    CacheRecord record;
+    while (ok && fread(&record, sizeof(record), 1, file) == 1) {
+        record.name[CACHE_NAME_SIZE - 1] = '\0';
+
+        C2Capabilities caps;
+        caps.name = record.name;
+        caps.width = load_range(record.width);
+        caps.height = load_range(record.height);
+        caps.bitrate = load_range(record.bitrate);
+        caps.max_framerate = record.max_framerate;
+        caps.profiles.assign(record.profiles,
+                             record.profiles + std::min<uint32_t>(record.profile_count,
+                                                                  CACHE_MAX_PROFILES));
+        caps.levels.assign(record.levels,
+                           record.levels + std::min<uint32_t>(record.level_count,
+                                                              CACHE_MAX_LEVELS));
+        capabilities_[caps.name] = caps;
+    }
+    fclose(file);
+
+    if (!ok) {
+        base::LogWarn() << "Capability cache " << config_.path << " is incompatible, ignored";
+        capabilities_.clear();
+    }
+}
+
+void C2CapabilityCache::Save() {
+    if (config_.path.empty() || Version().empty()) {
+        return;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = C2_CAPABILITY_CACHE_MAGIC;
+    header.version = C2_CAPABILITY_CACHE_VERSION;
+    header.header_size = sizeof(CacheHeader);
+    header.record_size = sizeof(CacheRecord);
+    strncpy(header.library, Version().c_str(), CACHE_LIBRARY_SIZE - 1);
+
+    // Written aside and renamed, so that a concurrent start never reads half a
+    // file. Each writer has its own temporary file.
+    std::string temp = config_.path + ".XXXXXX";
+    int fd = mkstemp(&temp[0]);
+    FILE *file = (fd >= 0 && fchmod(fd, 0644) == 0) ? fdopen(fd, "wb") : nullptr;
+    if (file == nullptr) {
+        base::LogWarn() << "Cannot create capability cache " << temp << ": " << strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+            unlink(temp.c_str());
+        }
+        return;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (const auto &entry : capabilities_) {
+        const C2Capabilities &caps = entry.second;
+        CacheRecord record;
+        memset(&record, 0, sizeof(record));
+        strncpy(record.name, caps.name.c_str(), CACHE_NAME_SIZE - 1);
+        store_range(caps.width, record.width);
+        store_range(caps.height, record.height);
+        store_range(caps.bitrate, record.bitrate);
+        record.max_framerate = caps.max_framerate;
+        record.profile_count = std::min<size_t>(caps.profiles.size(), CACHE_MAX_PROFILES);
+        record.level_count = std::min<size_t>(caps.levels.size(), CACHE_MAX_LEVELS);
+        std::copy_n(caps.profiles.begin(), record.profile_count, record.profiles);
+        std::copy_n(caps.levels.begin(), record.level_count, record.levels);
+        ok = ok && fwrite(&record, sizeof(record), 1, file) == 1;
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(temp.c_str(), config_.path.c_str()) != 0) {
+        base::LogWarn() << "Failed to write capability cache " << config_.path;
+        unlink(temp.c_str());
+    }
+}
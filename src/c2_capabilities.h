@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "c2_common.h"
+
+class C2Module;
+
+#define C2_CAPABILITY_CACHE_MAGIC 0x50433243u
+#define C2_CAPABILITY_CACHE_VERSION 1
+
+/** C2ValueRange
+ *
+ * Supported values of a numeric parameter field, step is the alignment
+ * required, 0 when any value in the range is accepted. An empty range (max 0)
+ * means that the component did not report the field.
+ **/
+struct C2ValueRange {
+    uint32_t min = 0;
+    uint32_t max = 0;
+    uint32_t step = 0;
+
+    bool IsKnown() const { return max != 0; }
+    bool Contains(uint32_t value) const;
+};
+
+/** C2Capabilities
+ *
+ * Stream parameters supported by a component, reflected from the supported
+ * values of its parameters.
+ **/
+struct C2Capabilities {
+    std::string name;
+    /// Picture size, the steps are the width and height alignment.
+    C2ValueRange width;
+    C2ValueRange height;
+    /// Bitrate in bits per second.
+    C2ValueRange bitrate;
+    /// Highest frame rate, 0 if not reported.
+    float max_framerate = 0;
+    /// C2Config::profile_t and C2Config::level_t values.
+    std::vector<uint32_t> profiles;
+    std::vector<uint32_t> levels;
+
+    /// Whether the component reported any of the values, components without
+    /// reflection are cached with none.
+    bool IsReported() const;
+};
+
+struct C2CapabilityCacheConfig {
+    /// File the capabilities are kept in across process starts, empty to
+    /// keep them in memory only.
+    std::string path = "/data/c2_capabilities";
+    /// Version of the component library, cached capabilities of another
+    /// version are discarded. Empty derives it from the Codec2 store library.
+    std::string version;
+    /// Save capabilities probed while a C2Factory component creator is set,
+    /// stand-in components otherwise only stay in memory.
+    bool save_overrides = false;
+};
+
+/** C2CapabilityCache
+ *
+ * Process wide cache of component capabilities. The supported values of a
+ * component are queried once per component name, in a single blocking round
+ * trip to the vendor stack, and saved to a file so that later process starts
+ * of the same library version skip probing altogether. Stand-in components
+ * created through a C2Factory creator are kept apart from the real ones.
+ **/
+class C2CapabilityCache {
+public:
+    static C2CapabilityCache &Instance();
+
+    /**
+     * @brief Apply the configuration, the capabilities in memory are dropped
+     * and the cache file is loaded again.
+     */
+    void Configure(const C2CapabilityCacheConfig &config);
+
+    /**
+     * @brief Get cached capabilities, without touching any component.
+     *
+     * @return: false if the component was never probed. A component
+     * which reported nothing is found with empty capabilities.
+     */
+    bool Lookup(const std::string &name, C2Capabilities &caps);
+
+    /**
+     * @brief Get the capabilities of a component, probing them through the
+     * module and saving them if they are not cached yet.
+     * @param name: Component name the capabilities are cached for.
+     * @param module: Module of the component, only queried on a cache miss.
+     *
+     * @return: false if the component reports none of the supported values.
+     */
+    bool Probe(const std::string &name, C2Module &module, C2Capabilities &caps);
+
+    /**
+     * @brief Get the capabilities of a component, creating a component
+     * instance to probe them on a cache miss.
+     */
+    bool Probe(const std::string &name, C2ModeType mode, C2Capabilities &caps);
+
+    /**
+     * @brief Check a stream configuration against the capabilities, fields
+     * not reported by the component are not checked.
+     * @param error: Set to the reason of a rejection.
+     *
+     * @return: true if the configuration is supported.
+     */
+    static bool Validate(const C2Capabilities &caps, const C2EngineConfig &config,
+                         std::string &error);
+
+    /**
+     * @brief Number of components probed by this process.
+     */
+    uint64_t GetProbes();
+private:
+    C2CapabilityCache();
+
+    /// Library version the capabilities are cached for, resolved on first use.
+    const std::string &Version();
+    /// Entries of the real components, or of the stand-in components kept in memory only.
+    std::map<std::string, C2Capabilities> &Entries(bool stand_in);
+    void Load();
+    void Save();
+
+    C2CapabilityCacheConfig config_;
+
+    std::mutex lock_;
+    std::map<std::string, C2Capabilities> capabilities_;
+    std::map<std::string, C2Capabilities> overrides_;
+    std::string version_;
+    bool loaded_;
+    uint64_t probes_;
+};
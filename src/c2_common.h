@@ -24,6 +24,20 @@ enum class C2PixelFormat : uint32_t {
 #endif
     /// YVU 4:2:0 Planar (YV12)
     kYV12 = 842094169,
+    /// YUV 4:2:0 Planar (I420), converted to NV12 on the input path
+    kI420 = 808596553,
+    /// YUV 4:2:2 packed 16-bit, 10 MSBs used (Y210), converted to P010 on the input path
+    kY210 = 808530521,
+    /// YUV 4:2:0 Planar 16-bit, 10 LSBs used (I010), converted to P010 on the input path
+    kI010 = 808529993,
+};
+
+/**
+ * @brief RGB to YUV conversion coefficients
+*/
+enum class C2ColorMatrix : uint32_t {
+    kBT601,
+    kBT709,
 };
 
 /**
@@ -45,7 +59,13 @@ enum class C2CodecType : uint32_t {
 enum class C2EventType : uint32_t {
     kError,
     kEOS,
-    kDrop
+    kDrop,
+    /// Static frame not submitted, payload is the frame index.
+    kSkip,
+    /// Frame dropped before submission because its deadline passed, payload is the frame index.
+    kExpired,
+    /// The oldest in-flight frame exceeded the watchdog threshold, payload is a C2StallInfo.
+    kStall
 };
 
 struct C2StreamBuffer {
@@ -55,7 +75,28 @@ struct C2StreamBuffer {
     int32_t height;
     int32_t offset[3];
     int32_t stride[3];
-    int32_t planes;  //NV12 = 2, YUV420P=3
+    int32_t planes;  //NV12 = 2, YUV420P=3, RGBA = 1
     C2PixelFormat pixel_format;
     bool isubwc;
-};
\ No newline at end of file
+    uint64_t timestamp;  // presentation timestamp in microseconds
+    C2ColorMatrix color_matrix = C2ColorMatrix::kBT601;  // used for RGBA input
+    uint64_t deadline = 0;  // latency budget mode, C2Stats::Now() in microseconds, 0 for default
+    uint64_t capture_time = 0;  // timestamp SEI, CLOCK_REALTIME microseconds, 0 for queue time
+    uint32_t flags = 0;          // C2FrameData input flags, e.g. FLAG_END_OF_STREAM
+    bool request_sync = false;   // encode this frame as a sync frame
+    uint32_t bitrate = 0;        // bitrate tuning applied from this frame on, 0 for none
+};
+
+struct C2EngineConfig {
+    uint32_t width;
+    uint32_t height;
+    float framerate;
+    uint32_t bitrate;  // bits per second, 0 keeps the component default
+    uint32_t gop;      // frames between sync frames, 0 keeps the component default
+};
+
+struct C2SliceOutputConfig {
+    bool enabled;
+    uint32_t slice_mbs;    // macroblocks per slice, 0 to use slice_bytes
+    uint32_t slice_bytes;  // bytes per slice, 0 keeps the component default
+};
@@ -0,0 +1,498 @@
+#include "c2_convert.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/** Coefficients
+ *
+ * 8-bit fixed point limited range RGB to YUV coefficients, luma is computed
+ * as ((r * R + g * G + b * B + 128) >> 8) + 16, chroma on the sum of a 2x2
+ * block as ((r * R + g * G + b * B + 512) >> 10) + 128.
+ **/
+struct Coefficients {
+    int16_t y[3];
+    int16_t u[3];
+    int16_t v[3];
+};
+
+static const Coefficients kBT601 = {{66, 129, 25}, {-38, -74, 112}, {112, -94, -18}};
+static const Coefficients kBT709 = {{47, 157, 16}, {-26, -87, 112}, {112, -102, -10}};
+
+static inline const Coefficients &coefficients(C2ColorMatrix matrix) {
+    return (matrix == C2ColorMatrix::kBT709) ? kBT709 : kBT601;
+}
+
+static inline uint8_t clamp_u8(int32_t value) {
+    return (value < 0) ? 0 : ((value > 255) ? 255 : value);
+}
+
+void C2Convert::CopyPlane(const uint8_t *src, uint32_t src_stride, uint8_t *dst,
+                          uint32_t dst_stride, uint32_t row_bytes, uint32_t rows) {
+    if (src_stride == dst_stride && row_bytes == src_stride) {
+        memcpy(dst, src, static_cast<size_t>(row_bytes) * rows);
+        return;
+    }
+
+    for (uint32_t row = 0; row < rows; row++) {
+        memcpy(dst, src, row_bytes);
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void C2Convert::InterleaveUVScalar(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                                   uint32_t v_stride, uint8_t *uv, uint32_t uv_stride,
+                                   uint32_t width, uint32_t height) {
+    for (uint32_t row = 0; row < height; row++) {
+        for (uint32_t col = 0; col < width; col++) {
+            uv[col * 2] = u[col];
+            uv[col * 2 + 1] = v[col];
+        }
+        u += u_stride;
+        v += v_stride;
+        uv += uv_stride;
+    }
+}
+
+void C2Convert::InterleaveUV(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                             uint32_t v_stride, uint8_t *uv, uint32_t uv_stride, uint32_t width,
+                             uint32_t height) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    uint32_t vector_width = width & ~15u;
+
+    for (uint32_t row = 0; row < height; row++) {
+        for (uint32_t col = 0; col < vector_width; col += 16) {
+#if defined(__SSE2__)
+            __m128i us = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + col));
+            __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + col));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(uv + col * 2), _mm_unpacklo_epi8(us, vs));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(uv + col * 2 + 16),
+                             _mm_unpackhi_epi8(us, vs));
+#else
+            uint8x16x2_t pair = {{vld1q_u8(u + col), vld1q_u8(v + col)}};
+            vst2q_u8(uv + col * 2, pair);
+#endif
+        }
+
+        // Remaining columns.
+        InterleaveUVScalar(u + vector_width, u_stride, v + vector_width, v_stride,
+                           uv + vector_width * 2, uv_stride, width - vector_width, 1);
+
+        u += u_stride;
+        v += v_stride;
+        uv += uv_stride;
+    }
+#else
+    InterleaveUVScalar(u, u_stride, v, v_stride, uv, uv_stride, width, height);
+#endif
+}
+
+// Convert the pixel pairs [first, last) of a row pair, also used for the tails.
+static void rgba_to_nv12_span(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1,
+                              uint8_t *uv, uint32_t first, uint32_t last,
+                              const Coefficients &c) {
+    for (uint32_t col = first; col < last; col += 2) {
+        int32_t r = 0, g = 0, b = 0;
+
+        for (uint32_t idx = 0; idx < 4; idx++) {
+            const uint8_t *px = ((idx < 2) ? row0 : row1) + (col + (idx & 1)) * 4;
+            uint8_t *luma = ((idx < 2) ? y0 : y1) + col + (idx & 1);
+
+            *luma = ((c.y[0] * px[0] + c.y[1] * px[1] + c.y[2] * px[2] + 128) >> 8) + 16;
+            r += px[0];
+            g += px[1];
+            b += px[2];
+        }
+
+        uv[col] = clamp_u8(((c.u[0] * r + c.u[1] * g + c.u[2] * b + 512) >> 10) + 128);
+        uv[col + 1] = clamp_u8(((c.v[0] * r + c.v[1] * g + c.v[2] * b + 512) >> 10) + 128);
+    }
+}
+
+void C2Convert::RGBAToNV12Scalar(const uint8_t *rgba, uint32_t rgba_stride, uint8_t *y,
+                                 uint32_t y_stride, uint8_t *uv, uint32_t uv_stride,
+                                 uint32_t width, uint32_t height, C2ColorMatrix matrix) {
+    const Coefficients &c = coefficients(matrix);
+
+    for (uint32_t row = 0; row + 1 < height; row += 2) {
+        rgba_to_nv12_span(rgba, rgba + rgba_stride, y, y + y_stride, uv, 0, width & ~1u, c);
+
+        rgba += rgba_stride * 2;
+        y += y_stride * 2;
+        uv += uv_stride;
+    }
+}
+
+#if defined(__SSE2__)
+// Sum the adjacent 32-bit lanes of madd results and gather lanes 0 and 2.
+static inline __m128i sse2_pair_sums(__m128i lo, __m128i hi) {
+    lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+    hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+    lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0));
+    hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+// Luma of 4 RGBA pixels as 32-bit lanes.
+static inline __m128i sse2_luma4(__m128i px, __m128i coef) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = sse2_pair_sums(_mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coef),
+                                  _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coef));
+    sums = _mm_srai_epi32(_mm_add_epi32(sums, _mm_set1_epi32(128)), 8);
+    return _mm_add_epi32(sums, _mm_set1_epi32(16));
+}
+
+// Interleaved U/V of the two 2x2 blocks covered by 4 pixels of 2 rows.
+static inline __m128i sse2_chroma4(__m128i px0, __m128i px1, __m128i ucoef, __m128i vcoef) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(px0, zero), _mm_unpacklo_epi8(px1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(px0, zero), _mm_unpackhi_epi8(px1, zero));
+
+    // Horizontal neighbours: [R G B A] sums of block 0 and block 1.
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    __m128i blocks = _mm_unpacklo_epi64(lo, hi);
+
+    const __m128i round = _mm_set1_epi32(512);
+    const __m128i offset = _mm_set1_epi32(128);
+
+    __m128i u = _mm_madd_epi16(blocks, ucoef);
+    __m128i v = _mm_madd_epi16(blocks, vcoef);
+    u = _mm_add_epi32(u, _mm_srli_epi64(u, 32));
+    v = _mm_add_epi32(v, _mm_srli_epi64(v, 32));
+    u = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(u, round), 10), offset);
+    v = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(v, round), 10), offset);
+
+    // Lanes 0 and 2 hold the values: [u0 v0 u1 v1].
+    u = _mm_shuffle_epi32(u, _MM_SHUFFLE(3, 1, 2, 0));
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_unpacklo_epi32(u, v);
+}
+#endif  // __SSE2__
+
+void C2Convert::RGBAToNV12(const uint8_t *rgba, uint32_t rgba_stride, uint8_t *y,
+                           uint32_t y_stride, uint8_t *uv, uint32_t uv_stride, uint32_t width,
+                           uint32_t height, C2ColorMatrix matrix) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    const Coefficients &c = coefficients(matrix);
+    uint32_t vector_width = width & ~15u;
+
+#if defined(__SSE2__)
+    const __m128i ycoef = _mm_setr_epi16(c.y[0], c.y[1], c.y[2], 0, c.y[0], c.y[1], c.y[2], 0);
+    const __m128i ucoef = _mm_setr_epi16(c.u[0], c.u[1], c.u[2], 0, c.u[0], c.u[1], c.u[2], 0);
+    const __m128i vcoef = _mm_setr_epi16(c.v[0], c.v[1], c.v[2], 0, c.v[0], c.v[1], c.v[2], 0);
+#else
+    const uint8x8_t yr = vdup_n_u8(c.y[0]);
+    const uint8x8_t yg = vdup_n_u8(c.y[1]);
+    const uint8x8_t yb = vdup_n_u8(c.y[2]);
+#endif
+
+    for (uint32_t row = 0; row + 1 < height; row += 2) {
+        const uint8_t *row0 = rgba;
+        const uint8_t *row1 = rgba + rgba_stride;
+        uint8_t *y0 = y;
+        uint8_t *y1 = y + y_stride;
+
+        for (uint32_t col = 0; col < vector_width; col += 16) {
+#if defined(__SSE2__)
+            __m128i px0[4], px1[4];
+            for (uint32_t idx = 0; idx < 4; idx++) {
+                px0[idx] = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(row0 + (col + idx * 4) * 4));
+                px1[idx] = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(row1 + (col + idx * 4) * 4));
+            }
+
+            __m128i luma0 = _mm_packs_epi32(sse2_luma4(px0[0], ycoef), sse2_luma4(px0[1], ycoef));
+            __m128i luma1 = _mm_packs_epi32(sse2_luma4(px0[2], ycoef), sse2_luma4(px0[3], ycoef));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(y0 + col), _mm_packus_epi16(luma0, luma1));
+
+            luma0 = _mm_packs_epi32(sse2_luma4(px1[0], ycoef), sse2_luma4(px1[1], ycoef));
+            luma1 = _mm_packs_epi32(sse2_luma4(px1[2], ycoef), sse2_luma4(px1[3], ycoef));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(y1 + col), _mm_packus_epi16(luma0, luma1));
+
+            __m128i chroma0 = _mm_packs_epi32(sse2_chroma4(px0[0], px1[0], ucoef, vcoef),
+                                              sse2_chroma4(px0[1], px1[1], ucoef, vcoef));
+            __m128i chroma1 = _mm_packs_epi32(sse2_chroma4(px0[2], px1[2], ucoef, vcoef),
+                                              sse2_chroma4(px0[3], px1[3], ucoef, vcoef));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(uv + col),
+                             _mm_packus_epi16(chroma0, chroma1));
+#else
+            uint8x16x4_t px0 = vld4q_u8(row0 + col * 4);
+            uint8x16x4_t px1 = vld4q_u8(row1 + col * 4);
+
+            for (uint32_t line = 0; line < 2; line++) {
+                const uint8x16x4_t &px = (line == 0) ? px0 : px1;
+                uint8_t *luma = (line == 0) ? y0 : y1;
+
+                uint16x8_t lo = vmull_u8(vget_low_u8(px.val[0]), yr);
+                lo = vmlal_u8(lo, vget_low_u8(px.val[1]), yg);
+                lo = vmlal_u8(lo, vget_low_u8(px.val[2]), yb);
+                uint16x8_t hi = vmull_u8(vget_high_u8(px.val[0]), yr);
+                hi = vmlal_u8(hi, vget_high_u8(px.val[1]), yg);
+                hi = vmlal_u8(hi, vget_high_u8(px.val[2]), yb);
+
+                // (sum + 128) >> 8, then the +16 offset.
+                uint8x16_t result = vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8));
+                vst1q_u8(luma + col, vaddq_u8(result, vdupq_n_u8(16)));
+            }
+
+            // 2x2 sums of each channel, 8 blocks.
+            int16x8_t sum[3];
+            for (uint32_t ch = 0; ch < 3; ch++) {
+                uint16x8_t pairs = vpaddlq_u8(px0.val[ch]);
+                sum[ch] = vreinterpretq_s16_u16(vpadalq_u8(pairs, px1.val[ch]));
+            }
+
+            int16x8_t chroma[2];
+            for (uint32_t plane = 0; plane < 2; plane++) {
+                const int16_t *k = (plane == 0) ? c.u : c.v;
+
+                int32x4_t lo = vmull_n_s16(vget_low_s16(sum[0]), k[0]);
+                lo = vmlal_n_s16(lo, vget_low_s16(sum[1]), k[1]);
+                lo = vmlal_n_s16(lo, vget_low_s16(sum[2]), k[2]);
+                int32x4_t hi = vmull_n_s16(vget_high_s16(sum[0]), k[0]);
+                hi = vmlal_n_s16(hi, vget_high_s16(sum[1]), k[1]);
+                hi = vmlal_n_s16(hi, vget_high_s16(sum[2]), k[2]);
+
+                // (sum + 512) >> 10, then the +128 offset.
+                chroma[plane] = vaddq_s16(vcombine_s16(vrshrn_n_s32(lo, 10), vrshrn_n_s32(hi, 10)),
+                                          vdupq_n_s16(128));
+            }
+
+            uint8x8x2_t pair = {{vqmovun_s16(chroma[0]), vqmovun_s16(chroma[1])}};
+            vst2_u8(uv + col, pair);
+#endif
+        }
+
+        // Remaining columns.
+        rgba_to_nv12_span(row0, row1, y0, y1, uv, vector_width, width & ~1u, c);
+
+        rgba += rgba_stride * 2;
+        y += y_stride * 2;
+        uv += uv_stride;
+    }
+#else
+    RGBAToNV12Scalar(rgba, rgba_stride, y, y_stride, uv, uv_stride, width, height, matrix);
+#endif
+}
+
+// 10-bit samples in the low bits of 16-bit words are moved to the high bits.
+#define P010_SHIFT 6
+
+static inline const uint16_t *row16(const uint8_t *base, uint32_t stride, uint32_t row) {
+    return reinterpret_cast<const uint16_t *>(base + static_cast<size_t>(stride) * row);
+}
+
+static inline uint16_t *row16(uint8_t *base, uint32_t stride, uint32_t row) {
+    return reinterpret_cast<uint16_t *>(base + static_cast<size_t>(stride) * row);
+}
+
+// Rounded average of two P010 samples at 10-bit precision.
+static inline uint16_t average10(uint16_t a, uint16_t b) {
+    return (((a >> P010_SHIFT) + (b >> P010_SHIFT) + 1) >> 1) << P010_SHIFT;
+}
+
+void C2Convert::ShiftPlane10Scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst,
+                                   uint32_t dst_stride, uint32_t width, uint32_t rows) {
+    for (uint32_t row = 0; row < rows; row++) {
+        const uint16_t *in = row16(src, src_stride, row);
+        uint16_t *out = row16(dst, dst_stride, row);
+
+        for (uint32_t col = 0; col < width; col++) {
+            out[col] = in[col] << P010_SHIFT;
+        }
+    }
+}
+
+void C2Convert::ShiftPlane10(const uint8_t *src, uint32_t src_stride, uint8_t *dst,
+                             uint32_t dst_stride, uint32_t width, uint32_t rows) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    uint32_t vector_width = width & ~7u;
+
+    for (uint32_t row = 0; row < rows; row++) {
+        const uint16_t *in = row16(src, src_stride, row);
+        uint16_t *out = row16(dst, dst_stride, row);
+
+        for (uint32_t col = 0; col < vector_width; col += 8) {
+#if defined(__SSE2__)
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + col));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + col),
+                             _mm_slli_epi16(value, P010_SHIFT));
+#else
+            vst1q_u16(out + col, vshlq_n_u16(vld1q_u16(in + col), P010_SHIFT));
+#endif
+        }
+
+        // Remaining columns.
+        for (uint32_t col = vector_width; col < width; col++) {
+            out[col] = in[col] << P010_SHIFT;
+        }
+    }
+#else
+    ShiftPlane10Scalar(src, src_stride, dst, dst_stride, width, rows);
+#endif
+}
+
+void C2Convert::InterleaveUV10Scalar(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                                     uint32_t v_stride, uint8_t *uv, uint32_t uv_stride,
+                                     uint32_t width, uint32_t height) {
+    for (uint32_t row = 0; row < height; row++) {
+        const uint16_t *us = row16(u, u_stride, row);
+        const uint16_t *vs = row16(v, v_stride, row);
+        uint16_t *out = row16(uv, uv_stride, row);
+
+        for (uint32_t col = 0; col < width; col++) {
+            out[col * 2] = us[col] << P010_SHIFT;
+            out[col * 2 + 1] = vs[col] << P010_SHIFT;
+        }
+    }
+}
+
+void C2Convert::InterleaveUV10(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                               uint32_t v_stride, uint8_t *uv, uint32_t uv_stride,
+                               uint32_t width, uint32_t height) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    uint32_t vector_width = width & ~7u;
+
+    for (uint32_t row = 0; row < height; row++) {
+        const uint16_t *us = row16(u, u_stride, row);
+        const uint16_t *vs = row16(v, v_stride, row);
+        uint16_t *out = row16(uv, uv_stride, row);
+
+        for (uint32_t col = 0; col < vector_width; col += 8) {
+#if defined(__SSE2__)
+            __m128i ul = _mm_slli_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(us + col)), P010_SHIFT);
+            __m128i vl = _mm_slli_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(vs + col)), P010_SHIFT);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + col * 2),
+                             _mm_unpacklo_epi16(ul, vl));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + col * 2 + 8),
+                             _mm_unpackhi_epi16(ul, vl));
+#else
+            uint16x8x2_t pair = {{vshlq_n_u16(vld1q_u16(us + col), P010_SHIFT),
+                                  vshlq_n_u16(vld1q_u16(vs + col), P010_SHIFT)}};
+            vst2q_u16(out + col * 2, pair);
+#endif
+        }
+
+        // Remaining columns.
+        for (uint32_t col = vector_width; col < width; col++) {
+            out[col * 2] = us[col] << P010_SHIFT;
+            out[col * 2 + 1] = vs[col] << P010_SHIFT;
+        }
+    }
+#else
+    InterleaveUV10Scalar(u, u_stride, v, v_stride, uv, uv_stride, width, height);
+#endif
+}
+
+// Convert the pixel pairs [first, last) of a Y210 row pair, also used for the tails.
+static void y210_to_p010_span(const uint16_t *row0, const uint16_t *row1, uint16_t *y0,
+                              uint16_t *y1, uint16_t *uv, uint32_t first, uint32_t last) {
+    for (uint32_t col = first; col < last; col += 2) {
+        // Y210 pixel pairs are stored as Y0 U Y1 V.
+        const uint16_t *px0 = row0 + col * 2;
+        const uint16_t *px1 = row1 + col * 2;
+
+        y0[col] = px0[0];
+        y0[col + 1] = px0[2];
+        y1[col] = px1[0];
+        y1[col + 1] = px1[2];
+        uv[col] = average10(px0[1], px1[1]);
+        uv[col + 1] = average10(px0[3], px1[3]);
+    }
+}
+
+void C2Convert::Y210ToP010Scalar(const uint8_t *src, uint32_t src_stride, uint8_t *y,
+                                 uint32_t y_stride, uint8_t *uv, uint32_t uv_stride,
+                                 uint32_t width, uint32_t height) {
+    for (uint32_t row = 0; row + 1 < height; row += 2) {
+        y210_to_p010_span(row16(src, src_stride, row), row16(src, src_stride, row + 1),
+                          row16(y, y_stride, row), row16(y, y_stride, row + 1),
+                          row16(uv, uv_stride, row / 2), 0, width & ~1u);
+    }
+}
+
+#if defined(__SSE2__)
+// Even 16-bit lanes of two vectors, sign extension keeps packs from saturating.
+static inline __m128i sse2_even16(__m128i a, __m128i b) {
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                           _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+// Odd 16-bit lanes of two vectors.
+static inline __m128i sse2_odd16(__m128i a, __m128i b) {
+    return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+static inline __m128i sse2_average10(__m128i a, __m128i b) {
+    __m128i average = _mm_avg_epu16(_mm_srli_epi16(a, P010_SHIFT), _mm_srli_epi16(b, P010_SHIFT));
+    return _mm_slli_epi16(average, P010_SHIFT);
+}
+#endif  // __SSE2__
+
+void C2Convert::Y210ToP010(const uint8_t *src, uint32_t src_stride, uint8_t *y,
+                           uint32_t y_stride, uint8_t *uv, uint32_t uv_stride, uint32_t width,
+                           uint32_t height) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    uint32_t vector_width = width & ~15u;
+
+    for (uint32_t row = 0; row + 1 < height; row += 2) {
+        const uint16_t *row0 = row16(src, src_stride, row);
+        const uint16_t *row1 = row16(src, src_stride, row + 1);
+        uint16_t *y0 = row16(y, y_stride, row);
+        uint16_t *y1 = row16(y, y_stride, row + 1);
+        uint16_t *out = row16(uv, uv_stride, row / 2);
+
+        for (uint32_t col = 0; col < vector_width; col += 16) {
+#if defined(__SSE2__)
+            // Two steps of 8 pixels, each 2 vectors of Y0 U Y1 V per row.
+            for (uint32_t half = 0; half < 16; half += 8) {
+                const __m128i *in0 = reinterpret_cast<const __m128i *>(row0 + (col + half) * 2);
+                const __m128i *in1 = reinterpret_cast<const __m128i *>(row1 + (col + half) * 2);
+                __m128i a0 = _mm_loadu_si128(in0);
+                __m128i b0 = _mm_loadu_si128(in0 + 1);
+                __m128i a1 = _mm_loadu_si128(in1);
+                __m128i b1 = _mm_loadu_si128(in1 + 1);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(y0 + col + half),
+                                 sse2_even16(a0, b0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(y1 + col + half),
+                                 sse2_even16(a1, b1));
+                // Odd lanes are already interleaved as U V.
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + col + half),
+                                 sse2_average10(sse2_odd16(a0, b0), sse2_odd16(a1, b1)));
+            }
+#else
+            uint16x8x4_t px0 = vld4q_u16(row0 + col * 2);
+            uint16x8x4_t px1 = vld4q_u16(row1 + col * 2);
+
+            uint16x8x2_t luma0 = {{px0.val[0], px0.val[2]}};
+            uint16x8x2_t luma1 = {{px1.val[0], px1.val[2]}};
+            vst2q_u16(y0 + col, luma0);
+            vst2q_u16(y1 + col, luma1);
+
+            uint16x8x2_t chroma;
+            for (uint32_t plane = 0; plane < 2; plane++) {
+                uint16x8_t a = vshrq_n_u16(px0.val[plane * 2 + 1], P010_SHIFT);
+                uint16x8_t b = vshrq_n_u16(px1.val[plane * 2 + 1], P010_SHIFT);
+                chroma.val[plane] = vshlq_n_u16(vrhaddq_u16(a, b), P010_SHIFT);
+            }
+            vst2q_u16(out + col, chroma);
+#endif
+        }
+
+        // Remaining columns.
+        y210_to_p010_span(row0, row1, y0, y1, out, vector_width, width & ~1u);
+    }
+#else
+    Y210ToP010Scalar(src, src_stride, y, y_stride, uv, uv_stride, width, height);
+#endif
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "c2_common.h"
+
+/** C2Convert
+ *
+ * Pixel format converters writing NV12 or Venus P010 straight into a mapped
+ * graphic block. Strides are in bytes, widths and heights in samples.
+ * Each converter has a vectorized implementation (SSE2 or NEON) and a scalar
+ * reference producing bit-exact identical output.
+ **/
+class C2Convert {
+public:
+    /**
+     * @brief Copy a plane row by row.
+     * @param row_bytes: Number of bytes copied from each row.
+     */
+    static void CopyPlane(const uint8_t *src, uint32_t src_stride, uint8_t *dst,
+                          uint32_t dst_stride, uint32_t row_bytes, uint32_t rows);
+
+    /**
+     * @brief Interleave separate U and V planes into an NV12 UV plane.
+     * @param width: Chroma width in samples.
+     * @param height: Chroma height in rows.
+     */
+    static void InterleaveUV(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                             uint32_t v_stride, uint8_t *uv, uint32_t uv_stride, uint32_t width,
+                             uint32_t height);
+    static void InterleaveUVScalar(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                                   uint32_t v_stride, uint8_t *uv, uint32_t uv_stride,
+                                   uint32_t width, uint32_t height);
+
+    /**
+     * @brief Convert RGBA to limited range NV12, chroma is the 2x2 average.
+     * @param width: Luma width, must be even.
+     * @param height: Luma height, must be even.
+     * @param matrix: BT.601 or BT.709 coefficients.
+     */
+    static void RGBAToNV12(const uint8_t *rgba, uint32_t rgba_stride, uint8_t *y,
+                           uint32_t y_stride, uint8_t *uv, uint32_t uv_stride, uint32_t width,
+                           uint32_t height, C2ColorMatrix matrix);
+    static void RGBAToNV12Scalar(const uint8_t *rgba, uint32_t rgba_stride, uint8_t *y,
+                                 uint32_t y_stride, uint8_t *uv, uint32_t uv_stride,
+                                 uint32_t width, uint32_t height, C2ColorMatrix matrix);
+
+    /**
+     * @brief Move 10-bit samples stored in the low bits of 16-bit words to the
+     *        high bits, as used by P010.
+     * @param width: Samples per row.
+     */
+    static void ShiftPlane10(const uint8_t *src, uint32_t src_stride, uint8_t *dst,
+                             uint32_t dst_stride, uint32_t width, uint32_t rows);
+    static void ShiftPlane10Scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst,
+                                   uint32_t dst_stride, uint32_t width, uint32_t rows);
+
+    /**
+     * @brief Interleave separate 16-bit U and V planes with 10 low bits used
+     *        into a P010 UV plane.
+     * @param width: Chroma width in samples.
+     * @param height: Chroma height in rows.
+     */
+    static void InterleaveUV10(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                               uint32_t v_stride, uint8_t *uv, uint32_t uv_stride,
+                               uint32_t width, uint32_t height);
+    static void InterleaveUV10Scalar(const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                                     uint32_t v_stride, uint8_t *uv, uint32_t uv_stride,
+                                     uint32_t width, uint32_t height);
+
+    /**
+     * @brief Convert packed 4:2:2 Y210 to P010, chroma is the rounded average
+     *        of each pair of rows at 10-bit precision.
+     * @param width: Luma width, must be even.
+     * @param height: Luma height, must be even.
+     */
+    static void Y210ToP010(const uint8_t *src, uint32_t src_stride, uint8_t *y,
+                           uint32_t y_stride, uint8_t *uv, uint32_t uv_stride, uint32_t width,
+                           uint32_t height);
+    static void Y210ToP010Scalar(const uint8_t *src, uint32_t src_stride, uint8_t *y,
+                                 uint32_t y_stride, uint8_t *uv, uint32_t uv_stride,
+                                 uint32_t width, uint32_t height);
+};
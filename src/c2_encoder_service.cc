@@ -0,0 +1,477 @@
+#include "c2_encoder_service.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+
+#include "base/log.h"
+#include "c2_engine.h"
+#include "c2_frame_source.h"
+
+#define MAX_SESSION_SLOTS 64
+#define MAX_FRAME_DIMENSION 8192
+#define SLOT_ALIGNMENT 4096
+#define LISTEN_BACKLOG 16
+
+static uint32_t align_slot(uint32_t size) {
+    return (size + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1);
+}
+
+static bool is_supported_format(C2PixelFormat format) {
+    switch (format) {
+        case C2PixelFormat::kNV12:
+        case C2PixelFormat::kI420:
+        case C2PixelFormat::kYV12:
+        case C2PixelFormat::kRGBA:
+        case C2PixelFormat::kP010:
+        case C2PixelFormat::kI010:
+        case C2PixelFormat::kY210:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** C2ServiceSession
+ *
+ * One client connection, served from its own thread: the engine of the
+ * session reads the frames from the input ring and writes the encoded output
+ * into the output ring.
+ **/
+class C2ServiceSession {
+public:
+    C2ServiceSession(const C2EncoderServiceConfig &config, int fd, uint32_t id, bool admitted)
+        : config_(config),
+          channel_(fd),
+          id_(id),
+          admitted_(admitted),
+          engine_(nullptr),
+          queued_(0),
+          closing_(false),
+          done_(false) {
+        thread_ = std::thread(&C2ServiceSession::Run, this);
+    }
+
+    ~C2ServiceSession() { Join(); }
+
+    void Shutdown() { channel_.Shutdown(); }
+
+    void Join() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    bool IsDone() const { return done_; }
+    bool IsAdmitted() const { return admitted_; }
+
+    /**
+     * @brief Copy an encoded frame into a free output slot and announce it,
+     * called from the component callback thread.
+     */
+    void Deliver(const C2EncodedFrame &frame) {
+        C2ServiceMessage message = {};
+        message.command = C2ServiceCommand::kFrame;
+        message.index = frame.index;
+        message.timestamp = frame.timestamp;
+        message.flags = frame.flags;
+        message.sync = frame.au.is_sync;
+        message.size = frame.size + frame.sei_size;
+
+        if (message.size > output_.GetSlotSize()) {
+            base::LogWarn() << "Session " << id_ << ": frame " << frame.index << " of "
+                            << message.size << " bytes exceeds the output slots, dropped";
+            Drop(message);
+            return;
+        }
+
+        // Backpressure on the encoder while the client holds every slot.
+        uint32_t slot;
+        {
+            std::unique_lock<std::mutex> lk(lock_);
+            released_.wait_for(lk, std::chrono::milliseconds(config_.output_wait_ms),
+                               [this] { return !free_outputs_.empty() || closing_; });
+            if (free_outputs_.empty() || closing_) {
+                lk.unlock();
+                base::LogWarn() << "Session " << id_ << ": no output slot released, frame "
+                                << frame.index << " dropped";
+                Drop(message);
+                return;
+            }
+            slot = free_outputs_.front();
+            free_outputs_.pop_front();
+        }
+
+        uint8_t *out = output_.GetSlot(slot);
+        if (frame.sei_size != 0) {
+            memcpy(out, frame.data, frame.sei_offset);
+            memcpy(out + frame.sei_offset, frame.sei, frame.sei_size);
+            memcpy(out + frame.sei_offset + frame.sei_size, frame.data + frame.sei_offset,
+                   frame.size - frame.sei_offset);
+        } else {
+            memcpy(out, frame.data, frame.size);
+        }
+
+        message.slot = slot;
+        channel_.Send(message);
+    }
+private:
+    /** SessionSink
+     *
+     * Forwards the engine output to the session, which outlives the engine.
+     **/
+    class SessionSink : public IC2OutputSink {
+    public:
+        explicit SessionSink(C2ServiceSession *session) : session_(session) {}
+        void OnFrame(const C2EncodedFrame &frame) override { session_->Deliver(frame); }
+    private:
+        C2ServiceSession *session_;
+    };
+
+    void Run() {
+        C2ServiceMessage message;
+        std::vector<int> fds;
+
+        if (channel_.Receive(message, fds) && message.command == C2ServiceCommand::kOpen) {
+            CloseFds(fds);
+            if (!admitted_) {
+                base::LogWarn() << "Session " << id_ << " rejected, " << config_.max_sessions
+                                << " sessions in use";
+                Reply(C2ServiceCommand::kError, kServiceBusy);
+            } else if (Open(message.session)) {
+                Serve();
+            }
+        } else {
+            CloseFds(fds);
+        }
+
+        Close();
+        done_ = true;
+    }
+
+    bool Open(C2ServiceSessionConfig &session) {
+        const C2EngineConfig &engine = session.engine;
+        if (engine.width == 0 || engine.height == 0 || engine.width > MAX_FRAME_DIMENSION ||
+            engine.height > MAX_FRAME_DIMENSION || ((engine.width | engine.height) & 1) ||
+            session.input_slots == 0 || session.input_slots > MAX_SESSION_SLOTS ||
+            session.output_slots == 0 || session.output_slots > MAX_SESSION_SLOTS ||
+            session.codec > C2CodecType::HEICVideoEncode ||
+            !is_supported_format(session.pixel_format)) {
+            base::LogError() << "Session " << id_ << ": invalid configuration "
+                             << engine.width << "x" << engine.height << ", "
+                             << session.input_slots << "/" << session.output_slots << " slots";
+            Reply(C2ServiceCommand::kError, kServiceInvalid);
+            return false;
+        }
+
+        uint32_t frame_size =
+            C2FrameSource::GetFrameSize(session.pixel_format, engine.width, engine.height);
+        session.input_slot_size = align_slot(frame_size);
+        session.output_slot_size = align_slot(
+            (session.output_slot_size != 0) ? session.output_slot_size : frame_size / 2);
+
+        if (!input_.Create("c2_service_input", session.input_slots, session.input_slot_size) ||
+            !output_.Create("c2_service_output", session.output_slots,
+                            session.output_slot_size)) {
+            Reply(C2ServiceCommand::kError, kServiceEngine);
+            return false;
+        }
+        for (uint32_t slot = 0; slot < session.output_slots; slot++) {
+            free_outputs_.push_back(slot);
+        }
+
+        engine_ = C2Engine::new_c2_engine(C2ModeType::VideoEncode, session.codec);
+        if (engine_ == nullptr) {
+            Reply(C2ServiceCommand::kError, kServiceEngine);
+            return false;
+        }
+        engine_->c2_engine_add_sink(std::make_shared<SessionSink>(this));
+        if (!engine_->c2_engine_configure(engine) || !engine_->start_c2_engine()) {
+            base::LogError() << "Session " << id_ << ": failed to start the encoder";
+            Reply(C2ServiceCommand::kError, kServiceEngine);
+            return false;
+        }
+        session_ = session;
+
+        C2ServiceMessage reply = {};
+        reply.command = C2ServiceCommand::kOpened;
+        reply.session = session;
+        if (!channel_.Send(reply, {input_.GetFd(), output_.GetFd()})) {
+            return false;
+        }
+
+        base::LogInfo() << "Session " << id_ << " opened: " << engine.width << "x"
+                        << engine.height << ", " << session.input_slots << " input slots of "
+                        << session.input_slot_size << " bytes, " << session.output_slots
+                        << " output slots of " << session.output_slot_size << " bytes";
+        return true;
+    }
+
+    void Serve() {
+        C2ServiceMessage message;
+        std::vector<int> fds;
+
+        while (channel_.Receive(message, fds)) {
+            CloseFds(fds);
+
+            switch (message.command) {
+                case C2ServiceCommand::kQueue:
+                    Queue(message);
+                    break;
+                case C2ServiceCommand::kRelease:
+                    Release(message.slot);
+                    break;
+                case C2ServiceCommand::kEndOfStream:
+                    Drain();
+                    break;
+                default:
+                    base::LogError() << "Session " << id_ << ": unexpected command "
+                                     << static_cast<uint32_t>(message.command);
+                    Reply(C2ServiceCommand::kError, kServiceInvalid);
+                    return;
+            }
+        }
+    }
+
+    void Queue(const C2ServiceMessage &message) {
+        C2ServiceMessage reply = {};
+        reply.command = C2ServiceCommand::kQueued;
+        reply.slot = message.slot;
+        reply.index = queued_;
+        reply.timestamp = message.timestamp;
+
+        if (message.slot >= input_.GetSlots()) {
+            reply.status = kServiceInvalid;
+        } else {
+            // The engine copies the frame into its own block, the slot is free on return.
+            C2StreamBuffer buffer = {};
+            C2FrameSource::DescribeFrame(input_.GetSlot(message.slot), session_.pixel_format,
+                                         session_.engine.width, session_.engine.height, buffer);
+            buffer.timestamp = message.timestamp;
+            reply.status = engine_->c2_engine_queue_buffer(&buffer) ? kServiceOk : kServiceEngine;
+            queued_++;
+        }
+
+        channel_.Send(reply);
+    }
+
+    /**
+     * @brief Announce the end of the stream once the pending frames are out,
+     * waiting aside so that output slots keep being released meanwhile.
+     */
+    void Drain() {
+        if (drain_.joinable()) {
+            drain_.join();
+        }
+        drain_ = std::thread([this] {
+            bool drained = engine_->c2_engine_wait_pending(0, config_.drain_timeout_ms);
+            Reply(C2ServiceCommand::kEndOfStream, drained ? kServiceOk : kServiceEngine);
+        });
+    }
+
+    void Release(uint32_t slot) {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (slot < output_.GetSlots() &&
+            std::find(free_outputs_.begin(), free_outputs_.end(), slot) == free_outputs_.end()) {
+            free_outputs_.push_back(slot);
+            released_.notify_all();
+        }
+    }
+
+    void Drop(C2ServiceMessage &message) {
+        message.slot = 0;
+        message.size = 0;
+        message.status = kServiceOverflow;
+        channel_.Send(message);
+    }
+
+    void Reply(C2ServiceCommand command, int32_t status) {
+        C2ServiceMessage reply = {};
+        reply.command = command;
+        reply.status = status;
+        channel_.Send(reply);
+    }
+
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lk(lock_);
+            closing_ = true;
+            released_.notify_all();
+        }
+        if (drain_.joinable()) {
+            drain_.join();
+        }
+
+        if (engine_ != nullptr) {
+            engine_->stop_c2_engine();
+            C2Engine::free_c2_engine(engine_);
+            engine_ = nullptr;
+            base::LogInfo() << "Session " << id_ << " closed after " << queued_ << " frames";
+        }
+        input_.Close();
+        output_.Close();
+    }
+
+    static void CloseFds(std::vector<int> &fds) {
+        for (int fd : fds) {
+            close(fd);
+        }
+        fds.clear();
+    }
+
+    const C2EncoderServiceConfig &config_;
+    C2ServiceChannel channel_;
+    uint32_t id_;
+    bool admitted_;
+
+    C2ServiceSessionConfig session_;
+    C2Engine *engine_;
+    C2SharedRing input_;
+    C2SharedRing output_;
+    uint64_t queued_;
+
+    std::mutex lock_;
+    std::condition_variable released_;
+    std::deque<uint32_t> free_outputs_;
+    bool closing_;
+
+    std::thread drain_;
+
+    std::atomic<bool> done_;
+    std::thread thread_;
+};
+
+C2EncoderService::C2EncoderService(const C2EncoderServiceConfig &config)
+    : config_(config), listen_fd_(-1), wakeup_fd_(-1) {}
+
+C2EncoderService::~C2EncoderService() {
+    Stop();
+}
+
+bool C2EncoderService::Start() {
+    struct sockaddr_un addr = {};
+    if (config_.socket_path.size() >= sizeof(addr.sun_path)) {
+        base::LogError() << "Service socket path too long: " << config_.socket_path;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, config_.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    wakeup_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (listen_fd_ < 0 || wakeup_fd_ < 0) {
+        base::LogError() << "Failed to create service socket, error: " << strerror(errno);
+        Stop();
+        return false;
+    }
+
+    // A socket left behind by a previous instance.
+    unlink(config_.socket_path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, LISTEN_BACKLOG) != 0) {
+        base::LogError() << "Failed to listen on " << config_.socket_path
+                         << ", error: " << strerror(errno);
+        Stop();
+        return false;
+    }
+
+    thread_ = std::thread(&C2EncoderService::AcceptLoop, this);
+    base::LogInfo() << "Encoder service listening on " << config_.socket_path << ", "
+                    << config_.max_sessions << " sessions";
+    return true;
+}
+
+void C2EncoderService::Stop() {
+    if (thread_.joinable()) {
+        uint64_t value = 1;
+        if (write(wakeup_fd_, &value, sizeof(value)) != sizeof(value)) {
+            base::LogError() << "Failed to wake the service thread up";
+        }
+        thread_.join();
+    }
+
+    std::list<std::shared_ptr<C2ServiceSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        sessions.swap(sessions_);
+    }
+    for (auto &session : sessions) {
+        session->Shutdown();
+        session->Join();
+    }
+
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(config_.socket_path.c_str());
+    }
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+}
+
+uint32_t C2EncoderService::GetSessionCount() {
+    std::lock_guard<std::mutex> lk(lock_);
+    uint32_t count = 0;
+    for (auto &session : sessions_) {
+        count += (session->IsAdmitted() && !session->IsDone()) ? 1 : 0;
+    }
+    return count;
+}
+
+void C2EncoderService::Reap() {
+    std::lock_guard<std::mutex> lk(lock_);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if ((*it)->IsDone()) {
+            (*it)->Join();
+            it = sessions_.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void C2EncoderService::AcceptLoop() {
+    uint32_t next_id = 1;
+    struct pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wakeup_fd_, POLLIN, 0}};
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            base::LogError() << "Service poll failed, error: " << strerror(errno);
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        if ((fds[0].revents & POLLIN) == 0) {
+            continue;
+        }
+
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            base::LogWarn() << "Failed to accept a service client, error: " << strerror(errno);
+            continue;
+        }
+
+        Reap();
+        // Over the limit the session only replies that the service is busy.
+        bool admitted = GetSessionCount() < config_.max_sessions;
+        std::lock_guard<std::mutex> lk(lock_);
+        sessions_.push_back(
+            std::make_shared<C2ServiceSession>(config_, fd, next_id++, admitted));
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "c2_service_channel.h"
+
+class C2ServiceSession;
+
+struct C2EncoderServiceConfig {
+    std::string socket_path = C2_SERVICE_SOCKET;
+    /// Sessions served at once, i.e. hardware encoder instances handed out.
+    uint32_t max_sessions = 4;
+    /// Longest wait of the encoder output for a slot released by the client,
+    /// the frame is dropped afterwards.
+    uint32_t output_wait_ms = 200;
+    /// Longest wait for the pending frames at the end of a stream.
+    uint32_t drain_timeout_ms = 3000;
+};
+
+/** C2EncoderService
+ *
+ * Local encoder daemon owning the engines of its clients. Every connection on
+ * the Unix socket is a session with its own engine, input frames and encoded
+ * output are exchanged through two shared memory rings passed to the client
+ * as file descriptors, the socket only carries slot numbers.
+ **/
+class C2EncoderService {
+public:
+    C2EncoderService(const C2EncoderServiceConfig &config);
+    ~C2EncoderService();
+
+    /**
+     * @brief Listen on the socket and serve clients from a background thread.
+     *
+     * @return: true on success or false on failure.
+     */
+    bool Start();
+    /**
+     * @brief Close every session and stop listening.
+     */
+    void Stop();
+
+    uint32_t GetSessionCount();
+private:
+    void AcceptLoop();
+    /// Join the threads of the sessions closed by their client.
+    void Reap();
+
+    C2EncoderServiceConfig config_;
+    int listen_fd_;
+    int wakeup_fd_;
+    std::thread thread_;
+
+    std::mutex lock_;
+    std::list<std::shared_ptr<C2ServiceSession>> sessions_;
+};
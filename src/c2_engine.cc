@@ -2,9 +2,35 @@
 
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "base/log.h"
+#include "base/trace.h"
 #include "c2_utils.h"
 
+#if __has_include(<QC2V4L2Config.h>)
+#include <QC2V4L2Config.h>
+#define HAVE_QC2_SLICE_CONFIG
+#endif  // QC2V4L2Config.h
+
+/// Time allowed for the component to return pending work on stop/flush.
+#define PENDING_WORK_TIMEOUT_MS 1000
+/// Capture times kept for the timestamp SEI, more than the frames ever in flight.
+#define CAPTURE_RING_SIZE 256
+
+// Copy a whole frame into the result of its future, with the SEI inserted.
+static void copy_frame(const C2EncodedFrame &frame, C2FrameResult &result) {
+    uint32_t head = (frame.sei != nullptr) ? frame.sei_offset : frame.size;
+
+    result.data.reserve(frame.size + frame.sei_size);
+    result.data.assign(frame.data, frame.data + head);
+    if (frame.sei != nullptr) {
+        result.data.insert(result.data.end(), frame.sei, frame.sei + frame.sei_size);
+        result.data.insert(result.data.end(), frame.data + head, frame.data + frame.size);
+    }
+    result.sync = frame.au.is_sync;
+}
+
 /************* static method *************/
 C2Engine *C2Engine::new_c2_engine(C2ModeType mode, C2CodecType codec_type) {
     C2Engine *engine = new C2Engine();
@@ -29,6 +55,16 @@ C2Engine *C2Engine::new_c2_engine(C2ModeType mode, C2CodecType codec_type) {
             break;
     }
 
+    engine->_trace_track = base::trace_register_track(engine->_name);
+    engine->_flight.set_name(engine->_name.c_str());
+
+    // HEIC input blocks need the HEIF usage of the tiled encoder.
+    engine->_heic = (codec_type == C2CodecType::HEICVideoEncode);
+
+    if (mode == C2ModeType::VideoEncode) {
+        engine->_nal_parser = std::make_unique<C2NalParser>(codec_type);
+    }
+
     try {
         engine->_c2_module = C2Factory::GetModule(engine->_name, mode);
     } catch (std::exception &e) {
@@ -37,15 +73,23 @@ C2Engine *C2Engine::new_c2_engine(C2ModeType mode, C2CodecType codec_type) {
         return nullptr;
     }
 
+    // Modules may be recreated and freed, the engine is only freed by free_c2_engine().
+    engine->_notifier = std::shared_ptr<IC2Notifier>(engine, [](IC2Notifier *) {});
+
     try {
-        std::shared_ptr<IC2Notifier> notifier(engine);
-        engine->_c2_module->Initialize(notifier);
+        engine->_c2_module->Initialize(engine->_notifier);
     } catch (std::exception &e) {
         base::LogError() << "Failed to initialize c2 engine, error: " << e.what();
         free_c2_engine(engine);
         return nullptr;
     }
 
+    // Reflected from the component on first use only, cached afterwards.
+    C2Capabilities caps;
+    if (C2CapabilityCache::Instance().Probe(engine->_name, *engine->_c2_module, caps)) {
+        engine->_capabilities = std::make_unique<C2Capabilities>(caps);
+    }
+
     base::LogInfo() << "Created C2 engine success";
     return engine;
 }
@@ -57,26 +101,102 @@ void C2Engine::free_c2_engine(C2Engine *engine) {
 /************* public method *************/
 void C2Engine::EventHandler(C2EventType event, void *payload) {
     base::LogDebug() << "callback event handle : " << (int)event;
-}
 
-FILE *fp = fopen("out.264", "wb");
-char buf[2048];
+    if (event == C2EventType::kDrop && payload != nullptr) {
+        C2_TRACE_END("in-hardware", _trace_track, *static_cast<uint64_t *>(payload));
+        _flight.record(base::FlightEvent::Drop, *static_cast<uint64_t *>(payload));
+        _stats.OnDropped(*static_cast<uint64_t *>(payload));
+        work_returned();
+        release_pending();
+        complete_promise(*static_cast<uint64_t *>(payload), C2FrameStatus::kDropped);
+    } else if (event == C2EventType::kError) {
+        uint32_t error = (payload != nullptr) ? *static_cast<uint32_t *>(payload) : 0;
+        _flight.record(base::FlightEvent::Error, 0, error);
+        _stats.OnError();
+        if (_watchdog && _watchdog->GetConfig().recover_on_error) {
+            _watchdog->Trigger();
+        }
+    } else if (event == C2EventType::kSkip) {
+        _flight.record(base::FlightEvent::Drop, *static_cast<uint64_t *>(payload), 0, "skip");
+        _stats.OnSkipped();
+        complete_promise(*static_cast<uint64_t *>(payload), C2FrameStatus::kSkipped);
+    } else if (event == C2EventType::kExpired) {
+        _flight.record(base::FlightEvent::Drop, *static_cast<uint64_t *>(payload), 0, "expired");
+        _stats.OnExpired();
+        C2_TRACE_END("queue", _trace_track, *static_cast<uint64_t *>(payload));
+        base::LogDebug() << "frame " << *static_cast<uint64_t *>(payload)
+                         << " dropped, deadline passed";
+        complete_promise(*static_cast<uint64_t *>(payload), C2FrameStatus::kExpired);
+    } else if (event == C2EventType::kStall) {
+        _stats.OnStall();
+    }
+
+    if (event == C2EventType::kEOS) {
+        std::lock_guard<std::mutex> lk(_lock);
+        for (auto &sink : _sinks) {
+            sink->OnEndOfStream();
+        }
+    }
+}
 
 void C2Engine::FrameAvailable(std::shared_ptr<C2Buffer> &c2buffer, uint64_t index,
                               uint64_t timestamp, C2FrameData::flags_t flags) {
     base::LogDebug() << "callback frame available";
     uint32_t fd = 0;
     uint32_t size = 0;
+    bool last_slice = !(flags & C2FrameData::FLAG_INCOMPLETE);
+    if (last_slice) {
+        C2_TRACE_END("in-hardware", _trace_track, index);
+    }
+    C2_TRACE_SCOPE("callback", _trace_track, index);
+    std::shared_ptr<C2FrameState> promise;
+    C2FrameResult result;
     if (c2buffer->data().type() == C2BufferData::LINEAR) {
         const C2ConstLinearBlock block = c2buffer->data().linearBlocks().front();
-        const C2Handle *handle = block.handle();
 
         size = block.size();
         C2ReadView view = block.map().get();
-        memcpy(buf, view.data(), size);
+        if (view.error() != C2_OK) {
+            base::LogError() << "Failed to map C2 linear block, error " << view.error();
+            return;
+        }
         base::LogDebug() << "C2BufferData type linear : " << size;
-        fwrite(buf, size, 1, fp);
-        fflush(fp);
+
+        promise = find_promise(index, last_slice);
+        std::lock_guard<std::mutex> lk(_lock);
+
+        C2EncodedFrame frame;
+        frame.data = view.data();
+        frame.size = size;
+        frame.index = index;
+        frame.timestamp = timestamp;
+        frame.flags = flags;
+        frame.au.is_sync = false;
+        frame.au.has_config = false;
+        frame.config = nullptr;
+        frame.config_version = 0;
+        frame.buffer = c2buffer;
+
+        // Locate the NAL units in place, nothing is copied out of the view.
+        if (_nal_parser && _nal_parser->Parse(view.data(), size, frame.au)) {
+            if (frame.au.is_sync) {
+                base::LogDebug() << "frame " << index << " is sync frame";
+            }
+            if (frame.au.has_config || (flags & C2FrameData::FLAG_CODEC_CONFIG)) {
+                base::LogDebug() << "frame " << index << " carries codec config";
+            }
+            if (!_nal_parser->GetCodecConfig().sps.empty()) {
+                frame.config = &_nal_parser->GetCodecConfig();
+                frame.config_version = _nal_parser->GetConfigVersion();
+            }
+        }
+
+        deliver_frame(frame, last_slice, promise ? &result : nullptr);
+        if (last_slice) {
+            _stats.OnCompleted(index, size);
+        } else {
+            _stats.OnPartial(index, size);
+        }
     } else if (c2buffer->data().type() == C2BufferData::GRAPHIC) {
         const C2ConstGraphicBlock block = c2buffer->data().graphicBlocks().front();
         auto handle = static_cast<const android::C2HandleGBM *>(block.handle());
@@ -84,61 +204,423 @@ void C2Engine::FrameAvailable(std::shared_ptr<C2Buffer> &c2buffer, uint64_t inde
         size = handle->mInts.size;
         fd = handle->mFds.buffer_fd;
         base::LogDebug() << "C2BufferData type graphic : " << size;
+        _stats.OnCompleted(index, size);
+        promise = find_promise(index, true);
     }
 
-    // Check whether this is a key/sync frame.
-    // error: ‘C2Param::CoreIndex::<unnamed enum> C2Param::CoreIndex::IS_STREAM_FLAG’ is protected within this context
-    // std::shared_ptr<const C2Info> c2info =
-    //     c2buffer->getInfo(C2StreamPictureTypeInfo::output::PARAM_TYPE);
-    // auto pictype = std::static_pointer_cast<const C2StreamPictureTypeInfo::output>(c2info);
+    work_returned();
 
-    // if (pictype && (pictype->value == C2Config::SYNC_FRAME)) {
-    //     base::LogDebug() << "picture value is sync frame";
-    // }
+    // In slice output mode the frame stays in flight until its last slice.
+    if (last_slice) {
+        _flight.record(base::FlightEvent::Done, index, size);
+        release_pending();
+    }
 
-    // if (flags & C2FrameData::FLAG_CODEC_CONFIG) {
-    //     base::LogDebug() << "GST_BUFFER_FLAG_HEADER";
-    // }
+    // Outside of the engine locks, the continuation may run right here.
+    if (promise && last_slice) {
+        result.status = C2FrameStatus::kEncoded;
+        result.index = index;
+        result.timestamp = timestamp;
+        result.flags = flags;
+        promise->Complete(std::move(result));
+    }
 
     // if (flags & C2FrameData::FLAG_DROP_FRAME) {
     //     base::LogDebug() << "GST_BUFFER_FLAG_DROPPABLE";
     // }
+}
 
-    // if (!(flags & C2FrameData::FLAG_INCOMPLETE)) {
-    //     base::LogDebug() << "GST_BUFFER_FLAG_MARKER";
-    // }
+void C2Engine::deliver_frame(C2EncodedFrame &frame, bool last_slice, C2FrameResult *result) {
+    C2_TRACE_SCOPE("sink", _trace_track, frame.index);
+
+    if (_slice_next == 0 || _slice_frame != frame.index) {
+        _slice_frame = frame.index;
+        _slice_next = 0;
+        _slice_data.clear();
+        _slice_au.nals.clear();
+        _slice_au.is_sync = false;
+        _slice_au.has_config = false;
+        _slice_sei = false;
+    }
+
+    frame.slice = _slice_next;
+    frame.last_slice = last_slice;
+    _slice_next = last_slice ? 0 : (_slice_next + 1);
+
+    if (_timestamp_sei && _nal_parser && frame.slice == 0) {
+        attach_sei(frame);
+    }
+
+    bool whole = (frame.slice == 0) && last_slice;
+    bool assemble = !whole && (result != nullptr);
+    for (auto &sink : _sinks) {
+        if (whole || sink->AcceptsSlices()) {
+            sink->OnFrame(frame);
+        } else {
+            assemble = true;
+        }
+    }
+
+    if (whole && result != nullptr) {
+        copy_frame(frame, *result);
+    }
+    if (!assemble) {
+        return;
+    }
+
+    // Sinks expecting whole frames get the slices concatenated, the NAL unit
+    // offsets are shifted instead of scanning the frame again.
+    uint32_t base = _slice_data.size();
+    _slice_data.insert(_slice_data.end(), frame.data, frame.data + frame.size);
+    for (C2NalUnit nal : frame.au.nals) {
+        nal.offset += base;
+        _slice_au.nals.push_back(nal);
+    }
+    _slice_au.is_sync |= frame.au.is_sync;
+    _slice_au.has_config |= frame.au.has_config;
+    if (frame.sei != nullptr) {
+        _slice_sei = true;
+        _slice_sei_offset = base + frame.sei_offset;
+    }
+
+    if (!last_slice) {
+        return;
+    }
+
+    // The buffer only holds the last slice, sinks keeping it would read past
+    // its end, without it they copy the assembled data.
+    C2EncodedFrame assembled = frame;
+    assembled.buffer.reset();
+    assembled.data = _slice_data.data();
+    assembled.size = _slice_data.size();
+    assembled.au = _slice_au;
+    assembled.slice = 0;
+    assembled.sei = _slice_sei ? _sei.data() : nullptr;
+    assembled.sei_size = _slice_sei ? _sei.size() : 0;
+    assembled.sei_offset = _slice_sei ? _slice_sei_offset : 0;
+
+    for (auto &sink : _sinks) {
+        if (!sink->AcceptsSlices()) {
+            sink->OnFrame(assembled);
+        }
+    }
+    if (result != nullptr) {
+        copy_frame(assembled, *result);
+    }
+}
+
+void C2Engine::attach_promise(uint64_t index, std::shared_ptr<C2FrameState> &promise) {
+    promise->SetIndex(index);
+
+    std::lock_guard<std::mutex> lk(_promise_lock);
+    _promises[index] = {promise, false};
+    _promise_count = _promises.size();
+}
+
+std::shared_ptr<C2FrameState> C2Engine::find_promise(uint64_t index, bool take) {
+    if (_promise_count == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lk(_promise_lock);
+    auto it = _promises.find(index);
+    if (it == _promises.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<C2FrameState> promise = it->second.first;
+    if (take) {
+        _promises.erase(it);
+        _promise_count = _promises.size();
+    }
+    return promise;
+}
+
+void C2Engine::complete_promise(uint64_t index, C2FrameStatus status) {
+    std::shared_ptr<C2FrameState> promise = find_promise(index, true);
+    if (promise) {
+        promise->Complete(status);
+    }
+}
+
+std::vector<std::shared_ptr<C2FrameState>> C2Engine::take_promises(bool queued_only) {
+    std::vector<std::shared_ptr<C2FrameState>> taken;
+    if (_promise_count == 0) {
+        return taken;
+    }
+
+    std::lock_guard<std::mutex> lk(_promise_lock);
+    for (auto it = _promises.begin(); it != _promises.end();) {
+        if (queued_only && !it->second.second) {
+            ++it;
+            continue;
+        }
+        taken.push_back(it->second.first);
+        it = _promises.erase(it);
+    }
+    _promise_count = _promises.size();
+    return taken;
+}
+
+void C2Engine::attach_sei(C2EncodedFrame &frame) {
+    bool hevc = _nal_parser->IsHEVC();
+
+    for (const C2NalUnit &nal : frame.au.nals) {
+        if (!C2Sei::IsSlice(hevc, nal.type)) {
+            continue;
+        }
+
+        const std::pair<uint64_t, uint64_t> &capture =
+            _capture_times[frame.index % _capture_times.size()];
+
+        C2TimestampSei sei;
+        sei.capture_time = (capture.first == frame.index) ? capture.second : 0;
+        sei.encode_time = C2Sei::RealTime();
+        sei.index = frame.index;
+        C2Sei::WriteTimestamp(hevc, sei, _sei);
+
+        frame.sei = _sei.data();
+        frame.sei_size = _sei.size();
+        frame.sei_offset = nal.offset - nal.start_code;
+        return;
+    }
+}
+
+void C2Engine::record_capture(uint64_t index, uint64_t capture_time) {
+    if (!_timestamp_sei) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(_lock);
+    if (!_capture_times.empty()) {
+        _capture_times[index % _capture_times.size()] = {
+            index, (capture_time != 0) ? capture_time : C2Sei::RealTime()};
+    }
+}
+
+bool C2Engine::c2_engine_timestamp_sei(bool enable) {
+    if (enable && _mode != C2ModeType::VideoEncode) {
+        base::LogError() << "Timestamp SEI requires a video encoder";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_lock);
+    _capture_times.assign(enable ? CAPTURE_RING_SIZE : 0, {0, 0});
+    _timestamp_sei = enable;
+    return true;
+}
+
+void C2Engine::c2_engine_add_sink(std::shared_ptr<IC2OutputSink> sink) {
+    std::lock_guard<std::mutex> lk(_lock);
+    _sinks.push_back(sink);
+}
+
+void C2Engine::c2_engine_remove_sink(std::shared_ptr<IC2OutputSink> sink) {
+    std::lock_guard<std::mutex> lk(_lock);
+    _sinks.erase(std::remove(_sinks.begin(), _sinks.end(), sink), _sinks.end());
+}
+
+void C2Engine::release_pending() {
+    {
+        std::lock_guard<std::mutex> lk(_pending_lock);
+        if (_pending > 0) {
+            _pending--;
+        }
+        _workdone.notify_all();
+    }
+
+    // Outside of _pending_lock, the input queue takes it while holding its own lock.
+    if (_input_queue) {
+        _input_queue->Notify();
+    }
+}
+
+bool C2Engine::c2_engine_wait_pending(uint32_t max_pending, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lk(_pending_lock);
+    return _workdone.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                              [&]() { return _pending <= max_pending; });
+}
+
+void C2Engine::c2_engine_stats(C2StatsSnapshot &snapshot) {
+    _stats.Snapshot(snapshot);
+}
+
+bool C2Engine::c2_engine_configure(const C2EngineConfig &config) {
+    // Rejected without a round trip to the component.
+    std::string error;
+    if (_capabilities && !C2CapabilityCache::Validate(*_capabilities, config, error)) {
+        base::LogError() << "Unsupported configuration of " << _name << ": " << error;
+        return false;
+    }
+
+    _config = config;
+    if (!configure_module(*_c2_module, config)) {
+        return false;
+    }
+
+    base::LogDebug() << "Configured c2module " << _name << " " << config.width << "x"
+                     << config.height;
+    return true;
+}
+
+bool C2Engine::configure_module(C2Module &module, const C2EngineConfig &config) {
+    std::vector<std::unique_ptr<C2Param>> params;
+
+    C2StreamPictureSizeInfo::input size(0u, config.width, config.height);
+    params.push_back(C2Param::Copy(size));
+
+    if (config.framerate > 0) {
+        C2StreamFrameRateInfo::output framerate(0u, config.framerate);
+        params.push_back(C2Param::Copy(framerate));
+    }
+
+    if (config.bitrate > 0) {
+        C2StreamBitrateInfo::output bitrate(0u, config.bitrate);
+        params.push_back(C2Param::Copy(bitrate));
+    }
+
+    if (config.gop > 0 && config.framerate > 0) {
+        // The sync frame interval is expressed in microseconds.
+        int64_t interval = static_cast<int64_t>(config.gop * 1000000.0 / config.framerate);
+        C2StreamSyncFrameIntervalTuning::output gop(0u, interval);
+        params.push_back(C2Param::Copy(gop));
+    }
+
+    try {
+        for (auto &param : params) {
+            module.SetParam(param);
+        }
+    } catch (std::exception &e) {
+        base::LogError() << "Failed to configure c2module, error: " << e.what();
+        return false;
+    }
+    return true;
+}
+
+bool C2Engine::c2_engine_slice_output(const C2SliceOutputConfig &config) {
+    if (config.enabled && _mode != C2ModeType::VideoEncode) {
+        base::LogError() << "Slice output requires a video encoder";
+        return false;
+    }
+
+    // Kept to configure a component recreated by the watchdog.
+    _slice_config = config;
+    if (!configure_slices(*_c2_module, config)) {
+        return false;
+    }
+
+    if (config.enabled) {
+        base::LogDebug() << "Slice output enabled on " << _name;
+    }
+    return true;
+}
+
+bool C2Engine::configure_slices(C2Module &module, const C2SliceOutputConfig &config) {
+    // Partial output is only returned early in low latency mode, not every
+    // component supports it.
+    try {
+        C2GlobalLowLatencyModeTuning low_latency(config.enabled);
+        std::unique_ptr<C2Param> param = C2Param::Copy(low_latency);
+        module.SetParam(param);
+    } catch (std::exception &e) {
+        base::LogWarn() << "Low latency mode not applied: " << e.what();
+    }
+
+    if (!config.enabled || (config.slice_mbs == 0 && config.slice_bytes == 0)) {
+        return true;
+    }
+
+#if defined(HAVE_QC2_SLICE_CONFIG)
+    try {
+        std::unique_ptr<C2Param> param;
+        if (config.slice_mbs > 0) {
+            qc2::C2VideoSliceSizeMBs::output slice(0u, config.slice_mbs);
+            param = C2Param::Copy(slice);
+        } else {
+            qc2::C2VideoSliceSizeBytes::output slice(0u, config.slice_bytes);
+            param = C2Param::Copy(slice);
+        }
+        module.SetParam(param);
+    } catch (std::exception &e) {
+        base::LogError() << "Failed to configure slices, error: " << e.what();
+        return false;
+    }
+#else
+    base::LogWarn() << "Slice size parameters not available, keeping the component default";
+#endif  // HAVE_QC2_SLICE_CONFIG
+
+    return true;
+}
+
+bool C2Engine::c2_engine_codec_config(std::vector<uint8_t> &config) {
+    std::lock_guard<std::mutex> lk(_lock);
+    if (!_nal_parser || _nal_parser->GetCodecConfig().annexb.empty()) {
+        return false;
+    }
+
+    config = _nal_parser->GetCodecConfig().annexb;
+    return true;
 }
 
 bool C2Engine::start_c2_engine() {
     try {
+        std::lock_guard<std::mutex> lk(_module_lock);
         _c2_module->Start();
+        _flight.record(base::FlightEvent::State, 0, 0, "start");
         base::LogDebug() << "Started c2module " << _name;
     } catch (std::exception &e) {
         base::LogError() << "Failed to start c2module, error: " << e.what();
         return false;
     }
 
+    if (_input_queue) {
+        _input_queue->Start();
+    }
+    if (_watchdog) {
+        _stall_time = 0;
+        _watchdog->Start();
+    }
+
     return true;
 }
 
 bool C2Engine::stop_c2_engine() {
+    if (_watchdog) {
+        _watchdog->Stop();
+    }
+    if (_input_queue) {
+        _input_queue->Stop();
+    }
+
     try {
+        std::lock_guard<std::mutex> lk(_module_lock);
         _c2_module->Stop();
+        _flight.record(base::FlightEvent::State, 0, 0, "stop");
         base::LogDebug() << "Stopped c2module " << _name;
     } catch (std::exception &e) {
         base::LogError() << "Failed to stop c2module, error: " << e.what();
         return false;
     }
 
-    // Wait until all work is completed or EOS.
-    // GST_C2_ENGINE_CHECK_AND_WAIT_PENDING_WORK(engine, 0);
+    // Work still held by the component is discarded once it is stopped.
+    _stats.DiscardPending();
+    {
+        std::lock_guard<std::mutex> lk(_pending_lock);
+        _pending = 0;
+        _workdone.notify_all();
+    }
 
+    for (auto &promise : take_promises(false)) {
+        promise->Complete(C2FrameStatus::kCancelled);
+    }
     return true;
 }
 
 bool C2Engine::flush_c2_engine() {
     try {
+        std::lock_guard<std::mutex> lk(_module_lock);
         _c2_module->Flush(C2Component::FLUSH_COMPONENT);
+        _flight.record(base::FlightEvent::State, 0, 0, "flush");
         base::LogDebug() << "Flushed c2module " << _name;
     } catch (std::exception &e) {
         base::LogError() << "Failed to flush c2module, error: " << e.what();
@@ -146,48 +628,507 @@ bool C2Engine::flush_c2_engine() {
     }
 
     // Wait until all work is completed or EOS.
-    // GST_C2_ENGINE_CHECK_AND_WAIT_PENDING_WORK(engine, 0);
+    if (!c2_engine_wait_pending(0, PENDING_WORK_TIMEOUT_MS)) {
+        base::LogWarn() << "Pending work not returned after flush of " << _name;
+    }
 
     return true;
 }
 
 bool C2Engine::c2_engine_queue_buffer(C2StreamBuffer *stream_buffer) {
+    return submit_buffer(stream_buffer, nullptr);
+}
+
+C2FrameFuture C2Engine::c2_engine_queue_buffer_async(C2StreamBuffer *stream_buffer) {
+    auto promise = std::make_shared<C2FrameState>(stream_buffer->timestamp);
+
+    // Failing before the frame got an index leaves the future unregistered.
+    if (!submit_buffer(stream_buffer, promise)) {
+        promise->Complete(C2FrameStatus::kError);
+    }
+    return C2FrameFuture(promise);
+}
+
+bool C2Engine::submit_buffer(C2StreamBuffer *stream_buffer,
+                             std::shared_ptr<C2FrameState> promise) {
     std::list<std::unique_ptr<C2Param>> settings;
-    std::shared_ptr<C2Buffer> c2buffer;
-    uint64_t index = 0;
-    uint64_t timestamp = 0;
-    uint32_t flags = 0;
 
-    std::shared_ptr<C2GraphicBlock> block;
+    if (_scene_detector && is_static_frame(stream_buffer, settings)) {
+        uint64_t index = _frame_index++;
+        if (promise) {
+            attach_promise(index, promise);
+        }
+        EventHandler(C2EventType::kSkip, &index);
+        return true;
+    }
 
-    // no dma buffer implement
+    std::shared_ptr<C2Buffer> c2buffer;
     {
-        C2PixelFormat format = stream_buffer->pixel_format;
-
-        uint32_t width = stream_buffer->width;
-        uint32_t height = stream_buffer->height;
-        bool isheic = false;
-
-        std::shared_ptr<C2GraphicBlock> block;
-        try {
-            std::shared_ptr<C2GraphicMemory> c2_mem = _c2_module->GetGraphicMemory();
-            block = c2_mem->Fetch(width, height, format, isheic);
-        } catch (std::exception &e) {
-            base::LogError() << "Failed to fetch memory block, error: " << e.what();
+        // The frame is given the next index once copied.
+        C2_TRACE_SCOPE("copy", _trace_track, _frame_index);
+
+        // no dma buffer implement
+        std::shared_ptr<C2GraphicBlock> block = c2_engine_fetch_block(
+            stream_buffer->width, stream_buffer->height,
+            C2Utils::GetBlockFormat(stream_buffer->pixel_format));
+        if (!block) {
             return false;
         }
+
         c2buffer = C2Utils::CreateBuffer(stream_buffer, block);
+        if (!c2buffer) {
+            return false;
+        }
+        if (_broker_client != 0 && !C2BufferBroker::HoldUntilReleased(c2buffer, block)) {
+            return false;
+        }
+    }
+
+    // Per frame tunings requested by the caller.
+    if (stream_buffer->request_sync) {
+        C2StreamRequestSyncFrameTuning::output request(0u, true);
+        settings.push_back(C2Param::Copy(request));
+    }
+    if (stream_buffer->bitrate > 0) {
+        C2StreamBitrateInfo::output bitrate(0u, stream_buffer->bitrate);
+        settings.push_back(C2Param::Copy(bitrate));
+    }
+
+    uint64_t index = _frame_index++;
+    if (promise) {
+        attach_promise(index, promise);
+    }
+    record_capture(index, stream_buffer->capture_time);
+    C2_TRACE_BEGIN("queue", _trace_track, index);
+
+    if (_input_queue) {
+        C2InputEntry entry;
+        entry.buffer = c2buffer;
+        entry.index = index;
+        entry.timestamp = stream_buffer->timestamp;
+        entry.deadline = stream_buffer->deadline;
+        if (entry.deadline == 0) {
+            entry.deadline = C2Stats::Now() + _input_queue->GetConfig().budget_ms * 1000ull;
+        }
+        entry.flags = stream_buffer->flags;
+        entry.settings = std::move(settings);
+        entry.request_sync = false;
+
+        _input_queue->Push(std::move(entry));
+        return true;
+    }
+
+    return queue_work(c2buffer, index, stream_buffer->timestamp, settings, stream_buffer->flags);
+}
+
+bool C2Engine::c2_engine_latency_budget(const C2LatencyBudgetConfig &config) {
+    if (_input_queue) {
+        _input_queue->Stop();
+        _input_queue.reset();
     }
+
+    if (!config.enabled) {
+        return true;
+    }
+
+    auto submit = [this](C2InputEntry &entry) {
+        if (entry.request_sync) {
+            // Restart the prediction chain after the gap left by dropped frames.
+            _force_sync = true;
+        }
+        return queue_work(entry.buffer, entry.index, entry.timestamp, entry.settings,
+                          entry.flags);
+    };
+    auto drop = [this](uint64_t index) { EventHandler(C2EventType::kExpired, &index); };
+    auto cancel = [this](uint64_t index) {
+        // Never submitted, not counted as expired.
+        _flight.record(base::FlightEvent::Drop, index, 0, "cancelled");
+        C2_TRACE_END("queue", _trace_track, index);
+        complete_promise(index, C2FrameStatus::kCancelled);
+    };
+    auto in_flight = [this]() {
+        std::lock_guard<std::mutex> lk(_pending_lock);
+        return _pending;
+    };
+
+    _input_queue = std::make_unique<C2InputQueue>(config, submit, drop, cancel, in_flight);
+    return true;
+}
+
+bool C2Engine::is_static_frame(C2StreamBuffer *stream_buffer,
+                               std::list<std::unique_ptr<C2Param>> &settings) {
+    switch (stream_buffer->pixel_format) {
+        case C2PixelFormat::kNV12:
+        case C2PixelFormat::kYV12:
+        case C2PixelFormat::kI420:
+            break;
+        default:
+            // Only 8-bit luma planes are compared.
+            return false;
+    }
+
+    uint64_t begin = C2Stats::ThreadCpuTime();
+    bool still = _scene_detector->IsStatic(
+        static_cast<const uint8_t *>(stream_buffer->data) + stream_buffer->offset[0],
+        stream_buffer->stride[0], stream_buffer->width, stream_buffer->height);
+    _stats.OnDetect(C2Stats::ThreadCpuTime() - begin);
+
+    const C2SceneDetectConfig &config = _scene_detector->GetConfig();
+    if (config.action == C2SkipAction::kSkip || _config.bitrate == 0) {
+        return still;
+    }
+
+    // Low cost mode: lower the bitrate while the scene is static, restore it after.
+    if (still != _low_cost) {
+        uint32_t bitrate = still ? (_config.bitrate / std::max(config.low_cost_divisor, 1u))
+                                 : _config.bitrate;
+        C2StreamBitrateInfo::output tuning(0u, bitrate);
+        settings.push_back(C2Param::Copy(tuning));
+        _low_cost = still;
+        base::LogDebug() << "Scene " << (still ? "static" : "changed") << ", bitrate "
+                         << bitrate;
+    }
+    return false;
+}
+
+bool C2Engine::c2_engine_scene_detect(const C2SceneDetectConfig &config) {
+    if (config.enabled && _mode != C2ModeType::VideoEncode) {
+        base::LogError() << "Scene detection requires a video encoder";
+        return false;
+    }
+
+    if (config.enabled && config.action == C2SkipAction::kLowCost && _config.bitrate == 0) {
+        base::LogWarn() << "Low cost mode needs a configured bitrate, frames are encoded as is";
+    }
+
+    _scene_detector = config.enabled ? std::make_unique<C2SceneDetector>(config) : nullptr;
+    _low_cost = false;
+    return true;
+}
+
+std::shared_ptr<C2GraphicBlock> C2Engine::c2_engine_fetch_block(uint32_t width, uint32_t height,
+                                                                C2PixelFormat format) {
+    bool isheic = _heic;
+
     try {
+        std::unique_lock<std::mutex> lk(_module_lock);
+        std::shared_ptr<C2GraphicMemory> c2_mem = _c2_module->GetGraphicMemory();
+        if (_broker_client == 0) {
+            return c2_mem->Fetch(width, height, format, isheic);
+        }
+
+        // The broker may wait for memory, the pool outlives a recreated module.
+        lk.unlock();
+        auto allocate = [&](size_t &size) {
+            std::shared_ptr<C2GraphicBlock> block = c2_mem->Fetch(width, height, format, isheic);
+            if (block) {
+                size = static_cast<const android::C2HandleGBM *>(block->handle())->mInts.size;
+            }
+            return block;
+        };
+
+        std::shared_ptr<C2GraphicBlock> block = C2BufferBroker::Instance().Acquire(
+            _broker_client, width, height, format, isheic ? 1 : 0, allocate);
+        if (!block) {
+            base::LogError() << "No graphic memory left within the broker budget";
+        }
+        return block;
+    } catch (std::exception &e) {
+        base::LogError() << "Failed to fetch memory block, error: " << e.what();
+        return nullptr;
+    }
+}
+
+bool C2Engine::c2_engine_buffer_broker(bool enable) {
+    if (enable && _broker_client == 0) {
+        _broker_client = C2BufferBroker::Instance().Register(_name);
+    } else if (!enable && _broker_client != 0) {
+        C2BufferBroker::Instance().Unregister(_broker_client);
+        _broker_client = 0;
+    }
+    return true;
+}
+
+bool C2Engine::c2_engine_publish_stats(bool enable) {
+    if (!enable) {
+        C2StatsPublisher::Instance().Unregister(_stats_publisher);
+        _stats_publisher = 0;
+        return true;
+    }
+    if (_stats_publisher != 0) {
+        return true;
+    }
+
+    auto source = [this](const C2BrokerUsage &usage, C2StatsEngineData &data) {
+        _stats.Snapshot(data.stats);
+        data.waiting = _input_queue ? _input_queue->GetWaiting() : 0;
+        for (const C2BrokerClientUsage &client : usage.clients) {
+            if (_broker_client != 0 && client.id == _broker_client) {
+                data.pool_bytes = client.bytes;
+                data.pool_peak = client.peak;
+                data.pool_quota = client.quota;
+                data.pool_waits = client.waits;
+            }
+        }
+    };
+
+    _stats_publisher = C2StatsPublisher::Instance().Register(_name, source);
+    return _stats_publisher != 0;
+}
+
+bool C2Engine::c2_engine_record_work(const std::string &path) {
+    std::shared_ptr<C2WorkLogWriter> log;
+    if (!path.empty()) {
+        log = std::make_shared<C2WorkLogWriter>();
+        if (!log->Open(path, _name, _mode, _config)) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(_module_lock);
+    _work_log = log;
+    _c2_module->SetWorkLog(log);
+    base::LogInfo() << (log ? "Recording work of " : "Stopped recording work of ") << _name;
+    return true;
+}
+
+bool C2Engine::c2_engine_capabilities(C2Capabilities &caps) {
+    if (!_capabilities) {
+        return false;
+    }
+    caps = *_capabilities;
+    return true;
+}
+
+bool C2Engine::c2_engine_queue_block(std::shared_ptr<C2GraphicBlock> &block, uint64_t index,
+                                     uint64_t timestamp) {
+    std::shared_ptr<C2Buffer> c2buffer = C2Utils::WrapBlock(block);
+    if (!c2buffer) {
+        return false;
+    }
+    if (_broker_client != 0 && !C2BufferBroker::HoldUntilReleased(c2buffer, block)) {
+        return false;
+    }
+
+    record_capture(index, 0);
+    C2_TRACE_BEGIN("queue", _trace_track, index);
+
+    std::list<std::unique_ptr<C2Param>> settings;
+    return queue_work(c2buffer, index, timestamp, settings);
+}
+
+bool C2Engine::queue_work(std::shared_ptr<C2Buffer> &c2buffer, uint64_t index,
+                          uint64_t timestamp, std::list<std::unique_ptr<C2Param>> &settings,
+                          uint32_t flags) {
+    std::unique_lock<std::mutex> module_lk(_module_lock);
+
+    if (_force_sync.exchange(false)) {
+        C2StreamRequestSyncFrameTuning::output request(0u, true);
+        settings.push_back(C2Param::Copy(request));
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(_pending_lock);
+        _pending++;
+    }
+    _stats.OnQueued(index);
+
+    if (_promise_count != 0) {
+        std::lock_guard<std::mutex> lk(_promise_lock);
+        auto it = _promises.find(index);
+        if (it != _promises.end()) {
+            it->second.second = true;
+        }
+    }
+
+    // The component may return the work before Queue() does.
+    C2_TRACE_END("queue", _trace_track, index);
+    C2_TRACE_BEGIN("in-hardware", _trace_track, index);
+
+    try {
+        _flight.record(base::FlightEvent::Queue, index, timestamp);
         _c2_module->Queue(c2buffer, settings, index, timestamp, flags);
         base::LogDebug() << "Queued buffer";
     } catch (std::exception &e) {
+        C2_TRACE_END("in-hardware", _trace_track, index);
+        _flight.record(base::FlightEvent::Error, index, 0, "queue");
+        module_lk.unlock();
         base::LogError() << "Failed to queue frame, error: " << e.what();
+        _stats.OnDropped(index);
+        release_pending();
+        complete_promise(index, C2FrameStatus::kError);
+        return false;
+    }
+    return true;
+}
+
+bool C2Engine::c2_engine_watchdog(const C2WatchdogConfig &config) {
+    if (_watchdog) {
+        _watchdog->Stop();
+        _watchdog.reset();
+    }
+
+    if (!config.enabled) {
+        return true;
+    }
+
+    auto oldest = [this]() { return _stats.OldestQueueTime(); };
+    auto stall = [this](uint64_t age) { handle_stall(age); };
+
+    _watchdog = std::make_unique<C2Watchdog>(config, oldest, stall);
+    return true;
+}
+
+void C2Engine::handle_stall(uint64_t age) {
+    C2RecoveryAction strongest = _watchdog->GetConfig().recovery;
+
+    // Escalate while work is still not coming back after the previous attempt.
+    C2StallInfo info;
+    uint64_t expected = 0;
+    if (_stall_time.compare_exchange_strong(expected, C2Stats::Now())) {
+        info.action = std::min(C2RecoveryAction::kFlush, strongest);
+    } else {
+        uint32_t next = static_cast<uint32_t>(_last_action) + 1;
+        info.action = std::min(static_cast<C2RecoveryAction>(next), strongest);
+    }
+    info.age = age;
+    _last_action = info.action;
+    _flight.record(base::FlightEvent::State, 0, age, "stall");
+
+    base::LogWarn() << "Component " << _name << " stalled, oldest frame " << age / 1000
+                    << " ms, recovery " << static_cast<uint32_t>(info.action);
+    EventHandler(C2EventType::kStall, &info);
+
+    if (info.action == C2RecoveryAction::kNone) {
+        return;
+    }
+
+    bool recovered;
+    uint32_t discarded;
+    std::vector<std::shared_ptr<C2FrameState>> lost;
+
+    _recovering = true;
+    {
+        std::lock_guard<std::mutex> lk(_module_lock);
+        recovered = recover(info.action);
+
+        // Whatever the component still holds is lost, frames queued from now
+        // on must not wait for it.
+        discarded = _stats.DiscardPending();
+        lost = take_promises(true);
+        {
+            std::lock_guard<std::mutex> pending_lk(_pending_lock);
+            _pending = 0;
+            _workdone.notify_all();
+        }
+        _force_sync = true;
+    }
+    _recovering = false;
+
+    if (_input_queue) {
+        _input_queue->Notify();
+    }
+    for (auto &promise : lost) {
+        promise->Complete(C2FrameStatus::kDropped);
+    }
+
+    _flight.record(base::FlightEvent::State, 0, discarded,
+                   recovered ? "recovered" : "recovery failed");
+    if (!recovered) {
+        base::LogError() << "Recovery of " << _name << " failed, " << discarded
+                         << " frames discarded";
+    } else {
+        base::LogInfo() << "Recovered " << _name << ", " << discarded << " frames discarded";
+    }
+}
+
+bool C2Engine::recover(C2RecoveryAction action) {
+    try {
+        switch (action) {
+            case C2RecoveryAction::kFlush:
+                _c2_module->Flush(C2Component::FLUSH_COMPONENT);
+                break;
+            case C2RecoveryAction::kRestart:
+                _c2_module->Stop();
+                _c2_module->Start();
+                break;
+            case C2RecoveryAction::kRecreate: {
+                // The new instance comes first, on failure the old one stays in place.
+                std::unique_ptr<C2Module> module(C2Factory::GetModule(_name, _mode));
+                module->Initialize(_notifier);
+                module->SetWorkLog(_work_log);
+                if (!configure_module(*module, _config) ||
+                    (_slice_config.enabled && !configure_slices(*module, _slice_config))) {
+                    return false;
+                }
+
+                try {
+                    _c2_module->Stop();
+                    _c2_module->Release();
+                } catch (std::exception &e) {
+                    base::LogWarn() << "Failed to release stalled component: " << e.what();
+                }
+                delete _c2_module;
+                _c2_module = module.release();
+                _c2_module->Start();
+                break;
+            }
+            default:
+                break;
+        }
+    } catch (std::exception &e) {
+        base::LogError() << "Failed to recover c2module, error: " << e.what();
         return false;
     }
     return true;
 }
 
-C2Engine::C2Engine() {}
+void C2Engine::work_returned() {
+    if (_recovering || _stall_time == 0) {
+        return;
+    }
+
+    uint64_t begin = _stall_time.exchange(0);
+    if (begin != 0) {
+        _stats.OnRecovered(C2Stats::Now() - begin);
+    }
+}
+
+C2Engine::C2Engine()
+    : _c2_module(nullptr),
+      _heic(false),
+      _broker_client(0),
+      _stats_publisher(0),
+      _pending(0),
+      _config(),
+      _slice_config(),
+      _low_cost(false),
+      _force_sync(false),
+      _stall_time(0),
+      _recovering(false),
+      _last_action(C2RecoveryAction::kNone),
+      _slice_frame(0),
+      _slice_next(0),
+      _slice_sei(false),
+      _slice_sei_offset(0),
+      _timestamp_sei(false),
+      _frame_index(0),
+      _promise_count(0),
+      _trace_track(0) {}
 
-C2Engine::~C2Engine() {}
\ No newline at end of file
+C2Engine::~C2Engine() {
+    c2_engine_publish_stats(false);
+    if (_watchdog) {
+        _watchdog->Stop();
+    }
+    if (_input_queue) {
+        _input_queue->Stop();
+    }
+    delete _c2_module;
+    for (auto &promise : take_promises(false)) {
+        promise->Complete(C2FrameStatus::kCancelled);
+    }
+    if (_broker_client != 0) {
+        C2BufferBroker::Instance().Unregister(_broker_client);
+    }
+}
\ No newline at end of file
@@ -3,7 +3,27 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/flight_recorder.h"
+#include "c2_buffer_broker.h"
+#include "c2_capabilities.h"
+#include "c2_frame_future.h"
+#include "c2_input_queue.h"
 #include "c2_module.h"
+#include "c2_nal_parser.h"
+#include "c2_output_sink.h"
+#include "c2_scene_detector.h"
+#include "c2_sei.h"
+#include "c2_stats.h"
+#include "c2_stats_publisher.h"
+#include "c2_watchdog.h"
 
 class C2Engine : public IC2Notifier {
 public:
@@ -28,6 +48,14 @@ public:
     virtual void FrameAvailable(std::shared_ptr<C2Buffer> &c2buffer, uint64_t index,
                                 uint64_t timestamp, C2FrameData::flags_t flags) override;
 public:
+    /**
+     * @brief Apply the stream configuration to the component, must be called
+     * before the engine is started.
+     * @config: Picture size, frame rate, bitrate and sync frame interval.
+     *
+     * @return: true on success or false on failure.
+     */
+    bool c2_engine_configure(const C2EngineConfig &config);
     /**
      * @brief : Allow the Codec2 component to process requests.
      * 
@@ -55,21 +83,273 @@ public:
      * @return:true on success or false on failure.
      */
     bool c2_engine_queue_buffer(C2StreamBuffer *stream_buffer);
+    /**
+     * @brief Queue a buffer like c2_engine_queue_buffer(), the returned future
+     * completes with the encoded output of this frame, or with the reason it
+     * has none (dropped, skipped, expired, not submitted, engine stopped).
+     * It is fulfilled from the component callback: continuations without an
+     * executor run there and must not queue to the same engine, the module
+     * may be locked by a flush or a stall recovery at that point.
+     * @stream_buffer: Buffer data that will be queued for encoding.
+     *
+     * @return: Future of the frame, always valid.
+     */
+    C2FrameFuture c2_engine_queue_buffer_async(C2StreamBuffer *stream_buffer);
+    /**
+     * @brief Fetch an empty graphic block from the engine's input pool, for
+     * callers filling the block themselves instead of queueing a stream buffer.
+     * @width: Block width in pixels.
+     * @height: Block height in pixels.
+     * @format: Block pixel format.
+     *
+     * @return: Empty shared pointer on failure.
+     */
+    std::shared_ptr<C2GraphicBlock> c2_engine_fetch_block(uint32_t width, uint32_t height,
+                                                          C2PixelFormat format);
+    /**
+     * @brief Submit a filled graphic block with a caller assigned frame index,
+     * e.g. to keep the indexes of several engines aligned.
+     * @block: Block fetched with c2_engine_fetch_block().
+     * @index: Frame index reported back with the encoded output.
+     * @timestamp: Presentation timestamp in microseconds.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_queue_block(std::shared_ptr<C2GraphicBlock> &block, uint64_t index,
+                               uint64_t timestamp);
+    /**
+     * @brief Enable or disable the static scene detection stage in front of
+     * c2_engine_queue_buffer. Static frames are skipped (kSkip event) or
+     * encoded at a reduced bitrate, depending on the configured action.
+     * @config: Detection grid, threshold and action.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_scene_detect(const C2SceneDetectConfig &config);
+    /**
+     * @brief Enable or disable the latency budget mode, must be called before
+     * the engine is started. Queued frames then wait in a small input queue and
+     * are dropped (kExpired event) instead of submitted once their deadline
+     * passed; the frame after a drop requests a sync frame.
+     * @config: Default budget, in-flight window, queue depth and policy.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_latency_budget(const C2LatencyBudgetConfig &config);
+    /**
+     * @brief Enable or disable the stall watchdog, must be called before the
+     * engine is started. A kStall event is sent when the oldest in-flight frame
+     * is older than the threshold, then the component is flushed, restarted or
+     * recreated, escalating while the stall persists. The next queued frame
+     * requests a sync frame.
+     * @config: Stall threshold, check interval and strongest recovery.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_watchdog(const C2WatchdogConfig &config);
+    /**
+     * @brief Enable or disable slice output, must be called before the engine
+     * is started. The encoder is put in low latency mode and configured for
+     * multiple slices per frame, slices are handed to the sinks accepting
+     * them as soon as the component returns them.
+     * @config: Slice size in macroblocks or bytes.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_slice_output(const C2SliceOutputConfig &config);
+    /**
+     * @brief Enable or disable the capture timestamp SEI. Each encoded access
+     * unit is handed to the sinks with a user data unregistered SEI carrying
+     * the capture time, the encode time and the frame index, which receivers
+     * extract with C2Sei::FindTimestamp() to measure end to end latency. The
+     * SEI is inserted on output, the encoded buffer is not copied.
+     * @enable: Insert the SEI in front of the first coded slice of each frame.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_timestamp_sei(bool enable);
+    /**
+     * @brief Fetch input blocks through the process wide C2BufferBroker, must
+     * be called before the engine is started. Blocks of the same geometry are
+     * shared with the other engines using the broker and count against its
+     * memory budget, a fetch fails once the budget stays exhausted.
+     * @enable: Register the engine as client of the broker.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_buffer_broker(bool enable);
+    /**
+     * @brief Publish the engine counters, input queue depth and broker usage
+     * to the process stats segment in /dev/shm, refreshed by the
+     * C2StatsPublisher thread from the lock free counters.
+     * @enable: Add or remove the engine from the segment.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_publish_stats(bool enable);
+    /**
+     * @brief Record the work queued to and returned by the component into a
+     * binary work log, replayed by work_replay without the hardware. Call after
+     * c2_engine_configure(), the configuration is stored in the log.
+     * @path: Log file, an empty path stops recording.
+     *
+     * @return:true on success or false on failure.
+     */
+    bool c2_engine_record_work(const std::string &path);
+    /**
+     * @brief Copy the capabilities of the component, probed once per
+     * component name and cached on disk across process starts.
+     * @caps: Filled with the capabilities on success.
+     *
+     * @return:true on success, false if the component does not report them.
+     */
+    bool c2_engine_capabilities(C2Capabilities &caps);
+    /**
+     * @brief Copy the latest SPS/PPS (and VPS for HEVC) seen on the encoder
+     * output as a single Annex-B blob.
+     * @config: Filled with the codec config on success.
+     *
+     * @return:true if parameter sets have been seen, false otherwise.
+     */
+    bool c2_engine_codec_config(std::vector<uint8_t> &config);
+    /**
+     * @brief Attach a consumer of the encoded output. Sinks are called in the
+     * order they were added, from the component callback thread.
+     * @sink: Output sink, e.g. C2FileSink or C2Mp4Muxer.
+     */
+    void c2_engine_add_sink(std::shared_ptr<IC2OutputSink> sink);
+    /**
+     * @brief Detach a previously added output sink.
+     */
+    void c2_engine_remove_sink(std::shared_ptr<IC2OutputSink> sink);
+    /**
+     * @brief Wait until at most max_pending frames are in flight.
+     * @max_pending: Number of frames allowed to remain in the component.
+     * @timeout_ms: Maximum time to wait in milliseconds.
+     *
+     * @return:true if the condition was met, false on timeout.
+     */
+    bool c2_engine_wait_pending(uint32_t max_pending, uint32_t timeout_ms);
+    /**
+     * @brief Copy the engine counters and latency percentiles.
+     */
+    void c2_engine_stats(C2StatsSnapshot &snapshot);
 public:
     C2Engine();
     ~C2Engine();
 private:
+    bool submit_buffer(C2StreamBuffer *stream_buffer, std::shared_ptr<C2FrameState> promise);
+    void release_pending();
+    bool queue_work(std::shared_ptr<C2Buffer> &c2buffer, uint64_t index, uint64_t timestamp,
+                    std::list<std::unique_ptr<C2Param>> &settings, uint32_t flags = 0);
+    bool is_static_frame(C2StreamBuffer *stream_buffer,
+                         std::list<std::unique_ptr<C2Param>> &settings);
+    void handle_stall(uint64_t age);
+    /// Called with _module_lock held.
+    bool recover(C2RecoveryAction action);
+    void work_returned();
+    /// Apply the stream configuration or the slice output settings to a module.
+    bool configure_module(C2Module &module, const C2EngineConfig &config);
+    bool configure_slices(C2Module &module, const C2SliceOutputConfig &config);
+    /// Called with _lock held, result is filled with the whole frame if set.
+    void deliver_frame(C2EncodedFrame &frame, bool last_slice, C2FrameResult *result);
+    void attach_promise(uint64_t index, std::shared_ptr<C2FrameState> &promise);
+    /// Look up the future of a frame, removed from the map if take is set.
+    std::shared_ptr<C2FrameState> find_promise(uint64_t index, bool take);
+    void complete_promise(uint64_t index, C2FrameStatus status);
+    /// Remove the futures of all frames, or only of those held by the component.
+    std::vector<std::shared_ptr<C2FrameState>> take_promises(bool queued_only);
+    void record_capture(uint64_t index, uint64_t capture_time);
+    /// Called with _lock held.
+    void attach_sei(C2EncodedFrame &frame);
+
     /// Component name, used mainly for debugging.
     std::string _name;
-    /// Codec2 component instance.
+    /// Codec2 component instance, replaced when the watchdog recreates it.
     C2Module *_c2_module;
+    /// Serializes queueing with the watchdog recovery of the component.
+    std::mutex _module_lock;
+    /// Non owning notifier handed to every module instance.
+    std::shared_ptr<IC2Notifier> _notifier;
     /// Component mode/type: Encode or Decode.
     C2ModeType _mode;
+    /// Input blocks are allocated for the HEIC encoder.
+    bool _heic;
+    /// Client ID of the engine in the buffer broker, 0 when not used.
+    uint32_t _broker_client;
+    /// ID of the engine in the stats publisher, 0 when not published.
+    uint32_t _stats_publisher;
+    /// Work log being recorded, handed to every module instance.
+    std::shared_ptr<C2WorkLogWriter> _work_log;
+    /// Capabilities the configurations are validated against, null if unknown.
+    std::unique_ptr<C2Capabilities> _capabilities;
 
-    // /// Draining state & pending frames lock.
-    // GMutex lock;
-    // /// Condition signalled when pending frame has been processed.
-    // GCond workdone;
+    /// Pending frames lock.
+    std::mutex _pending_lock;
+    /// Condition signalled when pending frame has been processed.
+    std::condition_variable _workdone;
     /// Tracking the number of pending frames.
     uint32_t _pending;
+    /// Counters and latency histogram.
+    C2Stats _stats;
+    /// Stream configuration applied by c2_engine_configure().
+    C2EngineConfig _config;
+    /// Slice output settings applied by c2_engine_slice_output().
+    C2SliceOutputConfig _slice_config;
+
+    /// Optional static scene detection, only used from the queueing thread.
+    std::unique_ptr<C2SceneDetector> _scene_detector;
+    /// Whether the reduced bitrate of the low cost mode is applied.
+    bool _low_cost;
+    /// Input queue of the latency budget mode.
+    std::unique_ptr<C2InputQueue> _input_queue;
+
+    /// Optional stall watchdog.
+    std::unique_ptr<C2Watchdog> _watchdog;
+    /// The next queued frame requests a sync frame.
+    std::atomic<bool> _force_sync;
+    /// Detection time of the unresolved stall, 0 if none.
+    std::atomic<uint64_t> _stall_time;
+    /// Returned work is not counted as recovery while an action is running.
+    std::atomic<bool> _recovering;
+    /// Last recovery attempted for the unresolved stall, watchdog thread only.
+    C2RecoveryAction _last_action;
+
+    /// Output bitstream scanner, only created for video encoders.
+    std::unique_ptr<C2NalParser> _nal_parser;
+    /// Consumers of the encoded output.
+    std::vector<std::shared_ptr<IC2OutputSink>> _sinks;
+    /// Protects the scanner, its cached codec config, the sinks and the slice state.
+    std::mutex _lock;
+    /// Frame whose slices are being delivered and the number of the next slice.
+    uint64_t _slice_frame;
+    uint32_t _slice_next;
+    /// Slices of the frame concatenated for sinks not accepting slices.
+    std::vector<uint8_t> _slice_data;
+    C2AccessUnitInfo _slice_au;
+    /// Position of the SEI within _slice_data, valid if _slice_sei is set.
+    bool _slice_sei;
+    uint32_t _slice_sei_offset;
+
+    /// Capture timestamp SEI insertion.
+    std::atomic<bool> _timestamp_sei;
+    /// Capture times of the frames in flight by index modulo the ring size.
+    std::vector<std::pair<uint64_t, uint64_t>> _capture_times;
+    /// SEI NAL unit of the frame being delivered.
+    std::vector<uint8_t> _sei;
+
+    /// Index assigned to the next queued frame.
+    uint64_t _frame_index;
+
+    /// Futures of frames queued with c2_engine_queue_buffer_async() by frame
+    /// index, with whether the frame was handed to the component.
+    std::mutex _promise_lock;
+    std::unordered_map<uint64_t, std::pair<std::shared_ptr<C2FrameState>, bool>> _promises;
+    /// Size of _promises, frames without future do not take the lock.
+    std::atomic<uint32_t> _promise_count;
+
+    /// Track of the engine in frame lifecycle traces.
+    uint32_t _trace_track;
+    /// Last frame and state events, dumped by the crash handler.
+    base::FlightRecorder _flight;
 };
\ No newline at end of file
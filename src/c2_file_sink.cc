@@ -0,0 +1,38 @@
+#include "c2_file_sink.h"
+
+#include "base/log.h"
+
+C2FileSink::C2FileSink(const std::string &path) : file_(fopen(path.c_str(), "wb")) {
+    if (file_ == nullptr) {
+        base::LogError() << "Failed to open output file " << path;
+    }
+}
+
+C2FileSink::~C2FileSink() {
+    if (file_ != nullptr) {
+        fclose(file_);
+    }
+}
+
+void C2FileSink::OnFrame(const C2EncodedFrame &frame) {
+    if (file_ == nullptr) {
+        return;
+    }
+
+    // The engine SEI is written in between, the encoded data is not copied.
+    uint32_t head = (frame.sei != nullptr) ? frame.sei_offset : frame.size;
+    bool ok = (head == 0 || fwrite(frame.data, head, 1, file_) == 1);
+    if (ok && frame.sei != nullptr) {
+        ok = fwrite(frame.sei, frame.sei_size, 1, file_) == 1 &&
+             (head == frame.size || fwrite(frame.data + head, frame.size - head, 1, file_) == 1);
+    }
+    if (!ok) {
+        base::LogError() << "Failed to write frame " << frame.index;
+    }
+}
+
+void C2FileSink::OnEndOfStream() {
+    if (file_ != nullptr) {
+        fflush(file_);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <string>
+
+#include "c2_output_sink.h"
+
+/** C2FileSink
+ *
+ * Output sink dumping the raw Annex-B elementary stream into a file.
+ **/
+class C2FileSink : public IC2OutputSink {
+public:
+    C2FileSink(const std::string &path);
+    ~C2FileSink();
+
+    bool IsOpen() const { return file_ != nullptr; }
+
+    void OnFrame(const C2EncodedFrame &frame) override;
+    void OnEndOfStream() override;
+    bool AcceptsSlices() const override { return true; }
+private:
+    FILE *file_;
+};
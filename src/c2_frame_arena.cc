@@ -0,0 +1,327 @@
+#include "c2_frame_arena.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+
+/// Stride and scanline alignments of the NV12 EXT layout.
+#define STRIDE_ALIGNMENT 128
+#define LUMA_SCANLINE_ALIGNMENT 32
+#define CHROMA_SCANLINE_ALIGNMENT 16
+/// Every plane starts on its own page.
+#define PLANE_ALIGNMENT 4096
+/// Size classes of frames mapped on small pages.
+#define SMALL_CLASS_ALIGNMENT (64 * 1024)
+/// Hugepage size when the kernel does not report one.
+#define DEFAULT_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+#define MEMINFO_PATH "/proc/meminfo"
+#define TRANSPARENT_HUGEPAGE_PATH "/sys/kernel/mm/transparent_hugepage/enabled"
+
+static size_t align(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/// Value in kB of a /proc/meminfo field, 0 if missing.
+static size_t meminfo_value(const std::string &field) {
+    std::ifstream meminfo(MEMINFO_PATH);
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0) {
+            return strtoull(line.c_str() + field.size() + 1, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+/// Transparent hugepages are available unless disabled system wide.
+static bool transparent_hugepages() {
+    std::ifstream enabled(TRANSPARENT_HUGEPAGE_PATH);
+    std::string modes;
+    return std::getline(enabled, modes) && modes.find("[never]") == std::string::npos;
+}
+
+C2FrameArena &C2FrameArena::Instance() {
+    // Never destroyed, frames may be released after static destruction.
+    static C2FrameArena *arena = new C2FrameArena();
+    return *arena;
+}
+
+C2FrameArena::C2FrameArena()
+    : hugepage_size_(DEFAULT_HUGEPAGE_SIZE),
+      explicit_(false),
+      transparent_(false),
+      generation_(0),
+      mapped_(0),
+      cached_(0),
+      hits_(0),
+      misses_(0),
+      explicit_maps_(0),
+      transparent_maps_(0),
+      small_maps_(0) {
+    size_t size = meminfo_value("Hugepagesize") * 1024;
+    if (size != 0) {
+        hugepage_size_ = size;
+    }
+    explicit_ = meminfo_value("HugePages_Total") > 0;
+    transparent_ = transparent_hugepages();
+}
+
+void C2FrameArena::Configure(const C2FrameArenaConfig &config) {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        config_ = config;
+        generation_++;
+        // The hugetlb pool may have been grown since the last failure.
+        explicit_ = meminfo_value("HugePages_Total") > 0;
+    }
+    Trim();
+}
+
+C2HugePages C2FrameArena::GetHugePages() {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (!config_.hugepages) {
+        return C2HugePages::kNone;
+    }
+    if (explicit_) {
+        return C2HugePages::kExplicit;
+    }
+    return transparent_ ? C2HugePages::kTransparent : C2HugePages::kNone;
+}
+
+size_t C2FrameArena::GetClass(size_t size) const {
+    if (config_.hugepages && (explicit_ || transparent_)) {
+        return align(size, hugepage_size_);
+    }
+    return align(size, SMALL_CLASS_ALIGNMENT);
+}
+
+std::shared_ptr<C2StreamBuffer> C2FrameArena::Acquire(C2PixelFormat format, uint32_t width,
+                                                      uint32_t height) {
+    size_t size = GetFrameSize(format, width, height);
+    if (size == 0) {
+        base::LogError() << "Invalid frame size " << width << "x" << height << " format "
+                         << static_cast<uint32_t>(format);
+        return nullptr;
+    }
+
+    C2HugePages pages = GetHugePages();
+    Block block;
+    bool cached = false;
+    uint64_t generation = 0;
+    size_t size_class = 0;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        size_class = GetClass(size);
+        generation = generation_;
+
+        auto it = cache_.find(size_class);
+        if (it != cache_.end()) {
+            block = it->second;
+            cache_.erase(it);
+            cached_ -= block.size;
+            hits_++;
+            cached = true;
+        } else {
+            misses_++;
+        }
+    }
+
+    if (!cached) {
+        if (!Map(size_class, pages, block)) {
+            return nullptr;
+        }
+        block.generation = generation;
+    }
+
+    C2StreamBuffer *buffer = new C2StreamBuffer();
+    DescribeFrame(block.data, format, width, height, *buffer);
+    return std::shared_ptr<C2StreamBuffer>(buffer, [block](C2StreamBuffer *buffer) {
+        C2FrameArena::Instance().Release(block);
+        delete buffer;
+    });
+}
+
+bool C2FrameArena::Map(size_t size, C2HugePages pages, Block &block) {
+    void *data = MAP_FAILED;
+
+    if (pages == C2HugePages::kExplicit) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+            // Pool exhausted or reserved by others, stop trying until reconfigured.
+            base::LogInfo() << "No explicit hugepages left, error: " << strerror(errno);
+            std::lock_guard<std::mutex> lk(lock_);
+            explicit_ = false;
+            pages = transparent_ ? C2HugePages::kTransparent : C2HugePages::kNone;
+        }
+    }
+
+    if (data == MAP_FAILED && pages == C2HugePages::kTransparent) {
+        // Over-reserve so that the frame can start on a hugepage boundary.
+        size_t reserved = size + hugepage_size_;
+        void *mapping = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping != MAP_FAILED) {
+            uint8_t *begin = static_cast<uint8_t *>(mapping);
+            uint8_t *aligned = reinterpret_cast<uint8_t *>(
+                align(reinterpret_cast<uintptr_t>(begin), hugepage_size_));
+            if (aligned != begin) {
+                munmap(begin, aligned - begin);
+            }
+            if (aligned + size != begin + reserved) {
+                munmap(aligned + size, begin + reserved - aligned - size);
+            }
+            data = aligned;
+            if (madvise(data, size, MADV_HUGEPAGE) != 0) {
+                pages = C2HugePages::kNone;
+            }
+        }
+    }
+
+    if (data == MAP_FAILED) {
+        pages = C2HugePages::kNone;
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data != MAP_FAILED) {
+            // Keep small pages even where transparent hugepages are always on.
+            madvise(data, size, MADV_NOHUGEPAGE);
+        }
+    }
+
+    if (data == MAP_FAILED) {
+        base::LogError() << "Failed to map " << size << " bytes frame, error: "
+                         << strerror(errno);
+        return false;
+    }
+
+    block.data = static_cast<uint8_t *>(data);
+    block.size = size;
+    block.pages = pages;
+
+    std::lock_guard<std::mutex> lk(lock_);
+    mapped_ += size;
+    switch (pages) {
+        case C2HugePages::kExplicit:
+            explicit_maps_++;
+            break;
+        case C2HugePages::kTransparent:
+            transparent_maps_++;
+            break;
+        default:
+            small_maps_++;
+            break;
+    }
+    return true;
+}
+
+void C2FrameArena::Release(const Block &block) {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (block.generation == generation_ &&
+            cached_ + block.size <= config_.max_cached_bytes) {
+            // Most recently released first, likely still in the caches.
+            cache_.emplace_hint(cache_.lower_bound(block.size), block.size, block);
+            cached_ += block.size;
+            return;
+        }
+        mapped_ -= block.size;
+    }
+    munmap(block.data, block.size);
+}
+
+size_t C2FrameArena::Trim() {
+    std::vector<Block> freed;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        for (auto &entry : cache_) {
+            freed.push_back(entry.second);
+        }
+        cache_.clear();
+        mapped_ -= cached_;
+        cached_ = 0;
+    }
+
+    size_t bytes = 0;
+    for (const Block &block : freed) {
+        munmap(block.data, block.size);
+        bytes += block.size;
+    }
+    return bytes;
+}
+
+void C2FrameArena::GetUsage(C2FrameArenaUsage &usage) {
+    std::lock_guard<std::mutex> lk(lock_);
+    usage.mapped = mapped_;
+    usage.cached = cached_;
+    usage.hits = hits_;
+    usage.misses = misses_;
+    usage.explicit_maps = explicit_maps_;
+    usage.transparent_maps = transparent_maps_;
+    usage.small_maps = small_maps_;
+}
+
+uint32_t C2FrameArena::GetFrameSize(C2PixelFormat format, uint32_t width, uint32_t height) {
+    C2StreamBuffer buffer = {};
+    DescribeFrame(nullptr, format, width, height, buffer);
+    return buffer.size;
+}
+
+void C2FrameArena::DescribeFrame(uint8_t *data, C2PixelFormat format, uint32_t width,
+                                 uint32_t height, C2StreamBuffer &buffer) {
+    uint32_t luma_scanlines = align(height, LUMA_SCANLINE_ALIGNMENT);
+    uint32_t chroma_scanlines = align(height / 2, CHROMA_SCANLINE_ALIGNMENT);
+
+    buffer.data = data;
+    buffer.width = width;
+    buffer.height = height;
+    buffer.pixel_format = format;
+    buffer.isubwc = false;
+    buffer.offset[0] = 0;
+
+    switch (format) {
+        case C2PixelFormat::kRGBA:
+        case C2PixelFormat::kY210:
+            buffer.planes = 1;
+            buffer.stride[0] = align(width * 4, STRIDE_ALIGNMENT);
+            buffer.size = align(buffer.stride[0] * luma_scanlines, PLANE_ALIGNMENT);
+            break;
+        case C2PixelFormat::kYV12:
+        case C2PixelFormat::kI420:
+        case C2PixelFormat::kI010: {
+            uint32_t sample = (format == C2PixelFormat::kI010) ? 2 : 1;
+            buffer.planes = 3;
+            buffer.stride[0] = align(width * sample, STRIDE_ALIGNMENT);
+            buffer.stride[1] = align(width / 2 * sample, STRIDE_ALIGNMENT);
+            buffer.stride[2] = buffer.stride[1];
+            buffer.offset[1] = align(buffer.stride[0] * luma_scanlines, PLANE_ALIGNMENT);
+            buffer.offset[2] = buffer.offset[1] +
+                               align(buffer.stride[1] * chroma_scanlines, PLANE_ALIGNMENT);
+            buffer.size = buffer.offset[2] +
+                          align(buffer.stride[2] * chroma_scanlines, PLANE_ALIGNMENT);
+            break;
+        }
+        case C2PixelFormat::kNV12:
+        case C2PixelFormat::kP010: {
+            // Interleaved chroma with the stride of the luma.
+            uint32_t sample = (format == C2PixelFormat::kP010) ? 2 : 1;
+            buffer.planes = 2;
+            buffer.stride[0] = align(width * sample, STRIDE_ALIGNMENT);
+            buffer.stride[1] = buffer.stride[0];
+            buffer.offset[1] = align(buffer.stride[0] * luma_scanlines, PLANE_ALIGNMENT);
+            buffer.size = buffer.offset[1] +
+                          align(buffer.stride[1] * chroma_scanlines, PLANE_ALIGNMENT);
+            break;
+        }
+        default:
+            // Compressed and unknown formats have no linear layout.
+            buffer.planes = 0;
+            buffer.size = 0;
+            break;
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "c2_common.h"
+
+/// Pages backing the frames of the arena.
+enum class C2HugePages {
+    kNone,
+    /// Transparent hugepages, requested with madvise() from the kernel.
+    kTransparent,
+    /// Explicit hugepages, reserved in the hugetlb pool.
+    kExplicit,
+};
+
+struct C2FrameArenaConfig {
+    /// Back frames with hugepages when the system provides them, explicit ones
+    /// first, then transparent ones. Disabled, frames are kept on small pages.
+    bool hugepages = true;
+    /// Released frames kept for reuse, frames released beyond it are unmapped.
+    size_t max_cached_bytes = 256 * 1024 * 1024;
+};
+
+struct C2FrameArenaUsage {
+    /// Bytes mapped for frames in use and cached.
+    size_t mapped;
+    size_t cached;
+    /// Acquires served from the cache and acquires which mapped memory.
+    uint64_t hits;
+    uint64_t misses;
+    /// Mappings made with every kind of pages.
+    uint64_t explicit_maps;
+    uint64_t transparent_maps;
+    uint64_t small_maps;
+};
+
+/** C2FrameArena
+ *
+ * Process wide staging memory for frames filled by the CPU before the engine
+ * copies them into its graphic blocks. Frames are mapped on hugepages when
+ * available, so that copying a 4K frame touches a handful of TLB entries
+ * instead of thousands, and are recycled by size class instead of going back
+ * to the heap after every frame.
+ *
+ * Planes are laid out like the NV12 EXT graphic blocks: strides aligned to 128
+ * bytes, scanlines to 32 rows for luma and 16 for chroma, and every plane
+ * starting on a page boundary.
+ **/
+class C2FrameArena {
+public:
+    static C2FrameArena &Instance();
+
+    /**
+     * @brief Apply the configuration, cached frames are unmapped and frames
+     * in use are unmapped once released.
+     */
+    void Configure(const C2FrameArenaConfig &config);
+
+    /**
+     * @brief Get a frame from the cache or map a new one.
+     * @param format: Pixel format of the frame.
+     * @param width: Frame width in pixels.
+     * @param height: Frame height in pixels.
+     *
+     * @return: Frame descriptor returning its memory to the arena when
+     * destroyed, empty shared pointer if no memory could be mapped.
+     */
+    std::shared_ptr<C2StreamBuffer> Acquire(C2PixelFormat format, uint32_t width,
+                                            uint32_t height);
+
+    /**
+     * @brief Unmap every cached frame.
+     * @return: Number of bytes unmapped.
+     */
+    size_t Trim();
+
+    void GetUsage(C2FrameArenaUsage &usage);
+
+    /**
+     * @brief Best pages the arena maps frames on with the current configuration.
+     */
+    C2HugePages GetHugePages();
+
+    /**
+     * @brief Size of an aligned frame, see DescribeFrame() for the layout. Zero for
+     * the compressed (UBWC) and unknown formats, which have no linear layout.
+     */
+    static uint32_t GetFrameSize(C2PixelFormat format, uint32_t width, uint32_t height);
+    /**
+     * @brief Describe the planes of an aligned frame stored at data.
+     * @param buffer: Filled with the data, size, dimensions and plane layout.
+     */
+    static void DescribeFrame(uint8_t *data, C2PixelFormat format, uint32_t width,
+                              uint32_t height, C2StreamBuffer &buffer);
+private:
+    struct Block {
+        uint8_t *data;
+        size_t size;
+        C2HugePages pages;
+        /// Configuration the block was mapped with.
+        uint64_t generation;
+    };
+
+    C2FrameArena();
+
+    /// Size class of a frame, i.e. the size mapped for it.
+    size_t GetClass(size_t size) const;
+    bool Map(size_t size, C2HugePages pages, Block &block);
+    void Release(const Block &block);
+
+    C2FrameArenaConfig config_;
+    /// Hugepage size and the kinds of hugepages available.
+    size_t hugepage_size_;
+    bool explicit_;
+    bool transparent_;
+
+    std::mutex lock_;
+    /// Cached blocks by size class.
+    std::multimap<size_t, Block> cache_;
+    uint64_t generation_;
+
+    size_t mapped_;
+    size_t cached_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t explicit_maps_;
+    uint64_t transparent_maps_;
+    uint64_t small_maps_;
+};
@@ -0,0 +1,129 @@
+#include "c2_frame_future.h"
+
+#include <algorithm>
+#include <chrono>
+
+C2WorkerExecutor::C2WorkerExecutor(size_t threads) : stop_(false) {
+    for (size_t idx = 0; idx < std::max<size_t>(threads, 1); idx++) {
+        threads_.emplace_back(&C2WorkerExecutor::Loop, this);
+    }
+}
+
+C2WorkerExecutor::~C2WorkerExecutor() {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        stop_ = true;
+    }
+    wakeup_.notify_all();
+
+    for (std::thread &thread : threads_) {
+        thread.join();
+    }
+}
+
+void C2WorkerExecutor::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        tasks_.push_back(std::move(task));
+    }
+    wakeup_.notify_one();
+}
+
+void C2WorkerExecutor::Loop() {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (true) {
+        wakeup_.wait(lk, [this] { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+            return;
+        }
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+
+        lk.unlock();
+        task();
+        lk.lock();
+    }
+}
+
+C2FrameState::C2FrameState(uint64_t timestamp) : ready_(false), executor_(nullptr) {
+    result_.timestamp = timestamp;
+}
+
+void C2FrameState::SetIndex(uint64_t index) {
+    std::lock_guard<std::mutex> lk(lock_);
+    result_.index = index;
+}
+
+bool C2FrameState::Complete(C2FrameResult &&result) {
+    Continuation callback;
+    C2Executor *executor;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (ready_) {
+            return false;
+        }
+        result_ = std::move(result);
+        ready_ = true;
+        callback.swap(callback_);
+        executor = executor_;
+    }
+    done_.notify_all();
+
+    if (callback) {
+        Run(callback, executor);
+    }
+    return true;
+}
+
+bool C2FrameState::Complete(C2FrameStatus status) {
+    C2FrameResult result;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        result.index = result_.index;
+        result.timestamp = result_.timestamp;
+    }
+    result.status = status;
+    return Complete(std::move(result));
+}
+
+bool C2FrameState::IsReady() {
+    std::lock_guard<std::mutex> lk(lock_);
+    return ready_;
+}
+
+bool C2FrameState::Wait(uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lk(lock_);
+    return done_.wait_for(lk, std::chrono::milliseconds(timeout_ms), [this] { return ready_; });
+}
+
+const C2FrameResult &C2FrameState::Get() {
+    std::unique_lock<std::mutex> lk(lock_);
+    done_.wait(lk, [this] { return ready_; });
+    // Not modified once ready.
+    return result_;
+}
+
+void C2FrameState::Then(Continuation callback, C2Executor *executor) {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (!ready_) {
+            callback_ = std::move(callback);
+            executor_ = executor;
+            return;
+        }
+    }
+    Run(callback, executor);
+}
+
+void C2FrameState::Run(Continuation &callback, C2Executor *executor) {
+    if (executor == nullptr) {
+        callback(result_);
+        return;
+    }
+
+    // The task keeps the state, and so the result, alive until it ran.
+    std::shared_ptr<C2FrameState> self = shared_from_this();
+    Continuation task = std::move(callback);
+    executor->Post([self, task]() { task(self->result_); });
+}
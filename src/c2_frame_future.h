@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class C2FrameStatus : uint32_t {
+    kPending,
+    /// Encoded output available in the result.
+    kEncoded,
+    /// Returned by the component without output, or lost in a stall recovery.
+    kDropped,
+    /// Static frame not submitted by the scene detection.
+    kSkipped,
+    /// Dropped before submission because its latency budget deadline passed.
+    kExpired,
+    /// The frame could not be submitted.
+    kError,
+    /// The engine was stopped before the frame completed.
+    kCancelled,
+};
+
+/** C2FrameResult
+ *
+ * Outcome of one submitted frame. The encoded data is a copy of the whole
+ * frame, slices assembled and the timestamp SEI inserted.
+ **/
+struct C2FrameResult {
+    C2FrameStatus status = C2FrameStatus::kPending;
+    uint64_t index = 0;
+    uint64_t timestamp = 0;
+    /// C2FrameData flags of the output and whether it is a sync frame.
+    uint32_t flags = 0;
+    bool sync = false;
+    std::vector<uint8_t> data;
+};
+
+/** C2Executor
+ *
+ * Runs continuations of frame futures away from the component callback.
+ **/
+class C2Executor {
+public:
+    virtual ~C2Executor(){};
+
+    virtual void Post(std::function<void()> task) = 0;
+};
+
+/** C2WorkerExecutor
+ *
+ * Fixed set of threads running posted tasks in posting order, shared by any
+ * number of engines and in-flight frames.
+ **/
+class C2WorkerExecutor : public C2Executor {
+public:
+    explicit C2WorkerExecutor(size_t threads);
+    /**
+     * @brief Run the tasks still queued, then join the threads.
+     */
+    ~C2WorkerExecutor();
+
+    void Post(std::function<void()> task) override;
+private:
+    void Loop();
+
+    std::vector<std::thread> threads_;
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::deque<std::function<void()>> tasks_;
+    bool stop_;
+};
+
+/** C2FrameState
+ *
+ * State shared by the engine completing a frame and the futures waiting on
+ * it. The first completion wins, later ones are ignored.
+ **/
+class C2FrameState : public std::enable_shared_from_this<C2FrameState> {
+public:
+    using Continuation = std::function<void(const C2FrameResult &)>;
+
+    explicit C2FrameState(uint64_t timestamp);
+
+    /**
+     * @brief Set the frame index reported with a result without output.
+     */
+    void SetIndex(uint64_t index);
+
+    /**
+     * @brief Store the result and run the continuation on the calling thread
+     * or post it to its executor.
+     *
+     * @return: false if the frame was already complete.
+     */
+    bool Complete(C2FrameResult &&result);
+    bool Complete(C2FrameStatus status);
+
+    bool IsReady();
+    bool Wait(uint32_t timeout_ms);
+    const C2FrameResult &Get();
+    void Then(Continuation callback, C2Executor *executor);
+private:
+    void Run(Continuation &callback, C2Executor *executor);
+
+    std::mutex lock_;
+    std::condition_variable done_;
+    bool ready_;
+    C2FrameResult result_;
+    Continuation callback_;
+    C2Executor *executor_;
+};
+
+/** C2FrameFuture
+ *
+ * Handle on the outcome of a submitted frame, cheap to copy. Waiting blocks
+ * the caller, Then() does not.
+ **/
+class C2FrameFuture {
+public:
+    C2FrameFuture() {}
+    explicit C2FrameFuture(std::shared_ptr<C2FrameState> state) : state_(state) {}
+
+    bool Valid() const { return state_ != nullptr; }
+    bool IsReady() const { return state_->IsReady(); }
+
+    /**
+     * @brief Wait for the frame to complete.
+     *
+     * @return: false on timeout.
+     */
+    bool Wait(uint32_t timeout_ms) const { return state_->Wait(timeout_ms); }
+    /**
+     * @brief Wait for the frame to complete and return its result.
+     */
+    const C2FrameResult &Get() const { return state_->Get(); }
+
+    /**
+     * @brief Call back once the frame completes, right away if it already
+     * has. Without executor the callback runs on the thread completing the
+     * frame, usually the component callback, and must not block. Only one
+     * continuation is kept per frame.
+     */
+    void Then(C2FrameState::Continuation callback, C2Executor *executor = nullptr) {
+        state_->Then(std::move(callback), executor);
+    }
+private:
+    std::shared_ptr<C2FrameState> state_;
+};
@@ -0,0 +1,269 @@
+#include "c2_frame_source.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+
+#include "base/log.h"
+#include "c2_stats.h"
+
+#define Y4M_MAGIC "YUV4MPEG2 "
+#define Y4M_FRAME "FRAME"
+
+C2FrameSource::C2FrameSource(const C2FrameSourceConfig &config)
+    : config_(config),
+      fd_(-1),
+      mapping_(nullptr),
+      mapping_size_(0),
+      position_(0),
+      start_time_(0) {}
+
+C2FrameSource::~C2FrameSource() {
+    Close();
+}
+
+uint32_t C2FrameSource::GetFrameSize(C2PixelFormat format, uint32_t width, uint32_t height) {
+    uint32_t pixels = width * height;
+
+    switch (format) {
+        case C2PixelFormat::kRGBA:
+        case C2PixelFormat::kY210:
+            return pixels * 4;
+        case C2PixelFormat::kP010:
+        case C2PixelFormat::kI010:
+            return pixels * 3;
+        default:
+            return pixels * 3 / 2;
+    }
+}
+
+uint32_t C2FrameSource::FrameSize() const {
+    return GetFrameSize(config_.pixel_format, config_.width, config_.height);
+}
+
+bool C2FrameSource::Open() {
+    fd_ = open(config_.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        base::LogError() << "Failed to open " << config_.path << ", error: " << strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+        base::LogError() << "Failed to stat " << config_.path;
+        Close();
+        return false;
+    }
+
+    mapping_size_ = st.st_size;
+    void *mapping = mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        base::LogError() << "Failed to map " << config_.path << ", error: " << strerror(errno);
+        mapping_size_ = 0;
+        Close();
+        return false;
+    }
+    mapping_ = static_cast<uint8_t *>(mapping);
+    madvise(mapping_, mapping_size_, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    bool y4m = mapping_size_ > strlen(Y4M_MAGIC) &&
+               memcmp(mapping_, Y4M_MAGIC, strlen(Y4M_MAGIC)) == 0;
+
+    if (y4m) {
+        if (!ParseY4MHeader()) {
+            Close();
+            return false;
+        }
+    } else {
+        if (config_.width == 0 || config_.height == 0) {
+            base::LogError() << "Raw input " << config_.path << " requires width and height";
+            Close();
+            return false;
+        }
+        for (size_t offset = 0; offset + FrameSize() <= mapping_size_; offset += FrameSize()) {
+            offsets_.push_back(offset);
+        }
+    }
+
+    if (offsets_.empty()) {
+        base::LogError() << "No complete frame in " << config_.path;
+        Close();
+        return false;
+    }
+
+    base::LogInfo() << "Mapped " << config_.path << ": " << config_.width << "x"
+                    << config_.height << ", " << offsets_.size() << " frames";
+    return true;
+}
+
+bool C2FrameSource::ParseY4MHeader() {
+    const char *header = reinterpret_cast<const char *>(mapping_);
+    const char *end = static_cast<const char *>(memchr(header, '\n', mapping_size_));
+    if (end == nullptr) {
+        base::LogError() << "Truncated Y4M header";
+        return false;
+    }
+
+    std::istringstream tokens(std::string(header + strlen(Y4M_MAGIC), end));
+    std::string token;
+    while (tokens >> token) {
+        switch (token[0]) {
+            case 'W':
+                config_.width = atoi(token.c_str() + 1);
+                break;
+            case 'H':
+                config_.height = atoi(token.c_str() + 1);
+                break;
+            case 'F': {
+                uint32_t num = 0, den = 0;
+                if (sscanf(token.c_str() + 1, "%u:%u", &num, &den) == 2 && den != 0) {
+                    config_.framerate = static_cast<float>(num) / den;
+                }
+                break;
+            }
+            case 'C':
+                // 8-bit 4:2:0 only, the chroma siting variants share the layout.
+                if (token != "C420" && token != "C420jpeg" && token != "C420paldv" &&
+                    token != "C420mpeg2") {
+                    base::LogError() << "Unsupported Y4M colorspace " << token;
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Y4M carries planar 4:2:0 with the U plane first.
+    config_.pixel_format = C2PixelFormat::kI420;
+
+    size_t offset = end - header + 1;
+    while (offset + strlen(Y4M_FRAME) < mapping_size_) {
+        if (memcmp(mapping_ + offset, Y4M_FRAME, strlen(Y4M_FRAME)) != 0) {
+            base::LogError() << "Invalid Y4M frame header at " << offset;
+            return false;
+        }
+
+        const void *eol = memchr(mapping_ + offset, '\n', mapping_size_ - offset);
+        if (eol == nullptr) {
+            break;
+        }
+
+        size_t payload = static_cast<const uint8_t *>(eol) - mapping_ + 1;
+        if (payload + FrameSize() > mapping_size_) {
+            break;
+        }
+
+        offsets_.push_back(payload);
+        offset = payload + FrameSize();
+    }
+
+    return true;
+}
+
+void C2FrameSource::Close() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+
+    offsets_.clear();
+}
+
+bool C2FrameSource::Next(C2StreamBuffer &buffer) {
+    if (offsets_.empty() || (!config_.loop && position_ >= offsets_.size())) {
+        return false;
+    }
+
+    // In double, float timestamps lose microsecond precision within the hour.
+    uint64_t timestamp = static_cast<uint64_t>(position_ * 1000000.0 / config_.framerate);
+
+    if (config_.paced) {
+        uint64_t now = C2Stats::Now();
+        if (position_ == 0) {
+            start_time_ = now;
+        } else if (start_time_ + timestamp > now) {
+            uint64_t wait = start_time_ + timestamp - now;
+            struct timespec ts = {static_cast<time_t>(wait / 1000000),
+                                  static_cast<long>((wait % 1000000) * 1000)};
+            nanosleep(&ts, nullptr);
+        }
+    }
+
+    DescribeFrame(mapping_ + offsets_[position_ % offsets_.size()], config_.pixel_format,
+                  config_.width, config_.height, buffer);
+    buffer.timestamp = timestamp;
+
+    position_++;
+    return true;
+}
+
+void C2FrameSource::DescribeFrame(uint8_t *data, C2PixelFormat format, uint32_t width,
+                                  uint32_t height, C2StreamBuffer &buffer) {
+    buffer.data = data;
+    buffer.size = GetFrameSize(format, width, height);
+    buffer.width = width;
+    buffer.height = height;
+    buffer.pixel_format = format;
+    buffer.isubwc = false;
+
+    switch (format) {
+        case C2PixelFormat::kYV12:
+        case C2PixelFormat::kI420:
+            // Planes in memory order, Y, V, U for YV12 and Y, U, V for I420.
+            buffer.planes = 3;
+            buffer.offset[0] = 0;
+            buffer.offset[1] = width * height;
+            buffer.offset[2] = width * height + (width / 2) * (height / 2);
+            buffer.stride[0] = width;
+            buffer.stride[1] = width / 2;
+            buffer.stride[2] = width / 2;
+            break;
+        case C2PixelFormat::kRGBA:
+            buffer.planes = 1;
+            buffer.offset[0] = 0;
+            buffer.stride[0] = width * 4;
+            break;
+        case C2PixelFormat::kP010:
+            buffer.planes = 2;
+            buffer.offset[0] = 0;
+            buffer.offset[1] = width * height * 2;
+            buffer.stride[0] = width * 2;
+            buffer.stride[1] = width * 2;
+            break;
+        case C2PixelFormat::kI010:
+            buffer.planes = 3;
+            buffer.offset[0] = 0;
+            buffer.offset[1] = width * height * 2;
+            buffer.offset[2] = width * height * 2 + (width / 2) * (height / 2) * 2;
+            buffer.stride[0] = width * 2;
+            buffer.stride[1] = width;
+            buffer.stride[2] = width;
+            break;
+        case C2PixelFormat::kY210:
+            buffer.planes = 1;
+            buffer.offset[0] = 0;
+            buffer.stride[0] = width * 4;
+            break;
+        default:
+            buffer.planes = 2;
+            buffer.offset[0] = 0;
+            buffer.offset[1] = width * height;
+            buffer.stride[0] = width;
+            buffer.stride[1] = width;
+            break;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "c2_common.h"
+
+struct C2FrameSourceConfig {
+    /// Raw YUV file or YUV4MPEG2 (.y4m) file.
+    std::string path;
+    /// Frame size and layout of raw files, taken from the header for Y4M.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    C2PixelFormat pixel_format = C2PixelFormat::kNV12;
+    /// Frame rate used for the timestamps and for pacing, Y4M header overrides it.
+    float framerate = 30.0;
+    /// Restart from the first frame once the end of the file is reached.
+    bool loop = false;
+    /// Hand out frames at the frame rate instead of as fast as possible.
+    bool paced = true;
+};
+
+/** C2FrameSource
+ *
+ * Memory mapped reader of raw YUV and Y4M files. Frames are handed out as
+ * C2StreamBuffer descriptors pointing into the mapping, nothing is copied
+ * until the engine fills its graphic block.
+ **/
+class C2FrameSource {
+public:
+    C2FrameSource(const C2FrameSourceConfig &config);
+    ~C2FrameSource();
+
+    /**
+     * @brief Map the file and index its frames.
+     *
+     * @return: true on success or false on failure.
+     */
+    bool Open();
+    void Close();
+
+    /**
+     * @brief Describe the next frame, in paced mode wait until it is due.
+     * @param buffer: Filled with the frame layout, data and timestamp.
+     *
+     * @return: false once the end of the file is reached and looping is disabled.
+     */
+    bool Next(C2StreamBuffer &buffer);
+
+    uint32_t GetWidth() const { return config_.width; }
+    uint32_t GetHeight() const { return config_.height; }
+    float GetFramerate() const { return config_.framerate; }
+    uint32_t GetFrameCount() const { return offsets_.size(); }
+
+    /**
+     * @brief Size of a tightly packed frame, planes stored one after the other.
+     */
+    static uint32_t GetFrameSize(C2PixelFormat format, uint32_t width, uint32_t height);
+    /**
+     * @brief Describe the planes of a tightly packed frame stored at data.
+     * @param buffer: Filled with the data, size, dimensions and plane layout.
+     */
+    static void DescribeFrame(uint8_t *data, C2PixelFormat format, uint32_t width,
+                              uint32_t height, C2StreamBuffer &buffer);
+private:
+    bool ParseY4MHeader();
+    uint32_t FrameSize() const;
+
+    C2FrameSourceConfig config_;
+    int fd_;
+    uint8_t *mapping_;
+    size_t mapping_size_;
+
+    /// Offset of every frame payload in the mapping.
+    std::vector<size_t> offsets_;
+    uint64_t position_;
+    uint64_t start_time_;
+};
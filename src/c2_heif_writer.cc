@@ -0,0 +1,250 @@
+#include "c2_heif_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+#include "c2_mp4_box.h"
+
+/// The grid is the primary item, tiles follow in raster order.
+#define GRID_ITEM_ID 1
+#define FIRST_TILE_ITEM_ID 2
+/// ImageGrid stores rows and columns minus one in 8 bits.
+#define MAX_GRID_DIMENSION 256
+/// Item ID and reference counts are 16 bit fields.
+#define MAX_TILES (65535 - FIRST_TILE_ITEM_ID)
+
+// infe flag marking items which are not displayed on their own.
+#define INFE_HIDDEN 0x000001
+// ipma property index with the essential bit.
+#define IPMA_ESSENTIAL 0x80
+
+// Property indexes within ipco, starting at 1.
+#define PROPERTY_HVCC 1
+#define PROPERTY_TILE_ISPE 2
+#define PROPERTY_IMAGE_ISPE 3
+
+/// Size of the ImageGrid descriptor stored ahead of the tiles.
+static uint32_t grid_descriptor_size(const C2HeifGrid &grid) {
+    bool large = grid.width > 0xFFFF || grid.height > 0xFFFF;
+    return 4 + (large ? 8 : 4);
+}
+
+bool C2HeifWriter::BuildHeader(const C2HeifGrid &grid, const C2CodecConfig &config,
+                               const std::vector<std::vector<uint8_t>> &tiles,
+                               std::vector<uint8_t> &header) {
+    uint32_t count = grid.columns * grid.rows;
+    if (grid.columns == 0 || grid.rows == 0 || grid.columns > MAX_GRID_DIMENSION ||
+        grid.rows > MAX_GRID_DIMENSION || count > MAX_TILES || tiles.size() != count) {
+        base::LogError() << "Invalid HEIF grid " << grid.columns << "x" << grid.rows << " with "
+                         << tiles.size() << " tiles";
+        return false;
+    }
+    if (grid.columns * grid.tile_width < grid.width ||
+        grid.rows * grid.tile_height < grid.height) {
+        base::LogError() << "HEIF grid does not cover the " << grid.width << "x" << grid.height
+                         << " image";
+        return false;
+    }
+
+    C2BoxWriter writer;
+
+    size_t ftyp = writer.Begin("ftyp");
+    writer.FourCC("heic");
+    writer.U32(0);
+    writer.FourCC("mif1");
+    writer.FourCC("heic");
+    writer.End(ftyp);
+
+    size_t meta = writer.BeginFull("meta", 0, 0);
+
+    size_t hdlr = writer.BeginFull("hdlr", 0, 0);
+    writer.U32(0);  // pre_defined
+    writer.FourCC("pict");
+    writer.Zeros(12);
+    writer.U8(0);   // name
+    writer.End(hdlr);
+
+    size_t pitm = writer.BeginFull("pitm", 0, 0);
+    writer.U16(GRID_ITEM_ID);
+    writer.End(pitm);
+
+    // Extent offsets are relative to the mdat payload until patched below.
+    std::vector<size_t> offsets;
+    size_t iloc = writer.BeginFull("iloc", 0, 0);
+    writer.U8((4 << 4) | 4);  // offset_size, length_size
+    writer.U8(0);             // base_offset_size
+    writer.U16(count + 1);
+
+    uint32_t position = grid_descriptor_size(grid);
+    writer.U16(GRID_ITEM_ID);
+    writer.U16(0);  // data_reference_index
+    writer.U16(1);  // extent_count
+    offsets.push_back(writer.Size());
+    writer.U32(0);
+    writer.U32(position);
+
+    for (uint32_t idx = 0; idx < count; idx++) {
+        writer.U16(FIRST_TILE_ITEM_ID + idx);
+        writer.U16(0);
+        writer.U16(1);
+        offsets.push_back(writer.Size());
+        writer.U32(position);
+        writer.U32(tiles[idx].size());
+        position += tiles[idx].size();
+    }
+    writer.End(iloc);
+
+    size_t iinf = writer.BeginFull("iinf", 0, 0);
+    writer.U16(count + 1);
+
+    size_t infe = writer.BeginFull("infe", 2, 0);
+    writer.U16(GRID_ITEM_ID);
+    writer.U16(0);  // item_protection_index
+    writer.FourCC("grid");
+    writer.U8(0);   // item_name
+    writer.End(infe);
+
+    for (uint32_t idx = 0; idx < count; idx++) {
+        infe = writer.BeginFull("infe", 2, INFE_HIDDEN);
+        writer.U16(FIRST_TILE_ITEM_ID + idx);
+        writer.U16(0);
+        writer.FourCC("hvc1");
+        writer.U8(0);
+        writer.End(infe);
+    }
+    writer.End(iinf);
+
+    size_t iref = writer.BeginFull("iref", 0, 0);
+    size_t dimg = writer.Begin("dimg");
+    writer.U16(GRID_ITEM_ID);
+    writer.U16(count);
+    for (uint32_t idx = 0; idx < count; idx++) {
+        writer.U16(FIRST_TILE_ITEM_ID + idx);
+    }
+    writer.End(dimg);
+    writer.End(iref);
+
+    size_t iprp = writer.Begin("iprp");
+    size_t ipco = writer.Begin("ipco");
+    if (!C2Mp4Utils::WriteHvcC(writer, config)) {
+        base::LogError() << "Invalid HEVC parameter sets for the HEIF tiles";
+        return false;
+    }
+
+    size_t ispe = writer.BeginFull("ispe", 0, 0);
+    writer.U32(grid.tile_width);
+    writer.U32(grid.tile_height);
+    writer.End(ispe);
+
+    ispe = writer.BeginFull("ispe", 0, 0);
+    writer.U32(grid.width);
+    writer.U32(grid.height);
+    writer.End(ispe);
+    writer.End(ipco);
+
+    size_t ipma = writer.BeginFull("ipma", 0, 0);
+    writer.U32(count + 1);
+    writer.U16(GRID_ITEM_ID);
+    writer.U8(1);
+    writer.U8(PROPERTY_IMAGE_ISPE);
+    for (uint32_t idx = 0; idx < count; idx++) {
+        writer.U16(FIRST_TILE_ITEM_ID + idx);
+        writer.U8(2);
+        writer.U8(IPMA_ESSENTIAL | PROPERTY_HVCC);
+        writer.U8(PROPERTY_TILE_ISPE);
+    }
+    writer.End(ipma);
+    writer.End(iprp);
+
+    writer.End(meta);
+
+    // The mdat payload starts right after its 8 byte header.
+    uint32_t payload = writer.Size() + 8;
+    for (size_t offset : offsets) {
+        std::vector<uint8_t> &data = writer.Data();
+        uint32_t relative = (data[offset] << 24) | (data[offset + 1] << 16) |
+                            (data[offset + 2] << 8) | data[offset + 3];
+        writer.Patch32(offset, payload + relative);
+    }
+
+    writer.U32(8 + position);
+    writer.FourCC("mdat");
+
+    // ImageGrid, 32 bit output size only when required.
+    bool large = grid.width > 0xFFFF || grid.height > 0xFFFF;
+    writer.U8(0);  // version
+    writer.U8(large ? 1 : 0);
+    writer.U8(grid.rows - 1);
+    writer.U8(grid.columns - 1);
+    if (large) {
+        writer.U32(grid.width);
+        writer.U32(grid.height);
+    } else {
+        writer.U16(grid.width);
+        writer.U16(grid.height);
+    }
+
+    header = std::move(writer.Data());
+    return true;
+}
+
+bool C2HeifWriter::Write(const std::string &path, const C2HeifGrid &grid,
+                         const C2CodecConfig &config,
+                         const std::vector<std::vector<uint8_t>> &tiles) {
+    std::vector<uint8_t> header;
+    if (!BuildHeader(grid, config, tiles, header)) {
+        return false;
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        base::LogError() << "Failed to open " << path << ", error: " << strerror(errno);
+        return false;
+    }
+
+    // The tiles are written from where they were collected, without a copy.
+    std::vector<struct iovec> iov;
+    iov.reserve(tiles.size() + 1);
+    iov.push_back({header.data(), header.size()});
+    for (const std::vector<uint8_t> &tile : tiles) {
+        if (!tile.empty()) {
+            iov.push_back({const_cast<uint8_t *>(tile.data()), tile.size()});
+        }
+    }
+
+    size_t first = 0;
+    while (first < iov.size()) {
+        int count = std::min<size_t>(iov.size() - first, IOV_MAX);
+        ssize_t result = writev(fd, iov.data() + first, count);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            base::LogError() << "Failed to write " << path << ", error: " << strerror(errno);
+            break;
+        }
+
+        size_t remaining = result;
+        while (first < iov.size() && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            first++;
+        }
+        if (remaining > 0) {
+            iov[first].iov_base = static_cast<uint8_t *>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+
+    bool ok = (first == iov.size());
+    if (close(fd) != 0) {
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "c2_nal_parser.h"
+
+/** C2HeifGrid
+ *
+ * Layout of an image coded as a grid of equally sized tiles. Tiles on the
+ * right and bottom edges may extend past the image, the grid crops them.
+ **/
+struct C2HeifGrid {
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_width;
+    uint32_t tile_height;
+    uint32_t columns;
+    uint32_t rows;
+};
+
+/** C2HeifWriter
+ *
+ * Writer of HEIF still image files holding one grid item derived from hidden
+ * HEVC coded tile items. Tiles share the hvcC configuration of the encoder
+ * and are stored in raster order as length prefixed NAL units, without
+ * parameter sets.
+ **/
+class C2HeifWriter {
+public:
+    /**
+     * @brief Build the ftyp and meta boxes and the mdat header preceding the
+     * tile data. Item locations refer to the tiles following the header.
+     * @param grid: Image and tile layout.
+     * @param config: Parameter sets of the tiles.
+     * @param tiles: Coded tiles in raster order.
+     * @param header: Filled with the file content up to the first tile.
+     *
+     * @return: true on success or false if the grid or the config is invalid.
+     */
+    static bool BuildHeader(const C2HeifGrid &grid, const C2CodecConfig &config,
+                            const std::vector<std::vector<uint8_t>> &tiles,
+                            std::vector<uint8_t> &header);
+
+    /**
+     * @brief Write a complete HEIF file.
+     *
+     * @return: true on success or false on failure.
+     */
+    static bool Write(const std::string &path, const C2HeifGrid &grid,
+                      const C2CodecConfig &config,
+                      const std::vector<std::vector<uint8_t>> &tiles);
+};
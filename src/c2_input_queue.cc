@@ -0,0 +1,147 @@
+#include "c2_input_queue.h"
+
+#include "base/log.h"
+#include "c2_stats.h"
+
+C2InputQueue::C2InputQueue(const C2LatencyBudgetConfig &config, SubmitCallback submit,
+                           DropCallback drop, CancelCallback cancel,
+                           InFlightCallback in_flight)
+    : config_(config),
+      submit_(submit),
+      drop_(drop),
+      cancel_(cancel),
+      in_flight_(in_flight),
+      running_(false),
+      gap_(false) {
+    if (config_.queue_depth == 0) {
+        config_.queue_depth = 1;
+    }
+    if (config_.max_in_flight == 0) {
+        config_.max_in_flight = 1;
+    }
+}
+
+C2InputQueue::~C2InputQueue() {
+    Stop();
+}
+
+void C2InputQueue::Start() {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (running_) {
+        return;
+    }
+
+    running_ = true;
+    gap_ = false;
+    thread_ = std::thread(&C2InputQueue::Loop, this);
+}
+
+void C2InputQueue::Stop() {
+    bool running;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        running = running_;
+        running_ = false;
+    }
+    if (running) {
+        wakeup_.notify_all();
+        thread_.join();
+    }
+
+    // Waiting frames are still reported, their owners may wait for them.
+    std::vector<uint64_t> cancelled;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        for (auto &entry : queue_) {
+            cancelled.push_back(entry.index);
+        }
+        queue_.clear();
+    }
+
+    for (auto index : cancelled) {
+        cancel_(index);
+    }
+}
+
+void C2InputQueue::Push(C2InputEntry entry) {
+    std::vector<uint64_t> dropped;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (queue_.size() >= config_.queue_depth) {
+            DropFront(dropped);
+        }
+        queue_.push_back(std::move(entry));
+    }
+    wakeup_.notify_all();
+
+    for (auto index : dropped) {
+        drop_(index);
+    }
+}
+
+void C2InputQueue::Notify() {
+    std::lock_guard<std::mutex> lk(lock_);
+    wakeup_.notify_all();
+}
+
+size_t C2InputQueue::GetWaiting() {
+    std::lock_guard<std::mutex> lk(lock_);
+    return queue_.size();
+}
+
+void C2InputQueue::DropFront(std::vector<uint64_t> &dropped) {
+    dropped.push_back(queue_.front().index);
+    queue_.pop_front();
+    gap_ = true;
+}
+
+void C2InputQueue::Loop() {
+    std::unique_lock<std::mutex> lk(lock_);
+
+    while (running_) {
+        std::vector<uint64_t> dropped;
+        uint64_t now = C2Stats::Now();
+
+        // Stale frames are worthless, whether the window is full or not.
+        while (!queue_.empty() && queue_.front().deadline <= now) {
+            DropFront(dropped);
+        }
+
+        bool window_full = in_flight_() >= config_.max_in_flight;
+        if (window_full && config_.policy == C2OverloadPolicy::kCoalesce) {
+            while (queue_.size() > 1) {
+                DropFront(dropped);
+            }
+        }
+
+        if (!dropped.empty()) {
+            lk.unlock();
+            for (auto index : dropped) {
+                drop_(index);
+            }
+            lk.lock();
+            continue;
+        }
+
+        if (!queue_.empty() && !window_full) {
+            C2InputEntry entry = std::move(queue_.front());
+            queue_.pop_front();
+            entry.request_sync = gap_;
+            gap_ = false;
+
+            lk.unlock();
+            if (!submit_(entry)) {
+                base::LogError() << "Failed to submit frame " << entry.index;
+            }
+            lk.lock();
+            continue;
+        }
+
+        if (queue_.empty()) {
+            wakeup_.wait(lk);
+        } else {
+            // Wake up for the deadline of the oldest frame at the latest.
+            wakeup_.wait_for(lk, std::chrono::microseconds(queue_.front().deadline - now));
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <C2Buffer.h>
+#include <C2Param.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief What happens to waiting frames while the in-flight window is full
+*/
+enum class C2OverloadPolicy : uint32_t {
+    /// Frames wait until their deadline and are dropped once it passed.
+    kDrop,
+    /// Only the newest waiting frame is kept, older ones are dropped.
+    kCoalesce,
+};
+
+struct C2LatencyBudgetConfig {
+    bool enabled = false;
+    /// Deadline of frames queued without one, relative to submission.
+    uint32_t budget_ms = 200;
+    /// Frames allowed in the component before further frames wait.
+    uint32_t max_in_flight = 4;
+    /// Waiting frames, the oldest is dropped when a new one does not fit.
+    uint32_t queue_depth = 4;
+    C2OverloadPolicy policy = C2OverloadPolicy::kDrop;
+};
+
+struct C2InputEntry {
+    std::shared_ptr<C2Buffer> buffer;
+    uint64_t index;
+    uint64_t timestamp;
+    /// C2Stats::Now() based time in microseconds after which the frame is stale.
+    uint64_t deadline;
+    /// C2FrameData input flags.
+    uint32_t flags = 0;
+    std::list<std::unique_ptr<C2Param>> settings;
+    /// Set when frames were dropped before this one, the encoder should restart
+    /// with a sync frame.
+    bool request_sync;
+};
+
+/** C2InputQueue
+ *
+ * Small queue in front of C2Module::Queue used in latency budget mode. A
+ * submission thread forwards frames while fewer than max_in_flight frames are
+ * in the component. Frames whose deadline passed are dropped instead of being
+ * encoded late, and the next submitted frame asks for a sync frame.
+ **/
+class C2InputQueue {
+public:
+    using SubmitCallback = std::function<bool(C2InputEntry &entry)>;
+    using DropCallback = std::function<void(uint64_t index)>;
+    using CancelCallback = std::function<void(uint64_t index)>;
+    using InFlightCallback = std::function<uint32_t()>;
+
+    C2InputQueue(const C2LatencyBudgetConfig &config, SubmitCallback submit, DropCallback drop,
+                 CancelCallback cancel, InFlightCallback in_flight);
+    ~C2InputQueue();
+
+    void Start();
+    /**
+     * @brief Stop the submission thread, waiting frames are cancelled. They did
+     * not miss a deadline and are not reported through the drop callback.
+     */
+    void Stop();
+
+    /**
+     * @brief Add a frame, the oldest waiting frame is dropped if the queue is full.
+     */
+    void Push(C2InputEntry entry);
+
+    /**
+     * @brief Wake the submission thread, called when the component returns work.
+     */
+    void Notify();
+
+    size_t GetWaiting();
+    const C2LatencyBudgetConfig &GetConfig() const { return config_; }
+private:
+    void Loop();
+    void DropFront(std::vector<uint64_t> &dropped);
+
+    C2LatencyBudgetConfig config_;
+    SubmitCallback submit_;
+    DropCallback drop_;
+    CancelCallback cancel_;
+    InFlightCallback in_flight_;
+
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::deque<C2InputEntry> queue_;
+    std::thread thread_;
+    bool running_;
+    /// A frame has been dropped since the last submission.
+    bool gap_;
+};
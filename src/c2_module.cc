@@ -36,6 +36,7 @@
 
 #include <C2PlatformSupport.h>
 #include <dlfcn.h>
+#include <sys/stat.h>
 
 #include <sstream>
 #if !defined(ANDROID)
@@ -46,8 +47,15 @@
 
 #define ALIGN(num, to) (((num) + (to - 1)) & (~(to - 1)))
 
+/// Codec2 store libraries and their factory getters.
+#define VIDEO_STORE_LIBRARY "libqcodec2_core.so"
+#define VIDEO_STORE_GETTER "QC2ComponentStoreFactoryGetter"
+#define AUDIO_STORE_LIBRARY "libqc2audio_core.so"
+#define AUDIO_STORE_GETTER "QC2AudioComponentStoreFactoryGetter"
+
 std::shared_ptr<QC2ComponentStoreFactory> C2Factory::factory_video_ = nullptr;
 std::shared_ptr<QC2ComponentStoreFactory> C2Factory::factory_audio_ = nullptr;
+C2Factory::ComponentCreator C2Factory::creator_ = nullptr;
 std::mutex C2Factory::lock_;
 
 template <typename... Args>
@@ -122,6 +130,51 @@ std::shared_ptr<C2LinearBlock> C2LinearMemory::Fetch(uint32_t size) {
     return block;
 }
 
+static void RecordQueue(C2WorkLogWriter &log, const C2Work &work) {
+    uint32_t size = 0, width = 0, height = 0;
+    const std::shared_ptr<C2Buffer> &buffer = work.input.buffers.front();
+
+    if (buffer && buffer->data().type() == C2BufferData::LINEAR) {
+        size = buffer->data().linearBlocks().front().size();
+    } else if (buffer && buffer->data().type() == C2BufferData::GRAPHIC) {
+        width = buffer->data().graphicBlocks().front().width();
+        height = buffer->data().graphicBlocks().front().height();
+    }
+
+    uint32_t tuning_mask = 0, bitrate = 0;
+    for (const std::unique_ptr<C2Tuning> &tuning : work.worklets.front()->tunings) {
+        if (tuning->index() == C2StreamRequestSyncFrameTuning::output::PARAM_TYPE) {
+            tuning_mask |= kTuningSyncFrame;
+        } else if (tuning->index() == C2StreamBitrateInfo::output::PARAM_TYPE) {
+            tuning_mask |= kTuningBitrate;
+            bitrate = static_cast<const C2StreamBitrateInfo::output *>(tuning.get())->value;
+        } else {
+            tuning_mask |= kTuningOther;
+        }
+    }
+
+    log.Record(C2WorkLogEvent::kQueue, work.input.ordinal.frameIndex.peeku(),
+               work.input.ordinal.timestamp.peeku(), work.input.flags, size, width, height,
+               work.worklets.front()->tunings.size(), tuning_mask, bitrate);
+}
+
+static void RecordDone(C2WorkLogWriter &log, const C2Worklet &worklet) {
+    C2FrameData::flags_t flags = worklet.output.flags;
+    C2WorkLogEvent event = C2WorkLogEvent::kDone;
+    uint32_t size = 0;
+
+    if (flags & C2FrameData::FLAG_END_OF_STREAM) {
+        event = C2WorkLogEvent::kEOS;
+    } else if (worklet.output.buffers.empty()) {
+        event = C2WorkLogEvent::kDrop;
+    } else if (worklet.output.buffers[0]->data().type() == C2BufferData::LINEAR) {
+        size = worklet.output.buffers[0]->data().linearBlocks().front().size();
+    }
+
+    log.Record(event, worklet.output.ordinal.frameIndex.peeku(),
+               worklet.output.ordinal.timestamp.peeku(), flags, size);
+}
+
 C2Module::C2Module(std::shared_ptr<C2Component> &component, C2ModeType mode)
     : component_(component), state_(State::kCreated), mode_(mode), notifier_(nullptr) {
     // Get local pointer to the underlying component interface.
@@ -281,6 +334,10 @@ std::unique_ptr<C2Param> C2Module::QueryParam(C2Param::Index index) {
     return std::move(params.at(0));
 }
 
+c2_status_t C2Module::QuerySupportedValues(std::vector<C2FieldSupportedValuesQuery> &fields) {
+    return interface_->querySupportedValues_vb(fields, C2_MAY_BLOCK);
+}
+
 c2_status_t C2Module::SetParam(std::unique_ptr<C2Param> &param) {
     std::vector<std::unique_ptr<C2SettingResult>> failures;
     auto status = interface_->config_vb({param.get()}, C2_MAY_BLOCK, &failures);
@@ -341,6 +398,22 @@ c2_status_t C2Module::Stop() {
     return C2_OK;
 }
 
+c2_status_t C2Module::Release() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    auto status = component_->release();
+    if (status != C2_OK) {
+        throw Exception("Component[", interface_->getName().c_str(),
+                        "]: "
+                        "Release failed, error ",
+                        status, "!");
+    }
+
+    // No further callbacks are delivered by a released component.
+    state_ = State::kCreated;
+    return C2_OK;
+}
+
 c2_status_t C2Module::Flush(C2Component::flush_mode_t mode) {
     std::lock_guard<std::mutex> lk(lock_);
 
@@ -353,6 +426,11 @@ c2_status_t C2Module::Flush(C2Component::flush_mode_t mode) {
     }
 
     std::list<std::unique_ptr<C2Work>> witems;
+    std::shared_ptr<C2WorkLogWriter> log = std::atomic_load(&work_log_);
+    if (log) {
+        log->Record(C2WorkLogEvent::kFlush, 0, 0, mode, 0);
+    }
+
     auto status = component_->flush_sm(mode, &witems);
 
     if (status != C2_OK) {
@@ -423,6 +501,12 @@ c2_status_t C2Module::Queue(std::shared_ptr<C2Buffer> &buffer,
     std::list<std::unique_ptr<C2Work>> witems;
     witems.push_back(std::move(work));
 
+    // Recorded first, the work may be returned before queue_nb() does.
+    std::shared_ptr<C2WorkLogWriter> log = std::atomic_load(&work_log_);
+    if (log) {
+        RecordQueue(*log, *witems.front());
+    }
+
     auto status = component_->queue_nb(&witems);
     if (status != C2_OK) {
         throw Exception("Component[", interface_->getName().c_str(),
@@ -434,7 +518,13 @@ c2_status_t C2Module::Queue(std::shared_ptr<C2Buffer> &buffer,
     return C2_OK;
 }
 
+void C2Module::SetWorkLog(std::shared_ptr<C2WorkLogWriter> log) {
+    std::atomic_store(&work_log_, log);
+}
+
 void C2Module::HandleWorkDone(std::list<std::unique_ptr<C2Work>> witems) {
+    std::shared_ptr<C2WorkLogWriter> log = std::atomic_load(&work_log_);
+
     while (!witems.empty()) {
         std::unique_ptr<C2Work> work = std::move(witems.front());
         witems.pop_front();
@@ -446,6 +536,9 @@ void C2Module::HandleWorkDone(std::list<std::unique_ptr<C2Work>> witems) {
 
         const std::unique_ptr<C2Worklet> &worklet = work->worklets.front();
         C2FrameData::flags_t flags = worklet->output.flags;
+        if (log) {
+            RecordDone(*log, *worklet);
+        }
 
         if (flags & C2FrameData::FLAG_END_OF_STREAM) {
             notifier_->EventHandler(C2EventType::kEOS, nullptr);
@@ -475,19 +568,62 @@ void C2Module::HandleTripped(std::vector<std::shared_ptr<C2SettingResult>> resul
 }
 
 void C2Module::HandleError(uint32_t error) {
+    std::shared_ptr<C2WorkLogWriter> log = std::atomic_load(&work_log_);
+    if (log) {
+        log->Record(C2WorkLogEvent::kError, 0, 0, error, 0);
+    }
     notifier_->EventHandler(C2EventType::kError, &error);
 }
 
+void C2Factory::SetComponentCreator(ComponentCreator creator) {
+    std::lock_guard<std::mutex> lk(C2Factory::lock_);
+    creator_ = creator;
+}
+
+bool C2Factory::HasComponentCreator() {
+    std::lock_guard<std::mutex> lk(C2Factory::lock_);
+    return static_cast<bool>(creator_);
+}
+
+std::string C2Factory::GetLibraryVersion(C2ModeType mode) {
+    bool is_audio = mode == C2ModeType::AudioEncode || mode == C2ModeType::AudioDecode;
+
+    void *handle = dlopen(is_audio ? AUDIO_STORE_LIBRARY : VIDEO_STORE_LIBRARY, RTLD_NOW);
+    if (!handle) {
+        return "";
+    }
+
+    // The library found by the loader, rebuilt or updated libraries differ in size or time.
+    std::string version;
+    Dl_info info;
+    struct stat st;
+    void *getter = dlsym(handle, is_audio ? AUDIO_STORE_GETTER : VIDEO_STORE_GETTER);
+    if (getter != nullptr && dladdr(getter, &info) != 0 && info.dli_fname != nullptr &&
+        stat(info.dli_fname, &st) == 0) {
+        version = std::string(info.dli_fname) + ":" + std::to_string(st.st_size) + ":" +
+                  std::to_string(st.st_mtime);
+    }
+    dlclose(handle);
+    return version;
+}
+
 C2Module *C2Factory::GetModule(std::string name, C2ModeType mode) {
     std::lock_guard<std::mutex> lk(C2Factory::lock_);
 
+    if (creator_) {
+        std::shared_ptr<C2Component> component = creator_(name, mode);
+        if (!component) {
+            throw Exception("Unable to create Codec2 component '", name, "' !");
+        }
+        return new C2Module(component, mode);
+    }
+
     bool is_audio = mode == C2ModeType::AudioEncode || mode == C2ModeType::AudioDecode;
 
     // Initialize Codec2 Store Factory.
     if ((is_audio && !factory_audio_) || (!is_audio && !factory_video_)) {
-        const char *dll_lib = is_audio ? "libqc2audio_core.so" : "libqcodec2_core.so";
-        const char *method =
-            is_audio ? "QC2AudioComponentStoreFactoryGetter" : "QC2ComponentStoreFactoryGetter";
+        const char *dll_lib = is_audio ? AUDIO_STORE_LIBRARY : VIDEO_STORE_LIBRARY;
+        const char *method = is_audio ? AUDIO_STORE_GETTER : VIDEO_STORE_GETTER;
 
         void *handle = dlopen(dll_lib, RTLD_NOW);
         if (!handle) {
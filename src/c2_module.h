@@ -43,12 +43,14 @@
 #include <atomic>
 #include <condition_variable>
 #include <exception>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <tuple>
 
 #include "c2_common.h"
+#include "c2_work_log.h"
 
 #if defined(ENABLE_AUDIO_PLUGINS)
 #include <codec2/QC2Buffer.h>
@@ -124,9 +126,18 @@ public:
 
     std::unique_ptr<C2Param> QueryParam(C2Param::Index index);
     c2_status_t SetParam(std::unique_ptr<C2Param> &param);
+    /**
+     * @brief Query the possible values of parameter fields in one call, the
+     * status of every field is set in the query.
+     *
+     * @return: C2_OK if all fields were answered, fields failing on their own
+     * do not throw.
+     */
+    c2_status_t QuerySupportedValues(std::vector<C2FieldSupportedValuesQuery> &fields);
 
     c2_status_t Start();
     c2_status_t Stop();
+    c2_status_t Release();
 
     c2_status_t Flush(C2Component::flush_mode_t mode);
     c2_status_t Drain(C2Component::drain_mode_t mode);
@@ -135,6 +146,12 @@ public:
                       std::list<std::unique_ptr<C2Param>> &settings, uint64_t index,
                       uint64_t timestamp, uint32_t flags);
 
+    /**
+     * @brief Record the queued and returned work into the given log, null
+     * stops recording.
+     */
+    void SetWorkLog(std::shared_ptr<C2WorkLogWriter> log);
+
     // TODO Make them protected/private.
     void HandleWorkDone(std::list<std::unique_ptr<C2Work>> work);
     void HandleTripped(std::vector<std::shared_ptr<C2SettingResult>> results);
@@ -161,6 +178,9 @@ private:
     C2ModeType mode_;
 
     std::mutex lock_;
+
+    /// Accessed with std::atomic_load/store, read from the callback thread.
+    std::shared_ptr<C2WorkLogWriter> work_log_;
 };
 
 // TODO Can be made part of the C2Module
@@ -193,12 +213,32 @@ private:
  **/
 class C2Factory {
 public:
+    using ComponentCreator =
+        std::function<std::shared_ptr<C2Component>(const std::string &name, C2ModeType mode)>;
+
     static C2Module *GetModule(std::string name, C2ModeType mode);
+
+    /**
+     * @brief Create components with the given function instead of the Codec2
+     * store, e.g. a stand-in component in tests. An empty function restores
+     * the store.
+     */
+    static void SetComponentCreator(ComponentCreator creator);
+    static bool HasComponentCreator();
+
+    /**
+     * @brief Identify the Codec2 store library of the mode by its path, size
+     * and modification time.
+     *
+     * @return: Empty string if the library cannot be loaded.
+     */
+    static std::string GetLibraryVersion(C2ModeType mode);
 private:
     using QC2ComponentStoreFactoryGetter_t = QC2ComponentStoreFactory *(*)(int major, int minor);
 
     static std::shared_ptr<QC2ComponentStoreFactory> factory_video_;
     static std::shared_ptr<QC2ComponentStoreFactory> factory_audio_;
+    static ComponentCreator creator_;
     static std::mutex lock_;
 };
 
@@ -0,0 +1,233 @@
+#include "c2_mp4_box.h"
+
+// H.265 NAL unit types of the parameter sets.
+#define HEVC_NAL_VPS 32
+#define HEVC_NAL_SPS 33
+#define HEVC_NAL_PPS 34
+
+/** C2BitReader
+ *
+ * MSB first bit reader over a NAL unit payload which drops the emulation
+ * prevention bytes while reading.
+ **/
+class C2BitReader {
+public:
+    C2BitReader(const uint8_t *data, size_t size) {
+        rbsp_.reserve(size);
+        for (size_t idx = 0; idx < size; idx++) {
+            if (idx >= 2 && data[idx] == 0x03 && data[idx - 1] == 0 && data[idx - 2] == 0) {
+                continue;
+            }
+            rbsp_.push_back(data[idx]);
+        }
+    }
+
+    uint32_t Bits(uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t idx = 0; idx < count; idx++) {
+            value = (value << 1) | Bit();
+        }
+        return value;
+    }
+
+    uint32_t Bit() {
+        if (position_ >= rbsp_.size() * 8) {
+            overrun_ = true;
+            return 0;
+        }
+        uint32_t value = (rbsp_[position_ / 8] >> (7 - (position_ % 8))) & 1;
+        position_++;
+        return value;
+    }
+
+    void Skip(uint32_t count) { position_ += count; }
+
+    // Exp-Golomb coded unsigned value.
+    uint32_t Ue() {
+        uint32_t zeros = 0;
+        while (Bit() == 0 && !overrun_ && zeros < 32) {
+            zeros++;
+        }
+        return ((1u << zeros) - 1) + Bits(zeros);
+    }
+
+    bool Overrun() const { return overrun_ || position_ > rbsp_.size() * 8; }
+private:
+    std::vector<uint8_t> rbsp_;
+    size_t position_ = 0;
+    bool overrun_ = false;
+};
+
+void C2BoxWriter::U16(uint16_t value) {
+    U8(value >> 8);
+    U8(value & 0xFF);
+}
+
+void C2BoxWriter::U24(uint32_t value) {
+    U8((value >> 16) & 0xFF);
+    U16(value & 0xFFFF);
+}
+
+void C2BoxWriter::U32(uint32_t value) {
+    U16(value >> 16);
+    U16(value & 0xFFFF);
+}
+
+void C2BoxWriter::U64(uint64_t value) {
+    U32(value >> 32);
+    U32(value & 0xFFFFFFFF);
+}
+
+size_t C2BoxWriter::Begin(const char *fourcc) {
+    size_t position = data_.size();
+    U32(0);
+    FourCC(fourcc);
+    return position;
+}
+
+size_t C2BoxWriter::BeginFull(const char *fourcc, uint8_t version, uint32_t flags) {
+    size_t position = Begin(fourcc);
+    U8(version);
+    U24(flags);
+    return position;
+}
+
+void C2BoxWriter::End(size_t position) {
+    Patch32(position, data_.size() - position);
+}
+
+void C2BoxWriter::Patch32(size_t position, uint32_t value) {
+    data_[position] = (value >> 24) & 0xFF;
+    data_[position + 1] = (value >> 16) & 0xFF;
+    data_[position + 2] = (value >> 8) & 0xFF;
+    data_[position + 3] = value & 0xFF;
+}
+
+bool C2Mp4Utils::ParseHevcSps(const std::vector<uint8_t> &sps, C2HevcSpsInfo &info) {
+    if (sps.size() < 4) {
+        return false;
+    }
+
+    // Skip the 2 byte NAL unit header.
+    C2BitReader reader(sps.data() + 2, sps.size() - 2);
+
+    reader.Skip(4);  // sps_video_parameter_set_id
+    uint32_t max_sub_layers_minus1 = reader.Bits(3);
+    info.max_sub_layers = max_sub_layers_minus1 + 1;
+    info.temporal_id_nesting = reader.Bit();
+
+    // profile_tier_level(1, sps_max_sub_layers_minus1)
+    info.profile_space = reader.Bits(2);
+    info.tier_flag = reader.Bit();
+    info.profile_idc = reader.Bits(5);
+    info.profile_compatibility = reader.Bits(32);
+    for (uint32_t idx = 0; idx < 6; idx++) {
+        info.constraint_flags[idx] = reader.Bits(8);
+    }
+    info.level_idc = reader.Bits(8);
+
+    uint32_t profile_present[8] = {0};
+    uint32_t level_present[8] = {0};
+    for (uint32_t idx = 0; idx < max_sub_layers_minus1; idx++) {
+        profile_present[idx] = reader.Bit();
+        level_present[idx] = reader.Bit();
+    }
+    if (max_sub_layers_minus1 > 0) {
+        reader.Skip(2 * (8 - max_sub_layers_minus1));
+    }
+    for (uint32_t idx = 0; idx < max_sub_layers_minus1; idx++) {
+        reader.Skip(profile_present[idx] ? 88 : 0);
+        reader.Skip(level_present[idx] ? 8 : 0);
+    }
+
+    reader.Ue();  // sps_seq_parameter_set_id
+    info.chroma_format_idc = reader.Ue();
+    if (info.chroma_format_idc == 3) {
+        reader.Skip(1);  // separate_colour_plane_flag
+    }
+
+    info.width = reader.Ue();
+    info.height = reader.Ue();
+
+    if (reader.Bit()) {
+        // Conformance window offsets are in chroma sample units.
+        uint32_t sub_width = (info.chroma_format_idc == 1 || info.chroma_format_idc == 2) ? 2 : 1;
+        uint32_t sub_height = (info.chroma_format_idc == 1) ? 2 : 1;
+
+        uint32_t left = reader.Ue();
+        uint32_t right = reader.Ue();
+        uint32_t top = reader.Ue();
+        uint32_t bottom = reader.Ue();
+
+        info.width -= sub_width * (left + right);
+        info.height -= sub_height * (top + bottom);
+    }
+
+    info.bit_depth_luma = reader.Ue() + 8;
+    info.bit_depth_chroma = reader.Ue() + 8;
+
+    return !reader.Overrun();
+}
+
+bool C2Mp4Utils::WriteAvcC(C2BoxWriter &writer, const C2CodecConfig &config) {
+    if (config.sps.size() < 4 || config.pps.empty()) {
+        return false;
+    }
+
+    size_t box = writer.Begin("avcC");
+    writer.U8(1);                 // configurationVersion
+    writer.U8(config.sps[1]);     // AVCProfileIndication
+    writer.U8(config.sps[2]);     // profile_compatibility
+    writer.U8(config.sps[3]);     // AVCLevelIndication
+    writer.U8(0xFC | 3);          // lengthSizeMinusOne
+    writer.U8(0xE0 | 1);          // numOfSequenceParameterSets
+    writer.U16(config.sps.size());
+    writer.Bytes(config.sps.data(), config.sps.size());
+    writer.U8(1);                 // numOfPictureParameterSets
+    writer.U16(config.pps.size());
+    writer.Bytes(config.pps.data(), config.pps.size());
+    writer.End(box);
+
+    return true;
+}
+
+bool C2Mp4Utils::WriteHvcC(C2BoxWriter &writer, const C2CodecConfig &config) {
+    C2HevcSpsInfo info;
+    if (config.vps.empty() || config.pps.empty() || !ParseHevcSps(config.sps, info)) {
+        return false;
+    }
+
+    size_t box = writer.Begin("hvcC");
+    writer.U8(1);  // configurationVersion
+    writer.U8((info.profile_space << 6) | (info.tier_flag << 5) | info.profile_idc);
+    writer.U32(info.profile_compatibility);
+    writer.Bytes(info.constraint_flags, sizeof(info.constraint_flags));
+    writer.U8(info.level_idc);
+    writer.U16(0xF000);  // min_spatial_segmentation_idc
+    writer.U8(0xFC);     // parallelismType
+    writer.U8(0xFC | info.chroma_format_idc);
+    writer.U8(0xF8 | (info.bit_depth_luma - 8));
+    writer.U8(0xF8 | (info.bit_depth_chroma - 8));
+    writer.U16(0);       // avgFrameRate
+    writer.U8((info.max_sub_layers << 3) | (info.temporal_id_nesting << 2) | 3);
+
+    const struct {
+        uint8_t type;
+        const std::vector<uint8_t> *nal;
+    } arrays[] = {
+        {HEVC_NAL_VPS, &config.vps},
+        {HEVC_NAL_SPS, &config.sps},
+        {HEVC_NAL_PPS, &config.pps},
+    };
+
+    writer.U8(3);  // numOfArrays
+    for (const auto &array : arrays) {
+        writer.U8(0x80 | array.type);  // array_completeness
+        writer.U16(1);                 // numNalus
+        writer.U16(array.nal->size());
+        writer.Bytes(array.nal->data(), array.nal->size());
+    }
+    writer.End(box);
+
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "c2_nal_parser.h"
+
+/** C2BoxWriter
+ *
+ * Big-endian byte writer for ISO BMFF boxes. Boxes are opened with Begin()
+ * and their size is patched when they are closed with End().
+ **/
+class C2BoxWriter {
+public:
+    C2BoxWriter(){};
+    ~C2BoxWriter(){};
+
+    void U8(uint8_t value) { data_.push_back(value); }
+    void U16(uint16_t value);
+    void U24(uint32_t value);
+    void U32(uint32_t value);
+    void U64(uint64_t value);
+    void Zeros(size_t count) { data_.insert(data_.end(), count, 0); }
+    void Bytes(const uint8_t *data, size_t size) { data_.insert(data_.end(), data, data + size); }
+    void FourCC(const char *fourcc) { Bytes(reinterpret_cast<const uint8_t *>(fourcc), 4); }
+
+    /**
+     * @brief Open a box, returns the position to be passed to End().
+     */
+    size_t Begin(const char *fourcc);
+    /**
+     * @brief Open a full box with the given version and flags.
+     */
+    size_t BeginFull(const char *fourcc, uint8_t version, uint32_t flags);
+    void End(size_t position);
+
+    /**
+     * @brief Overwrite a 32-bit value at the given position.
+     */
+    void Patch32(size_t position, uint32_t value);
+
+    size_t Size() const { return data_.size(); }
+    std::vector<uint8_t> &Data() { return data_; }
+    void Clear() { data_.clear(); }
+private:
+    std::vector<uint8_t> data_;
+};
+
+/** C2HevcSpsInfo
+ *
+ * Fields of a H.265 SPS required for the hvcC configuration record.
+ **/
+struct C2HevcSpsInfo {
+    uint8_t profile_space;
+    uint8_t tier_flag;
+    uint8_t profile_idc;
+    uint32_t profile_compatibility;
+    uint8_t constraint_flags[6];
+    uint8_t level_idc;
+    uint8_t max_sub_layers;
+    uint8_t temporal_id_nesting;
+    uint32_t chroma_format_idc;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bit_depth_luma;
+    uint32_t bit_depth_chroma;
+};
+
+class C2Mp4Utils {
+public:
+    /**
+     * @brief Parse the profile/tier/level, picture size and bit depth of a H.265 SPS.
+     * @param sps: SPS NAL unit including the 2 byte NAL header, without start code.
+     * @param info: Filled with the parsed fields.
+     *
+     * @return: true on success or false on failure.
+     */
+    static bool ParseHevcSps(const std::vector<uint8_t> &sps, C2HevcSpsInfo &info);
+    /**
+     * @brief Write an avcC box built from the cached H.264 parameter sets.
+     *
+     * @return: true on success or false if SPS/PPS are missing.
+     */
+    static bool WriteAvcC(C2BoxWriter &writer, const C2CodecConfig &config);
+    /**
+     * @brief Write an hvcC box built from the cached H.265 parameter sets.
+     *
+     * @return: true on success or false if VPS/SPS/PPS are missing or invalid.
+     */
+    static bool WriteHvcC(C2BoxWriter &writer, const C2CodecConfig &config);
+};
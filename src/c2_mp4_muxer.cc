@@ -0,0 +1,447 @@
+#include "c2_mp4_muxer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+
+// NAL unit types carried in the sample entry instead of the samples.
+#define AVC_NAL_SPS 7
+#define AVC_NAL_PPS 8
+#define AVC_NAL_AUD 9
+#define HEVC_NAL_VPS 32
+#define HEVC_NAL_PPS 34
+#define HEVC_NAL_AUD 35
+
+// The engine SEI is handed over with a 4 byte start code.
+#define SEI_START_CODE 4
+
+// ISO/IEC 14496-12 sample flags.
+#define SAMPLE_FLAGS_SYNC 0x02000000
+#define SAMPLE_FLAGS_NON_SYNC 0x01010000
+
+// trun flags: data-offset, sample-duration, sample-size and sample-flags present.
+#define TRUN_FLAGS 0x000701
+// tfhd flags: default-base-is-moof.
+#define TFHD_FLAGS 0x020000
+
+#define TRACK_ID 1
+
+static const uint32_t kMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+C2Mp4Muxer::C2Mp4Muxer(const C2Mp4MuxerConfig &config)
+    : config_(config),
+      fd_(-1),
+      initialized_(false),
+      config_version_(0),
+      halted_(false),
+      sequence_(1),
+      base_pts_(0),
+      last_duration_(config.timescale / 30),
+      queued_bytes_(0),
+      written_(0),
+      allocated_(0) {}
+
+C2Mp4Muxer::~C2Mp4Muxer() {
+    Close();
+}
+
+bool C2Mp4Muxer::Open() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    fd_ = open(config_.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        base::LogError() << "Failed to open " << config_.path << ", error: " << strerror(errno);
+        return false;
+    }
+
+    return Reserve(config_.preallocate);
+}
+
+void C2Mp4Muxer::Close() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (fd_ < 0) {
+        return;
+    }
+
+    if (!samples_.empty()) {
+        CloseFragment(samples_.back().pts + last_duration_);
+    }
+    Flush();
+
+    // Give back the space reserved past the end of the data.
+    if (ftruncate(fd_, written_) != 0) {
+        base::LogWarn() << "Failed to truncate " << config_.path;
+    }
+
+    close(fd_);
+    fd_ = -1;
+}
+
+void C2Mp4Muxer::OnEndOfStream() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (!samples_.empty()) {
+        CloseFragment(samples_.back().pts + last_duration_);
+    }
+    Flush();
+}
+
+void C2Mp4Muxer::OnFrame(const C2EncodedFrame &frame) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (fd_ < 0 || halted_) {
+        return;
+    }
+
+    if (!initialized_) {
+        // The stream can only start with a sync frame preceded by its parameter sets.
+        if (!frame.au.is_sync || frame.config == nullptr) {
+            base::LogDebug() << "Muxer waiting for sync frame, dropping frame " << frame.index;
+            return;
+        }
+        if (!WriteInitSegment(*frame.config)) {
+            return;
+        }
+        base_pts_ = frame.timestamp;
+        config_version_ = frame.config_version;
+        initialized_ = true;
+    } else if (frame.config != nullptr && frame.config_version != config_version_) {
+        // Later fragments would reference parameter sets missing from the init
+        // segment, the file stays decodable up to the change.
+        base::LogError() << "Codec config changed at frame " << frame.index
+                         << ", muxing to " << config_.path << " stopped";
+        if (!samples_.empty()) {
+            CloseFragment(samples_.back().pts + last_duration_);
+        }
+        Flush();
+        halted_ = true;
+        return;
+    }
+
+    if (frame.timestamp < base_pts_) {
+        base::LogWarn() << "Muxer dropping frame " << frame.index << " with timestamp before start";
+        return;
+    }
+
+    uint64_t pts = (frame.timestamp - base_pts_) * config_.timescale / 1000000;
+
+    if (!samples_.empty() && pts >= samples_.front().pts) {
+        bool cut = (config_.fragment_duration == 0)
+                       ? frame.au.is_sync
+                       : ((pts - samples_.front().pts) * 1000000 / config_.timescale >=
+                          config_.fragment_duration);
+        if (cut) {
+            CloseFragment(pts);
+        }
+    }
+
+    // Stage the sample, replacing the start codes with 4 byte lengths. The
+    // engine SEI is staged ahead of the NAL unit it is inserted before.
+    size_t begin = mdat_.size();
+    bool sei = (frame.sei != nullptr);
+    for (const C2NalUnit &nal : frame.au.nals) {
+        if (sei && nal.offset > frame.sei_offset) {
+            StageNal(frame.sei + SEI_START_CODE, frame.sei_size - SEI_START_CODE);
+            sei = false;
+        }
+
+        bool skip = config_.hevc ? (nal.type >= HEVC_NAL_VPS && nal.type <= HEVC_NAL_AUD)
+                                 : (nal.type >= AVC_NAL_SPS && nal.type <= AVC_NAL_AUD);
+        if (skip) {
+            continue;
+        }
+
+        StageNal(frame.data + nal.offset, nal.size);
+    }
+
+    if (mdat_.size() == begin) {
+        return;
+    }
+
+    samples_.push_back({pts, static_cast<uint32_t>(mdat_.size() - begin), frame.au.is_sync});
+}
+
+void C2Mp4Muxer::StageNal(const uint8_t *data, uint32_t size) {
+    size_t position = mdat_.size();
+    mdat_.resize(position + 4 + size);
+
+    uint8_t *sample = mdat_.data() + position;
+    sample[0] = (size >> 24) & 0xFF;
+    sample[1] = (size >> 16) & 0xFF;
+    sample[2] = (size >> 8) & 0xFF;
+    sample[3] = size & 0xFF;
+    memcpy(sample + 4, data, size);
+}
+
+bool C2Mp4Muxer::WriteInitSegment(const C2CodecConfig &config) {
+    C2BoxWriter writer;
+
+    size_t ftyp = writer.Begin("ftyp");
+    writer.FourCC("iso6");
+    writer.U32(0);
+    writer.FourCC("iso6");
+    writer.FourCC("cmfc");
+    writer.FourCC(config_.hevc ? "hvc1" : "avc1");
+    writer.FourCC("mp41");
+    writer.End(ftyp);
+
+    size_t moov = writer.Begin("moov");
+
+    size_t mvhd = writer.BeginFull("mvhd", 0, 0);
+    writer.U32(0);           // creation_time
+    writer.U32(0);           // modification_time
+    writer.U32(1000);        // timescale
+    writer.U32(0);           // duration
+    writer.U32(0x00010000);  // rate
+    writer.U16(0x0100);      // volume
+    writer.Zeros(10);
+    for (uint32_t value : kMatrix) {
+        writer.U32(value);
+    }
+    writer.Zeros(24);        // pre_defined
+    writer.U32(TRACK_ID + 1);
+    writer.End(mvhd);
+
+    size_t trak = writer.Begin("trak");
+
+    size_t tkhd = writer.BeginFull("tkhd", 0, 0x000003);
+    writer.U32(0);  // creation_time
+    writer.U32(0);  // modification_time
+    writer.U32(TRACK_ID);
+    writer.U32(0);
+    writer.U32(0);  // duration
+    writer.Zeros(8);
+    writer.U16(0);  // layer
+    writer.U16(0);  // alternate_group
+    writer.U16(0);  // volume
+    writer.U16(0);
+    for (uint32_t value : kMatrix) {
+        writer.U32(value);
+    }
+    writer.U32(config_.width << 16);
+    writer.U32(config_.height << 16);
+    writer.End(tkhd);
+
+    size_t mdia = writer.Begin("mdia");
+
+    size_t mdhd = writer.BeginFull("mdhd", 0, 0);
+    writer.U32(0);
+    writer.U32(0);
+    writer.U32(config_.timescale);
+    writer.U32(0);
+    writer.U16(0x55C4);  // 'und'
+    writer.U16(0);
+    writer.End(mdhd);
+
+    size_t hdlr = writer.BeginFull("hdlr", 0, 0);
+    writer.U32(0);
+    writer.FourCC("vide");
+    writer.Zeros(12);
+    writer.Bytes(reinterpret_cast<const uint8_t *>("VideoHandler"), 13);
+    writer.End(hdlr);
+
+    size_t minf = writer.Begin("minf");
+
+    size_t vmhd = writer.BeginFull("vmhd", 0, 1);
+    writer.Zeros(8);
+    writer.End(vmhd);
+
+    size_t dinf = writer.Begin("dinf");
+    size_t dref = writer.BeginFull("dref", 0, 0);
+    writer.U32(1);
+    writer.End(writer.BeginFull("url ", 0, 1));
+    writer.End(dref);
+    writer.End(dinf);
+
+    size_t stbl = writer.Begin("stbl");
+
+    size_t stsd = writer.BeginFull("stsd", 0, 0);
+    writer.U32(1);
+
+    size_t entry = writer.Begin(config_.hevc ? "hvc1" : "avc1");
+    writer.Zeros(6);
+    writer.U16(1);           // data_reference_index
+    writer.Zeros(16);
+    writer.U16(config_.width);
+    writer.U16(config_.height);
+    writer.U32(0x00480000);  // horizresolution
+    writer.U32(0x00480000);  // vertresolution
+    writer.U32(0);
+    writer.U16(1);           // frame_count
+    writer.Zeros(32);        // compressorname
+    writer.U16(0x0018);      // depth
+    writer.U16(0xFFFF);      // pre_defined
+
+    bool success = config_.hevc ? C2Mp4Utils::WriteHvcC(writer, config)
+                                : C2Mp4Utils::WriteAvcC(writer, config);
+    if (!success) {
+        base::LogError() << "Muxer failed to build codec configuration record";
+        return false;
+    }
+
+    writer.End(entry);
+    writer.End(stsd);
+
+    // Sample tables are empty, all samples are described by the fragments.
+    for (const char *table : {"stts", "stsc", "stco"}) {
+        size_t box = writer.BeginFull(table, 0, 0);
+        writer.U32(0);
+        writer.End(box);
+    }
+    size_t stsz = writer.BeginFull("stsz", 0, 0);
+    writer.U32(0);
+    writer.U32(0);
+    writer.End(stsz);
+
+    writer.End(stbl);
+    writer.End(minf);
+    writer.End(mdia);
+    writer.End(trak);
+
+    size_t mvex = writer.Begin("mvex");
+    size_t trex = writer.BeginFull("trex", 0, 0);
+    writer.U32(TRACK_ID);
+    writer.U32(1);  // default_sample_description_index
+    writer.U32(0);
+    writer.U32(0);
+    writer.U32(0);
+    writer.End(trex);
+    writer.End(mvex);
+
+    writer.End(moov);
+
+    return Queue(std::move(writer.Data())) && Flush();
+}
+
+void C2Mp4Muxer::CloseFragment(uint64_t next_pts) {
+    C2BoxWriter writer;
+
+    size_t moof = writer.Begin("moof");
+
+    size_t mfhd = writer.BeginFull("mfhd", 0, 0);
+    writer.U32(sequence_++);
+    writer.End(mfhd);
+
+    size_t traf = writer.Begin("traf");
+
+    size_t tfhd = writer.BeginFull("tfhd", 0, TFHD_FLAGS);
+    writer.U32(TRACK_ID);
+    writer.End(tfhd);
+
+    size_t tfdt = writer.BeginFull("tfdt", 1, 0);
+    writer.U64(samples_.front().pts);
+    writer.End(tfdt);
+
+    size_t trun = writer.BeginFull("trun", 0, TRUN_FLAGS);
+    writer.U32(samples_.size());
+    size_t data_offset = writer.Size();
+    writer.U32(0);
+
+    for (size_t idx = 0; idx < samples_.size(); idx++) {
+        uint64_t next = (idx + 1 < samples_.size()) ? samples_[idx + 1].pts : next_pts;
+        if (next > samples_[idx].pts) {
+            last_duration_ = next - samples_[idx].pts;
+        }
+
+        writer.U32(last_duration_);
+        writer.U32(samples_[idx].size);
+        writer.U32(samples_[idx].sync ? SAMPLE_FLAGS_SYNC : SAMPLE_FLAGS_NON_SYNC);
+    }
+    writer.End(trun);
+
+    writer.End(traf);
+    writer.End(moof);
+
+    // Sample data starts right after the mdat header which follows the moof.
+    writer.Patch32(data_offset, writer.Size() + 8);
+    writer.U32(mdat_.size() + 8);
+    writer.FourCC("mdat");
+
+    Queue(std::move(writer.Data()));
+    Queue(std::move(mdat_));
+
+    mdat_ = std::vector<uint8_t>();
+    samples_.clear();
+
+    if (queued_bytes_ >= config_.write_batch) {
+        Flush();
+    }
+}
+
+bool C2Mp4Muxer::Queue(std::vector<uint8_t> &&data) {
+    queued_bytes_ += data.size();
+    queued_.emplace_back(std::move(data));
+    return true;
+}
+
+bool C2Mp4Muxer::Reserve(uint64_t size) {
+    if (written_ + size <= allocated_ || config_.preallocate == 0) {
+        return true;
+    }
+
+    uint64_t length = ((written_ + size - allocated_ + config_.preallocate - 1) /
+                       config_.preallocate) * config_.preallocate;
+
+    // Keep the visible file size unchanged so a partial file stays parsable.
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_, length) != 0) {
+        base::LogDebug() << "fallocate not supported on " << config_.path;
+        config_.preallocate = 0;
+        return true;
+    }
+
+    allocated_ += length;
+    return true;
+}
+
+bool C2Mp4Muxer::Flush() {
+    if (queued_.empty() || fd_ < 0) {
+        return true;
+    }
+
+    Reserve(queued_bytes_);
+
+    std::vector<struct iovec> iov;
+    iov.reserve(queued_.size());
+    for (std::vector<uint8_t> &data : queued_) {
+        if (!data.empty()) {
+            iov.push_back({data.data(), data.size()});
+        }
+    }
+
+    size_t first = 0;
+    while (first < iov.size()) {
+        int count = std::min<size_t>(iov.size() - first, IOV_MAX);
+        ssize_t result = pwritev(fd_, iov.data() + first, count, written_);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            base::LogError() << "Failed to write " << config_.path << ", error: " << strerror(errno);
+            break;
+        }
+
+        written_ += result;
+
+        // Advance past the fully written vectors and trim a partial one.
+        size_t remaining = result;
+        while (first < iov.size() && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            first++;
+        }
+        if (remaining > 0) {
+            iov[first].iov_base = static_cast<uint8_t *>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+
+    queued_.clear();
+    queued_bytes_ = 0;
+    return first == iov.size();
+}
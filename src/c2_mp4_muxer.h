@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "c2_mp4_box.h"
+#include "c2_output_sink.h"
+
+struct C2Mp4MuxerConfig {
+    /// Output file path.
+    std::string path;
+    /// H.265 (hvc1) instead of H.264 (avc1) sample entries.
+    bool hevc = false;
+    /// Coded picture size written into the track header and sample entry.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /// Media timescale of the track.
+    uint32_t timescale = 90000;
+    /// Fragment length in microseconds, 0 emits one fragment per GOP.
+    uint64_t fragment_duration = 0;
+    /// File space is reserved ahead with fallocate in steps of this size.
+    uint64_t preallocate = 16 * 1024 * 1024;
+    /// Closed fragments are queued until this many bytes are pending.
+    uint32_t write_batch = 1024 * 1024;
+};
+
+/** C2Mp4Muxer
+ *
+ * Output sink writing the encoded stream as fragmented MP4 (CMAF): an init
+ * segment with the avcC/hvcC record built from the cached parameter sets,
+ * followed by moof/mdat pairs. Samples are converted from Annex-B to 4 byte
+ * length prefixed NAL units while they are staged into the fragment. The
+ * sample entry cannot change within the file, muxing stops at the first
+ * parameter set change.
+ **/
+class C2Mp4Muxer : public IC2OutputSink {
+public:
+    C2Mp4Muxer(const C2Mp4MuxerConfig &config);
+    ~C2Mp4Muxer();
+
+    /**
+     * @brief Create the output file.
+     *
+     * @return: true on success or false on failure.
+     */
+    bool Open();
+    /**
+     * @brief Write the pending fragment and close the output file.
+     */
+    void Close();
+
+    void OnFrame(const C2EncodedFrame &frame) override;
+    void OnEndOfStream() override;
+private:
+    struct Sample {
+        uint64_t pts;
+        uint32_t size;
+        bool sync;
+    };
+
+    void StageNal(const uint8_t *data, uint32_t size);
+    bool WriteInitSegment(const C2CodecConfig &config);
+    void CloseFragment(uint64_t next_pts);
+    bool Queue(std::vector<uint8_t> &&data);
+    bool Flush();
+    bool Reserve(uint64_t size);
+
+    C2Mp4MuxerConfig config_;
+    int fd_;
+    bool initialized_;
+    /// Parameter set version of the init segment, muxing stops when it changes.
+    uint32_t config_version_;
+    bool halted_;
+
+    /// Samples and length prefixed payload of the fragment being built.
+    std::vector<Sample> samples_;
+    std::vector<uint8_t> mdat_;
+    uint32_t sequence_;
+    uint64_t base_pts_;
+    uint64_t last_duration_;
+
+    /// Serialized fragments waiting to be written in one batch.
+    std::vector<std::vector<uint8_t>> queued_;
+    uint64_t queued_bytes_;
+    uint64_t written_;
+    uint64_t allocated_;
+
+    std::mutex lock_;
+};
@@ -0,0 +1,170 @@
+#include "c2_nal_parser.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// H.264 nal_unit_type values (ITU-T H.264 Table 7-1).
+#define AVC_NAL_IDR 5
+#define AVC_NAL_SPS 7
+#define AVC_NAL_PPS 8
+
+// H.265 nal_unit_type values (ITU-T H.265 Table 7-1).
+#define HEVC_NAL_BLA_W_LP 16
+#define HEVC_NAL_CRA 21
+#define HEVC_NAL_VPS 32
+#define HEVC_NAL_SPS 33
+#define HEVC_NAL_PPS 34
+
+static const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+
+C2NalParser::C2NalParser(C2CodecType codec_type)
+    : hevc_(codec_type != C2CodecType::H264VideoEncode), config_version_(0) {}
+
+size_t C2NalParser::FindStartCodeScalar(const uint8_t *data, size_t size, size_t from) {
+    for (size_t idx = from; idx + 2 < size; idx++) {
+        if (data[idx] == 0 && data[idx + 1] == 0 && data[idx + 2] == 1) {
+            return idx;
+        }
+    }
+
+    return size;
+}
+
+size_t C2NalParser::FindStartCode(const uint8_t *data, size_t size, size_t from) {
+    size_t idx = from;
+
+    // Compare 16 positions at a time against the three bytes of the prefix.
+    // The loads at +1 and +2 need two bytes of look-ahead past the block.
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+
+    for (; idx + 18 <= size; idx += 16) {
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx + 1));
+        __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx + 2));
+
+        __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero),
+                                                    _mm_cmpeq_epi8(b1, zero)),
+                                      _mm_cmpeq_epi8(b2, one));
+
+        int mask = _mm_movemask_epi8(match);
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+
+    for (; idx + 18 <= size; idx += 16) {
+        uint8x16_t match = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(data + idx), zero),
+                                             vceqq_u8(vld1q_u8(data + idx + 1), zero)),
+                                    vceqq_u8(vld1q_u8(data + idx + 2), one));
+
+        if (vmaxvq_u8(match) != 0) {
+            // A hit is rare, locate it within the block with the scalar loop.
+            return FindStartCodeScalar(data, idx + 18, idx);
+        }
+    }
+#endif
+
+    return FindStartCodeScalar(data, size, idx);
+}
+
+void C2NalParser::Split(const uint8_t *data, uint32_t size, bool hevc, bool scalar,
+                        std::vector<C2NalUnit> &nals) {
+    auto find = scalar ? FindStartCodeScalar : FindStartCode;
+    size_t pos = find(data, size, 0);
+
+    while (pos < size) {
+        size_t begin = pos + 3;
+        size_t next = find(data, size, begin);
+
+        // Drop the trailing zero bytes, this also removes the leading zero
+        // of a 4 byte start code belonging to the next unit.
+        size_t end = next;
+        while (end > begin && data[end - 1] == 0) {
+            end--;
+        }
+
+        if (end > begin) {
+            C2NalUnit nal;
+            nal.type = hevc ? ((data[begin] >> 1) & 0x3F) : (data[begin] & 0x1F);
+            nal.start_code = (pos > 0 && data[pos - 1] == 0) ? 4 : 3;
+            nal.offset = begin;
+            nal.size = end - begin;
+            nals.push_back(nal);
+        }
+
+        pos = next;
+    }
+}
+
+bool C2NalParser::Parse(const uint8_t *data, uint32_t size, C2AccessUnitInfo &info) {
+    info.nals.clear();
+    info.is_sync = false;
+    info.has_config = false;
+
+    if (data == nullptr || size < 4) {
+        return false;
+    }
+
+    Split(data, size, hevc_, false, info.nals);
+
+    for (const C2NalUnit &nal : info.nals) {
+        if (hevc_) {
+            if (nal.type >= HEVC_NAL_BLA_W_LP && nal.type <= HEVC_NAL_CRA) {
+                info.is_sync = true;
+            } else if (nal.type >= HEVC_NAL_VPS && nal.type <= HEVC_NAL_PPS) {
+                info.has_config = true;
+                UpdateConfig(data, nal);
+            }
+        } else {
+            if (nal.type == AVC_NAL_IDR) {
+                info.is_sync = true;
+            } else if (nal.type == AVC_NAL_SPS || nal.type == AVC_NAL_PPS) {
+                info.has_config = true;
+                UpdateConfig(data, nal);
+            }
+        }
+    }
+
+    return !info.nals.empty();
+}
+
+void C2NalParser::UpdateConfig(const uint8_t *data, const C2NalUnit &nal) {
+    std::vector<uint8_t> *target = nullptr;
+
+    if (hevc_) {
+        target = (nal.type == HEVC_NAL_VPS)   ? &config_.vps
+                 : (nal.type == HEVC_NAL_SPS) ? &config_.sps
+                                              : &config_.pps;
+    } else {
+        target = (nal.type == AVC_NAL_SPS) ? &config_.sps : &config_.pps;
+    }
+
+    const uint8_t *payload = data + nal.offset;
+    if (target->size() == nal.size && memcmp(target->data(), payload, nal.size) == 0) {
+        // Parameter set did not change, the cached blob is still valid.
+        return;
+    }
+
+    target->assign(payload, payload + nal.size);
+
+    config_.annexb.clear();
+    for (const std::vector<uint8_t> *ps : {&config_.vps, &config_.sps, &config_.pps}) {
+        if (ps->empty()) {
+            continue;
+        }
+        config_.annexb.insert(config_.annexb.end(), kStartCode, kStartCode + sizeof(kStartCode));
+        config_.annexb.insert(config_.annexb.end(), ps->begin(), ps->end());
+    }
+
+    config_version_++;
+}
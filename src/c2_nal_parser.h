@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "c2_common.h"
+
+/** C2NalUnit
+ *
+ * Location of a single NAL unit inside an Annex-B buffer. The unit is not
+ * copied, offset and size refer to the buffer which was scanned.
+ **/
+struct C2NalUnit {
+    /// nal_unit_type as defined by H.264 (5 bits) or H.265 (6 bits).
+    uint8_t type;
+    /// Length of the start code preceding the unit, 3 or 4 bytes.
+    uint8_t start_code;
+    /// Offset of the NAL unit header, i.e. the first byte after the start code.
+    uint32_t offset;
+    /// Size of the NAL unit without the start code and trailing zero bytes.
+    uint32_t size;
+};
+
+/** C2AccessUnitInfo
+ *
+ * Result of scanning one encoded output buffer.
+ **/
+struct C2AccessUnitInfo {
+    std::vector<C2NalUnit> nals;
+    /// The access unit contains an IDR/IRAP picture.
+    bool is_sync;
+    /// The access unit carries parameter sets (VPS/SPS/PPS).
+    bool has_config;
+};
+
+/** C2CodecConfig
+ *
+ * Latest parameter sets seen on the stream, stored without start codes, and
+ * the same set concatenated into a single Annex-B blob.
+ **/
+struct C2CodecConfig {
+    std::vector<uint8_t> vps;
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+    std::vector<uint8_t> annexb;
+};
+
+/** C2NalParser
+ *
+ * Annex-B start code scanner for H.264/H.265 encoder output. The scanner uses
+ * SSE2 or NEON where available and keeps a cached copy of the parameter sets.
+ **/
+class C2NalParser {
+public:
+    C2NalParser(C2CodecType codec_type);
+    ~C2NalParser(){};
+
+    /**
+     * @brief Split an Annex-B buffer into NAL units and classify the access unit.
+     * @param data: Pointer to the encoded data.
+     * @param size: Size of the encoded data in bytes.
+     * @param info: Filled with the NAL units found and the access unit flags.
+     *
+     * @return: true if at least one NAL unit was found, false otherwise.
+     */
+    bool Parse(const uint8_t *data, uint32_t size, C2AccessUnitInfo &info);
+
+    /**
+     * @brief Latest parameter sets extracted by Parse().
+     */
+    const C2CodecConfig &GetCodecConfig() const { return config_; }
+
+    /**
+     * @brief Bumped each time the cached parameter sets change.
+     */
+    uint32_t GetConfigVersion() const { return config_version_; }
+
+    bool IsHEVC() const { return hevc_; }
+
+    /**
+     * @brief Find the next 00 00 01 start code prefix.
+     * @param data: Pointer to the buffer.
+     * @param size: Size of the buffer.
+     * @param from: Position at which the search begins.
+     *
+     * @return: Position of the first zero byte of the prefix or size if not found.
+     */
+    static size_t FindStartCode(const uint8_t *data, size_t size, size_t from);
+    /**
+     * @brief Byte by byte reference implementation of FindStartCode().
+     */
+    static size_t FindStartCodeScalar(const uint8_t *data, size_t size, size_t from);
+
+    /**
+     * @brief Split a buffer using the scalar scanner, without classification.
+     *        Used as reference when validating the vectorized path.
+     */
+    static void Split(const uint8_t *data, uint32_t size, bool hevc, bool scalar,
+                      std::vector<C2NalUnit> &nals);
+private:
+    void UpdateConfig(const uint8_t *data, const C2NalUnit &nal);
+
+    bool hevc_;
+    C2CodecConfig config_;
+    uint32_t config_version_;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "c2_nal_parser.h"
+
+class C2Buffer;
+
+/** C2EncodedFrame
+ *
+ * Description of one encoded output buffer handed to the output sinks. The
+ * data pointer refers to the mapped Codec2 block and is only valid for the
+ * duration of the OnFrame() call, sinks which need the data afterwards either
+ * copy it or keep a reference to the Codec2 buffer.
+ **/
+struct C2EncodedFrame {
+    /// Encoded Annex-B data.
+    const uint8_t *data;
+    uint32_t size;
+    /// Frame index and presentation timestamp (microseconds) of the input.
+    uint64_t index;
+    uint64_t timestamp;
+    /// C2FrameData flags of the output worklet.
+    uint32_t flags;
+    /// NAL units of the access unit and the sync/config classification.
+    C2AccessUnitInfo au;
+    /// Latest parameter sets of the stream and their version.
+    const C2CodecConfig *config;
+    uint32_t config_version;
+    /// Codec2 buffer owning the data, null when the data is owned by the engine
+    /// (slices assembled into a whole frame).
+    std::shared_ptr<C2Buffer> buffer;
+    /// Position of this output within the frame in slice output mode, and
+    /// whether it completes the frame. Whole frames are slice 0 and last.
+    uint32_t slice = 0;
+    bool last_slice = true;
+    /// SEI NAL unit generated by the engine, start code included, to be
+    /// inserted at sei_offset (the start code of the first coded slice). The
+    /// encoded data itself is not modified.
+    const uint8_t *sei = nullptr;
+    uint32_t sei_size = 0;
+    uint32_t sei_offset = 0;
+};
+
+/** IC2OutputSink
+ *
+ * Interface implemented by consumers of the encoded output. The engine calls
+ * the sinks in the order they were added, from the component callback thread.
+ **/
+class IC2OutputSink {
+public:
+    virtual ~IC2OutputSink(){};
+
+    virtual void OnFrame(const C2EncodedFrame &frame) = 0;
+    virtual void OnEndOfStream(){};
+
+    /**
+     * @brief Whether partial frames are accepted in slice output mode, other
+     * sinks receive the frame once all of its slices are assembled.
+     */
+    virtual bool AcceptsSlices() const { return false; }
+};
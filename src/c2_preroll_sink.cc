@@ -0,0 +1,246 @@
+#include "c2_preroll_sink.h"
+
+#include <C2Buffer.h>
+#include <C2Work.h>
+
+#include "base/log.h"
+
+C2PreRollSink::C2PreRollSink(const C2PreRollConfig &config)
+    : config_(config),
+      codec_config_version_(0),
+      waiting_sync_(true),
+      bytes_(0),
+      copied_bytes_(0),
+      evicted_gops_(0),
+      overflows_(0),
+      triggers_(0) {}
+
+void C2PreRollSink::OnFrame(const C2EncodedFrame &frame) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (target_) {
+        target_->OnFrame(frame);
+    }
+
+    if (frame.config != nullptr &&
+        (!codec_config_ || frame.config_version != codec_config_version_)) {
+        codec_config_ = std::make_shared<C2CodecConfig>(*frame.config);
+        codec_config_version_ = frame.config_version;
+    }
+
+    // Parameter set only buffers are covered by the cached codec config.
+    if ((frame.flags & C2FrameData::FLAG_CODEC_CONFIG) && !frame.au.is_sync) {
+        return;
+    }
+
+    if (frame.au.is_sync) {
+        gops_.emplace_back();
+        gops_.back().config = codec_config_;
+        gops_.back().config_version = codec_config_version_;
+        gops_.back().bytes = 0;
+        waiting_sync_ = false;
+    } else if (waiting_sync_) {
+        return;
+    }
+
+    Gop &gop = gops_.back();
+    gop.frames.emplace_back();
+
+    Entry &entry = gop.frames.back();
+    entry.size = frame.size;
+    entry.index = frame.index;
+    entry.timestamp = frame.timestamp;
+    entry.flags = frame.flags;
+    entry.au = frame.au;
+    entry.sei_offset = frame.sei_offset;
+    if (frame.sei != nullptr) {
+        entry.sei.assign(frame.sei, frame.sei + frame.sei_size);
+    }
+
+    if (frame.buffer && frame.buffer->data().type() == C2BufferData::LINEAR) {
+        entry.buffer = frame.buffer;
+        references_.push_back(&entry);
+    } else {
+        entry.copy.assign(frame.data, frame.data + frame.size);
+        copied_bytes_ += frame.size;
+    }
+    gop.bytes += frame.size;
+    bytes_ += frame.size;
+
+    while (references_.size() > config_.max_references) {
+        Entry *oldest = references_.front();
+        references_.pop_front();
+        Compact(*oldest);
+    }
+
+    // Drop the oldest GOP as long as the remaining ones still cover the duration.
+    uint64_t duration = config_.duration_ms * 1000ull;
+    while (gops_.size() > 1 && frame.timestamp >= gops_[1].frames.front().timestamp &&
+           frame.timestamp - gops_[1].frames.front().timestamp >= duration) {
+        EvictFront();
+    }
+    while (gops_.size() > 1 && bytes_ > config_.max_bytes) {
+        EvictFront();
+    }
+
+    if (bytes_ > config_.max_bytes) {
+        base::LogWarn() << "Pre-roll GOP of " << bytes_ << " bytes exceeds the cap, "
+                        << "waiting for the next sync frame";
+        EvictFront();
+        overflows_++;
+        waiting_sync_ = true;
+    }
+}
+
+void C2PreRollSink::OnEndOfStream() {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (target_) {
+        target_->OnEndOfStream();
+    }
+}
+
+bool C2PreRollSink::Compact(Entry &entry) {
+    const C2ConstLinearBlock block = entry.buffer->data().linearBlocks().front();
+    C2ReadView view = block.map().get();
+    if (view.error() != C2_OK) {
+        base::LogError() << "Failed to map pre-roll frame " << entry.index << ", error "
+                         << view.error();
+        return false;
+    }
+
+    entry.copy.assign(view.data(), view.data() + entry.size);
+    entry.buffer.reset();
+    copied_bytes_ += entry.size;
+    return true;
+}
+
+void C2PreRollSink::EvictFront() {
+    Gop &gop = gops_.front();
+
+    for (Entry &entry : gop.frames) {
+        if (!entry.buffer) {
+            copied_bytes_ -= entry.size;
+        } else if (!references_.empty() && references_.front() == &entry) {
+            // The front GOP holds the oldest references.
+            references_.pop_front();
+        }
+    }
+
+    bytes_ -= gop.bytes;
+    gops_.pop_front();
+    evicted_gops_++;
+}
+
+void C2PreRollSink::Replay(const Gop &gop, const Entry &entry, IC2OutputSink &target) {
+    C2EncodedFrame frame;
+    frame.size = entry.size;
+    frame.index = entry.index;
+    frame.timestamp = entry.timestamp;
+    frame.flags = entry.flags;
+    frame.au = entry.au;
+    frame.config = gop.config.get();
+    frame.config_version = gop.config_version;
+    frame.buffer = entry.buffer;
+    if (!entry.sei.empty()) {
+        frame.sei = entry.sei.data();
+        frame.sei_size = entry.sei.size();
+        frame.sei_offset = entry.sei_offset;
+    }
+
+    if (!entry.buffer) {
+        frame.data = entry.copy.data();
+        target.OnFrame(frame);
+        return;
+    }
+
+    const C2ConstLinearBlock block = entry.buffer->data().linearBlocks().front();
+    C2ReadView view = block.map().get();
+    if (view.error() != C2_OK) {
+        base::LogError() << "Failed to map pre-roll frame " << entry.index << ", error "
+                         << view.error();
+        return;
+    }
+
+    frame.data = view.data();
+    target.OnFrame(frame);
+}
+
+uint32_t C2PreRollSink::Trigger(std::shared_ptr<IC2OutputSink> target, bool follow) {
+    std::lock_guard<std::mutex> lk(lock_);
+    uint32_t count = 0;
+
+    triggers_++;
+    target_ = follow ? target : nullptr;
+
+    if (gops_.empty()) {
+        return 0;
+    }
+
+    // Raw Annex-B consumers need the parameter sets ahead of the first frame.
+    const Gop &first = gops_.front();
+    const Entry &head = first.frames.front();
+    if (!head.au.has_config && first.config && !first.config->annexb.empty()) {
+        C2EncodedFrame config;
+        config.data = first.config->annexb.data();
+        config.size = first.config->annexb.size();
+        config.index = head.index;
+        config.timestamp = head.timestamp;
+        config.flags = C2FrameData::FLAG_CODEC_CONFIG;
+        config.au.is_sync = false;
+        config.au.has_config = true;
+        config.config = first.config.get();
+        config.config_version = first.config_version;
+        target->OnFrame(config);
+    }
+
+    for (const Gop &gop : gops_) {
+        for (const Entry &entry : gop.frames) {
+            Replay(gop, entry, *target);
+            count++;
+        }
+    }
+
+    base::LogInfo() << "Pre-roll replayed " << count << " frames in " << gops_.size()
+                    << " GOPs";
+    return count;
+}
+
+void C2PreRollSink::Detach() {
+    std::lock_guard<std::mutex> lk(lock_);
+    target_ = nullptr;
+}
+
+void C2PreRollSink::ReleaseReferences() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    for (; !references_.empty(); references_.pop_front()) {
+        Compact(*references_.front());
+    }
+}
+
+void C2PreRollSink::GetStats(C2PreRollStats &stats) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    stats.frames = 0;
+    stats.gops = gops_.size();
+    stats.references = 0;
+    stats.bytes = bytes_;
+    stats.copied_bytes = copied_bytes_;
+    stats.duration = 0;
+    stats.evicted_gops = evicted_gops_;
+    stats.overflows = overflows_;
+    stats.triggers = triggers_;
+
+    for (const Gop &gop : gops_) {
+        stats.frames += gop.frames.size();
+        for (const Entry &entry : gop.frames) {
+            stats.references += entry.buffer ? 1 : 0;
+        }
+    }
+
+    if (!gops_.empty()) {
+        uint64_t first = gops_.front().frames.front().timestamp;
+        uint64_t last = gops_.back().frames.back().timestamp;
+        stats.duration = (last > first) ? (last - first) : 0;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "c2_output_sink.h"
+
+struct C2PreRollConfig {
+    /// Time kept before a trigger, the window starts at the sync frame preceding it.
+    uint32_t duration_ms = 5000;
+    /// Cap of the encoded data held, referenced and copied frames together.
+    size_t max_bytes = 32 << 20;
+    /// Output buffers kept referenced, older frames are copied so that their
+    /// blocks return to the encoder pool.
+    uint32_t max_references = 8;
+};
+
+/** C2PreRollStats
+ *
+ * Current content of the pre-roll window and lifetime counters.
+ **/
+struct C2PreRollStats {
+    uint32_t frames;
+    uint32_t gops;
+    /// Frames still referencing a Codec2 output buffer.
+    uint32_t references;
+    /// Encoded bytes held, and the part of it held as copies.
+    size_t bytes;
+    size_t copied_bytes;
+    /// Timestamp span of the window in microseconds.
+    uint64_t duration;
+    uint64_t evicted_gops;
+    /// GOPs discarded because they alone exceeded max_bytes.
+    uint64_t overflows;
+    uint64_t triggers;
+};
+
+/** C2PreRollSink
+ *
+ * Output sink keeping the last seconds of the encoded stream for instant
+ * replay. Recent frames hold a reference to their Codec2 output buffer, older
+ * ones are compacted into copies of the encoded bytes. Whole GOPs are evicted
+ * from the front once the window is longer than the configured duration or
+ * larger than the memory cap, so the window always starts at a sync frame.
+ * Trigger() hands the window to another sink as is, without re-encoding.
+ **/
+class C2PreRollSink : public IC2OutputSink {
+public:
+    C2PreRollSink(const C2PreRollConfig &config);
+    ~C2PreRollSink(){};
+
+    void OnFrame(const C2EncodedFrame &frame) override;
+    void OnEndOfStream() override;
+
+    /**
+     * @brief Replay the window to target, oldest sync frame first.
+     * @param target: Sink receiving the pre-roll frames.
+     * @param follow: Keep forwarding new frames to target until Detach().
+     *
+     * @return: Number of frames replayed.
+     */
+    uint32_t Trigger(std::shared_ptr<IC2OutputSink> target, bool follow);
+
+    /**
+     * @brief Stop forwarding new frames to the sink of the last Trigger().
+     */
+    void Detach();
+
+    /**
+     * @brief Copy every referenced frame, e.g. when the output pool runs low.
+     */
+    void ReleaseReferences();
+
+    void GetStats(C2PreRollStats &stats);
+private:
+    struct Entry {
+        /// Referenced output buffer, empty once the frame is copied.
+        std::shared_ptr<C2Buffer> buffer;
+        std::vector<uint8_t> copy;
+        uint32_t size;
+        uint64_t index;
+        uint64_t timestamp;
+        uint32_t flags;
+        C2AccessUnitInfo au;
+        /// Engine SEI inserted on output, kept since it does not outlive OnFrame().
+        std::vector<uint8_t> sei;
+        uint32_t sei_offset;
+    };
+
+    struct Gop {
+        std::deque<Entry> frames;
+        /// Parameter sets in use when the GOP started.
+        std::shared_ptr<const C2CodecConfig> config;
+        uint32_t config_version;
+        size_t bytes;
+    };
+
+    bool Compact(Entry &entry);
+    void EvictFront();
+    void Replay(const Gop &gop, const Entry &entry, IC2OutputSink &target);
+
+    C2PreRollConfig config_;
+
+    std::mutex lock_;
+    std::deque<Gop> gops_;
+    /// Referenced frames, oldest first, compacted beyond max_references.
+    std::deque<Entry *> references_;
+    std::shared_ptr<const C2CodecConfig> codec_config_;
+    uint32_t codec_config_version_;
+    /// Frames are discarded until the next sync frame.
+    bool waiting_sync_;
+    std::shared_ptr<IC2OutputSink> target_;
+
+    size_t bytes_;
+    size_t copied_bytes_;
+    uint64_t evicted_gops_;
+    uint64_t overflows_;
+    uint64_t triggers_;
+};
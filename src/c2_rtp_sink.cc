@@ -0,0 +1,271 @@
+#include "c2_rtp_sink.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+
+#define RTP_HEADER_SIZE 12
+#define RTP_VERSION 2
+
+// Fragmentation unit packet types.
+#define AVC_FU_A 28
+#define HEVC_FU 49
+
+// Access unit delimiters are not sent, the marker bit delimits access units.
+#define AVC_NAL_AUD 9
+#define HEVC_NAL_AUD 35
+
+// The engine SEI is handed over with a 4 byte start code.
+#define SEI_START_CODE 4
+
+C2RtpPacketizer::C2RtpPacketizer(bool hevc, uint8_t payload_type, uint32_t ssrc, uint32_t mtu)
+    : hevc_(hevc), payload_type_(payload_type), ssrc_(ssrc), mtu_(mtu), sequence_(0) {}
+
+void C2RtpPacketizer::WriteHeader(C2RtpPacket &packet, uint32_t timestamp, bool marker) {
+    uint8_t *header = packet.header;
+
+    header[0] = RTP_VERSION << 6;
+    header[1] = (marker ? 0x80 : 0x00) | (payload_type_ & 0x7F);
+    header[2] = sequence_ >> 8;
+    header[3] = sequence_ & 0xFF;
+    header[4] = timestamp >> 24;
+    header[5] = (timestamp >> 16) & 0xFF;
+    header[6] = (timestamp >> 8) & 0xFF;
+    header[7] = timestamp & 0xFF;
+    header[8] = ssrc_ >> 24;
+    header[9] = (ssrc_ >> 16) & 0xFF;
+    header[10] = (ssrc_ >> 8) & 0xFF;
+    header[11] = ssrc_ & 0xFF;
+
+    packet.header_size = RTP_HEADER_SIZE;
+    sequence_++;
+}
+
+void C2RtpPacketizer::Packetize(const uint8_t *nal, uint32_t size, uint32_t timestamp,
+                                bool marker, std::vector<C2RtpPacket> &packets) {
+    uint32_t nal_header_size = hevc_ ? 2 : 1;
+    if (size <= nal_header_size) {
+        return;
+    }
+
+    if (size <= mtu_) {
+        // Single NAL unit packet.
+        C2RtpPacket packet;
+        WriteHeader(packet, timestamp, marker);
+        packet.payload = nal;
+        packet.payload_size = size;
+        packets.push_back(packet);
+        return;
+    }
+
+    // Fragmentation units, the NAL unit header is replaced by the FU headers.
+    uint32_t fu_header_size = nal_header_size + 1;
+    if (mtu_ <= fu_header_size) {
+        // No room for fragment payload, rejected by C2RtpSink::Open().
+        return;
+    }
+    uint32_t chunk = mtu_ - fu_header_size;
+    uint8_t type = hevc_ ? ((nal[0] >> 1) & 0x3F) : (nal[0] & 0x1F);
+
+    const uint8_t *payload = nal + nal_header_size;
+    uint32_t remaining = size - nal_header_size;
+    bool first = true;
+
+    while (remaining > 0) {
+        uint32_t length = std::min(chunk, remaining);
+        bool last = (length == remaining);
+
+        C2RtpPacket packet;
+        WriteHeader(packet, timestamp, marker && last);
+
+        uint8_t *fu = packet.header + RTP_HEADER_SIZE;
+        if (hevc_) {
+            fu[0] = (nal[0] & 0x81) | (HEVC_FU << 1);
+            fu[1] = nal[1];
+            fu[2] = (first ? 0x80 : 0x00) | (last ? 0x40 : 0x00) | type;
+        } else {
+            fu[0] = (nal[0] & 0xE0) | AVC_FU_A;
+            fu[1] = (first ? 0x80 : 0x00) | (last ? 0x40 : 0x00) | type;
+        }
+        packet.header_size += fu_header_size;
+        packet.payload = payload;
+        packet.payload_size = length;
+        packets.push_back(packet);
+
+        payload += length;
+        remaining -= length;
+        first = false;
+    }
+}
+
+C2RtpSink::C2RtpSink(const C2RtpConfig &config)
+    : config_(config),
+      packetizer_(config.hevc, config.payload_type, config.ssrc, config.mtu),
+      socket_(-1),
+      packets_sent_(0),
+      bytes_sent_(0),
+      send_errors_(0) {}
+
+C2RtpSink::~C2RtpSink() {
+    Close();
+}
+
+bool C2RtpSink::Open() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    // Fragmentation units need room for their headers and some payload.
+    uint32_t fu_header_size = config_.hevc ? 3 : 2;
+    if (config_.mtu <= fu_header_size) {
+        base::LogError() << "RTP payload size " << config_.mtu << " too small, more than "
+                         << fu_header_size << " bytes are needed";
+        return false;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *result = nullptr;
+    std::string port = std::to_string(config_.port);
+    int status = getaddrinfo(config_.host.c_str(), port.c_str(), &hints, &result);
+    if (status != 0) {
+        base::LogError() << "Failed to resolve " << config_.host << ", error: "
+                         << gai_strerror(status);
+        return false;
+    }
+
+    for (struct addrinfo *addr = result; addr != nullptr; addr = addr->ai_next) {
+        socket_ = socket(addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC, addr->ai_protocol);
+        if (socket_ < 0) {
+            continue;
+        }
+        if (connect(socket_, addr->ai_addr, addr->ai_addrlen) == 0) {
+            break;
+        }
+        close(socket_);
+        socket_ = -1;
+    }
+    freeaddrinfo(result);
+
+    if (socket_ < 0) {
+        base::LogError() << "Failed to connect RTP socket to " << config_.host << ":"
+                         << config_.port;
+        return false;
+    }
+
+    int size = 4 * 1024 * 1024;
+    setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    return true;
+}
+
+void C2RtpSink::Close() {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (socket_ >= 0) {
+        close(socket_);
+        socket_ = -1;
+    }
+}
+
+void C2RtpSink::OnFrame(const C2EncodedFrame &frame) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (socket_ < 0) {
+        return;
+    }
+
+    uint32_t timestamp = static_cast<uint32_t>(frame.timestamp * 90000 / 1000000);
+    uint8_t aud = config_.hevc ? HEVC_NAL_AUD : AVC_NAL_AUD;
+
+    packets_.clear();
+
+    // Receivers joining late need the parameter sets right before the IDR.
+    if (config_.resend_config && frame.au.is_sync && !frame.au.has_config &&
+        frame.slice == 0 && frame.config != nullptr) {
+        for (const std::vector<uint8_t> *ps :
+             {&frame.config->vps, &frame.config->sps, &frame.config->pps}) {
+            if (!ps->empty()) {
+                packetizer_.Packetize(ps->data(), ps->size(), timestamp, false, packets_);
+            }
+        }
+    }
+
+    // The marker bit goes on the last packet of the last sent NAL unit, and
+    // only on the last slice in slice output mode.
+    size_t last = frame.au.nals.size();
+    for (size_t idx = 0; frame.last_slice && idx < frame.au.nals.size(); idx++) {
+        if (frame.au.nals[idx].type != aud) {
+            last = idx;
+        }
+    }
+
+    // The engine SEI is sent ahead of the NAL unit it is inserted before.
+    bool sei = (frame.sei != nullptr);
+    for (size_t idx = 0; idx < frame.au.nals.size(); idx++) {
+        const C2NalUnit &nal = frame.au.nals[idx];
+        if (sei && nal.offset > frame.sei_offset) {
+            packetizer_.Packetize(frame.sei + SEI_START_CODE, frame.sei_size - SEI_START_CODE,
+                                  timestamp, false, packets_);
+            sei = false;
+        }
+        if (nal.type == aud) {
+            continue;
+        }
+        packetizer_.Packetize(frame.data + nal.offset, nal.size, timestamp, idx == last,
+                              packets_);
+    }
+
+    Send();
+}
+
+bool C2RtpSink::Send() {
+    iov_.resize(packets_.size() * 2);
+    messages_.resize(std::min<size_t>(packets_.size(), config_.batch));
+
+    size_t sent = 0;
+    while (sent < packets_.size()) {
+        size_t count = std::min<size_t>(packets_.size() - sent, config_.batch);
+
+        for (size_t idx = 0; idx < count; idx++) {
+            C2RtpPacket &packet = packets_[sent + idx];
+            struct iovec *iov = &iov_[(sent + idx) * 2];
+
+            iov[0].iov_base = packet.header;
+            iov[0].iov_len = packet.header_size;
+            iov[1].iov_base = const_cast<uint8_t *>(packet.payload);
+            iov[1].iov_len = packet.payload_size;
+
+            memset(&messages_[idx], 0, sizeof(struct mmsghdr));
+            messages_[idx].msg_hdr.msg_iov = iov;
+            messages_[idx].msg_hdr.msg_iovlen = 2;
+        }
+
+        int result = sendmmsg(socket_, messages_.data(), count, 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Drop the rest of the frame rather than stalling the callback thread.
+            send_errors_ += packets_.size() - sent;
+            base::LogDebug() << "sendmmsg failed, error: " << strerror(errno);
+            return false;
+        }
+
+        for (int idx = 0; idx < result; idx++) {
+            bytes_sent_ += messages_[idx].msg_len;
+        }
+        packets_sent_ += result;
+        sent += result;
+    }
+
+    return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "c2_output_sink.h"
+
+struct C2RtpConfig {
+    /// Destination address and UDP port.
+    std::string host = "127.0.0.1";
+    uint16_t port = 5004;
+    /// Packetize as RFC 7798 (H.265) instead of RFC 6184 (H.264).
+    bool hevc = false;
+    uint8_t payload_type = 96;
+    uint32_t ssrc = 0x43325254;
+    /// Maximum RTP payload size, NAL units above it are fragmented.
+    uint32_t mtu = 1400;
+    /// Maximum number of packets handed to a single sendmmsg call.
+    uint32_t batch = 64;
+    /// Send the cached parameter sets ahead of sync frames lacking them.
+    bool resend_config = true;
+};
+
+/** C2RtpPacket
+ *
+ * One RTP packet made of a small header area (RTP header plus the FU-A/FU
+ * headers) and a payload pointing into the NAL unit it was built from.
+ **/
+struct C2RtpPacket {
+    uint8_t header[16];
+    uint32_t header_size;
+    const uint8_t *payload;
+    uint32_t payload_size;
+};
+
+/** C2RtpPacketizer
+ *
+ * Splits NAL units into RTP packets without copying the payload: single NAL
+ * unit packets when they fit in the MTU, FU-A (RFC 6184) or FU (RFC 7798)
+ * fragments otherwise.
+ **/
+class C2RtpPacketizer {
+public:
+    C2RtpPacketizer(bool hevc, uint8_t payload_type, uint32_t ssrc, uint32_t mtu);
+    ~C2RtpPacketizer(){};
+
+    /**
+     * @brief Append the packets carrying one NAL unit.
+     * @param nal: NAL unit including its header, without start code.
+     * @param size: Size of the NAL unit.
+     * @param timestamp: RTP timestamp (90 kHz) of the access unit.
+     * @param marker: Set the marker bit on the last packet (end of access unit).
+     * @param packets: Packets are appended to this list.
+     */
+    void Packetize(const uint8_t *nal, uint32_t size, uint32_t timestamp, bool marker,
+                   std::vector<C2RtpPacket> &packets);
+
+    uint16_t GetSequence() const { return sequence_; }
+private:
+    void WriteHeader(C2RtpPacket &packet, uint32_t timestamp, bool marker);
+
+    bool hevc_;
+    uint8_t payload_type_;
+    uint32_t ssrc_;
+    uint32_t mtu_;
+    uint16_t sequence_;
+};
+
+/** C2RtpSink
+ *
+ * Output sink sending the encoded stream as RTP over UDP. Packets reference
+ * the mapped output buffer directly and are sent with sendmmsg in batches.
+ **/
+class C2RtpSink : public IC2OutputSink {
+public:
+    C2RtpSink(const C2RtpConfig &config);
+    ~C2RtpSink();
+
+    /**
+     * @brief Create the UDP socket and connect it to the destination.
+     *
+     * @return: true on success or false on failure.
+     */
+    bool Open();
+    void Close();
+
+    void OnFrame(const C2EncodedFrame &frame) override;
+    bool AcceptsSlices() const override { return true; }
+
+    uint64_t GetPacketsSent() const { return packets_sent_; }
+    uint64_t GetBytesSent() const { return bytes_sent_; }
+    uint64_t GetSendErrors() const { return send_errors_; }
+private:
+    bool Send();
+
+    C2RtpConfig config_;
+    C2RtpPacketizer packetizer_;
+    int socket_;
+
+    /// Scratch lists reused between frames.
+    std::vector<C2RtpPacket> packets_;
+    std::vector<struct iovec> iov_;
+    std::vector<struct mmsghdr> messages_;
+
+    std::atomic<uint64_t> packets_sent_;
+    std::atomic<uint64_t> bytes_sent_;
+    std::atomic<uint64_t> send_errors_;
+
+    std::mutex lock_;
+};
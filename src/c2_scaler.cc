@@ -0,0 +1,237 @@
+#include "c2_scaler.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/// Bilinear weights are 7-bit so that both fit in 8 bits (NEON widening multiply).
+#define BILINEAR_BITS 7
+#define BILINEAR_ONE (1 << BILINEAR_BITS)
+/// Largest integer ratio handled by the box filter, bounded by the 16-bit row sums.
+#define MAX_BOX_FACTOR 16
+
+/** Tap
+ *
+ * Source sample pair and weight of the second sample for one output position.
+ **/
+struct Tap {
+    uint32_t first;
+    uint32_t second;
+    uint32_t weight;
+};
+
+// Map output position to source position with pixel centers aligned.
+static Tap bilinear_tap(uint32_t pos, uint32_t src_size, uint32_t dst_size) {
+    int64_t fixed = ((2 * static_cast<int64_t>(pos) + 1) * src_size << 16) / (2 * dst_size) -
+                    (1 << 15);
+    fixed = std::max<int64_t>(fixed, 0);
+
+    Tap tap;
+    tap.first = static_cast<uint32_t>(fixed >> 16);
+    tap.weight = static_cast<uint32_t>((fixed & 0xFFFF) >> (16 - BILINEAR_BITS));
+    if (tap.first >= src_size - 1) {
+        tap.first = src_size - 1;
+        tap.weight = 0;
+    }
+    tap.second = std::min(tap.first + 1, src_size - 1);
+    return tap;
+}
+
+static void blend_rows_scalar(const uint8_t *row0, const uint8_t *row1, uint32_t weight,
+                              uint16_t *out, uint32_t count) {
+    for (uint32_t idx = 0; idx < count; idx++) {
+        out[idx] = row0[idx] * (BILINEAR_ONE - weight) + row1[idx] * weight;
+    }
+}
+
+// out = row0 * (128 - weight) + row1 * weight, at most 255 * 128 so it fits 16 bits.
+static void blend_rows(const uint8_t *row0, const uint8_t *row1, uint32_t weight, uint16_t *out,
+                       uint32_t count) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    uint32_t vector_count = count & ~15u;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w0 = _mm_set1_epi16(BILINEAR_ONE - weight);
+    const __m128i w1 = _mm_set1_epi16(weight);
+#else
+    const uint8x8_t w0 = vdup_n_u8(BILINEAR_ONE - weight);
+    const uint8x8_t w1 = vdup_n_u8(weight);
+#endif
+
+    for (uint32_t idx = 0; idx < vector_count; idx += 16) {
+#if defined(__SSE2__)
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + idx));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + idx));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + idx), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + idx + 8), hi);
+#else
+        uint8x16_t a = vld1q_u8(row0 + idx);
+        uint8x16_t b = vld1q_u8(row1 + idx);
+        vst1q_u16(out + idx, vmlal_u8(vmull_u8(vget_low_u8(a), w0), vget_low_u8(b), w1));
+        vst1q_u16(out + idx + 8, vmlal_u8(vmull_u8(vget_high_u8(a), w0), vget_high_u8(b), w1));
+#endif
+    }
+
+    blend_rows_scalar(row0 + vector_count, row1 + vector_count, weight, out + vector_count,
+                      count - vector_count);
+#else
+    blend_rows_scalar(row0, row1, weight, out, count);
+#endif
+}
+
+static void sum_rows_scalar(const uint8_t *row, uint16_t *out, uint32_t count, bool first) {
+    for (uint32_t idx = 0; idx < count; idx++) {
+        out[idx] = first ? row[idx] : (out[idx] + row[idx]);
+    }
+}
+
+// out (+)= row, widened to 16 bits.
+static void sum_rows(const uint8_t *row, uint16_t *out, uint32_t count, bool first) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+    uint32_t vector_count = count & ~15u;
+
+    for (uint32_t idx = 0; idx < vector_count; idx += 16) {
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + idx));
+        __m128i lo = _mm_unpacklo_epi8(value, zero);
+        __m128i hi = _mm_unpackhi_epi8(value, zero);
+        if (!first) {
+            lo = _mm_add_epi16(lo, _mm_loadu_si128(reinterpret_cast<__m128i *>(out + idx)));
+            hi = _mm_add_epi16(hi, _mm_loadu_si128(reinterpret_cast<__m128i *>(out + idx + 8)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + idx), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + idx + 8), hi);
+#else
+        uint8x16_t value = vld1q_u8(row + idx);
+        if (first) {
+            vst1q_u16(out + idx, vmovl_u8(vget_low_u8(value)));
+            vst1q_u16(out + idx + 8, vmovl_u8(vget_high_u8(value)));
+        } else {
+            vst1q_u16(out + idx, vaddw_u8(vld1q_u16(out + idx), vget_low_u8(value)));
+            vst1q_u16(out + idx + 8, vaddw_u8(vld1q_u16(out + idx + 8), vget_high_u8(value)));
+        }
+#endif
+    }
+
+    sum_rows_scalar(row + vector_count, out + vector_count, count - vector_count, first);
+#else
+    sum_rows_scalar(row, out, count, first);
+#endif
+}
+
+// Horizontal bilinear pass on a vertically blended line, rounding away the 2x 7-bit weights.
+template <uint32_t CHANNELS>
+static void blend_columns(const uint16_t *line, const Tap *columns, uint8_t *out,
+                          uint32_t dst_width) {
+    for (uint32_t col = 0; col < dst_width; col++) {
+        const uint16_t *first = line + columns[col].first * CHANNELS;
+        const uint16_t *second = line + columns[col].second * CHANNELS;
+        uint32_t weight = columns[col].weight;
+
+        for (uint32_t ch = 0; ch < CHANNELS; ch++) {
+            uint32_t sum = first[ch] * (BILINEAR_ONE - weight) + second[ch] * weight;
+            out[col * CHANNELS + ch] =
+                (sum + (1 << (2 * BILINEAR_BITS - 1))) >> (2 * BILINEAR_BITS);
+        }
+    }
+}
+
+void C2Scaler::ScalePlane(const uint8_t *src, uint32_t src_stride, uint32_t src_width,
+                          uint32_t src_height, uint8_t *dst, uint32_t dst_stride,
+                          uint32_t dst_width, uint32_t dst_height, uint32_t channels,
+                          uint32_t first_row, uint32_t last_row, bool scalar) {
+    last_row = std::min(last_row, dst_height);
+    if (first_row >= last_row || dst_width == 0) {
+        return;
+    }
+
+    uint32_t row_samples = src_width * channels;
+
+    if (src_width == dst_width && src_height == dst_height) {
+        for (uint32_t row = first_row; row < last_row; row++) {
+            memcpy(dst + static_cast<size_t>(row) * dst_stride,
+                   src + static_cast<size_t>(row) * src_stride, row_samples);
+        }
+        return;
+    }
+
+    std::vector<uint16_t> line(row_samples);
+    uint32_t factor = src_width / dst_width;
+
+    if (factor >= 2 && factor <= MAX_BOX_FACTOR && src_width == dst_width * factor &&
+        src_height == dst_height * factor) {
+        uint32_t area = factor * factor;
+
+        for (uint32_t row = first_row; row < last_row; row++) {
+            for (uint32_t tap = 0; tap < factor; tap++) {
+                const uint8_t *in = src + static_cast<size_t>(row * factor + tap) * src_stride;
+                if (scalar) {
+                    sum_rows_scalar(in, line.data(), row_samples, tap == 0);
+                } else {
+                    sum_rows(in, line.data(), row_samples, tap == 0);
+                }
+            }
+
+            uint8_t *out = dst + static_cast<size_t>(row) * dst_stride;
+            for (uint32_t col = 0; col < dst_width; col++) {
+                const uint16_t *block = line.data() + col * factor * channels;
+                for (uint32_t ch = 0; ch < channels; ch++) {
+                    uint32_t sum = 0;
+                    for (uint32_t tap = 0; tap < factor; tap++) {
+                        sum += block[tap * channels + ch];
+                    }
+                    out[col * channels + ch] = (sum + area / 2) / area;
+                }
+            }
+        }
+        return;
+    }
+
+    std::vector<Tap> columns(dst_width);
+    for (uint32_t col = 0; col < dst_width; col++) {
+        columns[col] = bilinear_tap(col, src_width, dst_width);
+    }
+
+    for (uint32_t row = first_row; row < last_row; row++) {
+        Tap tap = bilinear_tap(row, src_height, dst_height);
+        const uint8_t *row0 = src + static_cast<size_t>(tap.first) * src_stride;
+        const uint8_t *row1 = src + static_cast<size_t>(tap.second) * src_stride;
+
+        if (scalar) {
+            blend_rows_scalar(row0, row1, tap.weight, line.data(), row_samples);
+        } else {
+            blend_rows(row0, row1, tap.weight, line.data(), row_samples);
+        }
+
+        uint8_t *out = dst + static_cast<size_t>(row) * dst_stride;
+        if (channels == 2) {
+            blend_columns<2>(line.data(), columns.data(), out, dst_width);
+        } else {
+            blend_columns<1>(line.data(), columns.data(), out, dst_width);
+        }
+    }
+}
+
+void C2Scaler::ScaleNV12(const uint8_t *src_y, uint32_t src_y_stride, const uint8_t *src_uv,
+                         uint32_t src_uv_stride, uint32_t src_width, uint32_t src_height,
+                         uint8_t *dst_y, uint32_t dst_y_stride, uint8_t *dst_uv,
+                         uint32_t dst_uv_stride, uint32_t dst_width, uint32_t dst_height,
+                         bool scalar) {
+    ScalePlane(src_y, src_y_stride, src_width, src_height, dst_y, dst_y_stride, dst_width,
+               dst_height, 1, 0, dst_height, scalar);
+    ScalePlane(src_uv, src_uv_stride, src_width / 2, src_height / 2, dst_uv, dst_uv_stride,
+               dst_width / 2, dst_height / 2, 2, 0, dst_height / 2, scalar);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+/** C2Scaler
+ *
+ * Downscaler for 8-bit planes, used to derive smaller simulcast renditions.
+ * Integer factors use a box (area average) filter, other ratios bilinear.
+ * The vertical pass, which touches every source row, is vectorized (SSE2 or
+ * NEON); the horizontal pass runs on the already reduced row. Output rows can
+ * be produced in independent stripes so a frame can be split across threads.
+ **/
+class C2Scaler {
+public:
+    /**
+     * @brief Scale rows [first_row, last_row) of the destination plane.
+     * @param channels: Interleaved samples per pixel, 1 for luma, 2 for NV12 UV.
+     * @param src_width: Source width in pixels.
+     * @param dst_width: Destination width in pixels.
+     * @param scalar: Use the scalar vertical pass, as reference.
+     */
+    static void ScalePlane(const uint8_t *src, uint32_t src_stride, uint32_t src_width,
+                           uint32_t src_height, uint8_t *dst, uint32_t dst_stride,
+                           uint32_t dst_width, uint32_t dst_height, uint32_t channels,
+                           uint32_t first_row, uint32_t last_row, bool scalar = false);
+
+    /**
+     * @brief Scale a whole NV12 frame.
+     * @param src_width: Source luma width, must be even.
+     * @param dst_width: Destination luma width, must be even.
+     */
+    static void ScaleNV12(const uint8_t *src_y, uint32_t src_y_stride, const uint8_t *src_uv,
+                          uint32_t src_uv_stride, uint32_t src_width, uint32_t src_height,
+                          uint8_t *dst_y, uint32_t dst_y_stride, uint8_t *dst_uv,
+                          uint32_t dst_uv_stride, uint32_t dst_width, uint32_t dst_height,
+                          bool scalar = false);
+};
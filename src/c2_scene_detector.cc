@@ -0,0 +1,125 @@
+#include "c2_scene_detector.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define BLOCK_SIZE 16
+#define BLOCK_PIXELS (BLOCK_SIZE * BLOCK_SIZE)
+
+C2SceneDetector::C2SceneDetector(const C2SceneDetectConfig &config)
+    : config_(config), width_(0), height_(0), static_frames_(0) {
+    if (config_.grid_step == 0) {
+        config_.grid_step = 1;
+    }
+}
+
+void C2SceneDetector::Reset() {
+    width_ = 0;
+    height_ = 0;
+    reference_.clear();
+    static_frames_ = 0;
+}
+
+uint32_t C2SceneDetector::BlockSADScalar(const uint8_t *a, uint32_t a_stride, const uint8_t *b,
+                                         uint32_t b_stride) {
+    uint32_t sad = 0;
+    for (uint32_t row = 0; row < BLOCK_SIZE; row++) {
+        for (uint32_t col = 0; col < BLOCK_SIZE; col++) {
+            sad += (a[col] > b[col]) ? (a[col] - b[col]) : (b[col] - a[col]);
+        }
+        a += a_stride;
+        b += b_stride;
+    }
+    return sad;
+}
+
+uint32_t C2SceneDetector::BlockSAD(const uint8_t *a, uint32_t a_stride, const uint8_t *b,
+                                   uint32_t b_stride) {
+#if defined(__SSE2__)
+    __m128i sum = _mm_setzero_si128();
+    for (uint32_t row = 0; row < BLOCK_SIZE; row++) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+        a += a_stride;
+        b += b_stride;
+    }
+    return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    uint16x8_t sum = vdupq_n_u16(0);
+    for (uint32_t row = 0; row < BLOCK_SIZE; row++) {
+        sum = vpadalq_u8(sum, vabdq_u8(vld1q_u8(a), vld1q_u8(b)));
+        a += a_stride;
+        b += b_stride;
+    }
+    return vaddlvq_u16(sum);
+#else
+    return BlockSADScalar(a, a_stride, b, b_stride);
+#endif
+}
+
+void C2SceneDetector::StoreReference(const uint8_t *y, uint32_t stride) {
+    uint32_t step = config_.grid_step * BLOCK_SIZE;
+    uint8_t *out = reference_.data();
+
+    for (uint32_t top = 0; top + BLOCK_SIZE <= height_; top += step) {
+        for (uint32_t left = 0; left + BLOCK_SIZE <= width_; left += step) {
+            const uint8_t *block = y + static_cast<size_t>(top) * stride + left;
+            for (uint32_t row = 0; row < BLOCK_SIZE; row++) {
+                memcpy(out, block + row * stride, BLOCK_SIZE);
+                out += BLOCK_SIZE;
+            }
+        }
+    }
+}
+
+bool C2SceneDetector::IsStatic(const uint8_t *y, uint32_t stride, uint32_t width,
+                               uint32_t height) {
+    uint32_t step = config_.grid_step * BLOCK_SIZE;
+
+    if (width != width_ || height != height_ || reference_.empty()) {
+        width_ = width;
+        height_ = height;
+
+        size_t blocks = 0;
+        for (uint32_t top = 0; top + BLOCK_SIZE <= height; top += step) {
+            for (uint32_t left = 0; left + BLOCK_SIZE <= width; left += step) {
+                blocks++;
+            }
+        }
+        reference_.resize(blocks * BLOCK_PIXELS);
+        StoreReference(y, stride);
+        static_frames_ = 0;
+        return false;
+    }
+
+    uint32_t limit = config_.threshold * BLOCK_PIXELS;
+    const uint8_t *ref = reference_.data();
+    bool changed = false;
+
+    for (uint32_t top = 0; !changed && top + BLOCK_SIZE <= height; top += step) {
+        for (uint32_t left = 0; left + BLOCK_SIZE <= width; left += step) {
+            const uint8_t *block = y + static_cast<size_t>(top) * stride + left;
+            if (BlockSAD(block, stride, ref, BLOCK_SIZE) > limit) {
+                changed = true;
+                break;
+            }
+            ref += BLOCK_PIXELS;
+        }
+    }
+
+    if (!changed && (config_.max_static_frames == 0 ||
+                     static_frames_ < config_.max_static_frames)) {
+        static_frames_++;
+        return true;
+    }
+
+    StoreReference(y, stride);
+    static_frames_ = 0;
+    return false;
+}
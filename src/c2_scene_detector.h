@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+/**
+ * @brief What the engine does with a frame that did not change
+*/
+enum class C2SkipAction : uint32_t {
+    /// The frame is not submitted, a kSkip event is reported instead.
+    kSkip,
+    /// The frame is submitted with a reduced bitrate tuning.
+    kLowCost,
+};
+
+struct C2SceneDetectConfig {
+    bool enabled = false;
+    /// Only every grid_step-th 16x16 block in each direction is compared.
+    uint32_t grid_step = 2;
+    /// Mean absolute luma difference per pixel above which a block has changed.
+    uint32_t threshold = 3;
+    C2SkipAction action = C2SkipAction::kSkip;
+    /// Bitrate divisor applied to static frames with kLowCost.
+    uint32_t low_cost_divisor = 8;
+    /// Static frames in a row after which one is encoded anyway, 0 for no limit.
+    uint32_t max_static_frames = 0;
+};
+
+/** C2SceneDetector
+ *
+ * Detects frames identical (within a threshold) to the last encoded one by
+ * comparing the luma of a subsampled grid of 16x16 blocks. Only the sampled
+ * blocks of the reference are kept. Block SADs use SSE2 or NEON with a
+ * scalar fallback.
+ **/
+class C2SceneDetector {
+public:
+    explicit C2SceneDetector(const C2SceneDetectConfig &config);
+
+    /**
+     * @brief Compare the frame against the reference. A changed frame becomes
+     * the new reference, a static one leaves the reference untouched so slow
+     * drift still accumulates.
+     * @param y: Luma plane.
+     *
+     * @return: true if the frame has not changed.
+     */
+    bool IsStatic(const uint8_t *y, uint32_t stride, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Forget the reference, the next frame is reported as changed.
+     */
+    void Reset();
+
+    const C2SceneDetectConfig &GetConfig() const { return config_; }
+
+    /**
+     * @brief Sum of absolute differences of a 16x16 block.
+     */
+    static uint32_t BlockSAD(const uint8_t *a, uint32_t a_stride, const uint8_t *b,
+                             uint32_t b_stride);
+    static uint32_t BlockSADScalar(const uint8_t *a, uint32_t a_stride, const uint8_t *b,
+                                   uint32_t b_stride);
+private:
+    void StoreReference(const uint8_t *y, uint32_t stride);
+
+    C2SceneDetectConfig config_;
+    uint32_t width_;
+    uint32_t height_;
+    /// Sampled blocks of the reference frame, 16x16 bytes each in grid order.
+    std::vector<uint8_t> reference_;
+    uint32_t static_frames_;
+};
@@ -0,0 +1,314 @@
+#include "c2_segment_sink.h"
+
+#include <C2Work.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+
+#define INDEX_SUFFIX ".idx"
+
+static bool write_all(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+C2SegmentSink::C2SegmentSink(const C2SegmentSinkConfig &config)
+    : config_(config),
+      next_number_(1),
+      prepare_(1),
+      largest_(0),
+      opening_(false),
+      running_(true),
+      segments_(0),
+      frames_(0),
+      bytes_(0),
+      late_opens_(0),
+      write_errors_(0) {
+    thread_ = std::thread(&C2SegmentSink::Loop, this);
+}
+
+C2SegmentSink::~C2SegmentSink() {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (current_) {
+            finalizing_.push_back(std::move(current_));
+        }
+        running_ = false;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+
+    // Segment prepared ahead but never written.
+    if (next_) {
+        close(next_->fd);
+        close(next_->index_fd);
+        unlink(next_->info.path.c_str());
+        unlink(next_->info.index_path.c_str());
+    }
+}
+
+void C2SegmentSink::OnFrame(const C2EncodedFrame &frame) {
+    bool config_only = (frame.flags & C2FrameData::FLAG_CODEC_CONFIG) && !frame.au.is_sync;
+    uint64_t duration = static_cast<uint64_t>(config_.duration_ms) * 1000;
+
+    if (current_ && frame.au.is_sync && current_->info.frames > 0 &&
+        frame.timestamp >= current_->info.first_timestamp + duration) {
+        Rotate();
+    } else if (!current_) {
+        current_ = Take(false);
+    }
+    if (!current_) {
+        std::lock_guard<std::mutex> lk(lock_);
+        write_errors_++;
+        return;
+    }
+
+    Segment &segment = *current_;
+    C2SegmentInfo &info = segment.info;
+    uint64_t offset = info.bytes;
+    bool ok = true;
+
+    // A segment must play on its own, parameter sets sent apart go in front.
+    if (info.bytes == 0 && frame.au.is_sync && !frame.au.has_config && frame.config != nullptr) {
+        ok = Write(segment, frame.config->annexb.data(), frame.config->annexb.size());
+    }
+    if (frame.au.is_sync) {
+        // Seek to the parameter sets written right before the sync frame.
+        C2SegmentIndexEntry entry = {segment.config_pending ? segment.config_offset : offset,
+                                     frame.timestamp};
+        ok = write_all(segment.index_fd, reinterpret_cast<const uint8_t *>(&entry),
+                       sizeof(entry)) && ok;
+        info.sync_frames++;
+    }
+    segment.config_pending = config_only;
+    segment.config_offset = offset;
+
+    // The engine SEI is written in between, the encoded data is not copied.
+    uint32_t head = (frame.sei != nullptr) ? frame.sei_offset : frame.size;
+    ok = ok && Write(segment, frame.data, head);
+    if (ok && frame.sei != nullptr) {
+        ok = Write(segment, frame.sei, frame.sei_size) &&
+             Write(segment, frame.data + head, frame.size - head);
+    }
+
+    if (!config_only) {
+        if (info.frames == 0) {
+            info.first_timestamp = frame.timestamp;
+        }
+        info.last_timestamp = frame.timestamp;
+        info.frames++;
+    }
+
+    std::lock_guard<std::mutex> lk(lock_);
+    frames_++;
+    bytes_ += info.bytes - offset;
+    if (!ok) {
+        base::LogError() << "Failed to write frame " << frame.index << " to " << info.path;
+        write_errors_++;
+    }
+}
+
+void C2SegmentSink::OnEndOfStream() {
+    if (!current_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        finalizing_.push_back(std::move(current_));
+    }
+    wakeup_.notify_all();
+}
+
+void C2SegmentSink::GetStats(C2SegmentStats &stats) {
+    std::lock_guard<std::mutex> lk(lock_);
+    stats.segments = segments_;
+    stats.frames = frames_;
+    stats.bytes = bytes_;
+    stats.late_opens = late_opens_;
+    stats.write_errors = write_errors_;
+}
+
+bool C2SegmentSink::LoadIndex(const std::string &path,
+                              std::vector<C2SegmentIndexEntry> &entries) {
+    entries.clear();
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        base::LogError() << "Cannot open segment index " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    C2SegmentIndexHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              header.magic == C2_SEGMENT_INDEX_MAGIC &&
+              header.version == C2_SEGMENT_INDEX_VERSION &&
+              header.header_size >= sizeof(header) &&
+              header.entry_size >= sizeof(C2SegmentIndexEntry) &&
+              fseek(file, header.header_size, SEEK_SET) == 0;
+
+    std::vector<uint8_t> entry(ok ? header.entry_size : 0);
+    while (ok && fread(entry.data(), entry.size(), 1, file) == 1) {
+        entries.emplace_back();
+        memcpy(&entries.back(), entry.data(), sizeof(C2SegmentIndexEntry));
+    }
+    fclose(file);
+
+    if (!ok) {
+        base::LogError() << "Segment index " << path << " is not readable or incompatible";
+    }
+    return ok;
+}
+
+std::unique_ptr<C2SegmentSink::Segment> C2SegmentSink::Open(uint32_t number, size_t reserve) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%05u", number);
+
+    auto segment = std::make_unique<Segment>();
+    segment->info = {};
+    segment->info.number = number;
+    segment->info.path = config_.prefix + suffix + config_.extension;
+    segment->info.index_path = segment->info.path + INDEX_SUFFIX;
+    segment->config_pending = false;
+    segment->config_offset = 0;
+
+    segment->fd = open(segment->info.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644);
+    if (segment->fd < 0) {
+        base::LogError() << "Failed to open segment " << segment->info.path
+                         << ", error: " << strerror(errno);
+        return nullptr;
+    }
+
+    // Reserved beyond the end of file, the size grows with the data written.
+    if (reserve > 0 && fallocate(segment->fd, FALLOC_FL_KEEP_SIZE, 0, reserve) != 0) {
+        base::LogWarn() << "Cannot preallocate " << segment->info.path
+                        << ", error: " << strerror(errno);
+    }
+
+    C2SegmentIndexHeader header = {C2_SEGMENT_INDEX_MAGIC, C2_SEGMENT_INDEX_VERSION,
+                                   sizeof(C2SegmentIndexHeader), sizeof(C2SegmentIndexEntry)};
+    segment->index_fd = open(segment->info.index_path.c_str(),
+                             O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment->index_fd < 0 ||
+        !write_all(segment->index_fd, reinterpret_cast<const uint8_t *>(&header),
+                   sizeof(header))) {
+        base::LogError() << "Failed to create segment index " << segment->info.index_path;
+        if (segment->index_fd >= 0) {
+            close(segment->index_fd);
+        }
+        close(segment->fd);
+        unlink(segment->info.path.c_str());
+        unlink(segment->info.index_path.c_str());
+        return nullptr;
+    }
+    return segment;
+}
+
+void C2SegmentSink::Finalize(std::unique_ptr<Segment> segment) {
+    // Release the space reserved and not used.
+    if (ftruncate(segment->fd, segment->info.bytes) != 0 || fdatasync(segment->fd) != 0 ||
+        fdatasync(segment->index_fd) != 0) {
+        base::LogError() << "Failed to finalize segment " << segment->info.path
+                         << ", error: " << strerror(errno);
+    }
+    close(segment->fd);
+    close(segment->index_fd);
+
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        segments_++;
+        largest_ = std::max<size_t>(largest_, segment->info.bytes);
+    }
+    if (config_.finalized) {
+        config_.finalized(segment->info);
+    }
+}
+
+std::unique_ptr<C2SegmentSink::Segment> C2SegmentSink::Take(bool rotation) {
+    uint32_t number = next_number_++;
+    std::unique_ptr<Segment> segment;
+    size_t reserve = 0;
+    {
+        std::unique_lock<std::mutex> lk(lock_);
+        // Never open the same file twice, let a preparation in progress finish.
+        wakeup_.wait(lk, [this] { return next_ || !opening_; });
+        if (next_ && next_->info.number == number) {
+            segment = std::move(next_);
+        } else {
+            late_opens_ += rotation ? 1 : 0;
+            reserve = std::max(config_.preallocate_bytes, largest_);
+        }
+        prepare_ = number + 1;
+    }
+    wakeup_.notify_all();
+
+    if (!segment) {
+        segment = Open(number, reserve);
+    }
+    return segment;
+}
+
+void C2SegmentSink::Rotate() {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        finalizing_.push_back(std::move(current_));
+    }
+    wakeup_.notify_all();
+    current_ = Take(true);
+}
+
+bool C2SegmentSink::Write(Segment &segment, const uint8_t *data, size_t size) {
+    if (!write_all(segment.fd, data, size)) {
+        return false;
+    }
+    segment.info.bytes += size;
+    return true;
+}
+
+void C2SegmentSink::Loop() {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (running_ || !finalizing_.empty()) {
+        // Preparing the next segment comes first, a rotation may wait for it.
+        if (running_ && prepare_ != 0 && !next_) {
+            uint32_t number = prepare_;
+            size_t reserve = std::max(config_.preallocate_bytes, largest_);
+            opening_ = true;
+            lk.unlock();
+            std::unique_ptr<Segment> segment = Open(number, reserve);
+            lk.lock();
+            opening_ = false;
+            next_ = std::move(segment);
+            // On failure the output thread opens the segment itself and reports the error.
+            prepare_ = 0;
+            wakeup_.notify_all();
+            continue;
+        }
+
+        if (!finalizing_.empty()) {
+            std::unique_ptr<Segment> segment = std::move(finalizing_.front());
+            finalizing_.pop_front();
+            lk.unlock();
+            Finalize(std::move(segment));
+            lk.lock();
+            continue;
+        }
+
+        wakeup_.wait(lk);
+    }
+}
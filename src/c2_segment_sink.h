@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "c2_output_sink.h"
+
+#define C2_SEGMENT_INDEX_MAGIC 0x58533243u
+#define C2_SEGMENT_INDEX_VERSION 1
+
+/** C2SegmentIndexHeader
+ *
+ * Start of the seek index written next to every segment, followed by one
+ * C2SegmentIndexEntry per sync frame until the end of the file.
+ **/
+struct C2SegmentIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t entry_size;
+};
+
+struct C2SegmentIndexEntry {
+    /// Byte offset of the sync frame in the segment, parameter sets included.
+    uint64_t offset;
+    /// Presentation timestamp in microseconds.
+    uint64_t timestamp;
+};
+
+static_assert(sizeof(C2SegmentIndexEntry) == 16, "segment index entry layout changed");
+
+/** C2SegmentInfo
+ *
+ * Segment handed to the finalized callback once its data is on disk.
+ **/
+struct C2SegmentInfo {
+    uint32_t number;
+    std::string path;
+    std::string index_path;
+    uint64_t bytes;
+    uint32_t frames;
+    uint32_t sync_frames;
+    /// Timestamps of the first and last frame in microseconds.
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+};
+
+struct C2SegmentSinkConfig {
+    /// Segments are written to <prefix>_<number><extension>, their index to
+    /// the same path with .idx appended.
+    std::string prefix = "out";
+    std::string extension = ".264";
+    /// Length of a segment, the next one starts at the first sync frame after it.
+    uint32_t duration_ms = 60000;
+    /// Disk space reserved for a segment when it is opened, grown to the size
+    /// of the largest segment so far. The unused part is released on finalize.
+    size_t preallocate_bytes = 16 << 20;
+    /// Called from the background thread once a segment is finalized.
+    std::function<void(const C2SegmentInfo &info)> finalized;
+};
+
+struct C2SegmentStats {
+    uint32_t segments;
+    uint64_t frames;
+    uint64_t bytes;
+    /// Rotations which had to open the next segment on the output thread
+    /// because the background thread had not prepared it in time.
+    uint64_t late_opens;
+    uint64_t write_errors;
+};
+
+/** C2SegmentSink
+ *
+ * Output sink recording the Annex-B stream into a sequence of files split at
+ * sync frames, so that every segment plays on its own. A segment ends at the
+ * first sync frame whose timestamp is at least duration_ms after the start of
+ * the segment; the sync frame opens the next segment, preceded by the
+ * parameter sets if the encoder sent them separately.
+ *
+ * The next segment is opened and its space reserved ahead of time by a
+ * background thread, which also truncates, syncs and closes the previous one,
+ * so that the output thread never waits for the file system on a rotation.
+ **/
+class C2SegmentSink : public IC2OutputSink {
+public:
+    C2SegmentSink(const C2SegmentSinkConfig &config);
+    ~C2SegmentSink();
+
+    void OnFrame(const C2EncodedFrame &frame) override;
+    /**
+     * @brief Finalize the current segment, frames after it start a new one.
+     */
+    void OnEndOfStream() override;
+
+    void GetStats(C2SegmentStats &stats);
+
+    /**
+     * @brief Read the seek index of a segment.
+     * @param path: Path of the index file.
+     * @param entries: Filled with the sync frames of the segment, in stream order.
+     *
+     * @return: false if the file is not readable or not a segment index.
+     */
+    static bool LoadIndex(const std::string &path, std::vector<C2SegmentIndexEntry> &entries);
+private:
+    struct Segment {
+        C2SegmentInfo info;
+        int fd;
+        int index_fd;
+        /// Offset of a parameter set buffer written last, if any, sync
+        /// frames following it are indexed from there.
+        bool config_pending;
+        uint64_t config_offset;
+    };
+
+    std::unique_ptr<Segment> Open(uint32_t number, size_t reserve);
+    void Finalize(std::unique_ptr<Segment> segment);
+    /// Segment to write next, the prepared one or one opened here.
+    std::unique_ptr<Segment> Take(bool rotation);
+    /// Hand the current segment to the background thread and switch to the
+    /// prepared one, opening it here if it is not ready.
+    void Rotate();
+    bool Write(Segment &segment, const uint8_t *data, size_t size);
+    void Loop();
+
+    C2SegmentSinkConfig config_;
+    /// Segment being written, accessed from the output thread only.
+    std::unique_ptr<Segment> current_;
+    uint32_t next_number_;
+
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    /// Segment prepared by the background thread and the ones to finalize.
+    std::unique_ptr<Segment> next_;
+    std::deque<std::unique_ptr<Segment>> finalizing_;
+    /// Number of the segment to prepare next, 0 when none is needed.
+    uint32_t prepare_;
+    size_t largest_;
+    /// The background thread is opening the segment to prepare.
+    bool opening_;
+    bool running_;
+    std::thread thread_;
+
+    uint32_t segments_;
+    uint64_t frames_;
+    uint64_t bytes_;
+    uint64_t late_opens_;
+    uint64_t write_errors_;
+};
@@ -0,0 +1,157 @@
+#include "c2_sei.h"
+
+#include <string.h>
+#include <time.h>
+
+// SEI nal_unit_type values (ITU-T H.264 / H.265 Table 7-1).
+#define AVC_NAL_SEI 6
+#define HEVC_NAL_PREFIX_SEI 39
+#define HEVC_NAL_VPS 32
+
+// user_data_unregistered payloadType (Annex D).
+#define SEI_USER_DATA_UNREGISTERED 5
+#define UUID_SIZE 16
+/// UUID followed by three big endian 64 bit fields.
+#define TIMESTAMP_PAYLOAD_SIZE (UUID_SIZE + 3 * 8)
+
+static const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+
+// Identifies the capture timestamp message among other user data SEIs.
+static const uint8_t kTimestampUuid[UUID_SIZE] = {
+    0x9a, 0x21, 0xf3, 0xbe, 0x31, 0xf0, 0x4b, 0x78,
+    0xb0, 0xbe, 0xc7, 0xf7, 0xdb, 0xb9, 0x72, 0x64,
+};
+
+static void put_be64(std::vector<uint8_t> &out, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+static uint64_t get_be64(const uint8_t *data) {
+    uint64_t value = 0;
+    for (int idx = 0; idx < 8; idx++) {
+        value = (value << 8) | data[idx];
+    }
+    return value;
+}
+
+void C2Sei::WriteTimestamp(bool hevc, const C2TimestampSei &sei, std::vector<uint8_t> &nal) {
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(TIMESTAMP_PAYLOAD_SIZE + 4);
+
+    rbsp.push_back(SEI_USER_DATA_UNREGISTERED);
+    rbsp.push_back(TIMESTAMP_PAYLOAD_SIZE);
+    rbsp.insert(rbsp.end(), kTimestampUuid, kTimestampUuid + UUID_SIZE);
+    put_be64(rbsp, sei.capture_time);
+    put_be64(rbsp, sei.encode_time);
+    put_be64(rbsp, sei.index);
+    // rbsp_trailing_bits.
+    rbsp.push_back(0x80);
+
+    nal.assign(kStartCode, kStartCode + sizeof(kStartCode));
+    if (hevc) {
+        // forbidden_zero_bit, nal_unit_type, nuh_layer_id 0, nuh_temporal_id_plus1 1.
+        nal.push_back(HEVC_NAL_PREFIX_SEI << 1);
+        nal.push_back(0x01);
+    } else {
+        // nal_ref_idc 0.
+        nal.push_back(AVC_NAL_SEI);
+    }
+
+    // Emulation prevention, the timestamps may contain any byte sequence.
+    uint32_t zeros = 0;
+    for (uint8_t byte : rbsp) {
+        if (zeros >= 2 && byte <= 0x03) {
+            nal.push_back(0x03);
+            zeros = 0;
+        }
+        nal.push_back(byte);
+        zeros = (byte == 0) ? zeros + 1 : 0;
+    }
+}
+
+bool C2Sei::ParseTimestamp(bool hevc, const uint8_t *nal, uint32_t size, C2TimestampSei &sei) {
+    uint32_t header = hevc ? 2 : 1;
+    if (size <= header) {
+        return false;
+    }
+
+    uint8_t type = hevc ? ((nal[0] >> 1) & 0x3f) : (nal[0] & 0x1f);
+    if (type != (hevc ? HEVC_NAL_PREFIX_SEI : AVC_NAL_SEI)) {
+        return false;
+    }
+
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(size);
+    uint32_t zeros = 0;
+    for (uint32_t idx = header; idx < size; idx++) {
+        if (zeros >= 2 && nal[idx] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        rbsp.push_back(nal[idx]);
+        zeros = (nal[idx] == 0) ? zeros + 1 : 0;
+    }
+
+    // sei_message() loop, up to the trailing bits.
+    size_t pos = 0;
+    while (pos < rbsp.size() && rbsp[pos] != 0x80) {
+        uint32_t payload_type = 0;
+        uint32_t payload_size = 0;
+        for (; pos < rbsp.size() && rbsp[pos] == 0xff; pos++) {
+            payload_type += 0xff;
+        }
+        if (pos >= rbsp.size()) {
+            return false;
+        }
+        payload_type += rbsp[pos++];
+
+        for (; pos < rbsp.size() && rbsp[pos] == 0xff; pos++) {
+            payload_size += 0xff;
+        }
+        if (pos >= rbsp.size()) {
+            return false;
+        }
+        payload_size += rbsp[pos++];
+
+        if (payload_size > rbsp.size() - pos) {
+            return false;
+        }
+
+        const uint8_t *payload = rbsp.data() + pos;
+        if (payload_type == SEI_USER_DATA_UNREGISTERED &&
+            payload_size >= TIMESTAMP_PAYLOAD_SIZE &&
+            memcmp(payload, kTimestampUuid, UUID_SIZE) == 0) {
+            sei.capture_time = get_be64(payload + UUID_SIZE);
+            sei.encode_time = get_be64(payload + UUID_SIZE + 8);
+            sei.index = get_be64(payload + UUID_SIZE + 16);
+            return true;
+        }
+        pos += payload_size;
+    }
+
+    return false;
+}
+
+bool C2Sei::FindTimestamp(bool hevc, const uint8_t *data, const C2AccessUnitInfo &au,
+                          C2TimestampSei &sei) {
+    for (const C2NalUnit &nal : au.nals) {
+        if (ParseTimestamp(hevc, data + nal.offset, nal.size, sei)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool C2Sei::IsSlice(bool hevc, uint8_t type) {
+    // H.265 VCL units are types 0..31, H.264 coded slices are 1..5.
+    return hevc ? (type < HEVC_NAL_VPS) : (type >= 1 && type <= 5);
+}
+
+uint64_t C2Sei::RealTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "c2_nal_parser.h"
+
+/** C2TimestampSei
+ *
+ * Timing carried by the user data unregistered SEI of each access unit.
+ * Times are CLOCK_REALTIME microseconds so that they can be compared across
+ * hosts with synchronized clocks.
+ **/
+struct C2TimestampSei {
+    /// Time at which the frame was captured, or queued if not provided.
+    uint64_t capture_time;
+    /// Time at which the encoded frame left the encoder.
+    uint64_t encode_time;
+    /// Frame index assigned by the engine.
+    uint64_t index;
+};
+
+/** C2Sei
+ *
+ * Writer and parser of the capture timestamp SEI, a user data unregistered
+ * message (payload type 5) tagged with a fixed UUID.
+ **/
+class C2Sei {
+public:
+    /**
+     * @brief Build a complete SEI NAL unit, 4 byte start code included.
+     * @param hevc: Write an H.265 prefix SEI instead of an H.264 SEI.
+     * @param sei: Timing to embed.
+     * @param nal: Replaced with the Annex-B NAL unit.
+     */
+    static void WriteTimestamp(bool hevc, const C2TimestampSei &sei, std::vector<uint8_t> &nal);
+
+    /**
+     * @brief Extract the timestamp from one NAL unit.
+     * @param hevc: The NAL unit header is H.265.
+     * @param nal: NAL unit starting with its header, without start code.
+     * @param size: Size of the NAL unit.
+     *
+     * @return: true if the unit is a timestamp SEI.
+     */
+    static bool ParseTimestamp(bool hevc, const uint8_t *nal, uint32_t size,
+                               C2TimestampSei &sei);
+
+    /**
+     * @brief Search a scanned access unit for the timestamp SEI.
+     * @param data: Buffer the access unit was scanned from.
+     * @param au: NAL units found by C2NalParser::Parse().
+     *
+     * @return: true if the access unit carries a timestamp SEI.
+     */
+    static bool FindTimestamp(bool hevc, const uint8_t *data, const C2AccessUnitInfo &au,
+                              C2TimestampSei &sei);
+
+    /**
+     * @brief Whether the NAL unit type is a coded slice, the SEI goes ahead of
+     * the first one.
+     */
+    static bool IsSlice(bool hevc, uint8_t type);
+
+    /**
+     * @brief CLOCK_REALTIME in microseconds.
+     */
+    static uint64_t RealTime();
+};
@@ -0,0 +1,196 @@
+#include "c2_service_channel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "base/log.h"
+
+/// Descriptors passed with a single message.
+#define MAX_MESSAGE_FDS 4
+
+C2ServiceChannel::C2ServiceChannel(int fd) : fd_(fd) {}
+
+C2ServiceChannel::~C2ServiceChannel() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+std::unique_ptr<C2ServiceChannel> C2ServiceChannel::Connect(const std::string &path) {
+    struct sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        base::LogError() << "Service socket path too long: " << path;
+        return nullptr;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        base::LogError() << "Failed to create service socket, error: " << strerror(errno);
+        return nullptr;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+        base::LogError() << "Failed to connect to " << path << ", error: " << strerror(errno);
+        close(fd);
+        return nullptr;
+    }
+
+    return std::make_unique<C2ServiceChannel>(fd);
+}
+
+bool C2ServiceChannel::Send(const C2ServiceMessage &message, const std::vector<int> &fds) {
+    if (fds.size() > MAX_MESSAGE_FDS) {
+        base::LogError() << "Too many descriptors for one service message: " << fds.size();
+        return false;
+    }
+
+    struct iovec iov = {const_cast<C2ServiceMessage *>(&message), sizeof(message)};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int) * MAX_MESSAGE_FDS)] = {};
+    if (!fds.empty()) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    std::lock_guard<std::mutex> lk(send_lock_);
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent != static_cast<ssize_t>(sizeof(message))) {
+        base::LogDebug() << "Failed to send service message, error: " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool C2ServiceChannel::Receive(C2ServiceMessage &message, std::vector<int> &fds) {
+    struct iovec iov = {&message, sizeof(message)};
+    char control[CMSG_SPACE(sizeof(int) * MAX_MESSAGE_FDS)] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do {
+        received = recvmsg(fd_, &msg, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+
+    fds.clear();
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            fds.resize(fds.size() + count);
+            memcpy(fds.data() + fds.size() - count, CMSG_DATA(cmsg), sizeof(int) * count);
+        }
+    }
+
+    if (received != static_cast<ssize_t>(sizeof(message)) || (msg.msg_flags & MSG_CTRUNC)) {
+        if (received < 0) {
+            base::LogDebug() << "Failed to receive service message, error: " << strerror(errno);
+        } else if (received > 0) {
+            base::LogError() << "Malformed service message of " << received << " bytes";
+        }
+        for (int fd : fds) {
+            close(fd);
+        }
+        fds.clear();
+        return false;
+    }
+    return true;
+}
+
+void C2ServiceChannel::Shutdown() {
+    shutdown(fd_, SHUT_RDWR);
+}
+
+C2SharedRing::C2SharedRing()
+    : fd_(-1), data_(nullptr), size_(0), slots_(0), slot_size_(0) {}
+
+C2SharedRing::~C2SharedRing() {
+    Close();
+}
+
+bool C2SharedRing::Create(const char *name, uint32_t slots, uint32_t slot_size) {
+    Close();
+
+    int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        base::LogError() << "Failed to create shared memory " << name
+                         << ", error: " << strerror(errno);
+        return false;
+    }
+
+    // Sealed so that a client cannot shrink the file under the mapping of the service.
+    size_t size = static_cast<size_t>(slots) * slot_size;
+    if (ftruncate(fd, size) != 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        base::LogError() << "Failed to size shared memory " << name
+                         << ", error: " << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    return Map(fd, slots, slot_size, true);
+}
+
+bool C2SharedRing::Map(int fd, uint32_t slots, uint32_t slot_size, bool writable) {
+    Close();
+    fd_ = fd;
+
+    size_t size = static_cast<size_t>(slots) * slot_size;
+    struct stat st;
+    if (size == 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < size) {
+        base::LogError() << "Shared memory smaller than " << slots << " slots of " << slot_size
+                         << " bytes";
+        Close();
+        return false;
+    }
+
+    int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *data = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        base::LogError() << "Failed to map shared memory, error: " << strerror(errno);
+        Close();
+        return false;
+    }
+
+    data_ = static_cast<uint8_t *>(data);
+    size_ = size;
+    slots_ = slots;
+    slot_size_ = slot_size;
+    return true;
+}
+
+void C2SharedRing::Close() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    slots_ = 0;
+    slot_size_ = 0;
+}
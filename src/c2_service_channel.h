@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "c2_common.h"
+
+/// Default path of the encoder service socket.
+#define C2_SERVICE_SOCKET "/tmp/c2_encoder_service.sock"
+
+enum class C2ServiceCommand : uint32_t {
+    /// Client: open an encoder session. Service: session opened, the input and
+    /// output rings are attached as file descriptors.
+    kOpen,
+    kOpened,
+    /// Client: encode the frame written in an input slot. Service: the frame
+    /// was submitted and the slot may be written again.
+    kQueue,
+    kQueued,
+    /// Service: encoded frame written in an output slot. Client: the frame was
+    /// consumed and the slot may be written again.
+    kFrame,
+    kRelease,
+    /// Client: no more input. Service: the output of every frame was sent.
+    kEndOfStream,
+    /// Service: the session failed, the status carries the reason.
+    kError,
+};
+
+/** C2ServiceSessionConfig
+ *
+ * Encoder session requested by a client. The input frames are tightly packed
+ * in the given pixel format, see C2FrameSource::DescribeFrame().
+ **/
+struct C2ServiceSessionConfig {
+    C2CodecType codec = C2CodecType::H264VideoEncode;
+    C2EngineConfig engine = {1280, 720, 30.0f, 0, 0};
+    C2PixelFormat pixel_format = C2PixelFormat::kNV12;
+    /// Frames which may be queued at once, each has its own input slot.
+    uint32_t input_slots = 4;
+    /// Encoded frames which may be held by the client at once.
+    uint32_t output_slots = 8;
+    /// Largest encoded frame, 0 for half of an input frame.
+    uint32_t output_slot_size = 0;
+    /// Slot sizes of the rings, set by the service in kOpened.
+    uint32_t input_slot_size = 0;
+};
+
+/** C2ServiceMessage
+ *
+ * Fixed size message exchanged on the service socket. Frame data never goes
+ * through the socket, only the slot it was written to.
+ **/
+struct C2ServiceMessage {
+    C2ServiceCommand command;
+    /// Slot of the input ring (kQueue, kQueued) or of the output ring (kFrame, kRelease).
+    uint32_t slot;
+    /// Bytes of the encoded frame in the output slot.
+    uint32_t size;
+    /// 0 on success, otherwise a C2ServiceStatus.
+    int32_t status;
+    /// Frame index assigned by the engine and presentation timestamp (microseconds).
+    uint64_t index;
+    uint64_t timestamp;
+    /// C2FrameData flags of the encoded frame and whether it is a sync frame.
+    uint32_t flags;
+    uint32_t sync;
+    /// kOpen and kOpened only.
+    C2ServiceSessionConfig session;
+};
+
+enum C2ServiceStatus : int32_t {
+    kServiceOk = 0,
+    /// Invalid request or session configuration.
+    kServiceInvalid = -1,
+    /// Every encoder instance of the service is in use.
+    kServiceBusy = -2,
+    /// The engine failed to start or to take a frame.
+    kServiceEngine = -3,
+    /// An encoded frame was dropped, too large or no output slot was released in time.
+    kServiceOverflow = -4,
+};
+
+/** C2ServiceChannel
+ *
+ * Connected Unix sequenced packet socket carrying C2ServiceMessage, file
+ * descriptors are passed along with a message as SCM_RIGHTS. Sending is
+ * thread safe, receiving is meant for a single thread.
+ **/
+class C2ServiceChannel {
+public:
+    /**
+     * @brief Take ownership of a connected socket.
+     */
+    explicit C2ServiceChannel(int fd);
+    ~C2ServiceChannel();
+
+    static std::unique_ptr<C2ServiceChannel> Connect(const std::string &path);
+
+    bool Send(const C2ServiceMessage &message, const std::vector<int> &fds = {});
+    /**
+     * @brief Wait for the next message, received descriptors are owned by the caller.
+     *
+     * @return: false once the peer closed the connection or on error.
+     */
+    bool Receive(C2ServiceMessage &message, std::vector<int> &fds);
+    /**
+     * @brief Shut the connection down, a blocked Receive() returns false.
+     */
+    void Shutdown();
+private:
+    int fd_;
+    std::mutex send_lock_;
+};
+
+/** C2SharedRing
+ *
+ * Fixed number of equally sized slots in a sealed memfd, created by the
+ * service and mapped by the client from the received descriptor.
+ **/
+class C2SharedRing {
+public:
+    C2SharedRing();
+    ~C2SharedRing();
+
+    bool Create(const char *name, uint32_t slots, uint32_t slot_size);
+    /**
+     * @brief Map a ring created by the peer, the descriptor is owned by the ring.
+     * @param writable: Map the slots writable, otherwise read only.
+     */
+    bool Map(int fd, uint32_t slots, uint32_t slot_size, bool writable);
+    void Close();
+
+    uint8_t *GetSlot(uint32_t slot) const { return data_ + static_cast<size_t>(slot) * slot_size_; }
+    int GetFd() const { return fd_; }
+    uint32_t GetSlots() const { return slots_; }
+    uint32_t GetSlotSize() const { return slot_size_; }
+private:
+    int fd_;
+    uint8_t *data_;
+    size_t size_;
+    uint32_t slots_;
+    uint32_t slot_size_;
+};
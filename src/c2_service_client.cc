@@ -0,0 +1,205 @@
+#include "c2_service_client.h"
+
+#include <unistd.h>
+
+#include <chrono>
+
+#include "base/log.h"
+
+C2ServiceClient::C2ServiceClient() : dropped_(0), eos_(false), error_(kServiceOk) {}
+
+C2ServiceClient::~C2ServiceClient() {
+    Close();
+}
+
+bool C2ServiceClient::Open(const std::string &path, const C2ServiceSessionConfig &config) {
+    Close();
+
+    channel_ = C2ServiceChannel::Connect(path);
+    if (!channel_) {
+        return false;
+    }
+
+    C2ServiceMessage message = {};
+    message.command = C2ServiceCommand::kOpen;
+    message.session = config;
+
+    std::vector<int> fds;
+    if (!channel_->Send(message) || !channel_->Receive(message, fds)) {
+        base::LogError() << "No answer from the encoder service at " << path;
+        Close();
+        return false;
+    }
+    if (message.command != C2ServiceCommand::kOpened || fds.size() != 2) {
+        base::LogError() << "Encoder service refused the session, status " << message.status;
+        for (int fd : fds) {
+            close(fd);
+        }
+        Close();
+        return false;
+    }
+
+    session_ = message.session;
+    bool input = input_.Map(fds[0], session_.input_slots, session_.input_slot_size, true);
+    bool output = output_.Map(fds[1], session_.output_slots, session_.output_slot_size, false);
+    if (!input || !output) {
+        Close();
+        return false;
+    }
+
+    for (uint32_t slot = 0; slot < session_.input_slots; slot++) {
+        free_inputs_.push_back(slot);
+    }
+    receiver_ = std::thread(&C2ServiceClient::ReceiveLoop, this);
+    return true;
+}
+
+void C2ServiceClient::Close() {
+    if (channel_) {
+        channel_->Shutdown();
+    }
+    if (receiver_.joinable()) {
+        receiver_.join();
+    }
+    channel_.reset();
+    input_.Close();
+    output_.Close();
+
+    std::lock_guard<std::mutex> lk(lock_);
+    free_inputs_.clear();
+    frames_.clear();
+    dropped_ = 0;
+    eos_ = false;
+    error_ = kServiceOk;
+}
+
+uint8_t *C2ServiceClient::DequeueInput(uint32_t &slot, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lk(lock_);
+    changed_.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                      [this] { return !free_inputs_.empty() || error_ != kServiceOk; });
+    if (free_inputs_.empty() || error_ != kServiceOk) {
+        return nullptr;
+    }
+
+    slot = free_inputs_.front();
+    free_inputs_.pop_front();
+    return input_.GetSlot(slot);
+}
+
+bool C2ServiceClient::QueueInput(uint32_t slot, uint64_t timestamp) {
+    if (!channel_ || slot >= input_.GetSlots()) {
+        return false;
+    }
+
+    C2ServiceMessage message = {};
+    message.command = C2ServiceCommand::kQueue;
+    message.slot = slot;
+    message.timestamp = timestamp;
+    return channel_->Send(message);
+}
+
+bool C2ServiceClient::ReceiveFrame(C2ServiceFrame &frame, uint32_t timeout_ms) {
+    std::unique_lock<std::mutex> lk(lock_);
+    changed_.wait_for(lk, std::chrono::milliseconds(timeout_ms), [this] {
+        return !frames_.empty() || eos_ || error_ != kServiceOk;
+    });
+    if (frames_.empty()) {
+        return false;
+    }
+
+    frame = frames_.front();
+    frames_.pop_front();
+    return true;
+}
+
+bool C2ServiceClient::ReleaseFrame(const C2ServiceFrame &frame) {
+    if (!channel_) {
+        return false;
+    }
+
+    C2ServiceMessage message = {};
+    message.command = C2ServiceCommand::kRelease;
+    message.slot = frame.slot;
+    return channel_->Send(message);
+}
+
+bool C2ServiceClient::EndOfStream() {
+    if (!channel_) {
+        return false;
+    }
+
+    C2ServiceMessage message = {};
+    message.command = C2ServiceCommand::kEndOfStream;
+    return channel_->Send(message);
+}
+
+uint32_t C2ServiceClient::GetInputSize() const {
+    return session_.input_slot_size;
+}
+
+uint64_t C2ServiceClient::GetDropped() {
+    std::lock_guard<std::mutex> lk(lock_);
+    return dropped_;
+}
+
+void C2ServiceClient::Fail(int32_t status) {
+    if (error_ == kServiceOk) {
+        error_ = status;
+    }
+}
+
+void C2ServiceClient::ReceiveLoop() {
+    C2ServiceMessage message;
+    std::vector<int> fds;
+
+    while (channel_->Receive(message, fds)) {
+        for (int fd : fds) {
+            close(fd);
+        }
+
+        std::lock_guard<std::mutex> lk(lock_);
+        switch (message.command) {
+            case C2ServiceCommand::kQueued:
+                if (message.status != kServiceOk) {
+                    base::LogWarn() << "Encoder service failed to queue frame " << message.index
+                                    << ", status " << message.status;
+                }
+                if (message.slot < input_.GetSlots()) {
+                    free_inputs_.push_back(message.slot);
+                }
+                break;
+            case C2ServiceCommand::kFrame:
+                if (message.status == kServiceOverflow) {
+                    dropped_++;
+                } else if (message.slot < output_.GetSlots() &&
+                           message.size <= output_.GetSlotSize()) {
+                    frames_.push_back({output_.GetSlot(message.slot), message.size,
+                                       message.index, message.timestamp, message.flags,
+                                       message.sync != 0, message.slot});
+                } else {
+                    base::LogError() << "Invalid output slot " << message.slot << " of "
+                                     << message.size << " bytes";
+                    Fail(kServiceInvalid);
+                }
+                break;
+            case C2ServiceCommand::kEndOfStream:
+                if (message.status != kServiceOk) {
+                    base::LogWarn() << "Encoder service timed out draining the stream";
+                }
+                eos_ = true;
+                break;
+            case C2ServiceCommand::kError:
+                base::LogError() << "Encoder session failed, status " << message.status;
+                Fail(message.status);
+                break;
+            default:
+                break;
+        }
+        changed_.notify_all();
+    }
+
+    // Connection closed by the service or by Close().
+    std::lock_guard<std::mutex> lk(lock_);
+    Fail(kServiceEngine);
+    changed_.notify_all();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "c2_service_channel.h"
+
+/** C2ServiceFrame
+ *
+ * Encoded frame received from the service. The data stays valid until the
+ * frame is handed back with ReleaseFrame().
+ **/
+struct C2ServiceFrame {
+    const uint8_t *data;
+    uint32_t size;
+    /// Index of the frame in the session and presentation timestamp (microseconds).
+    uint64_t index;
+    uint64_t timestamp;
+    /// C2FrameData flags of the output and whether it is a sync frame.
+    uint32_t flags;
+    bool sync;
+    uint32_t slot;
+};
+
+/** C2ServiceClient
+ *
+ * Encoder session of a C2EncoderService. Frames are written straight into
+ * the shared input slots of the session and the encoded output is read from
+ * the shared output slots, the client process does not link the Codec2
+ * libraries.
+ **/
+class C2ServiceClient {
+public:
+    C2ServiceClient();
+    ~C2ServiceClient();
+
+    /**
+     * @brief Connect to the service and open an encoder session.
+     * @param path: Socket of the service.
+     * @param config: Encoder and ring configuration.
+     *
+     * @return: false on failure, e.g. every encoder instance is in use.
+     */
+    bool Open(const std::string &path, const C2ServiceSessionConfig &config);
+    void Close();
+
+    /**
+     * @brief Get a free input slot, waiting for the service to consume a
+     * frame when all of them are queued.
+     * @param slot: Slot to pass to QueueInput() once the frame is written.
+     *
+     * @return: Slot memory of GetInputSize() bytes, nullptr on timeout or failure.
+     */
+    uint8_t *DequeueInput(uint32_t &slot, uint32_t timeout_ms);
+    /**
+     * @brief Encode the frame written in the slot, tightly packed in the
+     * pixel format of the session.
+     */
+    bool QueueInput(uint32_t slot, uint64_t timestamp);
+
+    /**
+     * @brief Wait for the next encoded frame.
+     *
+     * @return: false on timeout, at the end of the stream or on failure.
+     */
+    bool ReceiveFrame(C2ServiceFrame &frame, uint32_t timeout_ms);
+    bool ReleaseFrame(const C2ServiceFrame &frame);
+
+    /**
+     * @brief Signal the end of the input, ReceiveFrame() then returns the
+     * remaining frames before reporting the end of the stream.
+     */
+    bool EndOfStream();
+
+    uint32_t GetInputSize() const;
+    const C2ServiceSessionConfig &GetSession() const { return session_; }
+    /// Encoded frames dropped by the service for lack of output space.
+    uint64_t GetDropped();
+private:
+    void ReceiveLoop();
+    void Fail(int32_t status);
+
+    std::unique_ptr<C2ServiceChannel> channel_;
+    C2ServiceSessionConfig session_;
+    C2SharedRing input_;
+    C2SharedRing output_;
+    std::thread receiver_;
+
+    std::mutex lock_;
+    std::condition_variable changed_;
+    std::deque<uint32_t> free_inputs_;
+    std::deque<C2ServiceFrame> frames_;
+    uint64_t dropped_;
+    bool eos_;
+    /// Status of the failure ending the session, 0 while it is running.
+    int32_t error_;
+};
@@ -0,0 +1,164 @@
+#include "c2_simulcast.h"
+
+#include <C2AllocatorGBM.h>
+#include <C2Buffer.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+#include "c2_scaler.h"
+
+/// Stripes per thread, small stripes keep the shared source rows in cache.
+#define STRIPES_PER_THREAD 4
+/// Lower bound of source rows per stripe.
+#define MIN_STRIPE_ROWS 32
+
+/** Target
+ *
+ * Mapped destination planes of one rung for the frame being scaled.
+ **/
+struct Target {
+    std::shared_ptr<C2GraphicBlock> block;
+    std::unique_ptr<C2GraphicView> view;
+    uint8_t *y;
+    uint8_t *uv;
+    uint32_t stride;
+    uint32_t width;
+    uint32_t height;
+};
+
+C2Simulcast::C2Simulcast(const C2SimulcastConfig &config) : config_(config), frame_index_(0) {}
+
+C2Simulcast::~C2Simulcast() {
+    for (auto engine : engines_) {
+        C2Engine::free_c2_engine(engine);
+    }
+}
+
+bool C2Simulcast::Open() {
+    if (config_.rungs.empty()) {
+        base::LogError() << "Simulcast requires at least one rung";
+        return false;
+    }
+
+    C2CodecType codec =
+        config_.hevc ? C2CodecType::H265VideoEncode : C2CodecType::H264VideoEncode;
+
+    for (auto &rung : config_.rungs) {
+        C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode, codec);
+        if (engine == nullptr) {
+            return false;
+        }
+        engines_.push_back(engine);
+
+        C2EngineConfig config;
+        config.width = rung.width;
+        config.height = rung.height;
+        config.framerate = config_.framerate;
+        config.bitrate = rung.bitrate;
+        config.gop = config_.gop;
+        if (!engine->c2_engine_configure(config)) {
+            return false;
+        }
+    }
+
+    pool_ = std::make_unique<base::ThreadPool>(config_.threads);
+    return true;
+}
+
+bool C2Simulcast::Start() {
+    for (auto engine : engines_) {
+        if (!engine->start_c2_engine()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void C2Simulcast::Stop() {
+    for (auto engine : engines_) {
+        engine->stop_c2_engine();
+    }
+}
+
+bool C2Simulcast::WaitPending(uint32_t max_pending, uint32_t timeout_ms) {
+    for (auto engine : engines_) {
+        if (!engine->c2_engine_wait_pending(max_pending, timeout_ms)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool C2Simulcast::Queue(C2StreamBuffer *stream_buffer) {
+    if (stream_buffer->pixel_format != C2PixelFormat::kNV12 || stream_buffer->planes != 2) {
+        base::LogError() << "Simulcast input must be NV12";
+        return false;
+    }
+
+    // The index is consumed even if the frame is skipped, the rungs stay aligned.
+    uint64_t index = frame_index_++;
+
+    std::vector<Target> targets(engines_.size());
+    for (size_t idx = 0; idx < engines_.size(); idx++) {
+        Target &target = targets[idx];
+        target.width = config_.rungs[idx].width;
+        target.height = config_.rungs[idx].height;
+
+        target.block = engines_[idx]->c2_engine_fetch_block(target.width, target.height,
+                                                            C2PixelFormat::kNV12);
+        if (!target.block) {
+            base::LogError() << "Skipping frame " << index << ", no block for rung " << idx;
+            return false;
+        }
+
+        target.view = std::make_unique<C2GraphicView>(target.block->map().get());
+        if (target.view->error() != C2_OK) {
+            base::LogError() << "Failed to map block of rung " << idx;
+            return false;
+        }
+
+        auto handle = static_cast<const android::C2HandleGBM *>(target.block->handle());
+        target.stride = handle->mInts.stride;
+        target.y = target.view->data()[0];
+        target.uv = target.y + target.stride * handle->mInts.slice_height;
+    }
+
+    const uint8_t *source = static_cast<const uint8_t *>(stream_buffer->data);
+    const uint8_t *src_y = source + stream_buffer->offset[0];
+    const uint8_t *src_uv = source + stream_buffer->offset[1];
+    uint32_t src_width = stream_buffer->width;
+    uint32_t src_height = stream_buffer->height;
+
+    uint32_t stripes = std::max<uint32_t>(
+        1, std::min<uint32_t>(pool_->size() * STRIPES_PER_THREAD, src_height / MIN_STRIPE_ROWS));
+
+    pool_->run(stripes, [&](size_t stripe) {
+        for (auto &target : targets) {
+            // Even luma rows so that the chroma stripe boundaries line up.
+            uint32_t first = (target.height * stripe / stripes) & ~1u;
+            uint32_t last = (stripe + 1 == stripes)
+                                ? target.height
+                                : ((target.height * (stripe + 1) / stripes) & ~1u);
+
+            C2Scaler::ScalePlane(src_y, stream_buffer->stride[0], src_width, src_height,
+                                 target.y, target.stride, target.width, target.height, 1, first,
+                                 last);
+            C2Scaler::ScalePlane(src_uv, stream_buffer->stride[1], src_width / 2,
+                                 src_height / 2, target.uv, target.stride, target.width / 2,
+                                 target.height / 2, 2, first / 2, last / 2);
+        }
+    });
+
+    bool queued = true;
+    for (size_t idx = 0; idx < engines_.size(); idx++) {
+        targets[idx].view.reset();
+        if (!engines_[idx]->c2_engine_queue_block(targets[idx].block, index,
+                                                  stream_buffer->timestamp)) {
+            base::LogError() << "Failed to queue frame " << index << " on rung " << idx;
+            queued = false;
+        }
+    }
+
+    return queued;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/thread_pool.h"
+#include "c2_common.h"
+#include "c2_engine.h"
+
+struct C2SimulcastRung {
+    uint32_t width;
+    uint32_t height;
+    uint32_t bitrate;
+};
+
+struct C2SimulcastConfig {
+    bool hevc = false;
+    float framerate = 30;
+    /// Sync frame interval shared by all rungs so their GOPs stay aligned.
+    uint32_t gop = 0;
+    std::vector<C2SimulcastRung> rungs;
+    /// Scaling threads in addition to the submitting thread.
+    uint32_t threads = 2;
+};
+
+/** C2Simulcast
+ *
+ * Encodes one input at several resolutions. Every rung has its own C2Engine;
+ * a submitted NV12 frame is scaled straight into a graphic block fetched from
+ * each engine and all blocks are queued with the same frame index and
+ * timestamp, so outputs of the rungs can be matched per frame.
+ *
+ * The frame is processed in horizontal stripes spread over a thread pool. A
+ * stripe produces the matching rows of every rung before moving on, so each
+ * source row is fetched from memory once and reused from cache by the others.
+ **/
+class C2Simulcast {
+public:
+    explicit C2Simulcast(const C2SimulcastConfig &config);
+    ~C2Simulcast();
+
+    /**
+     * @brief Create and configure one engine per rung.
+     * @return: true on success or false on failure.
+     */
+    bool Open();
+    bool Start();
+    void Stop();
+
+    /**
+     * @brief Scale the frame into every rung and queue it.
+     * @param stream_buffer: NV12 frame at the source resolution.
+     *
+     * @return: true if every rung has been queued.
+     */
+    bool Queue(C2StreamBuffer *stream_buffer);
+
+    /**
+     * @brief Wait until every rung has at most max_pending frames in flight.
+     */
+    bool WaitPending(uint32_t max_pending, uint32_t timeout_ms);
+
+    size_t GetRungCount() const { return engines_.size(); }
+    /**
+     * @brief Engine of a rung, e.g. to attach its output sinks.
+     */
+    C2Engine *GetEngine(size_t rung) const { return engines_[rung]; }
+private:
+    C2SimulcastConfig config_;
+    std::vector<C2Engine *> engines_;
+    std::unique_ptr<base::ThreadPool> pool_;
+    /// Index shared by the rungs for the next frame.
+    uint64_t frame_index_;
+};
@@ -0,0 +1,242 @@
+#include "c2_stats.h"
+
+#include <time.h>
+
+C2Stats::C2Stats() {
+    Reset();
+}
+
+uint64_t C2Stats::Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint64_t C2Stats::ThreadCpuTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t C2Stats::Bucket(uint64_t value) {
+    if (value < kSubBuckets) {
+        return value;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll(value);
+    uint32_t bucket = (msb - 2) * kSubBuckets + ((value >> (msb - 3)) & (kSubBuckets - 1));
+    return (bucket < kBuckets) ? bucket : (kBuckets - 1);
+}
+
+uint64_t C2Stats::BucketValue(uint32_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+
+    uint32_t msb = bucket / kSubBuckets + 2;
+    uint64_t width = 1ull << (msb - 3);
+    // Middle of the bucket.
+    return (kSubBuckets + bucket % kSubBuckets) * width + width / 2;
+}
+
+void C2Stats::OnQueued(uint64_t index) {
+    Pending &slot = pending_[index % kTrackedFrames];
+    slot.time.store(Now(), std::memory_order_relaxed);
+    slot.started.store(false, std::memory_order_relaxed);
+    slot.index.store(index + 1, std::memory_order_release);
+
+    queued_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void C2Stats::OnCompleted(uint64_t index, uint32_t bytes) {
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    bytes_out_.fetch_add(bytes, std::memory_order_relaxed);
+
+    Pending &slot = pending_[index % kTrackedFrames];
+    if (slot.index.load(std::memory_order_acquire) != index + 1) {
+        return;
+    }
+
+    uint64_t latency = Now() - slot.time.load(std::memory_order_relaxed);
+    bool started = slot.started.load(std::memory_order_relaxed);
+    slot.index.store(0, std::memory_order_relaxed);
+
+    histogram_[Bucket(latency)].fetch_add(1, std::memory_order_relaxed);
+    if (!started) {
+        first_histogram_[Bucket(latency)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t max = latency_max_.load(std::memory_order_relaxed);
+    while (latency > max &&
+           !latency_max_.compare_exchange_weak(max, latency, std::memory_order_relaxed)) {
+    }
+}
+
+void C2Stats::OnPartial(uint64_t index, uint32_t bytes) {
+    bytes_out_.fetch_add(bytes, std::memory_order_relaxed);
+
+    Pending &slot = pending_[index % kTrackedFrames];
+    if (slot.index.load(std::memory_order_acquire) != index + 1 ||
+        slot.started.exchange(true, std::memory_order_relaxed)) {
+        return;
+    }
+
+    uint64_t latency = Now() - slot.time.load(std::memory_order_relaxed);
+    first_histogram_[Bucket(latency)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void C2Stats::OnDropped(uint64_t index) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+
+    Pending &slot = pending_[index % kTrackedFrames];
+    uint64_t expected = index + 1;
+    slot.index.compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+}
+
+void C2Stats::OnError() {
+    errors_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void C2Stats::OnSkipped() {
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void C2Stats::OnDetect(uint64_t cpu_time) {
+    detect_time_.fetch_add(cpu_time, std::memory_order_relaxed);
+}
+
+void C2Stats::OnExpired() {
+    expired_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void C2Stats::OnStall() {
+    stalls_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void C2Stats::OnRecovered(uint64_t recover_time) {
+    recovered_.fetch_add(1, std::memory_order_relaxed);
+    recover_time_last_.store(recover_time, std::memory_order_relaxed);
+
+    uint64_t max = recover_time_max_.load(std::memory_order_relaxed);
+    while (recover_time > max &&
+           !recover_time_max_.compare_exchange_weak(max, recover_time,
+                                                    std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t C2Stats::QueueTime(uint64_t index) const {
+    const Pending &slot = pending_[index % kTrackedFrames];
+    if (slot.index.load(std::memory_order_acquire) != index + 1) {
+        return 0;
+    }
+    return slot.time.load(std::memory_order_relaxed);
+}
+
+uint64_t C2Stats::OldestQueueTime() const {
+    uint64_t oldest = 0;
+    for (uint32_t idx = 0; idx < kTrackedFrames; idx++) {
+        const Pending &slot = pending_[idx];
+        if (slot.index.load(std::memory_order_acquire) == 0) {
+            continue;
+        }
+
+        uint64_t time = slot.time.load(std::memory_order_relaxed);
+        if (oldest == 0 || time < oldest) {
+            oldest = time;
+        }
+    }
+    return oldest;
+}
+
+uint32_t C2Stats::DiscardPending() {
+    uint32_t count = 0;
+    for (uint32_t idx = 0; idx < kTrackedFrames; idx++) {
+        if (pending_[idx].index.exchange(0, std::memory_order_relaxed) != 0) {
+            count++;
+        }
+    }
+
+    dropped_.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+uint64_t C2Stats::Percentile(const uint64_t *histogram, uint64_t total, double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(total * percentile);
+    uint64_t count = 0;
+    for (uint32_t bucket = 0; bucket < kBuckets; bucket++) {
+        count += histogram[bucket];
+        if (count > target) {
+            return BucketValue(bucket);
+        }
+    }
+    return BucketValue(kBuckets - 1);
+}
+
+void C2Stats::Snapshot(C2StatsSnapshot &snapshot) const {
+    snapshot.queued = queued_.load(std::memory_order_relaxed);
+    snapshot.completed = completed_.load(std::memory_order_relaxed);
+    snapshot.dropped = dropped_.load(std::memory_order_relaxed);
+    snapshot.errors = errors_.load(std::memory_order_relaxed);
+    snapshot.bytes_out = bytes_out_.load(std::memory_order_relaxed);
+    snapshot.skipped = skipped_.load(std::memory_order_relaxed);
+    snapshot.detect_time = detect_time_.load(std::memory_order_relaxed);
+    snapshot.expired = expired_.load(std::memory_order_relaxed);
+    snapshot.stalls = stalls_.load(std::memory_order_relaxed);
+    snapshot.recovered = recovered_.load(std::memory_order_relaxed);
+    snapshot.recover_time_last = recover_time_last_.load(std::memory_order_relaxed);
+    snapshot.recover_time_max = recover_time_max_.load(std::memory_order_relaxed);
+
+    uint64_t done = snapshot.completed + snapshot.dropped;
+    snapshot.in_flight = (snapshot.queued > done) ? (snapshot.queued - done) : 0;
+
+    uint64_t histogram[kBuckets];
+    uint64_t total = 0;
+    for (uint32_t bucket = 0; bucket < kBuckets; bucket++) {
+        histogram[bucket] = histogram_[bucket].load(std::memory_order_relaxed);
+        total += histogram[bucket];
+    }
+
+    snapshot.latency_p50 = Percentile(histogram, total, 0.50);
+    snapshot.latency_p90 = Percentile(histogram, total, 0.90);
+    snapshot.latency_p99 = Percentile(histogram, total, 0.99);
+    snapshot.latency_max = latency_max_.load(std::memory_order_relaxed);
+
+    total = 0;
+    for (uint32_t bucket = 0; bucket < kBuckets; bucket++) {
+        histogram[bucket] = first_histogram_[bucket].load(std::memory_order_relaxed);
+        total += histogram[bucket];
+    }
+
+    snapshot.first_byte_p50 = Percentile(histogram, total, 0.50);
+    snapshot.first_byte_p99 = Percentile(histogram, total, 0.99);
+}
+
+void C2Stats::Reset() {
+    queued_ = 0;
+    completed_ = 0;
+    dropped_ = 0;
+    errors_ = 0;
+    bytes_out_ = 0;
+    skipped_ = 0;
+    detect_time_ = 0;
+    expired_ = 0;
+    stalls_ = 0;
+    recovered_ = 0;
+    recover_time_last_ = 0;
+    recover_time_max_ = 0;
+    latency_max_ = 0;
+
+    for (uint32_t bucket = 0; bucket < kBuckets; bucket++) {
+        histogram_[bucket] = 0;
+        first_histogram_[bucket] = 0;
+    }
+    for (uint32_t idx = 0; idx < kTrackedFrames; idx++) {
+        pending_[idx].index = 0;
+        pending_[idx].time = 0;
+        pending_[idx].started = false;
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+/** C2StatsSnapshot
+ *
+ * Consistent enough copy of the engine counters for reporting.
+ **/
+struct C2StatsSnapshot {
+    uint64_t queued;
+    uint64_t completed;
+    uint64_t dropped;
+    uint64_t errors;
+    uint64_t bytes_out;
+    uint64_t in_flight;
+    /// Static frames not submitted by the scene detector.
+    uint64_t skipped;
+    /// Thread CPU time spent on scene detection in microseconds.
+    uint64_t detect_time;
+    /// Frames dropped before submission because their deadline passed.
+    uint64_t expired;
+    /// Stalls reported by the watchdog and stalls which were recovered from.
+    uint64_t stalls;
+    uint64_t recovered;
+    /// Stall detection to first returned work, last and worst, in microseconds.
+    uint64_t recover_time_last;
+    uint64_t recover_time_max;
+    /// Queue to output latency percentiles in microseconds.
+    uint64_t latency_p50;
+    uint64_t latency_p90;
+    uint64_t latency_p99;
+    uint64_t latency_max;
+    /// Queue to first output byte latency percentiles in microseconds, lower
+    /// than the above when slices are delivered before the frame completes.
+    uint64_t first_byte_p50;
+    uint64_t first_byte_p99;
+};
+
+/** C2Stats
+ *
+ * Lock free per engine counters and queue to output latency histogram. The
+ * queue time of in-flight frames is kept in a ring indexed by frame index, so
+ * recording never allocates nor takes a lock.
+ **/
+class C2Stats {
+public:
+    C2Stats();
+    ~C2Stats(){};
+
+    void OnQueued(uint64_t index);
+    void OnCompleted(uint64_t index, uint32_t bytes);
+    /**
+     * @brief Record a partial output of a frame which is not complete yet.
+     */
+    void OnPartial(uint64_t index, uint32_t bytes);
+    void OnDropped(uint64_t index);
+    void OnError();
+    void OnSkipped();
+    void OnDetect(uint64_t cpu_time);
+    void OnExpired();
+    void OnStall();
+    void OnRecovered(uint64_t recover_time);
+
+    /**
+     * @brief Time in microseconds at which the given in-flight frame was queued.
+     *
+     * @return: 0 if the frame is unknown or no longer tracked.
+     */
+    uint64_t QueueTime(uint64_t index) const;
+    /**
+     * @brief Queue time of the oldest tracked in-flight frame.
+     *
+     * @return: 0 if no frame is in flight.
+     */
+    uint64_t OldestQueueTime() const;
+    /**
+     * @brief Count all tracked in-flight frames as dropped, for work the
+     * component will never return.
+     *
+     * @return: Number of discarded frames.
+     */
+    uint32_t DiscardPending();
+
+    void Snapshot(C2StatsSnapshot &snapshot) const;
+    void Reset();
+
+    /**
+     * @brief Monotonic clock in microseconds.
+     */
+    static uint64_t Now();
+    /**
+     * @brief CPU time of the calling thread in microseconds.
+     */
+    static uint64_t ThreadCpuTime();
+private:
+    // Log-linear buckets: 8 sub buckets per power of two, up to ~1 hour.
+    static const uint32_t kSubBuckets = 8;
+    static const uint32_t kBuckets = 32 * kSubBuckets;
+    static const uint32_t kTrackedFrames = 1024;
+
+    static uint32_t Bucket(uint64_t value);
+    static uint64_t BucketValue(uint32_t bucket);
+    uint64_t Percentile(const uint64_t *histogram, uint64_t total, double percentile) const;
+
+    std::atomic<uint64_t> queued_;
+    std::atomic<uint64_t> completed_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> errors_;
+    std::atomic<uint64_t> bytes_out_;
+    std::atomic<uint64_t> skipped_;
+    std::atomic<uint64_t> detect_time_;
+    std::atomic<uint64_t> expired_;
+    std::atomic<uint64_t> stalls_;
+    std::atomic<uint64_t> recovered_;
+    std::atomic<uint64_t> recover_time_last_;
+    std::atomic<uint64_t> recover_time_max_;
+    std::atomic<uint64_t> latency_max_;
+
+    std::atomic<uint64_t> histogram_[kBuckets];
+    std::atomic<uint64_t> first_histogram_[kBuckets];
+
+    /// Queue timestamps of the in-flight frames, tagged with the frame index.
+    struct Pending {
+        std::atomic<uint64_t> index;
+        std::atomic<uint64_t> time;
+        /// A partial output of the frame has been delivered.
+        std::atomic<bool> started;
+    };
+    Pending pending_[kTrackedFrames];
+};
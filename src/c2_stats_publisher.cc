@@ -0,0 +1,134 @@
+#include "c2_stats_publisher.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "base/log.h"
+
+C2StatsPublisher &C2StatsPublisher::Instance() {
+    // Never destroyed, engines may unregister during static destruction.
+    static C2StatsPublisher *publisher = new C2StatsPublisher();
+    return *publisher;
+}
+
+C2StatsPublisher::C2StatsPublisher()
+    : generation_(0), entries_(C2_STATS_MAX_ENGINES), count_(0) {}
+
+void C2StatsPublisher::Configure(const C2StatsPublisherConfig &config) {
+    std::lock_guard<std::mutex> lk(lock_);
+    config_ = config;
+}
+
+uint32_t C2StatsPublisher::Register(const std::string &name, Source source) {
+    std::lock_guard<std::mutex> lk(lock_);
+
+    if (count_ == 0) {
+        if (!segment_.Create(config_.name)) {
+            return 0;
+        }
+        segment_name_ = config_.name.empty() ? C2StatsSegment::GetName(getpid()) : config_.name;
+        thread_ = std::thread(&C2StatsPublisher::Loop, this, ++generation_);
+        base::LogInfo() << "Publishing engine stats to " << segment_name_;
+    }
+
+    for (uint32_t slot = 0; slot < entries_.size(); slot++) {
+        if (!entries_[slot].source) {
+            entries_[slot] = {source, name, 0, C2Stats::Now()};
+            count_++;
+            return slot + 1;
+        }
+    }
+
+    base::LogError() << "No stats slot left for " << name;
+    return 0;
+}
+
+void C2StatsPublisher::Unregister(uint32_t id) {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (id == 0 || id > entries_.size() || !entries_[id - 1].source) {
+            return;
+        }
+
+        entries_[id - 1].source = nullptr;
+        C2StatsEngineData data;
+        memset(&data, 0, sizeof(data));
+        segment_.WriteEngine(id - 1, data);
+
+        if (--count_ > 0) {
+            return;
+        }
+        generation_++;
+        thread.swap(thread_);
+    }
+    wakeup_.notify_all();
+    thread.join();
+
+    // Unless an engine was registered meanwhile, recreating the segment.
+    std::lock_guard<std::mutex> lk(lock_);
+    if (count_ == 0) {
+        segment_.Close();
+        segment_name_.clear();
+    }
+}
+
+std::string C2StatsPublisher::GetSegmentName() {
+    std::lock_guard<std::mutex> lk(lock_);
+    return segment_name_;
+}
+
+void C2StatsPublisher::Loop(uint64_t generation) {
+    std::unique_lock<std::mutex> lk(lock_);
+    while (generation_ == generation) {
+        Publish();
+        wakeup_.wait_for(lk, std::chrono::milliseconds(config_.interval_ms),
+                         [&] { return generation_ != generation; });
+    }
+}
+
+void C2StatsPublisher::Publish() {
+    C2BrokerUsage usage;
+    C2BufferBroker::Instance().GetUsage(usage);
+    uint64_t now = C2Stats::Now();
+
+    for (uint32_t slot = 0; slot < entries_.size(); slot++) {
+        Entry &entry = entries_[slot];
+        if (!entry.source) {
+            continue;
+        }
+
+        C2StatsEngineData data;
+        memset(&data, 0, sizeof(data));
+        entry.source(usage, data);
+        data.active = 1;
+        data.id = slot + 1;
+        strncpy(data.name, entry.name.c_str(), sizeof(data.name) - 1);
+        data.updated = now;
+
+        if (now > entry.time && data.stats.completed >= entry.completed) {
+            data.fps = (data.stats.completed - entry.completed) * 1000000.0 / (now - entry.time);
+        }
+        entry.completed = data.stats.completed;
+        entry.time = now;
+
+        segment_.WriteEngine(slot, data);
+    }
+
+    C2StatsProcessData process;
+    memset(&process, 0, sizeof(process));
+    process.updated = now;
+    process.engines = count_;
+    process.pool_budget = usage.budget;
+    process.pool_current = usage.current;
+    process.pool_peak = usage.peak;
+    process.pool_in_use = usage.in_use;
+    process.pool_cached = usage.cached;
+    process.pool_hits = usage.hits;
+    process.pool_misses = usage.misses;
+    process.pool_evictions = usage.evictions;
+    process.pool_failures = usage.failures;
+    segment_.WriteProcess(process);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "c2_buffer_broker.h"
+#include "c2_stats_segment.h"
+
+struct C2StatsPublisherConfig {
+    /// Shared memory name, "/c2_stats.<pid>" when empty.
+    std::string name;
+    /// Period of the segment updates.
+    uint32_t interval_ms = 100;
+};
+
+/** C2StatsPublisher
+ *
+ * Process wide thread copying the counters of the registered engines into the
+ * stats segment. Engines are only read through their lock free counters, the
+ * queueing and callback paths never wait for the publisher.
+ **/
+class C2StatsPublisher {
+public:
+    /**
+     * @brief Fill the data of an engine, called from the publisher thread.
+     * @param usage: Buffer broker accounting of the current update.
+     */
+    typedef std::function<void(const C2BrokerUsage &usage, C2StatsEngineData &data)> Source;
+
+    static C2StatsPublisher &Instance();
+
+    /**
+     * @brief Applies when the segment is created, by the first Register().
+     */
+    void Configure(const C2StatsPublisherConfig &config);
+
+    /**
+     * @brief Publish an engine, creating the segment if needed.
+     *
+     * @return: Publisher ID, 0 if the segment is full or cannot be created.
+     */
+    uint32_t Register(const std::string &name, Source source);
+    /**
+     * @brief Stop publishing an engine, its source is not called anymore once
+     * this returns. The segment is removed with the last engine.
+     */
+    void Unregister(uint32_t id);
+
+    /**
+     * @brief Name of the published segment, empty if none.
+     */
+    std::string GetSegmentName();
+private:
+    C2StatsPublisher();
+
+    struct Entry {
+        Source source;
+        std::string name;
+        /// Completed frames and time of the previous update, for the frame rate.
+        uint64_t completed;
+        uint64_t time;
+    };
+
+    void Loop(uint64_t generation);
+    /// Called with lock_ held.
+    void Publish();
+
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::thread thread_;
+    /// Changed to stop the running thread, which may outlive a new one briefly.
+    uint64_t generation_;
+    C2StatsPublisherConfig config_;
+    C2StatsSegment segment_;
+    std::string segment_name_;
+    /// Indexed by slot, an entry without source is free.
+    std::vector<Entry> entries_;
+    uint32_t count_;
+};
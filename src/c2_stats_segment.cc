@@ -0,0 +1,189 @@
+#include "c2_stats_segment.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+
+/// Copies attempted before a reader gives up on a slot being rewritten.
+#define READ_RETRIES 64
+#define SLOT_HEADER_SIZE (2 * sizeof(uint32_t))
+
+template <typename Data>
+static void write_slot(C2StatsSlot<Data> *slot, const Data &data) {
+    uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot->data, &data, sizeof(Data));
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Copy size bytes of a slot written by a writer with a possibly older layout.
+static bool read_slot(const std::atomic<uint32_t> &sequence, const void *data, size_t size,
+                      void *copy) {
+    for (uint32_t retry = 0; retry < READ_RETRIES; retry++) {
+        uint32_t begin = sequence.load(std::memory_order_acquire);
+        if (begin & 1) {
+            sched_yield();
+            continue;
+        }
+
+        memcpy(copy, data, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == begin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+C2StatsSegment::C2StatsSegment() : header_(nullptr), size_(0), owner_(false) {}
+
+C2StatsSegment::~C2StatsSegment() {
+    Close();
+}
+
+std::string C2StatsSegment::GetName(uint32_t pid) {
+    return "/" C2_STATS_SEGMENT_PREFIX + std::to_string(pid);
+}
+
+bool C2StatsSegment::Create(const std::string &name) {
+    Close();
+
+    name_ = name.empty() ? GetName(getpid()) : name;
+    size_ = sizeof(C2StatsSegmentHeader) +
+            C2_STATS_MAX_ENGINES * sizeof(C2StatsSlot<C2StatsEngineData>);
+
+    int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        base::LogError() << "Cannot create stats segment " << name_ << ": " << strerror(errno);
+        return false;
+    }
+
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, size_) == 0) {
+        data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        base::LogError() << "Cannot map stats segment " << name_ << ": " << strerror(errno);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    // The file is zero filled, every slot starts inactive with an even sequence.
+    header_ = static_cast<C2StatsSegmentHeader *>(data);
+    owner_ = true;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header_->version = C2_STATS_VERSION;
+    header_->header_size = sizeof(C2StatsSegmentHeader);
+    header_->engine_slot_size = sizeof(C2StatsSlot<C2StatsEngineData>);
+    header_->max_engines = C2_STATS_MAX_ENGINES;
+    header_->pid = getpid();
+    header_->created = now.tv_sec * 1000000ull + now.tv_nsec / 1000;
+    header_->magic.store(C2_STATS_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool C2StatsSegment::Open(const std::string &name) {
+    Close();
+
+    name_ = name;
+    int fd = shm_open(name_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        base::LogError() << "Cannot open stats segment " << name_ << ": " << strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 &&
+        static_cast<size_t>(info.st_size) >= sizeof(C2StatsSegmentHeader)) {
+        size_ = info.st_size;
+        data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        base::LogError() << "Cannot map stats segment " << name_;
+        return false;
+    }
+    header_ = static_cast<C2StatsSegmentHeader *>(data);
+
+    // Older headers lack fields, the slot sizes only have to cover the sequence.
+    uint64_t engines_end = static_cast<uint64_t>(header_->header_size) +
+                           static_cast<uint64_t>(header_->engine_slot_size) * header_->max_engines;
+    if (header_->magic.load(std::memory_order_acquire) != C2_STATS_MAGIC ||
+        header_->version != C2_STATS_VERSION ||
+        header_->header_size < offsetof(C2StatsSegmentHeader, process) + SLOT_HEADER_SIZE ||
+        header_->engine_slot_size < SLOT_HEADER_SIZE || engines_end > size_) {
+        base::LogError() << "Stats segment " << name_ << " not ready or incompatible";
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void C2StatsSegment::Close() {
+    if (header_ != nullptr) {
+        munmap(header_, size_);
+        header_ = nullptr;
+    }
+    if (owner_) {
+        shm_unlink(name_.c_str());
+        owner_ = false;
+    }
+    size_ = 0;
+}
+
+uint32_t C2StatsSegment::GetMaxEngines() const {
+    return header_ ? header_->max_engines : 0;
+}
+
+C2StatsSlot<C2StatsEngineData> *C2StatsSegment::EngineSlot(uint32_t slot) const {
+    uint8_t *base = reinterpret_cast<uint8_t *>(header_);
+    return reinterpret_cast<C2StatsSlot<C2StatsEngineData> *>(
+        base + header_->header_size + static_cast<size_t>(slot) * header_->engine_slot_size);
+}
+
+void C2StatsSegment::WriteEngine(uint32_t slot, const C2StatsEngineData &data) {
+    if (owner_ && slot < header_->max_engines) {
+        write_slot(EngineSlot(slot), data);
+    }
+}
+
+void C2StatsSegment::WriteProcess(const C2StatsProcessData &data) {
+    if (owner_) {
+        write_slot(&header_->process, data);
+    }
+}
+
+bool C2StatsSegment::ReadEngine(uint32_t slot, C2StatsEngineData &data) const {
+    memset(&data, 0, sizeof(data));
+    if (header_ == nullptr || slot >= header_->max_engines) {
+        return false;
+    }
+
+    C2StatsSlot<C2StatsEngineData> *record = EngineSlot(slot);
+    size_t size = std::min(sizeof(data), header_->engine_slot_size - SLOT_HEADER_SIZE);
+    return read_slot(record->sequence, &record->data, size, &data);
+}
+
+bool C2StatsSegment::ReadProcess(C2StatsProcessData &data) const {
+    memset(&data, 0, sizeof(data));
+    if (header_ == nullptr) {
+        return false;
+    }
+
+    size_t offset = offsetof(C2StatsSegmentHeader, process) + SLOT_HEADER_SIZE;
+    size_t size = std::min(sizeof(data), header_->header_size - offset);
+    return read_slot(header_->process.sequence, &header_->process.data, size, &data);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <type_traits>
+
+#include "c2_stats.h"
+
+/// Segment names are "/c2_stats.<pid>", found under /dev/shm.
+#define C2_STATS_SEGMENT_PREFIX "c2_stats."
+#define C2_STATS_MAGIC 0x54533243u
+/// Incremented on incompatible layout changes. Fields are only ever appended
+/// to the data structures, readers use the sizes in the header.
+#define C2_STATS_VERSION 1
+#define C2_STATS_MAX_ENGINES 64
+#define C2_STATS_NAME_SIZE 64
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock needs lock free atomics");
+
+/** C2StatsEngineData
+ *
+ * Counters of one engine as published, refreshed by the publisher thread.
+ **/
+struct C2StatsEngineData {
+    /// Zero once the engine is gone, the slot may be reused.
+    uint32_t active;
+    uint32_t id;
+    char name[C2_STATS_NAME_SIZE];
+    /// Monotonic time of the update in microseconds.
+    uint64_t updated;
+    /// Frames completed per second over the last publishing interval.
+    double fps;
+    /// Frames waiting in the latency budget input queue.
+    uint64_t waiting;
+    /// Graphic memory held through the buffer broker, its peak and fair share.
+    uint64_t pool_bytes;
+    uint64_t pool_peak;
+    uint64_t pool_quota;
+    uint64_t pool_waits;
+    /// Engine counters, kept last so that new counters are appended.
+    C2StatsSnapshot stats;
+};
+
+// Both are copied as plain bytes into the segment. A size change means the
+// layout changed: update the size below, and bump C2_STATS_VERSION unless the
+// fields were appended at the end.
+static_assert(std::is_trivially_copyable<C2StatsEngineData>::value,
+              "engine data is copied into shared memory");
+static_assert(sizeof(C2StatsEngineData) == 280, "engine data layout changed");
+
+/** C2StatsProcessData
+ *
+ * Process wide buffer broker accounting.
+ **/
+struct C2StatsProcessData {
+    uint64_t updated;
+    uint32_t engines;
+    uint32_t reserved;
+    uint64_t pool_budget;
+    uint64_t pool_current;
+    uint64_t pool_peak;
+    uint64_t pool_in_use;
+    uint64_t pool_cached;
+    uint64_t pool_hits;
+    uint64_t pool_misses;
+    uint64_t pool_evictions;
+    uint64_t pool_failures;
+};
+
+static_assert(std::is_trivially_copyable<C2StatsProcessData>::value,
+              "process data is copied into shared memory");
+static_assert(sizeof(C2StatsProcessData) == 88, "process data layout changed");
+
+/** C2StatsSlot
+ *
+ * Seqlock protected record: the sequence is odd while the data is written,
+ * readers retry when it was odd or changed during their copy.
+ **/
+template <typename Data>
+struct C2StatsSlot {
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    Data data;
+};
+
+struct C2StatsSegmentHeader {
+    /// Written last, a segment being created has no magic yet.
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t engine_slot_size;
+    uint32_t max_engines;
+    uint32_t pid;
+    /// Wall clock creation time in microseconds.
+    uint64_t created;
+    C2StatsSlot<C2StatsProcessData> process;
+};
+
+/** C2StatsSegment
+ *
+ * Shared memory segment the counters are published to, written by a single
+ * thread and read lock free by any number of processes.
+ **/
+class C2StatsSegment {
+public:
+    C2StatsSegment();
+    ~C2StatsSegment();
+
+    /**
+     * @brief Create the segment, replacing a stale one of the same name.
+     * @param name: POSIX shared memory name, "/c2_stats.<pid>" when empty.
+     */
+    bool Create(const std::string &name);
+    /**
+     * @brief Map an existing segment read only and validate its layout.
+     */
+    bool Open(const std::string &name);
+    /**
+     * @brief Unmap the segment, and remove it if it was created here.
+     */
+    void Close();
+
+    bool IsOpen() const { return header_ != nullptr; }
+    const C2StatsSegmentHeader *GetHeader() const { return header_; }
+    uint32_t GetMaxEngines() const;
+
+    void WriteEngine(uint32_t slot, const C2StatsEngineData &data);
+    void WriteProcess(const C2StatsProcessData &data);
+
+    /**
+     * @brief Consistent copy of a slot, fields unknown to the writer are zero.
+     *
+     * @return: false if the writer kept updating the slot during the copy.
+     */
+    bool ReadEngine(uint32_t slot, C2StatsEngineData &data) const;
+    bool ReadProcess(C2StatsProcessData &data) const;
+
+    /**
+     * @brief Default segment name of the given process.
+     */
+    static std::string GetName(uint32_t pid);
+
+    C2StatsSegment(const C2StatsSegment &) = delete;
+    void operator=(const C2StatsSegment &) = delete;
+private:
+    C2StatsSlot<C2StatsEngineData> *EngineSlot(uint32_t slot) const;
+
+    C2StatsSegmentHeader *header_;
+    size_t size_;
+    std::string name_;
+    bool owner_;
+};
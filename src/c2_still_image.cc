@@ -0,0 +1,298 @@
+#include "c2_still_image.h"
+
+#include <C2AllocatorGBM.h>
+#include <C2Buffer.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "base/log.h"
+
+/// Nominal rate of the tile sequence, only relevant to the rate control.
+#define TILE_FRAMERATE 30
+
+// Parameter sets and delimiters are carried by the hvcC of the tiles.
+#define HEVC_NAL_VPS 32
+#define HEVC_NAL_AUD 35
+
+/** TileCollector
+ *
+ * Output sink gathering the coded tiles of the image being encoded, stored as
+ * length prefixed NAL units.
+ **/
+class TileCollector : public IC2OutputSink {
+public:
+    TileCollector() : first_(0), received_(0), last_output_(0) {}
+
+    void Reset(uint64_t first, uint32_t count) {
+        std::lock_guard<std::mutex> lk(lock_);
+        first_ = first;
+        tiles_.assign(count, std::vector<uint8_t>());
+        complete_.assign(count, false);
+        received_ = 0;
+        last_output_ = 0;
+    }
+
+    void OnFrame(const C2EncodedFrame &frame) override {
+        std::lock_guard<std::mutex> lk(lock_);
+
+        if (frame.config != nullptr) {
+            config_ = *frame.config;
+        }
+        if (frame.index < first_ || frame.index - first_ >= tiles_.size()) {
+            return;
+        }
+
+        size_t idx = frame.index - first_;
+        std::vector<uint8_t> &tile = tiles_[idx];
+        for (const C2NalUnit &nal : frame.au.nals) {
+            if (nal.type >= HEVC_NAL_VPS && nal.type <= HEVC_NAL_AUD) {
+                continue;
+            }
+
+            size_t position = tile.size();
+            tile.resize(position + 4 + nal.size);
+            tile[position] = (nal.size >> 24) & 0xFF;
+            tile[position + 1] = (nal.size >> 16) & 0xFF;
+            tile[position + 2] = (nal.size >> 8) & 0xFF;
+            tile[position + 3] = nal.size & 0xFF;
+            memcpy(tile.data() + position + 4, frame.data + nal.offset, nal.size);
+        }
+
+        // Parameter set only buffers do not complete a tile.
+        if (!complete_[idx] && !tile.empty() && frame.last_slice) {
+            complete_[idx] = true;
+            received_++;
+            last_output_ = C2Stats::Now();
+            done_.notify_all();
+        }
+    }
+
+    bool Wait(uint32_t timeout_ms) {
+        std::unique_lock<std::mutex> lk(lock_);
+        return done_.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                              [this] { return received_ == tiles_.size(); });
+    }
+
+    /**
+     * @brief Hand over the tiles and the parameter sets, returns the time at
+     * which the last tile arrived.
+     */
+    uint64_t Take(std::vector<std::vector<uint8_t>> &tiles, C2CodecConfig &config) {
+        std::lock_guard<std::mutex> lk(lock_);
+        tiles.swap(tiles_);
+        tiles_.clear();
+        complete_.clear();
+        config = config_;
+        return last_output_;
+    }
+private:
+    std::mutex lock_;
+    std::condition_variable done_;
+    uint64_t first_;
+    std::vector<std::vector<uint8_t>> tiles_;
+    std::vector<bool> complete_;
+    size_t received_;
+    uint64_t last_output_;
+    C2CodecConfig config_;
+};
+
+/** TileBlock
+ *
+ * Mapped graphic block receiving one tile.
+ **/
+struct TileBlock {
+    std::shared_ptr<C2GraphicBlock> block;
+    std::unique_ptr<C2GraphicView> view;
+    uint8_t *y;
+    uint8_t *uv;
+    uint32_t stride;
+};
+
+/// Copy one plane region, replicating the last column and row into the padding.
+static void copy_tile_plane(const uint8_t *src, uint32_t src_stride, uint32_t width,
+                            uint32_t height, uint8_t *dst, uint32_t dst_stride,
+                            uint32_t tile_width, uint32_t tile_height, uint32_t pixel) {
+    for (uint32_t row = 0; row < tile_height; row++) {
+        const uint8_t *line = src + std::min(row, height - 1) * src_stride;
+        uint8_t *out = dst + row * dst_stride;
+
+        memcpy(out, line, width);
+        for (uint32_t pos = width; pos < tile_width; pos += pixel) {
+            memcpy(out + pos, line + width - pixel, pixel);
+        }
+    }
+}
+
+C2StillImageEncoder::C2StillImageEncoder(const C2StillImageConfig &config)
+    : config_(config), engine_(nullptr), tile_index_(0) {}
+
+C2StillImageEncoder::~C2StillImageEncoder() {
+    Close();
+}
+
+bool C2StillImageEncoder::Open() {
+    if (config_.tile_size == 0 || config_.tile_size % 64 != 0 || config_.batch == 0) {
+        base::LogError() << "Invalid still image tile size " << config_.tile_size
+                         << " or batch " << config_.batch;
+        return false;
+    }
+
+    engine_ = C2Engine::new_c2_engine(C2ModeType::VideoEncode, C2CodecType::HEICVideoEncode);
+    if (engine_ == nullptr) {
+        return false;
+    }
+
+    // Every tile is a sync frame, they are decoded independently.
+    C2EngineConfig config;
+    config.width = config_.tile_size;
+    config.height = config_.tile_size;
+    config.framerate = TILE_FRAMERATE;
+    config.bitrate = config_.bitrate;
+    config.gop = 1;
+
+    collector_ = std::make_shared<TileCollector>();
+    engine_->c2_engine_add_sink(collector_);
+
+    if (!engine_->c2_engine_configure(config) || !engine_->start_c2_engine()) {
+        Close();
+        return false;
+    }
+
+    pool_ = std::make_unique<base::ThreadPool>(config_.threads);
+    return true;
+}
+
+void C2StillImageEncoder::Close() {
+    if (engine_ != nullptr) {
+        engine_->stop_c2_engine();
+        C2Engine::free_c2_engine(engine_);
+        engine_ = nullptr;
+    }
+    collector_.reset();
+    pool_.reset();
+}
+
+C2HeifGrid C2StillImageEncoder::GetGrid(uint32_t width, uint32_t height) const {
+    C2HeifGrid grid;
+    grid.width = width;
+    grid.height = height;
+    grid.tile_width = config_.tile_size;
+    grid.tile_height = config_.tile_size;
+    grid.columns = (width + config_.tile_size - 1) / config_.tile_size;
+    grid.rows = (height + config_.tile_size - 1) / config_.tile_size;
+    return grid;
+}
+
+bool C2StillImageEncoder::Encode(const C2StreamBuffer *image, const std::string &path,
+                                 C2StillImageStats &stats) {
+    if (engine_ == nullptr) {
+        base::LogError() << "Still image encoder is not open";
+        return false;
+    }
+    if (image->pixel_format != C2PixelFormat::kNV12 || image->planes != 2 ||
+        image->width <= 0 || image->height <= 0 || ((image->width | image->height) & 1)) {
+        base::LogError() << "Still image input must be NV12 with even dimensions";
+        return false;
+    }
+
+    C2HeifGrid grid = GetGrid(image->width, image->height);
+    uint32_t count = grid.columns * grid.rows;
+    uint32_t tile = config_.tile_size;
+    uint64_t first = tile_index_;
+    tile_index_ += count;
+
+    collector_->Reset(first, count);
+
+    const uint8_t *source = static_cast<const uint8_t *>(image->data);
+    const uint8_t *src_y = source + image->offset[0];
+    const uint8_t *src_uv = source + image->offset[1];
+
+    stats.tiles = count;
+    stats.fill_time = 0;
+    uint64_t begin = C2Stats::Now();
+
+    for (uint32_t start = 0; start < count; start += config_.batch) {
+        uint32_t size = std::min(config_.batch, count - start);
+
+        // The previous batches keep the encoder busy while this one is filled.
+        uint32_t pending = (config_.max_in_flight > size) ? (config_.max_in_flight - size) : 0;
+        if (!engine_->c2_engine_wait_pending(pending, config_.timeout_ms)) {
+            base::LogError() << "Timeout waiting for the encoder, tile " << start;
+            return false;
+        }
+
+        std::vector<TileBlock> blocks(size);
+        for (uint32_t idx = 0; idx < size; idx++) {
+            TileBlock &target = blocks[idx];
+            target.block = engine_->c2_engine_fetch_block(tile, tile, C2PixelFormat::kNV12);
+            if (!target.block) {
+                base::LogError() << "No block for tile " << start + idx;
+                return false;
+            }
+
+            target.view = std::make_unique<C2GraphicView>(target.block->map().get());
+            if (target.view->error() != C2_OK) {
+                base::LogError() << "Failed to map block of tile " << start + idx;
+                return false;
+            }
+
+            auto handle = static_cast<const android::C2HandleGBM *>(target.block->handle());
+            target.stride = handle->mInts.stride;
+            target.y = target.view->data()[0];
+            target.uv = target.y + target.stride * handle->mInts.slice_height;
+        }
+
+        uint64_t fill = C2Stats::Now();
+        pool_->run(size, [&](size_t idx) {
+            uint32_t number = start + idx;
+            uint32_t left = (number % grid.columns) * tile;
+            uint32_t top = (number / grid.columns) * tile;
+            uint32_t width = std::min(tile, grid.width - left);
+            uint32_t height = std::min(tile, grid.height - top);
+
+            copy_tile_plane(src_y + top * image->stride[0] + left, image->stride[0], width,
+                            height, blocks[idx].y, blocks[idx].stride, tile, tile, 1);
+            copy_tile_plane(src_uv + top / 2 * image->stride[1] + left, image->stride[1], width,
+                            height / 2, blocks[idx].uv, blocks[idx].stride, tile, tile / 2, 2);
+        });
+        stats.fill_time += C2Stats::Now() - fill;
+
+        for (uint32_t idx = 0; idx < size; idx++) {
+            uint64_t index = first + start + idx;
+            blocks[idx].view.reset();
+            if (!engine_->c2_engine_queue_block(blocks[idx].block, index,
+                                                index * 1000000 / TILE_FRAMERATE)) {
+                base::LogError() << "Failed to queue tile " << start + idx;
+                return false;
+            }
+        }
+    }
+
+    if (!engine_->c2_engine_wait_pending(0, config_.timeout_ms) ||
+        !collector_->Wait(config_.timeout_ms)) {
+        base::LogError() << "Not every tile of the image was encoded";
+        return false;
+    }
+
+    std::vector<std::vector<uint8_t>> tiles;
+    C2CodecConfig config;
+    uint64_t end = collector_->Take(tiles, config);
+
+    stats.encode_time = end - begin;
+    stats.time_per_mp = stats.encode_time * 1e6 / (static_cast<double>(grid.width) * grid.height);
+    stats.bytes = 0;
+    for (const std::vector<uint8_t> &data : tiles) {
+        stats.bytes += data.size();
+    }
+
+    base::LogInfo() << "Encoded " << grid.width << "x" << grid.height << " image in " << count
+                    << " tiles, " << stats.encode_time << " us, " << stats.time_per_mp
+                    << " us per megapixel";
+
+    return C2HeifWriter::Write(path, grid, config, tiles);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "base/thread_pool.h"
+#include "c2_common.h"
+#include "c2_engine.h"
+#include "c2_heif_writer.h"
+
+struct C2StillImageConfig {
+    /// Square tile size of the HEIF grid.
+    uint32_t tile_size = 512;
+    /// Tile bitrate at the nominal tile rate, 0 keeps the component default.
+    uint32_t bitrate = 0;
+    /// Tiles filled in parallel and queued together.
+    uint32_t batch = 8;
+    /// Tiles kept queued in the encoder, the next batch is filled meanwhile.
+    uint32_t max_in_flight = 16;
+    /// Copy threads in addition to the calling thread.
+    uint32_t threads = 2;
+    uint32_t timeout_ms = 5000;
+};
+
+/** C2StillImageStats
+ *
+ * Timing of the last encoded image, in microseconds.
+ **/
+struct C2StillImageStats {
+    uint32_t tiles;
+    uint64_t bytes;
+    /// Time spent copying pixels into the tile blocks.
+    uint64_t fill_time;
+    /// From the first tile fetched until the last tile returned.
+    uint64_t encode_time;
+    /// encode_time per megapixel of the image.
+    double time_per_mp;
+};
+
+class TileCollector;
+
+/** C2StillImageEncoder
+ *
+ * Encodes large still images into HEIF files. The image is split into grid
+ * tiles which are copied straight into graphic blocks of a HEIC encoder, with
+ * the edges replicated into the padding of partial tiles. Tiles are filled by
+ * a thread pool and queued in batches while the previous batches are being
+ * encoded, so the hardware does not wait for the copies. The coded tiles are
+ * stored as hidden items of a grid image.
+ **/
+class C2StillImageEncoder {
+public:
+    explicit C2StillImageEncoder(const C2StillImageConfig &config);
+    ~C2StillImageEncoder();
+
+    /**
+     * @brief Create, configure and start the HEIC encoder.
+     * @return: true on success or false on failure.
+     */
+    bool Open();
+    void Close();
+
+    /**
+     * @brief Encode an NV12 image into a HEIF file.
+     * @param image: NV12 image, width and height must be even.
+     * @param path: Output file.
+     * @param stats: Filled with the tile count and timing.
+     *
+     * @return: true on success or false on failure.
+     */
+    bool Encode(const C2StreamBuffer *image, const std::string &path, C2StillImageStats &stats);
+
+    /**
+     * @brief Grid used for an image of the given size.
+     */
+    C2HeifGrid GetGrid(uint32_t width, uint32_t height) const;
+private:
+    C2StillImageConfig config_;
+    C2Engine *engine_;
+    std::shared_ptr<TileCollector> collector_;
+    std::unique_ptr<base::ThreadPool> pool_;
+    /// Index of the next tile, tiles of consecutive images keep increasing.
+    uint64_t tile_index_;
+};
@@ -4,7 +4,26 @@
 #include <C2Buffer.h>
 #include <C2PlatformSupport.h>
 
+#include <algorithm>
+
 #include "base/log.h"
+#include "c2_convert.h"
+
+C2PixelFormat C2Utils::GetBlockFormat(C2PixelFormat format) {
+    switch (format) {
+        case C2PixelFormat::kYV12:
+        case C2PixelFormat::kI420:
+        case C2PixelFormat::kRGBA:
+            // Converted to NV12 while copying into the block.
+            return C2PixelFormat::kNV12;
+        case C2PixelFormat::kY210:
+        case C2PixelFormat::kI010:
+            // Converted to Venus P010 while copying into the block.
+            return C2PixelFormat::kP010;
+        default:
+            return format;
+    }
+}
 
 bool C2Utils::ImportHandleInfo(C2StreamBuffer *stream_buffer, ::android::C2HandleGBM *handle) {
     return false;
@@ -30,22 +49,80 @@ std::shared_ptr<C2Buffer> C2Utils::CreateBuffer(C2StreamBuffer *stream_buffer,
     printf("handle info stride:%d, slice_height:%d\n", handle->mInts.stride,
            handle->mInts.slice_height);
 
-    for (uint32_t idx = 0; idx < stream_buffer->planes; idx++) {
-        uint32_t n_rows = (idx == 0) ? stream_buffer->height : (stream_buffer->height / 2);
+    uint32_t width = stream_buffer->width;
+    uint32_t height = stream_buffer->height;
+    uint32_t stride = handle->mInts.stride;
+
+    // Destination luma and interleaved chroma planes of the NV12 block.
+    uint8_t *y = static_cast<uint8_t *>(data[0]);
+    uint8_t *uv = y + (stride * handle->mInts.slice_height);
 
-        // Set the source and destination pointers for the next plane.
-        uint8_t *source = static_cast<uint8_t *>(stream_buffer->data) + stream_buffer->offset[idx];
-        uint8_t *destination = static_cast<uint8_t *>(data[0]) +
-                               (idx * handle->mInts.stride * handle->mInts.slice_height);
+    const uint8_t *source = static_cast<const uint8_t *>(stream_buffer->data);
+    const uint8_t *planes[3] = {};
+    for (uint32_t idx = 0; idx < stream_buffer->planes && idx < 3; idx++) {
+        planes[idx] = source + stream_buffer->offset[idx];
+    }
 
-        for (uint32_t num = 0; num < n_rows; num++) {
-            memcpy(destination, source, stream_buffer->stride[idx]);
+    switch (stream_buffer->pixel_format) {
+        case C2PixelFormat::kYV12:
+        case C2PixelFormat::kI420: {
+            if (stream_buffer->planes != 3) {
+                base::LogError() << "Planar 4:2:0 input requires 3 planes";
+                return nullptr;
+            }
 
-            destination += handle->mInts.stride;
-            source += stream_buffer->stride[idx];
+            // YV12 stores V before U, the planes are given in memory order.
+            bool yv12 = stream_buffer->pixel_format == C2PixelFormat::kYV12;
+            uint32_t u = yv12 ? 2 : 1;
+            uint32_t v = yv12 ? 1 : 2;
+
+            C2Convert::CopyPlane(planes[0], stream_buffer->stride[0], y, stride, width, height);
+            C2Convert::InterleaveUV(planes[u], stream_buffer->stride[u], planes[v],
+                                    stream_buffer->stride[v], uv, stride, width / 2, height / 2);
+            break;
         }
+        case C2PixelFormat::kRGBA:
+            C2Convert::RGBAToNV12(planes[0], stream_buffer->stride[0], y, stride, uv, stride,
+                                  width, height, stream_buffer->color_matrix);
+            break;
+        case C2PixelFormat::kP010:
+            // Same 16-bit MSB aligned layout, only the strides and scanline differ.
+            C2Convert::CopyPlane(planes[0], stream_buffer->stride[0], y, stride, width * 2,
+                                 height);
+            C2Convert::CopyPlane(planes[1], stream_buffer->stride[1], uv, stride, width * 2,
+                                 height / 2);
+            break;
+        case C2PixelFormat::kI010:
+            if (stream_buffer->planes != 3) {
+                base::LogError() << "Planar 10-bit input requires 3 planes";
+                return nullptr;
+            }
+
+            C2Convert::ShiftPlane10(planes[0], stream_buffer->stride[0], y, stride, width,
+                                    height);
+            C2Convert::InterleaveUV10(planes[1], stream_buffer->stride[1], planes[2],
+                                      stream_buffer->stride[2], uv, stride, width / 2,
+                                      height / 2);
+            break;
+        case C2PixelFormat::kY210:
+            C2Convert::Y210ToP010(planes[0], stream_buffer->stride[0], y, stride, uv, stride,
+                                  width, height);
+            break;
+        default:
+            for (uint32_t idx = 0; idx < stream_buffer->planes && idx < 2; idx++) {
+                uint32_t n_rows = (idx == 0) ? height : (height / 2);
+                uint32_t row_bytes = std::min<uint32_t>(stream_buffer->stride[idx], stride);
+
+                C2Convert::CopyPlane(planes[idx], stream_buffer->stride[idx],
+                                     (idx == 0) ? y : uv, stride, row_bytes, n_rows);
+            }
+            break;
     }
 
+    return WrapBlock(block);
+}
+
+std::shared_ptr<C2Buffer> C2Utils::WrapBlock(std::shared_ptr<C2GraphicBlock> &block) {
     auto c2buffer = C2Buffer::CreateGraphicBuffer(
         block->share(C2Rect(block->width(), block->height()), ::C2Fence()));
     if (!c2buffer) {
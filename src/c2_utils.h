@@ -7,6 +7,13 @@
 
 class C2Utils {
 public:
+    /**
+     * @brief Graphic block format used for a stream buffer pixel format.
+     * @param format: Pixel format of the input stream buffer.
+     *
+     * @return: NV12 for formats converted on copy, otherwise the format itself.
+     */
+    static C2PixelFormat GetBlockFormat(C2PixelFormat format);
     /** 
      * @brief Fills Codec2 GBM handle with the information (fd, width, height, etc.) imported from the GStreamer buffer.
      * @buffer: Pointer to custom buffer.
@@ -24,4 +31,11 @@ public:
     */
     static std::shared_ptr<C2Buffer> CreateBuffer(C2StreamBuffer *stream_buffer,
                                                   std::shared_ptr<C2GraphicBlock> &block);
+    /**
+     * @brief Place an already filled Codec2 graphic block into a Codec2 buffer wrapper.
+     * @param block: Reference to Codec2 graphic block.
+     *
+     * @return: Empty shared pointer on failure.
+    */
+    static std::shared_ptr<C2Buffer> WrapBlock(std::shared_ptr<C2GraphicBlock> &block);
 };
\ No newline at end of file
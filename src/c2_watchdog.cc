@@ -0,0 +1,78 @@
+#include "c2_watchdog.h"
+
+#include "c2_stats.h"
+
+C2Watchdog::C2Watchdog(const C2WatchdogConfig &config, OldestCallback oldest,
+                       StallCallback stall)
+    : config_(config),
+      oldest_(oldest),
+      stall_(stall),
+      running_(false),
+      triggered_(false),
+      reported_(0) {
+    if (config_.interval_ms == 0) {
+        config_.interval_ms = 1;
+    }
+}
+
+C2Watchdog::~C2Watchdog() {
+    Stop();
+}
+
+void C2Watchdog::Start() {
+    std::lock_guard<std::mutex> lk(lock_);
+    if (running_) {
+        return;
+    }
+
+    running_ = true;
+    triggered_ = false;
+    reported_ = 0;
+    thread_ = std::thread(&C2Watchdog::Loop, this);
+}
+
+void C2Watchdog::Stop() {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+}
+
+void C2Watchdog::Trigger() {
+    std::lock_guard<std::mutex> lk(lock_);
+    triggered_ = true;
+    wakeup_.notify_all();
+}
+
+void C2Watchdog::Loop() {
+    std::unique_lock<std::mutex> lk(lock_);
+
+    while (running_) {
+        wakeup_.wait_for(lk, std::chrono::milliseconds(config_.interval_ms),
+                         [&]() { return !running_ || triggered_; });
+        if (!running_) {
+            break;
+        }
+
+        bool triggered = triggered_;
+        triggered_ = false;
+        lk.unlock();
+
+        uint64_t oldest = oldest_();
+        uint64_t age = (oldest != 0) ? (C2Stats::Now() - oldest) : 0;
+
+        // A frame which stays stuck is reported once, recovery discards it.
+        bool stalled = oldest != 0 && oldest != reported_ && age >= config_.stall_ms * 1000ull;
+        if (stalled || triggered) {
+            reported_ = oldest;
+            stall_(age);
+        }
+
+        lk.lock();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Recovery steps tried on a stalled component, in escalation order
+*/
+enum class C2RecoveryAction : uint32_t {
+    /// Only report the stall.
+    kNone,
+    /// Flush the component, held work is returned or discarded.
+    kFlush,
+    /// Stop and start the component again.
+    kRestart,
+    /// Release the component and create a new instance through C2Factory.
+    kRecreate,
+};
+
+struct C2WatchdogConfig {
+    bool enabled = false;
+    /// Age of the oldest in-flight frame after which the component is stalled.
+    uint32_t stall_ms = 2000;
+    /// Period at which the oldest in-flight frame is checked.
+    uint32_t interval_ms = 100;
+    /// Strongest recovery, a stall outliving the previous recovery escalates one step.
+    C2RecoveryAction recovery = C2RecoveryAction::kRecreate;
+    /// Handle component errors like a stall.
+    bool recover_on_error = true;
+};
+
+/** C2StallInfo
+ *
+ * Payload of the kStall event.
+ **/
+struct C2StallInfo {
+    /// Age of the oldest in-flight frame in microseconds, 0 if none (error).
+    uint64_t age;
+    /// Recovery about to be attempted.
+    C2RecoveryAction action;
+};
+
+/** C2Watchdog
+ *
+ * Thread periodically checking the age of the oldest frame held by the
+ * component. The stall callback is called once per stalled frame, or right
+ * away after Trigger(), from the watchdog thread.
+ **/
+class C2Watchdog {
+public:
+    /// C2Stats::Now() based queue time of the oldest in-flight frame, 0 if none.
+    using OldestCallback = std::function<uint64_t()>;
+    using StallCallback = std::function<void(uint64_t age)>;
+
+    C2Watchdog(const C2WatchdogConfig &config, OldestCallback oldest, StallCallback stall);
+    ~C2Watchdog();
+
+    void Start();
+    /**
+     * @brief Stop the watchdog thread, must not be called from the stall callback.
+     */
+    void Stop();
+
+    /**
+     * @brief Report a stall at the next wakeup regardless of the frame ages.
+     */
+    void Trigger();
+
+    const C2WatchdogConfig &GetConfig() const { return config_; }
+private:
+    void Loop();
+
+    C2WatchdogConfig config_;
+    OldestCallback oldest_;
+    StallCallback stall_;
+
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::thread thread_;
+    bool running_;
+    bool triggered_;
+    /// Queue time of the frame of the last reported stall.
+    uint64_t reported_;
+};
@@ -0,0 +1,193 @@
+#include "c2_work_log.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "base/log.h"
+
+/// Records written to the file at once.
+#define RECORD_BATCH 256
+
+static uint64_t now_us(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+C2WorkLogWriter::C2WorkLogWriter() : file_(nullptr), start_(0), records_(0) {}
+
+C2WorkLogWriter::~C2WorkLogWriter() {
+    Close();
+}
+
+bool C2WorkLogWriter::Open(const std::string &path, const std::string &name, C2ModeType mode,
+                           const C2EngineConfig &config) {
+    Close();
+
+    std::lock_guard<std::mutex> lk(lock_);
+    file_ = fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        base::LogError() << "Cannot create work log " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    C2WorkLogHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = C2_WORK_LOG_MAGIC;
+    header.version = C2_WORK_LOG_VERSION;
+    header.header_size = sizeof(C2WorkLogHeader);
+    header.record_size = sizeof(C2WorkLogRecord);
+    strncpy(header.name, name.c_str(), sizeof(header.name) - 1);
+    header.mode = static_cast<uint32_t>(mode);
+    header.created = now_us(CLOCK_REALTIME);
+    header.config = config;
+
+    if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+        base::LogError() << "Cannot write work log " << path;
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    start_ = now_us(CLOCK_MONOTONIC);
+    records_ = 0;
+    buffer_.reserve(RECORD_BATCH);
+    thread_ = std::thread(&C2WorkLogWriter::Loop, this, file_);
+    return true;
+}
+
+void C2WorkLogWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        if (file_ == nullptr) {
+            return;
+        }
+        Flush();
+        // The writer thread drains the remaining batches and exits.
+        file_ = nullptr;
+    }
+    wakeup_.notify_all();
+    thread_.join();
+}
+
+void C2WorkLogWriter::Record(C2WorkLogEvent event, uint64_t index, uint64_t timestamp,
+                             uint32_t flags, uint32_t size, uint32_t width, uint32_t height,
+                             uint32_t tunings, uint32_t tuning_mask, uint32_t bitrate) {
+    C2WorkLogRecord record;
+    record.index = index;
+    record.timestamp = timestamp;
+    record.event = static_cast<uint32_t>(event);
+    record.flags = flags;
+    record.size = size;
+    record.width = static_cast<uint16_t>(width);
+    record.height = static_cast<uint16_t>(height);
+    record.tunings = tunings;
+    record.tuning_mask = tuning_mask;
+    record.bitrate = bitrate;
+    record.reserved = 0;
+
+    std::lock_guard<std::mutex> lk(lock_);
+    if (file_ == nullptr) {
+        return;
+    }
+
+    // Timed under the lock, so that records are in time order in the file.
+    record.time = now_us(CLOCK_MONOTONIC) - start_;
+    buffer_.push_back(record);
+    records_++;
+    if (buffer_.size() >= RECORD_BATCH) {
+        Flush();
+    }
+}
+
+uint64_t C2WorkLogWriter::GetRecords() const {
+    std::lock_guard<std::mutex> lk(lock_);
+    return records_;
+}
+
+void C2WorkLogWriter::Flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+
+    // Swapped with a written batch, the buffer is not allocated under the lock.
+    batches_.push_back(std::move(buffer_));
+    buffer_.clear();
+    if (!spare_.empty()) {
+        buffer_ = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    wakeup_.notify_all();
+}
+
+void C2WorkLogWriter::Loop(FILE *file) {
+    std::unique_lock<std::mutex> lk(lock_);
+
+    while (true) {
+        if (batches_.empty()) {
+            if (file_ == nullptr) {
+                break;
+            }
+            wakeup_.wait(lk);
+            continue;
+        }
+
+        std::vector<C2WorkLogRecord> batch = std::move(batches_.front());
+        batches_.pop_front();
+        lk.unlock();
+
+        if (fwrite(batch.data(), sizeof(C2WorkLogRecord), batch.size(), file) != batch.size()) {
+            base::LogError() << "Failed to write " << batch.size() << " work log records";
+        }
+        batch.clear();
+
+        lk.lock();
+        spare_.push_back(std::move(batch));
+    }
+    lk.unlock();
+
+    fclose(file);
+}
+
+bool C2WorkLogReader::Load(const std::string &path) {
+    records_.clear();
+    memset(&header_, 0, sizeof(header_));
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        base::LogError() << "Cannot open work log " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    // Fields are only ever appended, the sizes in the header are authoritative.
+    size_t prefix = offsetof(C2WorkLogHeader, record_size);
+    bool ok = fread(&header_, prefix, 1, file) == 1 && header_.magic == C2_WORK_LOG_MAGIC &&
+              header_.version == C2_WORK_LOG_VERSION &&
+              header_.header_size >= offsetof(C2WorkLogHeader, config);
+    if (ok) {
+        size_t size = std::min<size_t>(header_.header_size, sizeof(header_)) - prefix;
+        ok = fread(reinterpret_cast<uint8_t *>(&header_) + prefix, size, 1, file) == 1 &&
+             fseek(file, header_.header_size, SEEK_SET) == 0 &&
+             header_.record_size >= offsetof(C2WorkLogRecord, tuning_mask);
+    }
+
+    // Fields unknown to the writer are left zero.
+    std::vector<uint8_t> record(ok ? header_.record_size : 0);
+    size_t known = std::min<size_t>(record.size(), sizeof(C2WorkLogRecord));
+    while (ok && fread(record.data(), record.size(), 1, file) == 1) {
+        records_.emplace_back();
+        memset(&records_.back(), 0, sizeof(C2WorkLogRecord));
+        memcpy(&records_.back(), record.data(), known);
+    }
+    fclose(file);
+
+    if (!ok) {
+        base::LogError() << "Work log " << path << " is not readable or incompatible";
+        return false;
+    }
+    header_.name[C2_WORK_LOG_NAME_SIZE - 1] = '\0';
+    return true;
+}
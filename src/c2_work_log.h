@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "c2_common.h"
+
+#define C2_WORK_LOG_MAGIC 0x4c573243u
+#define C2_WORK_LOG_VERSION 1
+#define C2_WORK_LOG_NAME_SIZE 64
+
+enum class C2WorkLogEvent : uint32_t {
+    /// Work handed to queue_nb().
+    kQueue,
+    /// Work returned with output, one per slice in slice output mode.
+    kDone,
+    /// Work returned without output.
+    kDrop,
+    kEOS,
+    /// Component error, the code is in flags.
+    kError,
+    /// Flush of the component, the flushed work follows as kDone/kDrop.
+    kFlush,
+};
+
+/// Kinds of tunings queued with a work, ORed in C2WorkLogRecord::tuning_mask.
+enum C2WorkLogTuning : uint32_t {
+    kTuningSyncFrame = 1 << 0,
+    kTuningBitrate = 1 << 1,
+    /// Any other tuning, not replayed.
+    kTuningOther = 1u << 31,
+};
+
+/** C2WorkLogHeader
+ *
+ * Start of a work log, followed by C2WorkLogRecord until the end of the file.
+ **/
+struct C2WorkLogHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    char name[C2_WORK_LOG_NAME_SIZE];
+    /// C2ModeType of the component.
+    uint32_t mode;
+    uint32_t reserved;
+    /// CLOCK_REALTIME of the start of the recording in microseconds.
+    uint64_t created;
+    /// Stream configuration when the recording started, zero if not configured.
+    C2EngineConfig config;
+};
+
+/** C2WorkLogRecord
+ *
+ * One work item crossing the component boundary.
+ **/
+struct C2WorkLogRecord {
+    /// Microseconds since the start of the recording.
+    uint64_t time;
+    uint64_t index;
+    uint64_t timestamp;
+    uint32_t event;
+    /// C2FrameData flags of the input or of the output.
+    uint32_t flags;
+    /// Bytes of the linear input or output buffer.
+    uint32_t size;
+    /// Dimensions of a graphic input buffer.
+    uint16_t width;
+    uint16_t height;
+    /// Tunings queued with the work, e.g. sync frame requests.
+    uint32_t tunings;
+    /// C2WorkLogTuning kinds of the tunings, and the value of a bitrate tuning.
+    uint32_t tuning_mask;
+    uint32_t bitrate;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(C2WorkLogRecord) == 56, "work log record layout changed");
+
+/** C2WorkLogWriter
+ *
+ * Appends records of the work queued to and returned by a component, from
+ * the queueing and the callback threads. Records are buffered, full batches
+ * are written by a writer thread so that no file I/O happens on the recorded
+ * paths.
+ **/
+class C2WorkLogWriter {
+public:
+    C2WorkLogWriter();
+    ~C2WorkLogWriter();
+
+    /**
+     * @brief Create the log file and write its header.
+     * @param path: Output file, truncated.
+     * @param name: Component name.
+     * @param mode: Component mode.
+     * @param config: Stream configuration, replayed with the log.
+     * @return: true on success, false otherwise.
+     */
+    bool Open(const std::string &path, const std::string &name, C2ModeType mode,
+              const C2EngineConfig &config);
+
+    /**
+     * @brief Write the buffered records and close the file.
+     */
+    void Close();
+
+    /**
+     * @brief Append a record, its time is taken now.
+     */
+    void Record(C2WorkLogEvent event, uint64_t index, uint64_t timestamp, uint32_t flags,
+                uint32_t size, uint32_t width = 0, uint32_t height = 0, uint32_t tunings = 0,
+                uint32_t tuning_mask = 0, uint32_t bitrate = 0);
+
+    uint64_t GetRecords() const;
+private:
+    /// Hand the buffered records to the writer thread, called with lock_ held.
+    void Flush();
+    void Loop(FILE *file);
+
+    mutable std::mutex lock_;
+    std::condition_variable wakeup_;
+    FILE *file_;
+    uint64_t start_;
+    uint64_t records_;
+    std::vector<C2WorkLogRecord> buffer_;
+    /// Batches waiting for the writer thread, and written ones to be reused.
+    std::deque<std::vector<C2WorkLogRecord>> batches_;
+    std::vector<std::vector<C2WorkLogRecord>> spare_;
+    std::thread thread_;
+};
+
+/** C2WorkLogReader
+ *
+ * Loads a work log written by C2WorkLogWriter.
+ **/
+class C2WorkLogReader {
+public:
+    /**
+     * @brief Read the whole log.
+     * @return: false if the file cannot be read or is not a compatible log.
+     */
+    bool Load(const std::string &path);
+
+    const C2WorkLogHeader &GetHeader() const { return header_; }
+    const std::vector<C2WorkLogRecord> &GetRecords() const { return records_; }
+private:
+    C2WorkLogHeader header_;
+    std::vector<C2WorkLogRecord> records_;
+};
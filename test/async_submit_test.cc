@@ -0,0 +1,173 @@
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "c2_test_stream.h"
+#include "src/c2_engine.h"
+#include "src/c2_frame_source.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define NUM_STREAMS 4
+#define FRAMES_PER_STREAM 250
+#define EXECUTOR_THREADS 2
+#define GOP_SIZE 30
+#define PAYLOAD_SIZE 2000
+#define TIMEOUT_MS 5000
+
+static std::mutex g_lock;
+static bool g_output = true;
+static std::shared_ptr<FakeComponent> g_latest;
+
+static std::vector<uint8_t> expected_output(uint64_t index) {
+    C2TestStream stream(false, WIDTH, HEIGHT, index + 1);
+    return stream.AccessUnit(index % GOP_SIZE == 0, PAYLOAD_SIZE);
+}
+
+static C2Engine *create_engine() {
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    if (engine == nullptr) {
+        return nullptr;
+    }
+
+    C2EngineConfig config = {WIDTH, HEIGHT, 30.0f, 1000000, GOP_SIZE};
+    if (!engine->c2_engine_configure(config) || !engine->start_c2_engine()) {
+        C2Engine::free_c2_engine(engine);
+        return nullptr;
+    }
+    return engine;
+}
+
+static C2FrameFuture queue_frame(C2Engine *engine, std::vector<uint8_t> &frame, uint64_t index) {
+    C2StreamBuffer buffer = {};
+    C2FrameSource::DescribeFrame(frame.data(), C2PixelFormat::kNV12, WIDTH, HEIGHT, buffer);
+    buffer.timestamp = index * 33333;
+    return engine->c2_engine_queue_buffer_async(&buffer);
+}
+
+// Thousands of frames in flight across streams, completed on a small executor.
+static bool check_encoded() {
+    std::vector<uint8_t> frame(C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, WIDTH, HEIGHT));
+    std::atomic<uint32_t> completed(0);
+    std::atomic<uint32_t> mismatches(0);
+    C2WorkerExecutor executor(EXECUTOR_THREADS);
+
+    std::vector<C2Engine *> engines;
+    for (uint32_t stream = 0; stream < NUM_STREAMS; stream++) {
+        C2Engine *engine = create_engine();
+        if (engine == nullptr) {
+            break;
+        }
+        engines.push_back(engine);
+    }
+
+    bool ok = engines.size() == NUM_STREAMS;
+    for (uint64_t index = 0; ok && index < FRAMES_PER_STREAM; index++) {
+        for (C2Engine *engine : engines) {
+            C2FrameFuture future = queue_frame(engine, frame, index);
+            future.Then([&, index](const C2FrameResult &result) {
+                if (result.status != C2FrameStatus::kEncoded || result.index != index ||
+                    result.timestamp != index * 33333 || result.data != expected_output(index) ||
+                    result.sync != (index % GOP_SIZE == 0)) {
+                    mismatches++;
+                }
+                completed++;
+            }, &executor);
+        }
+    }
+
+    uint32_t expected = NUM_STREAMS * FRAMES_PER_STREAM;
+    for (uint32_t wait = 0; wait < TIMEOUT_MS && completed != expected; wait += 10) {
+        usleep(10000);
+    }
+
+    for (C2Engine *engine : engines) {
+        engine->stop_c2_engine();
+        C2Engine::free_c2_engine(engine);
+    }
+
+    if (!ok || completed != expected || mismatches != 0) {
+        base::LogError() << "Async encode: " << completed << " of " << expected
+                         << " frames completed, " << mismatches << " mismatches";
+        return false;
+    }
+    return true;
+}
+
+// Frames returned without output or still held at stop complete with a status.
+static bool check_status(HangMode mode, C2FrameStatus status) {
+    std::vector<uint8_t> frame(C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, WIDTH, HEIGHT));
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_output = false;
+    }
+
+    C2Engine *engine = create_engine();
+    if (engine == nullptr) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_latest->Hang(mode);
+    }
+
+    std::vector<C2FrameFuture> futures;
+    for (uint64_t index = 0; index < 10; index++) {
+        futures.push_back(queue_frame(engine, frame, index));
+    }
+    if (mode != HangMode::kNone) {
+        engine->stop_c2_engine();
+    }
+
+    bool ok = true;
+    for (uint64_t index = 0; index < futures.size(); index++) {
+        if (!futures[index].Wait(TIMEOUT_MS) || futures[index].Get().status != status ||
+            futures[index].Get().index != index || !futures[index].Get().data.empty()) {
+            base::LogError() << "Frame " << index << " did not complete with status "
+                             << static_cast<uint32_t>(status);
+            ok = false;
+        }
+    }
+
+    engine->stop_c2_engine();
+    C2Engine::free_c2_engine(engine);
+
+    std::lock_guard<std::mutex> lk(g_lock);
+    g_output = true;
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        auto component = std::make_shared<FakeComponent>(name);
+
+        std::lock_guard<std::mutex> lk(g_lock);
+        if (g_output) {
+            component->SetOutput(expected_output);
+        }
+        g_latest = component;
+        return std::static_pointer_cast<C2Component>(component);
+    });
+
+    bool ok = check_encoded();
+    ok = check_status(HangMode::kNone, C2FrameStatus::kDropped) && ok;
+    ok = check_status(HangMode::kForever, C2FrameStatus::kCancelled) && ok;
+
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_latest.reset();
+    }
+    C2Factory::SetComponentCreator(nullptr);
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Async submit checks passed";
+    return 0;
+}
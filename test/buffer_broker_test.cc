@@ -0,0 +1,263 @@
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_buffer_broker.h"
+#include "test/c2_test_check.h"
+
+#define WIDTH 1280
+#define HEIGHT 768
+#define BLOCK_SIZE (WIDTH * HEIGHT * 3 / 2)
+
+/** FakeAllocator
+ *
+ * Hands out distinct block pointers which are never dereferenced by the
+ * broker, and counts how many are alive.
+ **/
+class FakeAllocator {
+public:
+    FakeAllocator() : allocated(0), freed(0) {}
+
+    C2BufferBroker::Allocator Get(size_t size) {
+        return [this, size](size_t &actual) {
+            actual = size;
+            allocated++;
+            char *storage = new char[1];
+            return std::shared_ptr<C2GraphicBlock>(reinterpret_cast<C2GraphicBlock *>(storage),
+                                                   [this](C2GraphicBlock *block) {
+                                                       delete[] reinterpret_cast<char *>(block);
+                                                       freed++;
+                                                   });
+        };
+    }
+
+    std::atomic<uint32_t> allocated;
+    std::atomic<uint32_t> freed;
+};
+
+static void configure(size_t budget, uint32_t idle_ms, uint32_t wait_ms) {
+    C2BrokerConfig config;
+    config.budget_bytes = budget;
+    config.idle_ms = idle_ms;
+    config.wait_ms = wait_ms;
+    C2BufferBroker &broker = C2BufferBroker::Instance();
+    broker.Configure(config);
+    broker.Trim();
+}
+
+static std::shared_ptr<C2GraphicBlock> acquire(uint32_t client, uint32_t width,
+                                               FakeAllocator &allocator) {
+    return C2BufferBroker::Instance().Acquire(client, width, HEIGHT, C2PixelFormat::kNV12, 0,
+                                              allocator.Get(width * HEIGHT * 3 / 2));
+}
+
+static bool check_sharing() {
+    configure(0, 60000, 100);
+    C2BufferBroker &broker = C2BufferBroker::Instance();
+    FakeAllocator allocator;
+    uint32_t first = broker.Register("first");
+    uint32_t second = broker.Register("second");
+
+    C2BrokerUsage before;
+    broker.GetUsage(before);
+
+    // A block released by one engine is reused by another of the same geometry.
+    std::shared_ptr<C2GraphicBlock> block = acquire(first, WIDTH, allocator);
+    C2GraphicBlock *raw = block.get();
+    block.reset();
+    block = acquire(second, WIDTH, allocator);
+    bool ok = check(block.get() == raw && allocator.allocated == 1, "block shared");
+
+    // Other geometries and usages are not mixed.
+    std::shared_ptr<C2GraphicBlock> other = acquire(second, WIDTH / 2, allocator);
+    ok = ok && check(allocator.allocated == 2, "geometry separated");
+
+    C2BrokerUsage usage;
+    broker.GetUsage(usage);
+    ok = ok && check(usage.hits - before.hits == 1 && usage.misses - before.misses == 2, "hits");
+    ok = ok && check(usage.in_use == BLOCK_SIZE + BLOCK_SIZE / 2, "in use bytes");
+    for (auto &client : usage.clients) {
+        if (client.id == second) {
+            ok = ok && check(client.bytes == BLOCK_SIZE + BLOCK_SIZE / 2, "client bytes");
+        }
+    }
+
+    block.reset();
+    other.reset();
+    broker.GetUsage(usage);
+    ok = ok && check(usage.in_use == 0 && usage.cached == usage.current, "released to cache");
+    ok = ok && check(broker.Trim() == BLOCK_SIZE + BLOCK_SIZE / 2 && allocator.freed == 2,
+                     "trim frees the cache");
+
+    broker.Unregister(first);
+    broker.Unregister(second);
+    return ok;
+}
+
+static bool check_budget() {
+    configure(3 * BLOCK_SIZE, 60000, 50);
+    C2BufferBroker &broker = C2BufferBroker::Instance();
+    FakeAllocator allocator;
+    uint32_t client = broker.Register("budget");
+
+    // Idle blocks of other geometries make room for a new one.
+    std::vector<std::shared_ptr<C2GraphicBlock>> blocks;
+    for (uint32_t idx = 0; idx < 3; idx++) {
+        blocks.push_back(acquire(client, WIDTH, allocator));
+    }
+    blocks.clear();
+
+    C2BrokerUsage before;
+    broker.GetUsage(before);
+    std::shared_ptr<C2GraphicBlock> wide = acquire(client, WIDTH * 2, allocator);
+    C2BrokerUsage usage;
+    broker.GetUsage(usage);
+    bool ok = check(wide != nullptr && usage.evictions - before.evictions == 2, "evicted");
+    ok = ok && check(usage.current <= usage.budget && usage.peak <= usage.budget, "within budget");
+
+    // Over budget with every block in use, the fetch waits then fails.
+    std::shared_ptr<C2GraphicBlock> last = acquire(client, WIDTH, allocator);
+    std::shared_ptr<C2GraphicBlock> none = acquire(client, WIDTH, allocator);
+    broker.GetUsage(usage);
+    ok = ok && check(last != nullptr && none == nullptr, "backpressure fails on timeout");
+    ok = ok && check(usage.failures - before.failures == 1, "failure counted");
+
+    // A release during the wait serves the waiting fetch.
+    configure(3 * BLOCK_SIZE, 60000, 2000);
+    std::shared_ptr<C2GraphicBlock> served;
+    std::thread waiter([&] { served = acquire(client, WIDTH, allocator); });
+    usleep(50000);
+    last.reset();
+    waiter.join();
+    ok = ok && check(served != nullptr, "served after release");
+
+    served.reset();
+    wide.reset();
+    broker.Unregister(client);
+    broker.Trim();
+    return ok;
+}
+
+static bool check_fairness() {
+    configure(4 * BLOCK_SIZE, 60000, 300);
+    C2BufferBroker &broker = C2BufferBroker::Instance();
+    FakeAllocator allocator;
+    uint32_t greedy = broker.Register("greedy");
+    uint32_t modest = broker.Register("modest");
+
+    // The greedy client took three blocks while memory was free, above its share of two.
+    std::vector<std::shared_ptr<C2GraphicBlock>> held;
+    for (uint32_t idx = 0; idx < 3; idx++) {
+        held.push_back(acquire(greedy, WIDTH, allocator));
+    }
+    std::shared_ptr<C2GraphicBlock> own = acquire(modest, WIDTH / 2, allocator);
+
+    std::shared_ptr<C2GraphicBlock> greedy_block, modest_block;
+    std::thread over([&] { greedy_block = acquire(greedy, WIDTH * 2, allocator); });
+    std::thread under([&] { modest_block = acquire(modest, WIDTH, allocator); });
+    usleep(50000);
+
+    // Room for the smaller block only, it goes to the client below its quota.
+    held.pop_back();
+    held.pop_back();
+    over.join();
+    under.join();
+
+    bool ok = check(modest_block != nullptr, "client under quota served");
+    ok = ok && check(greedy_block == nullptr, "client over quota held back");
+
+    C2BrokerUsage usage;
+    broker.GetUsage(usage);
+    for (auto &client : usage.clients) {
+        ok = ok && check(client.quota == 2 * BLOCK_SIZE, "fair quota");
+        ok = ok && check(client.waits == 1, "waits per client");
+    }
+    base::LogInfo() << "broker usage: current " << usage.current << ", peak " << usage.peak
+                    << ", in use " << usage.in_use << ", cached " << usage.cached;
+
+    held.clear();
+    own.reset();
+    greedy_block.reset();
+    modest_block.reset();
+    broker.Unregister(greedy);
+    broker.Unregister(modest);
+    broker.Trim();
+    return ok;
+}
+
+static uint64_t process_cpu_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static bool check_waiters_blocked() {
+    configure(6 * BLOCK_SIZE, 60000, 300);
+    C2BufferBroker &broker = C2BufferBroker::Instance();
+    FakeAllocator allocator;
+    uint32_t holder = broker.Register("holder");
+    uint32_t first = broker.Register("first");
+    uint32_t second = broker.Register("second");
+    uint32_t extra = broker.Register("extra");
+
+    std::vector<std::shared_ptr<C2GraphicBlock>> held;
+    for (uint32_t idx = 0; idx < 6; idx++) {
+        held.push_back(acquire(holder, WIDTH, allocator));
+    }
+
+    // Two waiters below their quota, woken once without memory becoming available.
+    uint64_t begin = process_cpu_us();
+    std::shared_ptr<C2GraphicBlock> first_block, second_block;
+    std::thread first_waiter([&] { first_block = acquire(first, WIDTH, allocator); });
+    std::thread second_waiter([&] { second_block = acquire(second, WIDTH, allocator); });
+    usleep(50000);
+    broker.Unregister(extra);
+    first_waiter.join();
+    second_waiter.join();
+    uint64_t cpu = process_cpu_us() - begin;
+
+    bool ok = check(first_block == nullptr && second_block == nullptr, "waiters time out");
+    ok = ok && check(cpu < 30000, "waiters do not spin");
+    base::LogInfo() << "two blocked waiters used " << cpu << " us of CPU in 300 ms";
+
+    held.clear();
+    broker.Unregister(holder);
+    broker.Unregister(first);
+    broker.Unregister(second);
+    broker.Trim();
+    return ok;
+}
+
+static bool check_idle() {
+    configure(0, 20, 100);
+    C2BufferBroker &broker = C2BufferBroker::Instance();
+    FakeAllocator allocator;
+    uint32_t client = broker.Register("idle");
+
+    acquire(client, WIDTH, allocator).reset();
+    usleep(50000);
+
+    // Any fetch frees the blocks idle for too long.
+    std::shared_ptr<C2GraphicBlock> block = acquire(client, WIDTH / 2, allocator);
+    bool ok = check(allocator.freed == 1, "idle block freed");
+
+    block.reset();
+    broker.Unregister(client);
+    broker.Trim();
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    if (!check_sharing() || !check_budget() || !check_fairness() ||
+        !check_waiters_blocked() || !check_idle()) {
+        return 1;
+    }
+
+    base::LogInfo() << "Buffer broker checks passed";
+    return 0;
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <C2PlatformSupport.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "c2_test_component.h"
+#include "src/c2_work_log.h"
+
+/** ReplayComponent
+ *
+ * Stand-in component returning the n-th queued work the way the n-th work of
+ * a recorded work log was returned: after the recorded latency, in as many
+ * slices, with outputs of the recorded sizes. Work without recorded
+ * completion is held until flushed. The time spent in the listener, i.e. the
+ * callback overhead of the layer above, is measured.
+ **/
+class ReplayComponent : public C2Component, public std::enable_shared_from_this<ReplayComponent> {
+public:
+    struct Completion {
+        /// Microseconds after the work was queued.
+        uint64_t delay;
+        C2WorkLogEvent event;
+        uint32_t flags;
+        uint32_t size;
+    };
+
+    /**
+     * @brief Completions of every queued work, in queue order.
+     */
+    static std::vector<std::vector<Completion>> Plan(const std::vector<C2WorkLogRecord> &records) {
+        std::vector<std::vector<Completion>> plan;
+        std::vector<uint64_t> queued;
+        // Recorded frame index to queue position of the work in flight.
+        std::unordered_map<uint64_t, size_t> in_flight;
+
+        for (const C2WorkLogRecord &record : records) {
+            auto event = static_cast<C2WorkLogEvent>(record.event);
+            if (event == C2WorkLogEvent::kQueue) {
+                in_flight[record.index] = plan.size();
+                plan.emplace_back();
+                queued.push_back(record.time);
+                continue;
+            }
+            if (event != C2WorkLogEvent::kDone && event != C2WorkLogEvent::kDrop &&
+                event != C2WorkLogEvent::kEOS) {
+                continue;
+            }
+
+            auto it = in_flight.find(record.index);
+            if (it == in_flight.end()) {
+                continue;
+            }
+            plan[it->second].push_back(
+                {record.time - queued[it->second], event, record.flags, record.size});
+            if (event != C2WorkLogEvent::kDone || !(record.flags & C2FrameData::FLAG_INCOMPLETE)) {
+                in_flight.erase(it);
+            }
+        }
+        return plan;
+    }
+
+    ReplayComponent(const C2String &name, const std::vector<C2WorkLogRecord> &records)
+        : interface_(std::make_shared<FakeInterface>(name)),
+          plan_(Plan(records)),
+          queued_(0),
+          running_(true) {
+        thread_ = std::thread(&ReplayComponent::Loop, this);
+    }
+
+    ~ReplayComponent() { release(); }
+
+    /**
+     * @brief Durations of the listener calls in nanoseconds.
+     */
+    std::vector<uint64_t> GetCallbackTimes() {
+        std::lock_guard<std::mutex> lk(lock_);
+        return callback_times_;
+    }
+
+    c2_status_t setListener_vb(const std::shared_ptr<Listener> &listener,
+                               c2_blocking_t mayBlock) override {
+        std::lock_guard<std::mutex> lk(lock_);
+        listener_ = listener;
+        return C2_OK;
+    }
+
+    c2_status_t queue_nb(std::list<std::unique_ptr<C2Work>> *const items) override {
+        std::lock_guard<std::mutex> lk(lock_);
+        Clock::time_point now = Clock::now();
+
+        for (auto &work : *items) {
+            work->worklets.front()->output.ordinal = work->input.ordinal;
+            uint64_t id = queued_++;
+
+            if (id < plan_.size()) {
+                const std::vector<Completion> &completions = plan_[id];
+                for (size_t idx = 0; idx < completions.size(); idx++) {
+                    Clock::time_point due = now + std::chrono::microseconds(completions[idx].delay);
+                    scheduled_.emplace(due, std::make_pair(id, idx));
+                }
+            }
+            works_[id] = std::move(work);
+        }
+        items->clear();
+        wakeup_.notify_all();
+        return C2_OK;
+    }
+
+    c2_status_t announce_nb(const std::vector<C2WorkOutline> &items) override {
+        return C2_OMITTED;
+    }
+
+    c2_status_t flush_sm(flush_mode_t mode,
+                         std::list<std::unique_ptr<C2Work>> *const flushedWork) override {
+        std::lock_guard<std::mutex> lk(lock_);
+        for (auto &entry : works_) {
+            flushedWork->push_back(std::move(entry.second));
+        }
+        works_.clear();
+        scheduled_.clear();
+        return C2_OK;
+    }
+
+    c2_status_t drain_nb(drain_mode_t mode) override { return C2_OK; }
+
+    c2_status_t start() override { return C2_OK; }
+
+    c2_status_t stop() override {
+        std::lock_guard<std::mutex> lk(lock_);
+        works_.clear();
+        scheduled_.clear();
+        return C2_OK;
+    }
+
+    c2_status_t reset() override { return stop(); }
+
+    c2_status_t release() override {
+        {
+            std::lock_guard<std::mutex> lk(lock_);
+            if (!running_) {
+                return C2_OK;
+            }
+            running_ = false;
+            listener_.reset();
+        }
+        wakeup_.notify_all();
+        thread_.join();
+        return C2_OK;
+    }
+
+    std::shared_ptr<C2ComponentInterface> intf() override { return interface_; }
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Loop() {
+        std::unique_lock<std::mutex> lk(lock_);
+        while (running_) {
+            if (scheduled_.empty()) {
+                wakeup_.wait(lk);
+                continue;
+            }
+            auto next = scheduled_.begin();
+            if (next->first > Clock::now()) {
+                wakeup_.wait_until(lk, next->first);
+                continue;
+            }
+
+            uint64_t id = next->second.first;
+            const Completion &completion = plan_[id][next->second.second];
+            bool last = next->second.second + 1 == plan_[id].size();
+            scheduled_.erase(next);
+
+            auto it = works_.find(id);
+            if (it == works_.end()) {
+                continue;
+            }
+
+            // Every slice but the last one is returned in a work of its own.
+            std::unique_ptr<C2Work> work;
+            if (last) {
+                work = std::move(it->second);
+                works_.erase(it);
+            } else {
+                work = std::make_unique<C2Work>();
+                work->input.ordinal = it->second->input.ordinal;
+                work->worklets.emplace_back(std::make_unique<C2Worklet>());
+                work->worklets.front()->output.ordinal = it->second->input.ordinal;
+            }
+            work->workletsProcessed = 1;
+            std::shared_ptr<Listener> listener = listener_;
+
+            lk.unlock();
+            C2FrameData &output = work->worklets.front()->output;
+            output.flags = static_cast<C2FrameData::flags_t>(completion.flags);
+            if (completion.event == C2WorkLogEvent::kDone) {
+                std::shared_ptr<C2Buffer> buffer = CreateOutput(completion.size);
+                if (buffer) {
+                    output.buffers.push_back(buffer);
+                }
+            }
+
+            std::list<std::unique_ptr<C2Work>> done;
+            done.push_back(std::move(work));
+            Clock::time_point begin = Clock::now();
+            if (listener) {
+                listener->onWorkDone_nb(weak_from_this(), std::move(done));
+            }
+            uint64_t duration =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+            lk.lock();
+            callback_times_.push_back(duration);
+        }
+    }
+
+    std::shared_ptr<C2Buffer> CreateOutput(uint32_t size) {
+        if (size == 0 || (!pool_ && ::android::GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR,
+                                                                   nullptr, &pool_) != C2_OK)) {
+            return nullptr;
+        }
+
+        std::shared_ptr<C2LinearBlock> block;
+        C2MemoryUsage usage = {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE};
+        if (pool_->fetchLinearBlock(size, usage, &block) != C2_OK) {
+            return nullptr;
+        }
+
+        C2WriteView view = block->map().get();
+        if (view.error() != C2_OK) {
+            return nullptr;
+        }
+        memset(view.data(), 0, size);
+        return C2Buffer::CreateLinearBuffer(block->share(0, size, ::C2Fence()));
+    }
+
+    std::shared_ptr<FakeInterface> interface_;
+    std::shared_ptr<Listener> listener_;
+    const std::vector<std::vector<Completion>> plan_;
+
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    /// Work in flight by queue position.
+    std::unordered_map<uint64_t, std::unique_ptr<C2Work>> works_;
+    /// Queue position and completion of the work, by due time.
+    std::multimap<Clock::time_point, std::pair<uint64_t, size_t>> scheduled_;
+    uint64_t queued_;
+    std::vector<uint64_t> callback_times_;
+    /// Accessed from the worker thread only.
+    std::shared_ptr<C2BlockPool> pool_;
+    bool running_;
+    std::thread thread_;
+};
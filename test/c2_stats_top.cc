@@ -0,0 +1,149 @@
+#include <dirent.h>
+#include <getopt.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/c2_stats_segment.h"
+
+/// Updates older than this are shown as stale.
+#define STALE_US 2000000
+
+static void usage(const char *name) {
+    std::cout << "Usage: " << name << " [options]\n"
+              << "  -p, --pid <pid>        process publishing the stats (default: only one)\n"
+              << "  -s, --segment <name>   shared memory name instead of the pid\n"
+              << "  -i, --interval <ms>    refresh period (default 1000)\n"
+              << "  -n, --count <updates>  exit after the given number of updates\n";
+}
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+// Segments found in /dev/shm, by shared memory name.
+static std::vector<std::string> find_segments() {
+    std::vector<std::string> segments;
+    DIR *dir = opendir("/dev/shm");
+    if (dir == nullptr) {
+        return segments;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        if (strncmp(entry->d_name, C2_STATS_SEGMENT_PREFIX, strlen(C2_STATS_SEGMENT_PREFIX)) == 0) {
+            segments.push_back(std::string("/") + entry->d_name);
+        }
+    }
+    closedir(dir);
+    return segments;
+}
+
+static void print(const C2StatsSegment &segment) {
+    const C2StatsSegmentHeader *header = segment.GetHeader();
+    C2StatsProcessData process;
+    bool alive = kill(header->pid, 0) == 0 || errno != ESRCH;
+
+    std::cout << "pid " << header->pid << (alive ? "" : " (exited)");
+    if (segment.ReadProcess(process)) {
+        std::cout << ", " << process.engines << " engines, pool " << (process.pool_current >> 20)
+                  << "/" << (process.pool_budget >> 20) << " MB, in use "
+                  << (process.pool_in_use >> 20) << " MB, cached " << (process.pool_cached >> 20)
+                  << " MB, failures " << process.pool_failures;
+    }
+    std::cout << "\n";
+
+    std::cout << std::left << std::setw(28) << "engine" << std::right << std::setw(8) << "fps"
+              << std::setw(10) << "queued" << std::setw(10) << "done" << std::setw(8) << "drop"
+              << std::setw(7) << "err" << std::setw(7) << "fly" << std::setw(7) << "wait"
+              << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms" << std::setw(8) << "pool MB"
+              << "\n";
+
+    uint64_t now = now_us();
+    for (uint32_t slot = 0; slot < segment.GetMaxEngines(); slot++) {
+        C2StatsEngineData data;
+        if (!segment.ReadEngine(slot, data) || !data.active) {
+            continue;
+        }
+
+        std::string name = std::string(data.name) + "#" + std::to_string(data.id);
+        if (now > data.updated + STALE_US) {
+            name += " (stale)";
+        }
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(8) << data.fps << std::setw(10)
+                  << data.stats.queued << std::setw(10) << data.stats.completed << std::setw(8)
+                  << data.stats.dropped + data.stats.expired << std::setw(7) << data.stats.errors
+                  << std::setw(7) << data.stats.in_flight << std::setw(7) << data.waiting
+                  << std::setprecision(2) << std::setw(9) << data.stats.latency_p50 / 1000.0
+                  << std::setw(9) << data.stats.latency_p99 / 1000.0 << std::setw(8)
+                  << (data.pool_bytes >> 20) << "\n";
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::string name;
+    uint32_t interval_ms = 1000;
+    uint64_t count = 0;
+
+    const struct option options[] = {
+        {"pid", required_argument, nullptr, 'p'},
+        {"segment", required_argument, nullptr, 's'},
+        {"interval", required_argument, nullptr, 'i'},
+        {"count", required_argument, nullptr, 'n'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "p:s:i:n:", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'p':
+                name = C2StatsSegment::GetName(atoi(optarg));
+                break;
+            case 's':
+                name = optarg;
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 'n':
+                count = strtoull(optarg, nullptr, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (name.empty()) {
+        std::vector<std::string> segments = find_segments();
+        if (segments.size() != 1) {
+            std::cerr << segments.size() << " stats segments found, select one with -p or -s\n";
+            for (const std::string &segment : segments) {
+                std::cerr << "  " << segment << "\n";
+            }
+            return 1;
+        }
+        name = segments.front();
+    }
+
+    C2StatsSegment segment;
+    if (!segment.Open(name)) {
+        return 1;
+    }
+
+    for (uint64_t update = 0; count == 0 || update < count; update++) {
+        if (update > 0) {
+            usleep(interval_ms * 1000);
+        }
+        print(segment);
+    }
+    return 0;
+}
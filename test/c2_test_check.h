@@ -0,0 +1,14 @@
+#pragma once
+
+#include "base/log.h"
+
+/**
+ * @brief Log a failed test condition.
+ * @return The condition, for chaining with &&.
+ */
+inline bool check(bool condition, const char *what) {
+    if (!condition) {
+        base::LogError() << "Check failed: " << what;
+    }
+    return condition;
+}
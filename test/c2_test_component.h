@@ -0,0 +1,267 @@
+#pragma once
+
+#include <C2PlatformSupport.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "src/c2_module.h"
+
+/**
+ * @brief How a FakeComponent misbehaves after Hang()
+*/
+enum class HangMode : uint32_t {
+    kNone,
+    /// Work is held until the component is flushed.
+    kUntilFlush,
+    /// Work is held and lost on flush, a stop clears the hang.
+    kUntilRestart,
+    /// Work is held until the instance is released.
+    kForever,
+};
+
+/** FakeInterface
+ *
+ * Accepts every parameter, queries are not supported. Supported values are
+ * answered by the handler given to SetSupportedValues(), if any.
+ **/
+class FakeInterface : public C2ComponentInterface {
+public:
+    using SupportedValuesHandler =
+        std::function<c2_status_t(std::vector<C2FieldSupportedValuesQuery> &fields)>;
+
+    explicit FakeInterface(const C2String &name) : name_(name) {}
+
+    void SetSupportedValues(SupportedValuesHandler handler) { supported_values_ = handler; }
+
+    C2String getName() const override { return name_; }
+
+    c2_status_t query_vb(const std::vector<C2Param *> &stackParams,
+                         const std::vector<C2Param::Index> &heapParamIndices,
+                         c2_blocking_t mayBlock,
+                         std::vector<std::unique_ptr<C2Param>> *const heapParams) const override {
+        return C2_OMITTED;
+    }
+
+    c2_status_t config_vb(const std::vector<C2Param *> &params, c2_blocking_t mayBlock,
+                          std::vector<std::unique_ptr<C2SettingResult>> *const failures) override {
+        return C2_OK;
+    }
+
+    c2_status_t querySupportedParams_nb(
+        std::vector<std::shared_ptr<C2ParamDescriptor>> *const params) const override {
+        return C2_OMITTED;
+    }
+
+    c2_status_t querySupportedValues_vb(std::vector<C2FieldSupportedValuesQuery> &fields,
+                                        c2_blocking_t mayBlock) const override {
+        return supported_values_ ? supported_values_(fields) : C2_OMITTED;
+    }
+private:
+    C2String name_;
+    SupportedValuesHandler supported_values_;
+};
+
+/** FakeComponent
+ *
+ * Stand-in encoder returning every queued work from a worker thread, without
+ * output unless SetOutput() was called, the engine then sees them as dropped
+ * frames. Hang() makes it hold work, SetInputFilter() rejects it.
+ **/
+class FakeComponent : public C2Component, public std::enable_shared_from_this<FakeComponent> {
+public:
+    /// Encoded data returned for the frame of the given index.
+    using OutputGenerator = std::function<std::vector<uint8_t>(uint64_t index)>;
+    /// Sees every queued work, any status other than C2_OK fails queue_nb().
+    using InputFilter = std::function<c2_status_t(const C2Work &work)>;
+
+    explicit FakeComponent(const C2String &name)
+        : interface_(std::make_shared<FakeInterface>(name)),
+          hang_(HangMode::kNone),
+          running_(true),
+          sync_requests_(0) {
+        thread_ = std::thread(&FakeComponent::Loop, this);
+    }
+
+    ~FakeComponent() { release(); }
+
+    void Hang(HangMode mode) {
+        std::lock_guard<std::mutex> lk(lock_);
+        hang_ = mode;
+    }
+
+    void SetOutput(OutputGenerator generator) {
+        std::lock_guard<std::mutex> lk(lock_);
+        generator_ = generator;
+    }
+
+    void SetInputFilter(InputFilter filter) {
+        std::lock_guard<std::mutex> lk(lock_);
+        filter_ = filter;
+    }
+
+    uint32_t GetSyncRequests() { return sync_requests_; }
+
+    /// Set before the component is handed to the engine.
+    std::shared_ptr<FakeInterface> GetInterface() { return interface_; }
+
+    c2_status_t setListener_vb(const std::shared_ptr<Listener> &listener,
+                               c2_blocking_t mayBlock) override {
+        std::lock_guard<std::mutex> lk(lock_);
+        listener_ = listener;
+        return C2_OK;
+    }
+
+    c2_status_t queue_nb(std::list<std::unique_ptr<C2Work>> *const items) override {
+        std::lock_guard<std::mutex> lk(lock_);
+        for (auto &work : *items) {
+            c2_status_t status = filter_ ? filter_(*work) : C2_OK;
+            if (status != C2_OK) {
+                return status;
+            }
+        }
+
+        for (auto &work : *items) {
+            for (auto &tuning : work->worklets.front()->tunings) {
+                if (tuning->index() == C2StreamRequestSyncFrameTuning::output::PARAM_TYPE) {
+                    sync_requests_++;
+                }
+            }
+            work->worklets.front()->output.ordinal = work->input.ordinal;
+
+            if (hang_ != HangMode::kNone) {
+                held_.push_back(std::move(work));
+            } else {
+                ready_.push_back(std::move(work));
+            }
+        }
+        items->clear();
+        wakeup_.notify_all();
+        return C2_OK;
+    }
+
+    c2_status_t announce_nb(const std::vector<C2WorkOutline> &items) override {
+        return C2_OMITTED;
+    }
+
+    c2_status_t flush_sm(flush_mode_t mode,
+                         std::list<std::unique_ptr<C2Work>> *const flushedWork) override {
+        std::lock_guard<std::mutex> lk(lock_);
+        for (; !ready_.empty(); ready_.pop_front()) {
+            flushedWork->push_back(std::move(ready_.front()));
+        }
+        if (hang_ == HangMode::kUntilFlush) {
+            for (; !held_.empty(); held_.pop_front()) {
+                flushedWork->push_back(std::move(held_.front()));
+            }
+            hang_ = HangMode::kNone;
+        }
+        return C2_OK;
+    }
+
+    c2_status_t drain_nb(drain_mode_t mode) override { return C2_OK; }
+
+    c2_status_t start() override { return C2_OK; }
+
+    c2_status_t stop() override {
+        std::lock_guard<std::mutex> lk(lock_);
+        ready_.clear();
+        held_.clear();
+        if (hang_ == HangMode::kUntilRestart) {
+            hang_ = HangMode::kNone;
+        }
+        return C2_OK;
+    }
+
+    c2_status_t reset() override { return stop(); }
+
+    c2_status_t release() override {
+        {
+            std::lock_guard<std::mutex> lk(lock_);
+            if (!running_) {
+                return C2_OK;
+            }
+            running_ = false;
+            listener_.reset();
+        }
+        wakeup_.notify_all();
+        thread_.join();
+        return C2_OK;
+    }
+
+    std::shared_ptr<C2ComponentInterface> intf() override { return interface_; }
+private:
+    void Loop() {
+        std::unique_lock<std::mutex> lk(lock_);
+        while (running_) {
+            if (ready_.empty()) {
+                wakeup_.wait(lk);
+                continue;
+            }
+
+            std::list<std::unique_ptr<C2Work>> done;
+            done.push_back(std::move(ready_.front()));
+            ready_.pop_front();
+            done.front()->workletsProcessed = 1;
+            std::shared_ptr<Listener> listener = listener_;
+            OutputGenerator generator = generator_;
+
+            lk.unlock();
+            if (generator) {
+                std::unique_ptr<C2Worklet> &worklet = done.front()->worklets.front();
+                std::shared_ptr<C2Buffer> buffer =
+                    CreateOutput(generator(worklet->output.ordinal.frameIndex.peeku()));
+                if (buffer) {
+                    worklet->output.buffers.push_back(buffer);
+                }
+            }
+            if (listener) {
+                listener->onWorkDone_nb(weak_from_this(), std::move(done));
+            }
+            lk.lock();
+        }
+    }
+
+    std::shared_ptr<C2Buffer> CreateOutput(const std::vector<uint8_t> &data) {
+        if (!pool_ && ::android::GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, nullptr, &pool_) !=
+                          C2_OK) {
+            return nullptr;
+        }
+
+        std::shared_ptr<C2LinearBlock> block;
+        C2MemoryUsage usage = {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE};
+        if (pool_->fetchLinearBlock(data.size(), usage, &block) != C2_OK) {
+            return nullptr;
+        }
+
+        C2WriteView view = block->map().get();
+        if (view.error() != C2_OK) {
+            return nullptr;
+        }
+        memcpy(view.data(), data.data(), data.size());
+        return C2Buffer::CreateLinearBuffer(block->share(0, data.size(), ::C2Fence()));
+    }
+
+    std::shared_ptr<FakeInterface> interface_;
+    std::shared_ptr<Listener> listener_;
+
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::deque<std::unique_ptr<C2Work>> ready_;
+    std::deque<std::unique_ptr<C2Work>> held_;
+    HangMode hang_;
+    OutputGenerator generator_;
+    InputFilter filter_;
+    /// Accessed from the worker thread only.
+    std::shared_ptr<C2BlockPool> pool_;
+    bool running_;
+    std::thread thread_;
+
+    std::atomic<uint32_t> sync_requests_;
+};
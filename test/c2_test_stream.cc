@@ -0,0 +1,204 @@
+#include "c2_test_stream.h"
+
+#include <C2Work.h>
+
+/** BitWriter
+ *
+ * MSB first bit writer producing an RBSP, emulation prevention is applied
+ * when the payload is converted into a NAL unit.
+ **/
+class BitWriter {
+public:
+    void Bits(uint32_t value, uint32_t count) {
+        for (uint32_t idx = count; idx > 0; idx--) {
+            Bit((value >> (idx - 1)) & 1);
+        }
+    }
+
+    void Bit(uint32_t bit) {
+        current_ = (current_ << 1) | bit;
+        if (++count_ == 8) {
+            data_.push_back(current_);
+            current_ = 0;
+            count_ = 0;
+        }
+    }
+
+    void Ue(uint32_t value) {
+        uint32_t code = value + 1;
+        uint32_t length = 32 - __builtin_clz(code);
+        Bits(0, length - 1);
+        Bits(code, length);
+    }
+
+    // rbsp_trailing_bits() and emulation prevention.
+    std::vector<uint8_t> Finish(const std::vector<uint8_t> &header) {
+        Bit(1);
+        while (count_ != 0) {
+            Bit(0);
+        }
+
+        std::vector<uint8_t> nal = header;
+        uint32_t zeros = 0;
+        for (uint8_t value : data_) {
+            if (zeros >= 2 && value <= 3) {
+                nal.push_back(0x03);
+                zeros = 0;
+            }
+            nal.push_back(value);
+            zeros = (value == 0) ? zeros + 1 : 0;
+        }
+        return nal;
+    }
+private:
+    std::vector<uint8_t> data_;
+    uint32_t current_ = 0;
+    uint32_t count_ = 0;
+};
+
+C2TestStream::C2TestStream(bool hevc, uint32_t width, uint32_t height, uint32_t seed)
+    : hevc_(hevc), seed_(seed) {
+    if (hevc_) {
+        vps_ = {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90,
+                0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x5D, 0x95, 0x98, 0x09};
+        BuildHevcSps(width, height);
+        pps_ = {0x44, 0x01, 0xC1, 0x72, 0xB4, 0x62, 0x40};
+    } else {
+        sps_ = {0x67, 0x42, 0xC0, 0x28, 0xDA, 0x01, 0xE0, 0x08, 0x9F, 0x96, 0x10, 0x00,
+                0x00, 0x03, 0x00, 0x10, 0x00, 0x00, 0x03, 0x03, 0xC8, 0xF1, 0x83, 0x2A};
+        pps_ = {0x68, 0xCE, 0x3C, 0x80};
+    }
+}
+
+void C2TestStream::BuildHevcSps(uint32_t width, uint32_t height) {
+    BitWriter writer;
+
+    writer.Bits(0, 4);  // sps_video_parameter_set_id
+    writer.Bits(0, 3);  // sps_max_sub_layers_minus1
+    writer.Bit(1);      // sps_temporal_id_nesting_flag
+
+    // profile_tier_level: Main profile, level 4.1.
+    writer.Bits(0, 2);
+    writer.Bit(0);
+    writer.Bits(1, 5);
+    writer.Bits(0x60000000, 32);
+    writer.Bits(0x90, 8);
+    writer.Bits(0, 32);
+    writer.Bits(0, 8);
+    writer.Bits(123, 8);
+
+    writer.Ue(0);  // sps_seq_parameter_set_id
+    writer.Ue(1);  // chroma_format_idc
+    writer.Ue(width);
+    writer.Ue(height);
+    writer.Bit(0);  // conformance_window_flag
+    writer.Ue(0);   // bit_depth_luma_minus8
+    writer.Ue(0);   // bit_depth_chroma_minus8
+    writer.Ue(4);   // log2_max_pic_order_cnt_lsb_minus4
+
+    sps_ = writer.Finish({0x42, 0x01});
+}
+
+void C2TestStream::Append(std::vector<uint8_t> &au, const std::vector<uint8_t> &nal) {
+    au.insert(au.end(), {0x00, 0x00, 0x00, 0x01});
+    au.insert(au.end(), nal.begin(), nal.end());
+}
+
+std::vector<uint8_t> C2TestStream::ParameterSets() {
+    std::vector<uint8_t> au;
+    if (hevc_) {
+        Append(au, vps_);
+    }
+    Append(au, sps_);
+    Append(au, pps_);
+    return au;
+}
+
+std::vector<uint8_t> C2TestStream::AccessUnit(bool sync, size_t payload_size, bool config) {
+    std::vector<uint8_t> au;
+
+    if (sync && config) {
+        au = ParameterSets();
+    }
+
+    // Slice header bytes: IDR_W_RADL/TRAIL_R for H.265, IDR/non-IDR for H.264.
+    std::vector<uint8_t> slice;
+    if (hevc_) {
+        slice = sync ? std::vector<uint8_t>{0x26, 0x01} : std::vector<uint8_t>{0x02, 0x01};
+    } else {
+        slice = sync ? std::vector<uint8_t>{0x65} : std::vector<uint8_t>{0x41};
+    }
+
+    uint32_t zeros = 0;
+    for (size_t idx = 0; idx < payload_size; idx++) {
+        // xorshift32, with a bias towards zero bytes.
+        seed_ ^= seed_ << 13;
+        seed_ ^= seed_ >> 17;
+        seed_ ^= seed_ << 5;
+        uint8_t value = ((seed_ & 0x700) == 0) ? 0 : static_cast<uint8_t>(seed_);
+
+        if (zeros >= 2 && value <= 3) {
+            slice.push_back(0x03);
+            zeros = 0;
+        }
+        slice.push_back(value);
+        zeros = (value == 0) ? zeros + 1 : 0;
+    }
+    slice.push_back(0x80);
+
+    Append(au, slice);
+    return au;
+}
+
+C2TestEncoder::C2TestEncoder(const C2TestEncoderConfig &config)
+    : config_(config),
+      stream_(false, 1280, 720),
+      parser_(C2CodecType::H264VideoEncode),
+      config_sent_(config.config_mode != C2TestConfigMode::kBuffer),
+      index_(0) {
+    if (config_.config_mode == C2TestConfigMode::kAttached) {
+        std::vector<uint8_t> config_sets = stream_.ParameterSets();
+        C2AccessUnitInfo info;
+        parser_.Parse(config_sets.data(), config_sets.size(), info);
+    }
+}
+
+void C2TestEncoder::Encode(IC2OutputSink &sink, bool sync) {
+    if (!config_sent_) {
+        // Shares the index and timestamp of the first frame.
+        Deliver(sink, stream_.ParameterSets(), C2FrameData::FLAG_CODEC_CONFIG);
+        config_sent_ = true;
+    }
+
+    std::vector<uint8_t> au =
+        stream_.AccessUnit(sync, config_.payload_size + index_ % 100,
+                           config_.config_mode == C2TestConfigMode::kInline);
+    Deliver(sink, au, 0);
+    encoded[index_++] = au;
+}
+
+void C2TestEncoder::EncodeFrames(IC2OutputSink &sink, uint32_t count) {
+    for (uint32_t idx = 0; idx < count; idx++) {
+        Encode(sink, index_ % config_.gop_size == 0);
+    }
+}
+
+void C2TestEncoder::Deliver(IC2OutputSink &sink, const std::vector<uint8_t> &data,
+                            uint32_t flags) {
+    C2EncodedFrame frame;
+    frame.data = data.data();
+    frame.size = data.size();
+    frame.index = index_;
+    frame.timestamp = index_ * config_.frame_duration_us;
+    frame.flags = flags;
+    frame.config = nullptr;
+    frame.config_version = 0;
+    parser_.Parse(data.data(), data.size(), frame.au);
+    if (!parser_.GetCodecConfig().sps.empty()) {
+        frame.config = &parser_.GetCodecConfig();
+        frame.config_version = parser_.GetConfigVersion();
+    }
+
+    sink.OnFrame(frame);
+    bitstream.insert(bitstream.end(), data.begin(), data.end());
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "src/c2_nal_parser.h"
+#include "src/c2_output_sink.h"
+
+/** C2TestStream
+ *
+ * Generator of synthetic H.264/H.265 Annex-B access units for the tests and
+ * benchmarks. Parameter sets are syntactically valid so that configuration
+ * records can be built from them, slice payloads are random.
+ **/
+class C2TestStream {
+public:
+    C2TestStream(bool hevc, uint32_t width, uint32_t height, uint32_t seed = 1);
+    ~C2TestStream(){};
+
+    /**
+     * @brief Build one access unit. Sync frames carry the parameter sets.
+     * @param sync: Generate an IDR access unit.
+     * @param payload_size: Approximate size of the slice payload.
+     * @param config: Prepend the parameter sets to sync frames.
+     */
+    std::vector<uint8_t> AccessUnit(bool sync, size_t payload_size, bool config = true);
+
+    /**
+     * @brief The parameter sets alone, as Annex-B NAL units.
+     */
+    std::vector<uint8_t> ParameterSets();
+
+    const std::vector<uint8_t> &Vps() const { return vps_; }
+    const std::vector<uint8_t> &Sps() const { return sps_; }
+    const std::vector<uint8_t> &Pps() const { return pps_; }
+private:
+    void BuildHevcSps(uint32_t width, uint32_t height);
+    void Append(std::vector<uint8_t> &au, const std::vector<uint8_t> &nal);
+
+    bool hevc_;
+    uint32_t seed_;
+    std::vector<uint8_t> vps_;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+};
+
+/**
+ * @brief How a C2TestEncoder delivers the parameter sets
+*/
+enum class C2TestConfigMode : uint32_t {
+    /// In front of every sync frame.
+    kInline,
+    /// Seen once before the first frame, only the sinks' config record has them.
+    kAttached,
+    /// In a FLAG_CODEC_CONFIG buffer of their own ahead of the first frame, as
+    /// Codec2 encoders deliver them.
+    kBuffer,
+};
+
+struct C2TestEncoderConfig {
+    C2TestConfigMode config_mode = C2TestConfigMode::kInline;
+    /// Every gop_size-th frame, counted from 0, is a sync frame.
+    uint32_t gop_size = 15;
+    /// Slice payload size, varied by up to 100 bytes from frame to frame.
+    size_t payload_size = 2000;
+    uint64_t frame_duration_us = 33333;
+};
+
+/** C2TestEncoder
+ *
+ * Synthetic H.264 encoder output fed to a sink the way the engine does it.
+ **/
+class C2TestEncoder {
+public:
+    C2TestEncoder(const C2TestEncoderConfig &config);
+    ~C2TestEncoder(){};
+
+    void Encode(IC2OutputSink &sink, bool sync);
+    void EncodeFrames(IC2OutputSink &sink, uint32_t count);
+
+    const C2CodecConfig &GetCodecConfig() const { return parser_.GetCodecConfig(); }
+
+    /// Frames by index, and everything handed to the sinks concatenated.
+    std::map<uint64_t, std::vector<uint8_t>> encoded;
+    std::vector<uint8_t> bitstream;
+private:
+    void Deliver(IC2OutputSink &sink, const std::vector<uint8_t> &data, uint32_t flags);
+
+    C2TestEncoderConfig config_;
+    C2TestStream stream_;
+    C2NalParser parser_;
+    bool config_sent_;
+    uint64_t index_;
+};
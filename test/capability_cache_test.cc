@@ -0,0 +1,198 @@
+#include <C2Config.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "src/c2_capabilities.h"
+#include "src/c2_engine.h"
+#include "test/c2_test_check.h"
+
+#define MAX_WIDTH 1920
+#define MAX_HEIGHT 1088
+#define ALIGNMENT 16
+#define MAX_BITRATE 20000000
+#define MAX_FRAMERATE 60.0f
+
+/// Supported value queries answered by the fake components.
+static std::atomic<uint32_t> g_queries(0);
+
+/// Answers like an encoder limited to 1080p60 at 20 Mbps, in any order of fields.
+static c2_status_t supported_values(std::vector<C2FieldSupportedValuesQuery> &fields) {
+    C2StreamPictureSizeInfo::input size;
+    C2StreamBitrateInfo::output bitrate;
+    C2StreamFrameRateInfo::output framerate;
+    C2StreamProfileLevelInfo::output profile_level;
+
+    g_queries++;
+    for (C2FieldSupportedValuesQuery &query : fields) {
+        query.status = C2_OK;
+        if (query.field() == C2ParamField(&size, &size.width)) {
+            query.values = C2FieldSupportedValues(96u, (uint32_t)MAX_WIDTH, (uint32_t)ALIGNMENT);
+        } else if (query.field() == C2ParamField(&size, &size.height)) {
+            query.values = C2FieldSupportedValues(96u, (uint32_t)MAX_HEIGHT, (uint32_t)ALIGNMENT);
+        } else if (query.field() == C2ParamField(&bitrate, &bitrate.value)) {
+            query.values = C2FieldSupportedValues(1u, (uint32_t)MAX_BITRATE, 1u);
+        } else if (query.field() == C2ParamField(&framerate, &framerate.value)) {
+            query.values = C2FieldSupportedValues(1.0f, MAX_FRAMERATE, 0.0f);
+        } else if (query.field() == C2ParamField(&profile_level, &profile_level.profile)) {
+            query.values = C2FieldSupportedValues(
+                false, std::vector<uint32_t>{C2Config::PROFILE_AVC_BASELINE,
+                                             C2Config::PROFILE_AVC_MAIN,
+                                             C2Config::PROFILE_AVC_HIGH});
+        } else if (query.field() == C2ParamField(&profile_level, &profile_level.level)) {
+            query.values = C2FieldSupportedValues(
+                false, std::vector<uint32_t>{C2Config::LEVEL_AVC_4_1, C2Config::LEVEL_AVC_5_1});
+        } else {
+            query.status = C2_BAD_INDEX;
+        }
+    }
+    return C2_OK;
+}
+
+/// Answers like a component without reflection of its stream parameters.
+static c2_status_t no_supported_values(std::vector<C2FieldSupportedValuesQuery> &fields) {
+    g_queries++;
+    for (C2FieldSupportedValuesQuery &query : fields) {
+        query.status = C2_BAD_INDEX;
+    }
+    return C2_BAD_INDEX;
+}
+
+static void set_supported_values(FakeInterface::SupportedValuesHandler handler) {
+    C2Factory::SetComponentCreator([handler](const std::string &name, C2ModeType mode) {
+        auto component = std::make_shared<FakeComponent>(name);
+        component->GetInterface()->SetSupportedValues(handler);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+}
+
+static void configure_cache(const std::string &path, const std::string &version,
+                            bool save_overrides = true) {
+    C2CapabilityCacheConfig config;
+    config.path = path;
+    config.version = version;
+    config.save_overrides = save_overrides;
+    C2CapabilityCache::Instance().Configure(config);
+}
+
+/// Create an engine as a new process start would, after the cache was configured.
+static bool check_start(const char *what, uint64_t expected_probes, C2Capabilities &caps) {
+    C2CapabilityCache &cache = C2CapabilityCache::Instance();
+    uint64_t probes = cache.GetProbes();
+    uint32_t queries = g_queries;
+
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    if (!check(engine != nullptr, "engine created")) {
+        return false;
+    }
+
+    bool ok = check(engine->c2_engine_capabilities(caps), "capabilities known");
+    ok = ok && check(cache.GetProbes() - probes == expected_probes &&
+                         g_queries - queries == expected_probes,
+                     what);
+    ok = ok && check(caps.width.max == MAX_WIDTH && caps.height.step == ALIGNMENT &&
+                         caps.bitrate.max == MAX_BITRATE && caps.max_framerate == MAX_FRAMERATE &&
+                         caps.profiles.size() == 3 && caps.levels.size() == 2,
+                     "capabilities reflected");
+
+    // Unsupported configurations are refused before reaching the component.
+    C2EngineConfig supported = {1280, 720, 30.0f, 4000000, 30};
+    C2EngineConfig too_large = {3840, 2160, 30.0f, 4000000, 30};
+    C2EngineConfig misaligned = {1280, 722, 30.0f, 4000000, 30};
+    C2EngineConfig bitrate = {1280, 720, 30.0f, 50000000, 30};
+    C2EngineConfig framerate = {1280, 720, 120.0f, 4000000, 30};
+    ok = ok && check(engine->c2_engine_configure(supported), "supported configuration");
+    ok = ok && check(!engine->c2_engine_configure(too_large) &&
+                         !engine->c2_engine_configure(misaligned) &&
+                         !engine->c2_engine_configure(bitrate) &&
+                         !engine->c2_engine_configure(framerate),
+                     "unsupported configurations rejected");
+
+    C2Engine::free_c2_engine(engine);
+    return ok;
+}
+
+/// Components without reflection are probed once as well and run unchecked.
+static bool check_unreported(const char *what, uint64_t expected_probes) {
+    C2CapabilityCache &cache = C2CapabilityCache::Instance();
+    uint64_t probes = cache.GetProbes();
+    uint32_t queries = g_queries;
+
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    if (!check(engine != nullptr, "engine created")) {
+        return false;
+    }
+
+    C2Capabilities caps;
+    C2EngineConfig config = {3840, 2160, 30.0f, 4000000, 30};
+    bool ok = check(!engine->c2_engine_capabilities(caps), "no capabilities");
+    ok = ok && check(cache.GetProbes() - probes == expected_probes &&
+                         g_queries - queries == expected_probes,
+                     what);
+    ok = ok && check(engine->c2_engine_configure(config), "configuration not checked");
+
+    C2Engine::free_c2_engine(engine);
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    std::string path = "/tmp/capability_cache_test." + std::to_string(getpid());
+
+    set_supported_values(supported_values);
+
+    C2Capabilities caps;
+    configure_cache(path, "1.0");
+    bool ok = check_start("first start probes", 1, caps);
+
+    struct stat st;
+    ok = ok && check(stat(path.c_str(), &st) == 0 && st.st_size > 0, "cache file written");
+
+    // A restart of the same library reads the file, the component is not queried.
+    configure_cache(path, "1.0");
+    ok = ok && check_start("restart served from the cache", 0, caps);
+
+    C2Capabilities cached;
+    ok = ok && check(C2CapabilityCache::Instance().Lookup(caps.name, cached) &&
+                         cached.width.max == caps.width.max && cached.levels == caps.levels,
+                     "lookup without a component");
+
+    // An updated library may support other values.
+    configure_cache(path, "2.0");
+    ok = ok && check_start("new library probes again", 1, caps);
+
+    // Nothing reported is cached too, also across restarts.
+    set_supported_values(no_supported_values);
+    configure_cache(path, "3.0");
+    ok = ok && check_unreported("component without reflection probes", 1);
+    ok = ok && check_unreported("no capabilities served from memory", 0);
+    configure_cache(path, "3.0");
+    ok = ok && check_unreported("no capabilities served from the cache", 0);
+
+    // Stand-in components are not saved unless asked for.
+    unlink(path.c_str());
+    configure_cache(path, "4.0", false);
+    ok = ok && check_unreported("stand-in component probes", 1);
+    ok = ok && check(stat(path.c_str(), &st) != 0, "stand-in capabilities not saved");
+
+    // Real components of the same name do not see them.
+    C2Factory::SetComponentCreator(nullptr);
+    ok = ok && check(!C2CapabilityCache::Instance().Lookup(caps.name, cached),
+                     "stand-in capabilities hidden from real components");
+
+    C2Factory::SetComponentCreator(nullptr);
+    unlink(path.c_str());
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Capability cache checks passed";
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <getopt.h>
 #include <unistd.h>
 
 #include <iostream>
@@ -5,54 +6,346 @@
 
 #include "base/log.h"
 #include "base/signal_monitor.h"
+#include "base/trace.h"
 #include "src/c2_common.h"
 #include "src/c2_engine.h"
+#include "src/c2_file_sink.h"
+#include "src/c2_frame_source.h"
+#include "src/c2_mp4_muxer.h"
+#include "src/c2_segment_sink.h"
 
-/// Codec2 component instance.
-C2Module *c2module = nullptr;
+/// Frames allowed in the component before submission waits.
+#define DEFAULT_MAX_PENDING 8
+/// Trace events buffered by each thread, several minutes of frames.
+#define TRACE_EVENTS_PER_THREAD (1 << 18)
 
-int main(int argc, const char *argv[]) {
+static void usage(const char *name) {
+    std::cout << "Usage: " << name << " -i <input> [options]\n"
+              << "  -i, --input <path>     raw YUV or Y4M input file\n"
+              << "  -w, --width <pixels>   raw input width\n"
+              << "  -h, --height <pixels>  raw input height\n"
+              << "  -f, --format <fmt>     raw input format: nv12, i420, yv12, rgba,\n"
+              << "                         p010, i010, y210\n"
+              << "  -c, --codec <codec>    h264 or h265 (default h264)\n"
+              << "  -o, --output <path>    output file, .mp4 for fragmented MP4 (default out.264)\n"
+              << "  -r, --fps <rate>       frame rate (default 30 or Y4M header)\n"
+              << "  -b, --bitrate <bps>    target bitrate\n"
+              << "  -g, --gop <frames>     sync frame interval\n"
+              << "  -n, --frames <count>   number of frames to encode (default whole file)\n"
+              << "  -l, --loop             loop the input\n"
+              << "  -F, --flat-out         submit as fast as possible instead of at frame rate\n"
+              << "  -p, --pending <count>  maximum frames in flight (default "
+              << DEFAULT_MAX_PENDING << ")\n"
+              << "  -s, --static <action>  handle static frames: skip or lowcost\n"
+              << "  -L, --latency <ms>     drop frames older than the latency budget\n"
+              << "  -W, --watchdog <ms>    recover the component after a stall\n"
+              << "  -S, --slices <mbs>     deliver slices of the given size in macroblocks\n"
+              << "  -T, --timestamp-sei    insert the capture timestamp SEI in each frame\n"
+              << "  -M, --memory <MB>      fetch input blocks through the buffer broker\n"
+              << "                         with the given graphic memory budget\n"
+              << "  -P, --publish-stats    publish the engine stats for c2_stats_top\n"
+              << "  -R, --record <path>    record the component work for work_replay\n"
+              << "  -D, --segment <secs>   split the output into segments of the given length\n"
+              << "                         at sync frames, each with a seek index\n"
+              << "  -t, --trace <path>     record the frame lifecycle, .json for Chrome JSON,\n"
+              << "                         otherwise Perfetto protobuf (ENABLE_C2_TRACE builds)\n";
+}
+
+static C2PixelFormat parse_format(const std::string &format) {
+    if (format == "yv12") {
+        return C2PixelFormat::kYV12;
+    } else if (format == "i420") {
+        return C2PixelFormat::kI420;
+    } else if (format == "rgba") {
+        return C2PixelFormat::kRGBA;
+    } else if (format == "p010") {
+        return C2PixelFormat::kP010;
+    } else if (format == "i010") {
+        return C2PixelFormat::kI010;
+    } else if (format == "y210") {
+        return C2PixelFormat::kY210;
+    }
+    return C2PixelFormat::kNV12;
+}
+
+static bool ends_with(const std::string &value, const std::string &suffix) {
+    return value.size() >= suffix.size() &&
+           value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char *argv[]) {
     base::register_signal_monitor("/data/dump");
 
-    FILE *fp = fopen("sample.yuv", "rb");
-    if (fp == NULL) {
-        base::LogError() << "cannot open sample yuv";
+    C2FrameSourceConfig source_config;
+    std::string output = "out.264";
+    bool hevc = false;
+    uint32_t bitrate = 0;
+    uint32_t gop = 0;
+    uint64_t num_frames = 0;
+    uint32_t max_pending = DEFAULT_MAX_PENDING;
+    float framerate = 0;
+    C2SceneDetectConfig scene_config;
+    C2LatencyBudgetConfig budget_config;
+    C2WatchdogConfig watchdog_config;
+    C2SliceOutputConfig slice_config = {false, 0, 0};
+    bool timestamp_sei = false;
+    bool broker = false;
+    C2BrokerConfig broker_config;
+    std::string trace_path;
+    bool publish_stats = false;
+    std::string record_path;
+    uint32_t segment_seconds = 0;
+
+    const struct option options[] = {
+        {"input", required_argument, nullptr, 'i'},  {"width", required_argument, nullptr, 'w'},
+        {"height", required_argument, nullptr, 'h'}, {"format", required_argument, nullptr, 'f'},
+        {"codec", required_argument, nullptr, 'c'},  {"output", required_argument, nullptr, 'o'},
+        {"fps", required_argument, nullptr, 'r'},    {"bitrate", required_argument, nullptr, 'b'},
+        {"gop", required_argument, nullptr, 'g'},    {"frames", required_argument, nullptr, 'n'},
+        {"loop", no_argument, nullptr, 'l'},         {"flat-out", no_argument, nullptr, 'F'},
+        {"pending", required_argument, nullptr, 'p'}, {"static", required_argument, nullptr, 's'},
+        {"latency", required_argument, nullptr, 'L'}, {"watchdog", required_argument, nullptr, 'W'},
+        {"slices", required_argument, nullptr, 'S'},  {"timestamp-sei", no_argument, nullptr, 'T'},
+        {"memory", required_argument, nullptr, 'M'},  {"trace", required_argument, nullptr, 't'},
+        {"publish-stats", no_argument, nullptr, 'P'}, {"record", required_argument, nullptr, 'R'},
+        {"segment", required_argument, nullptr, 'D'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "i:w:h:f:c:o:r:b:g:n:lFp:s:L:W:S:TM:t:PR:D:", options,
+                              nullptr)) != -1) {
+        switch (opt) {
+            case 'i':
+                source_config.path = optarg;
+                break;
+            case 'w':
+                source_config.width = atoi(optarg);
+                break;
+            case 'h':
+                source_config.height = atoi(optarg);
+                break;
+            case 'f':
+                source_config.pixel_format = parse_format(optarg);
+                break;
+            case 'c':
+                hevc = std::string(optarg) == "h265";
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'r':
+                framerate = atof(optarg);
+                break;
+            case 'b':
+                bitrate = atoi(optarg);
+                break;
+            case 'g':
+                gop = atoi(optarg);
+                break;
+            case 'n':
+                num_frames = strtoull(optarg, nullptr, 10);
+                break;
+            case 'l':
+                source_config.loop = true;
+                break;
+            case 'F':
+                source_config.paced = false;
+                break;
+            case 'p':
+                max_pending = atoi(optarg);
+                if (max_pending == 0) {
+                    base::LogError() << "At least one frame must be allowed in flight";
+                    return 1;
+                }
+                break;
+            case 's':
+                scene_config.enabled = true;
+                scene_config.action = (std::string(optarg) == "lowcost") ? C2SkipAction::kLowCost
+                                                                         : C2SkipAction::kSkip;
+                break;
+            case 'L':
+                budget_config.enabled = true;
+                budget_config.budget_ms = atoi(optarg);
+                break;
+            case 'W':
+                watchdog_config.enabled = true;
+                watchdog_config.stall_ms = atoi(optarg);
+                break;
+            case 'S':
+                slice_config.enabled = true;
+                slice_config.slice_mbs = atoi(optarg);
+                break;
+            case 'T':
+                timestamp_sei = true;
+                break;
+            case 'M':
+                broker = true;
+                broker_config.budget_bytes = strtoull(optarg, nullptr, 10) << 20;
+                break;
+            case 't':
+                trace_path = optarg;
+                break;
+            case 'P':
+                publish_stats = true;
+                break;
+            case 'R':
+                record_path = optarg;
+                break;
+            case 'D':
+                segment_seconds = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (source_config.path.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (framerate > 0) {
+        source_config.framerate = framerate;
+    }
+    budget_config.max_in_flight = max_pending;
+
+    C2FrameSource source(source_config);
+    if (!source.Open()) {
         return 1;
     }
-    int width = 1920;
-    int height = 1080;
-    int buffer_size = width * height * 3 / 2;
-    uint8_t *mem_buffer = (uint8_t *)malloc(buffer_size);
-    int read_size = fread(mem_buffer, buffer_size, 0, fp);
-    fclose(fp);
 
-    C2Engine *engine =
-        C2Engine::new_c2_engine(C2ModeType::VideoEncode, C2CodecType::H264VideoEncode);
+    C2BufferBroker::Instance().Configure(broker_config);
+
+    C2Engine *engine = C2Engine::new_c2_engine(
+        C2ModeType::VideoEncode,
+        hevc ? C2CodecType::H265VideoEncode : C2CodecType::H264VideoEncode);
+    if (engine == nullptr) {
+        return 1;
+    }
+
+    C2EngineConfig config;
+    config.width = source.GetWidth();
+    config.height = source.GetHeight();
+    config.framerate = source.GetFramerate();
+    config.bitrate = bitrate;
+    config.gop = gop;
+    if (!engine->c2_engine_configure(config) || !engine->c2_engine_scene_detect(scene_config) ||
+        !engine->c2_engine_latency_budget(budget_config) ||
+        !engine->c2_engine_watchdog(watchdog_config) ||
+        !engine->c2_engine_slice_output(slice_config) ||
+        !engine->c2_engine_timestamp_sei(timestamp_sei) ||
+        !engine->c2_engine_buffer_broker(broker) ||
+        !engine->c2_engine_publish_stats(publish_stats) ||
+        (!record_path.empty() && !engine->c2_engine_record_work(record_path))) {
+        C2Engine::free_c2_engine(engine);
+        return 1;
+    }
+
+    std::shared_ptr<C2Mp4Muxer> muxer;
+    if (ends_with(output, ".mp4")) {
+        C2Mp4MuxerConfig muxer_config;
+        muxer_config.path = output;
+        muxer_config.hevc = hevc;
+        muxer_config.width = config.width;
+        muxer_config.height = config.height;
+        muxer = std::make_shared<C2Mp4Muxer>(muxer_config);
+        if (!muxer->Open()) {
+            C2Engine::free_c2_engine(engine);
+            return 1;
+        }
+        engine->c2_engine_add_sink(muxer);
+    } else if (segment_seconds > 0) {
+        // out.264 is recorded as out_00001.264, out_00002.264, ...
+        C2SegmentSinkConfig segment_config;
+        size_t dot = output.find_last_of('.');
+        if (dot != std::string::npos && output.find('/', dot) != std::string::npos) {
+            dot = std::string::npos;
+        }
+        segment_config.prefix = output.substr(0, dot);
+        segment_config.extension = (dot != std::string::npos) ? output.substr(dot) : "";
+        segment_config.duration_ms = segment_seconds * 1000;
+        engine->c2_engine_add_sink(std::make_shared<C2SegmentSink>(segment_config));
+    } else {
+        engine->c2_engine_add_sink(std::make_shared<C2FileSink>(output));
+    }
+
+    if (!trace_path.empty()) {
+        base::trace_start(TRACE_EVENTS_PER_THREAD);
+    }
     engine->start_c2_engine();
 
+    uint64_t begin = C2Stats::Now();
+    uint64_t submitted = 0;
+
     C2StreamBuffer stream_buffer;
-    stream_buffer.data = mem_buffer;
-    stream_buffer.size = buffer_size;
-    stream_buffer.width = width;
-    stream_buffer.height = height;
-    stream_buffer.offset[0] = 0;
-    stream_buffer.offset[1] = width * height;
-    stream_buffer.stride[0] = width;
-    stream_buffer.stride[1] = width;
-    stream_buffer.planes = 2;
-    stream_buffer.pixel_format = C2PixelFormat::kNV12;
-    stream_buffer.isubwc = false;
-
-    for (int i = 0; i < 30; i++) {
-        engine->c2_engine_queue_buffer(&stream_buffer);
-        usleep(33000);
-    }
-
-    getchar();
-
-    free(mem_buffer);
+    while ((num_frames == 0 || submitted < num_frames) && source.Next(stream_buffer)) {
+        // Keep a bounded number of frames in flight so the input pool is not exhausted,
+        // in latency budget mode the engine drops stale frames instead.
+        while (!budget_config.enabled && !engine->c2_engine_wait_pending(max_pending - 1, 1000)) {
+            base::LogWarn() << "Waiting for the encoder to return work";
+        }
+        if (!engine->c2_engine_queue_buffer(&stream_buffer)) {
+            base::LogError() << "Failed to queue frame " << submitted;
+            break;
+        }
+        submitted++;
+    }
+
+    if (!engine->c2_engine_wait_pending(0, 2000)) {
+        base::LogWarn() << "Encoder did not return all pending frames";
+    }
+    uint64_t elapsed = C2Stats::Now() - begin;
+
     engine->stop_c2_engine();
+    if (muxer) {
+        muxer->Close();
+    }
+
+    if (!trace_path.empty()) {
+        base::trace_stop();
+        bool chrome = ends_with(trace_path, ".json");
+        base::trace_export(trace_path,
+                           chrome ? base::TraceFormat::Chrome : base::TraceFormat::Perfetto);
+        if (base::trace_lost() > 0) {
+            base::LogWarn() << "trace: " << base::trace_lost() << " events lost, buffers full";
+        }
+    }
+
+    C2StatsSnapshot stats;
+    engine->c2_engine_stats(stats);
     C2Engine::free_c2_engine(engine);
+
+    double seconds = elapsed / 1000000.0;
+    double content = submitted / config.framerate;
+    base::LogInfo() << "frames: submitted " << submitted << ", encoded " << stats.completed
+                    << ", dropped " << stats.dropped << ", errors " << stats.errors
+                    << ", skipped " << stats.skipped << ", expired " << stats.expired;
+    if (scene_config.enabled) {
+        base::LogInfo() << "scene detection: " << stats.detect_time << " us cpu, "
+                        << (submitted > 0 ? stats.detect_time / submitted : 0) << " us per frame";
+    }
+    if (watchdog_config.enabled) {
+        base::LogInfo() << "watchdog: " << stats.stalls << " stalls, " << stats.recovered
+                        << " recovered, recovery ms last " << stats.recover_time_last / 1000
+                        << ", max " << stats.recover_time_max / 1000;
+    }
+    base::LogInfo() << "throughput: " << (seconds > 0 ? stats.completed / seconds : 0)
+                    << " fps over " << seconds << " s";
+    base::LogInfo() << "latency us: p50 " << stats.latency_p50 << ", p90 " << stats.latency_p90
+                    << ", p99 " << stats.latency_p99 << ", max " << stats.latency_max;
+    base::LogInfo() << "first byte latency us: p50 " << stats.first_byte_p50 << ", p99 "
+                    << stats.first_byte_p99;
+    base::LogInfo() << "output: " << stats.bytes_out << " bytes, "
+                    << (content > 0 ? stats.bytes_out * 8 / content / 1000 : 0)
+                    << " kbps at " << config.framerate << " fps";
+    if (broker) {
+        C2BrokerUsage usage;
+        C2BufferBroker::Instance().GetUsage(usage);
+        base::LogInfo() << "graphic memory: peak " << usage.peak << " bytes of " << usage.budget
+                        << ", " << usage.hits << " reused, " << usage.misses << " allocated, "
+                        << usage.waits << " waits, " << usage.failures << " failures";
+    }
     base::LogInfo() << "end of main function";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_convert.h"
+
+// Destination stride alignment of the Venus NV12 layout.
+#define DST_ALIGNMENT 128
+
+static uint32_t align(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static std::vector<uint8_t> random_bytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (auto &value : data) {
+        value = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Compare the vectorized converters with the scalar references for one size.
+static bool check_size(uint32_t width, uint32_t height) {
+    uint32_t stride = align(width, DST_ALIGNMENT);
+    uint32_t chroma_width = width / 2;
+    uint32_t chroma_height = height / 2;
+
+    // Source strides padded to keep the row starts unaligned.
+    uint32_t u_stride = chroma_width + 3;
+    uint32_t rgba_stride = width * 4 + 12;
+    std::vector<uint8_t> u = random_bytes(u_stride * chroma_height, width);
+    std::vector<uint8_t> v = random_bytes(u_stride * chroma_height, height);
+    std::vector<uint8_t> rgba = random_bytes(rgba_stride * height, width + height);
+
+    std::vector<uint8_t> expected(stride * chroma_height, 0xAA);
+    std::vector<uint8_t> result(stride * chroma_height, 0xAA);
+    C2Convert::InterleaveUVScalar(u.data(), u_stride, v.data(), u_stride, expected.data(), stride,
+                                  chroma_width, chroma_height);
+    C2Convert::InterleaveUV(u.data(), u_stride, v.data(), u_stride, result.data(), stride,
+                            chroma_width, chroma_height);
+    if (expected != result) {
+        base::LogError() << "InterleaveUV mismatch at " << width << "x" << height;
+        return false;
+    }
+
+    for (auto matrix : {C2ColorMatrix::kBT601, C2ColorMatrix::kBT709}) {
+        std::vector<uint8_t> expected_y(stride * height, 0xAA), result_y(stride * height, 0xAA);
+        std::vector<uint8_t> expected_uv(stride * chroma_height, 0xAA);
+        std::vector<uint8_t> result_uv(stride * chroma_height, 0xAA);
+
+        C2Convert::RGBAToNV12Scalar(rgba.data(), rgba_stride, expected_y.data(), stride,
+                                    expected_uv.data(), stride, width, height, matrix);
+        C2Convert::RGBAToNV12(rgba.data(), rgba_stride, result_y.data(), stride,
+                              result_uv.data(), stride, width, height, matrix);
+        if (expected_y != result_y || expected_uv != result_uv) {
+            base::LogError() << "RGBAToNV12 mismatch at " << width << "x" << height;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Compare the 10-bit converters with the scalar references for one size.
+static bool check_size10(uint32_t width, uint32_t height) {
+    uint32_t stride = align(width * 2, DST_ALIGNMENT);
+    uint32_t chroma_width = width / 2;
+    uint32_t chroma_height = height / 2;
+
+    uint32_t y_stride = width * 2 + 6;
+    uint32_t u_stride = chroma_width * 2 + 10;
+    uint32_t y210_stride = width * 4 + 8;
+    std::vector<uint8_t> luma = random_bytes(y_stride * height, width);
+    std::vector<uint8_t> u = random_bytes(u_stride * chroma_height, height);
+    std::vector<uint8_t> v = random_bytes(u_stride * chroma_height, width * height);
+    std::vector<uint8_t> y210 = random_bytes(y210_stride * height, width + height);
+
+    std::vector<uint8_t> expected(stride * height, 0xAA), result(stride * height, 0xAA);
+    C2Convert::ShiftPlane10Scalar(luma.data(), y_stride, expected.data(), stride, width, height);
+    C2Convert::ShiftPlane10(luma.data(), y_stride, result.data(), stride, width, height);
+    if (expected != result) {
+        base::LogError() << "ShiftPlane10 mismatch at " << width << "x" << height;
+        return false;
+    }
+
+    std::vector<uint8_t> expected_uv(stride * chroma_height, 0xAA);
+    std::vector<uint8_t> result_uv(stride * chroma_height, 0xAA);
+    C2Convert::InterleaveUV10Scalar(u.data(), u_stride, v.data(), u_stride, expected_uv.data(),
+                                    stride, chroma_width, chroma_height);
+    C2Convert::InterleaveUV10(u.data(), u_stride, v.data(), u_stride, result_uv.data(), stride,
+                              chroma_width, chroma_height);
+    if (expected_uv != result_uv) {
+        base::LogError() << "InterleaveUV10 mismatch at " << width << "x" << height;
+        return false;
+    }
+
+    C2Convert::Y210ToP010Scalar(y210.data(), y210_stride, expected.data(), stride,
+                                expected_uv.data(), stride, width, height);
+    C2Convert::Y210ToP010(y210.data(), y210_stride, result.data(), stride, result_uv.data(),
+                          stride, width, height);
+    if (expected != result || expected_uv != result_uv) {
+        base::LogError() << "Y210ToP010 mismatch at " << width << "x" << height;
+        return false;
+    }
+
+    return true;
+}
+
+// Known values: white, black and primaries must land on the limited range levels.
+static bool check_levels() {
+    const uint8_t colors[4][4] = {
+        {255, 255, 255, 255}, {0, 0, 0, 255}, {255, 0, 0, 255}, {0, 0, 255, 255}};
+    const uint8_t levels[4][3] = {{235, 128, 128}, {16, 128, 128}, {82, 90, 240}, {41, 240, 110}};
+
+    for (uint32_t idx = 0; idx < 4; idx++) {
+        std::vector<uint8_t> rgba(32 * 2 * 4);
+        for (size_t px = 0; px < rgba.size(); px += 4) {
+            memcpy(&rgba[px], colors[idx], 4);
+        }
+
+        std::vector<uint8_t> y(32 * 2), uv(32);
+        C2Convert::RGBAToNV12(rgba.data(), 32 * 4, y.data(), 32, uv.data(), 32, 32, 2,
+                              C2ColorMatrix::kBT601);
+
+        if (abs(y[0] - levels[idx][0]) > 1 || abs(uv[0] - levels[idx][1]) > 1 ||
+            abs(uv[1] - levels[idx][2]) > 1) {
+            base::LogError() << "Unexpected levels for color " << idx << ": " << int(y[0])
+                             << " " << int(uv[0]) << " " << int(uv[1]);
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Func>
+static double measure_fps(int iterations, Func func) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < iterations; idx++) {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return iterations / std::chrono::duration<double>(end - begin).count();
+}
+
+static void benchmark(uint32_t width, uint32_t height, int iterations) {
+    uint32_t stride = align(width, DST_ALIGNMENT);
+    std::vector<uint8_t> src = random_bytes(width * height * 4, 1);
+    std::vector<uint8_t> y(stride * height), uv(stride * height / 2);
+
+    const uint8_t *u = src.data() + width * height;
+    const uint8_t *v = u + (width / 2) * (height / 2);
+
+    double planar_scalar = measure_fps(iterations, [&]() {
+        C2Convert::CopyPlane(src.data(), width, y.data(), stride, width, height);
+        C2Convert::InterleaveUVScalar(u, width / 2, v, width / 2, uv.data(), stride, width / 2,
+                                      height / 2);
+    });
+    double planar = measure_fps(iterations, [&]() {
+        C2Convert::CopyPlane(src.data(), width, y.data(), stride, width, height);
+        C2Convert::InterleaveUV(u, width / 2, v, width / 2, uv.data(), stride, width / 2,
+                                height / 2);
+    });
+    double rgba_scalar = measure_fps(iterations, [&]() {
+        C2Convert::RGBAToNV12Scalar(src.data(), width * 4, y.data(), stride, uv.data(), stride,
+                                    width, height, C2ColorMatrix::kBT709);
+    });
+    double rgba = measure_fps(iterations, [&]() {
+        C2Convert::RGBAToNV12(src.data(), width * 4, y.data(), stride, uv.data(), stride, width,
+                              height, C2ColorMatrix::kBT709);
+    });
+
+    base::LogInfo() << width << "x" << height << " I420: scalar " << planar_scalar
+                    << " fps, simd " << planar << " fps";
+    base::LogInfo() << width << "x" << height << " RGBA: scalar " << rgba_scalar
+                    << " fps, simd " << rgba << " fps";
+}
+
+static void benchmark10(uint32_t width, uint32_t height, int iterations) {
+    uint32_t stride = align(width * 2, DST_ALIGNMENT);
+    std::vector<uint8_t> src = random_bytes(width * height * 4, 2);
+    std::vector<uint8_t> y(stride * height), uv(stride * height / 2);
+
+    const uint8_t *u = src.data() + width * height * 2;
+    const uint8_t *v = u + (width / 2) * (height / 2) * 2;
+
+    double planar_scalar = measure_fps(iterations, [&]() {
+        C2Convert::ShiftPlane10Scalar(src.data(), width * 2, y.data(), stride, width, height);
+        C2Convert::InterleaveUV10Scalar(u, width, v, width, uv.data(), stride, width / 2,
+                                        height / 2);
+    });
+    double planar = measure_fps(iterations, [&]() {
+        C2Convert::ShiftPlane10(src.data(), width * 2, y.data(), stride, width, height);
+        C2Convert::InterleaveUV10(u, width, v, width, uv.data(), stride, width / 2, height / 2);
+    });
+    double packed_scalar = measure_fps(iterations, [&]() {
+        C2Convert::Y210ToP010Scalar(src.data(), width * 4, y.data(), stride, uv.data(), stride,
+                                    width, height);
+    });
+    double packed = measure_fps(iterations, [&]() {
+        C2Convert::Y210ToP010(src.data(), width * 4, y.data(), stride, uv.data(), stride, width,
+                              height);
+    });
+    double p010 = measure_fps(iterations, [&]() {
+        C2Convert::CopyPlane(src.data(), width * 2, y.data(), stride, width * 2, height);
+        C2Convert::CopyPlane(src.data(), width * 2, uv.data(), stride, width * 2, height / 2);
+    });
+
+    base::LogInfo() << width << "x" << height << " I010: scalar " << planar_scalar
+                    << " fps, simd " << planar << " fps";
+    base::LogInfo() << width << "x" << height << " Y210: scalar " << packed_scalar
+                    << " fps, simd " << packed << " fps";
+    base::LogInfo() << width << "x" << height << " P010: copy " << p010 << " fps";
+}
+
+int main(int argc, const char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+
+    // Widths around the 16 pixel vector step exercise the scalar tails.
+    const uint32_t sizes[][2] = {{2, 2},    {14, 4},   {16, 2},   {18, 6},    {30, 8},
+                                 {34, 10},  {62, 2},   {176, 144}, {642, 482}, {1920, 1080}};
+    for (const auto &size : sizes) {
+        if (!check_size(size[0], size[1]) || !check_size10(size[0], size[1])) {
+            return 1;
+        }
+    }
+
+    if (!check_levels()) {
+        return 1;
+    }
+    base::LogInfo() << "Converters match the scalar references";
+
+    benchmark(1920, 1080, iterations);
+    benchmark(3840, 2160, iterations);
+    benchmark10(3840, 2160, iterations);
+    return 0;
+}
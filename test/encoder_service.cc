@@ -0,0 +1,67 @@
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include <iostream>
+#include <string>
+
+#include "base/log.h"
+#include "base/signal_monitor.h"
+#include "src/c2_encoder_service.h"
+
+static void usage(const char *name) {
+    std::cout << "Usage: " << name << " [options]\n"
+              << "  -s, --socket <path>    service socket (default " << C2_SERVICE_SOCKET << ")\n"
+              << "  -n, --sessions <count> encoder instances handed out at once (default 4)\n"
+              << "  -w, --wait <ms>        wait for a free output slot before dropping a frame\n";
+}
+
+int main(int argc, char *argv[]) {
+    base::register_signal_monitor("/data/dump");
+
+    C2EncoderServiceConfig config;
+
+    const struct option options[] = {
+        {"socket", required_argument, nullptr, 's'},
+        {"sessions", required_argument, nullptr, 'n'},
+        {"wait", required_argument, nullptr, 'w'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "s:n:w:", options, nullptr)) != -1) {
+        switch (opt) {
+            case 's':
+                config.socket_path = optarg;
+                break;
+            case 'n':
+                config.max_sessions = atoi(optarg);
+                break;
+            case 'w':
+                config.output_wait_ms = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // Termination is waited for below, the service threads inherit the mask.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    C2EncoderService service(config);
+    if (!service.Start()) {
+        return 1;
+    }
+
+    int signal_number = 0;
+    sigwait(&signals, &signal_number);
+    base::LogInfo() << "Signal " << signal_number << " received, stopping the encoder service";
+
+    service.Stop();
+    return 0;
+}
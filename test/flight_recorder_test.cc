@@ -0,0 +1,124 @@
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/flight_recorder.h"
+#include "base/log.h"
+#include "base/signal_monitor.h"
+
+#define NUM_THREADS 4
+#define EVENTS_PER_THREAD 1000
+
+static std::string read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static size_t count(const std::string &text, const std::string &pattern) {
+    size_t found = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+        found++;
+    }
+    return found;
+}
+
+// Only the newest kEntries events of concurrent writers are kept, oldest first.
+static bool check_ring(const std::string &dir) {
+    base::FlightRecorder recorder;
+    recorder.set_name("c2.test.ring");
+
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < NUM_THREADS; thread++) {
+        threads.emplace_back([&recorder, thread] {
+            for (uint64_t idx = 0; idx < EVENTS_PER_THREAD; idx++) {
+                recorder.record(base::FlightEvent::Queue, thread * EVENTS_PER_THREAD + idx);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    recorder.record(base::FlightEvent::State, 0, 0, "stop");
+
+    std::string path = dir + "/ring.txt";
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    recorder.dump(fileno(file), 0);
+    fclose(file);
+
+    std::string dump = read_file(path);
+    uint64_t total = NUM_THREADS * EVENTS_PER_THREAD + 1;
+    std::string first = "#" + std::to_string(total - base::FlightRecorder::kEntries) + " ";
+    std::string last = "#" + std::to_string(total - 1) + " ";
+    if (dump.find("recorder c2.test.ring, " + std::to_string(total) + " events") != 0 ||
+        count(dump, " queue frame ") != base::FlightRecorder::kEntries - 1 ||
+        count(dump, "incomplete") != 0 || dump.find(first) == std::string::npos ||
+        dump.find(last) < dump.find(first) || dump.find(" state stop\n") < dump.find(last)) {
+        base::LogError() << "Unexpected ring dump:\n" << dump;
+        return false;
+    }
+    return true;
+}
+
+// The crash handler writes the recorders next to the backtrace, maps and fds.
+static bool check_crash(const std::string &dir) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        base::register_signal_monitor(dir.c_str());
+        base::FlightRecorder recorder;
+        recorder.set_name("c2.test.crash");
+        recorder.record(base::FlightEvent::Queue, 42, 1000);
+        recorder.record(base::FlightEvent::Error, 42, 7, "queue");
+        raise(SIGSEGV);
+        _exit(1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    std::string suffix = "_" + std::to_string(pid) + "[" + std::to_string(SIGSEGV) + "].txt";
+    std::string trace = read_file(dir + "/trace" + suffix);
+    std::string fds = read_file(dir + "/fd" + suffix);
+    std::string maps = read_file(dir + "/maps" + suffix);
+    std::string threads = read_file(dir + "/threads" + suffix);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        trace.find("backtrace:\n") == std::string::npos ||
+        trace.find("recorder c2.test.crash, 2 events") == std::string::npos ||
+        trace.find(" queue frame 42 value 1000\n") == std::string::npos ||
+        trace.find(" error frame 42 value 7 queue\n") == std::string::npos ||
+        fds.find("0 -> ") == std::string::npos || maps.find("r-xp") == std::string::npos ||
+        threads.find(std::to_string(pid) + " ") != 0) {
+        base::LogError() << "Unexpected crash dump, status " << status << ":\n" << trace;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    char dir[] = "/tmp/flight_recorder_test.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        return 1;
+    }
+
+    bool ok = check_ring(dir);
+    ok = check_crash(dir) && ok;
+
+    std::string cleanup = std::string("rm -rf ") + dir;
+    [[maybe_unused]] int result = system(cleanup.c_str());
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Flight recorder checks passed";
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_convert.h"
+#include "src/c2_frame_arena.h"
+#include "src/c2_frame_source.h"
+
+/// Frames cycled through, enough to exceed the last level cache at 4K.
+#define NUM_FRAMES 8
+/// Staging alignments the arena promises.
+#define STRIDE_ALIGNMENT 128
+#define PAGE_ALIGNMENT 4096
+
+typedef std::function<std::shared_ptr<C2StreamBuffer>()> FrameAllocator;
+
+static const char *pages_name(C2HugePages pages) {
+    switch (pages) {
+        case C2HugePages::kExplicit:
+            return "explicit hugepages";
+        case C2HugePages::kTransparent:
+            return "transparent hugepages";
+        default:
+            return "small pages";
+    }
+}
+
+// Tightly packed frame on the heap, the way sources used to stage frames.
+static std::shared_ptr<C2StreamBuffer> heap_frame(uint32_t width, uint32_t height) {
+    uint32_t size = C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, width, height);
+    uint8_t *data = static_cast<uint8_t *>(malloc(size));
+    C2StreamBuffer *buffer = new C2StreamBuffer();
+    C2FrameSource::DescribeFrame(data, C2PixelFormat::kNV12, width, height, *buffer);
+    return std::shared_ptr<C2StreamBuffer>(buffer, [](C2StreamBuffer *buffer) {
+        free(buffer->data);
+        delete buffer;
+    });
+}
+
+static bool check_layout(const C2StreamBuffer &buffer) {
+    bool ok = reinterpret_cast<uintptr_t>(buffer.data) % PAGE_ALIGNMENT == 0;
+    for (int32_t plane = 0; plane < buffer.planes; plane++) {
+        ok = ok && buffer.stride[plane] % STRIDE_ALIGNMENT == 0 &&
+             buffer.offset[plane] % PAGE_ALIGNMENT == 0;
+    }
+    return ok;
+}
+
+// Released frames are handed out again and the layout matches NV12 EXT.
+static bool check_recycling(uint32_t width, uint32_t height) {
+    const C2PixelFormat formats[] = {C2PixelFormat::kNV12, C2PixelFormat::kP010,
+                                     C2PixelFormat::kI420, C2PixelFormat::kRGBA};
+
+    C2FrameArena &arena = C2FrameArena::Instance();
+    for (C2PixelFormat format : formats) {
+        uint8_t *data = nullptr;
+        {
+            std::shared_ptr<C2StreamBuffer> frame = arena.Acquire(format, width, height);
+            if (!frame || !check_layout(*frame)) {
+                base::LogError() << "Misaligned frame of format " << static_cast<int>(format);
+                return false;
+            }
+            data = frame->data;
+            memset(frame->data, 0, frame->size);
+        }
+
+        C2FrameArenaUsage before, after;
+        arena.GetUsage(before);
+        std::shared_ptr<C2StreamBuffer> frame = arena.Acquire(format, width, height);
+        arena.GetUsage(after);
+        if (!frame || frame->data != data || after.hits != before.hits + 1) {
+            base::LogError() << "Frame of format " << static_cast<int>(format)
+                             << " was not recycled";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Compressed and unknown formats have no linear layout to stage frames in.
+static bool check_unsupported(uint32_t width, uint32_t height) {
+    const C2PixelFormat formats[] = {C2PixelFormat::kNV12UBWC, C2PixelFormat::kTP10UBWC,
+                                     C2PixelFormat::kRGBA_UBWC, C2PixelFormat::kUnknown};
+
+    C2FrameArena &arena = C2FrameArena::Instance();
+    for (C2PixelFormat format : formats) {
+        if (C2FrameArena::GetFrameSize(format, width, height) != 0 ||
+            arena.Acquire(format, width, height) != nullptr) {
+            base::LogError() << "Frame of format " << static_cast<int>(format)
+                             << " was not rejected";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copy of the frames into a block sized destination, the way CreateBuffer
+// fills the graphic blocks, in MB/s.
+static double measure_copy(const std::vector<std::shared_ptr<C2StreamBuffer>> &frames,
+                           std::vector<uint8_t> &block, uint32_t block_stride, int iterations) {
+    uint32_t width = frames.front()->width;
+    uint32_t height = frames.front()->height;
+    uint8_t *y = block.data();
+    uint8_t *uv = y + block_stride * height;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < iterations; idx++) {
+        const C2StreamBuffer &frame = *frames[idx % frames.size()];
+        C2Convert::CopyPlane(frame.data + frame.offset[0], frame.stride[0], y, block_stride, width,
+                             height);
+        C2Convert::CopyPlane(frame.data + frame.offset[1], frame.stride[1], uv, block_stride,
+                             width, height / 2);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin)
+                         .count();
+    return static_cast<double>(width) * height * 3 / 2 * iterations / (seconds * 1024 * 1024);
+}
+
+// Allocation and fill of a frame per iteration, page faults of fresh memory
+// included, in microseconds per frame.
+static double measure_fill(const FrameAllocator &allocate, int iterations) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < iterations; idx++) {
+        std::shared_ptr<C2StreamBuffer> frame = allocate();
+        memset(frame->data, idx, frame->size);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin)
+                         .count();
+    return seconds * 1000000 / iterations;
+}
+
+static bool run(const char *name, const FrameAllocator &allocate, std::vector<uint8_t> &block,
+                uint32_t block_stride, int iterations) {
+    std::vector<std::shared_ptr<C2StreamBuffer>> frames;
+    for (int idx = 0; idx < NUM_FRAMES; idx++) {
+        frames.push_back(allocate());
+        if (!frames.back() || frames.back()->data == nullptr) {
+            base::LogError() << "Failed to allocate " << name << " frames";
+            return false;
+        }
+        memset(frames.back()->data, idx, frames.back()->size);
+    }
+
+    // Warm up, then measure.
+    measure_copy(frames, block, block_stride, NUM_FRAMES);
+    double copy = measure_copy(frames, block, block_stride, iterations);
+    frames.clear();
+    double fill = measure_fill(allocate, iterations);
+
+    base::LogInfo() << name << ": copy " << copy << " MB/s, allocate and fill " << fill
+                    << " us/frame";
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    uint32_t width = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 3840;
+    uint32_t height = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 2160;
+    int iterations = (argc > 3) ? atoi(argv[3]) : 200;
+
+    C2FrameArena &arena = C2FrameArena::Instance();
+    C2FrameArenaConfig config;
+    arena.Configure(config);
+    if (!check_recycling(width, height) || !check_unsupported(width, height)) {
+        return 1;
+    }
+
+    C2StreamBuffer layout = {};
+    C2FrameArena::DescribeFrame(nullptr, C2PixelFormat::kNV12, width, height, layout);
+    std::vector<uint8_t> block(layout.size);
+    uint32_t block_stride = layout.stride[0];
+
+    auto heap = [width, height] { return heap_frame(width, height); };
+    auto staged = [&arena, width, height] {
+        return arena.Acquire(C2PixelFormat::kNV12, width, height);
+    };
+
+    base::LogInfo() << "NV12 " << width << "x" << height << ", " << iterations << " iterations";
+    bool ok = run("heap", heap, block, block_stride, iterations);
+
+    config.hugepages = false;
+    arena.Configure(config);
+    ok = ok && run("arena on small pages", staged, block, block_stride, iterations);
+
+    config.hugepages = true;
+    arena.Configure(config);
+    C2HugePages pages = arena.GetHugePages();
+    if (pages == C2HugePages::kNone) {
+        base::LogInfo() << "No hugepages available, arena falls back to small pages";
+    }
+    ok = ok && run((std::string("arena on ") + pages_name(pages)).c_str(), staged, block,
+                   block_stride, iterations);
+
+    C2FrameArenaUsage usage;
+    arena.GetUsage(usage);
+    base::LogInfo() << "Arena " << usage.hits << " hits, " << usage.misses << " misses, "
+                    << usage.explicit_maps << " explicit, " << usage.transparent_maps
+                    << " transparent and " << usage.small_maps << " small page mappings";
+    arena.Trim();
+    return ok ? 0 : 1;
+}
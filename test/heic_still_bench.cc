@@ -0,0 +1,58 @@
+#include <stdlib.h>
+
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_still_image.h"
+
+/// 48 MP sensor resolution.
+#define WIDTH 8064
+#define HEIGHT 6048
+
+int main(int argc, const char *argv[]) {
+    int images = (argc > 1) ? atoi(argv[1]) : 5;
+    const char *path = (argc > 2) ? argv[2] : "still.heic";
+
+    C2StillImageConfig config;
+    C2StillImageEncoder encoder(config);
+    if (!encoder.Open()) {
+        base::LogError() << "Failed to open the HEIC encoder";
+        return 1;
+    }
+
+    std::vector<uint8_t> nv12(WIDTH * HEIGHT * 3 / 2);
+    C2StreamBuffer image = {};
+    image.data = nv12.data();
+    image.size = nv12.size();
+    image.width = WIDTH;
+    image.height = HEIGHT;
+    image.offset[1] = WIDTH * HEIGHT;
+    image.stride[0] = WIDTH;
+    image.stride[1] = WIDTH;
+    image.planes = 2;
+    image.pixel_format = C2PixelFormat::kNV12;
+
+    double total = 0;
+    uint64_t fill = 0;
+    for (int idx = 0; idx < images; idx++) {
+        // Diagonal gradient changing with every image.
+        for (uint32_t row = 0; row < HEIGHT; row++) {
+            for (uint32_t col = 0; col < WIDTH; col++) {
+                nv12[row * WIDTH + col] = static_cast<uint8_t>((row + col) / 16 + idx * 8);
+            }
+        }
+
+        C2StillImageStats stats;
+        if (!encoder.Encode(&image, path, stats)) {
+            base::LogError() << "Encoding image " << idx << " failed";
+            return 1;
+        }
+        total += stats.time_per_mp;
+        fill += stats.fill_time;
+    }
+
+    base::LogInfo() << WIDTH << "x" << HEIGHT << " in " << config.tile_size << " px tiles: "
+                    << total / images << " us per megapixel, tile copies "
+                    << fill / images << " us per image";
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_heif_writer.h"
+#include "src/c2_nal_parser.h"
+#include "test/c2_test_check.h"
+#include "test/c2_test_stream.h"
+
+#define TILE_SIZE 512
+
+static uint32_t read_u16(const uint8_t *data) {
+    return (data[0] << 8) | data[1];
+}
+
+static uint32_t read_u32(const uint8_t *data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+/** Box
+ *
+ * Location of a box payload inside the file.
+ **/
+struct Box {
+    std::string type;
+    size_t payload;
+    size_t size;
+};
+
+static std::vector<Box> children(const std::vector<uint8_t> &file, size_t begin, size_t end) {
+    std::vector<Box> boxes;
+    while (begin + 8 <= end) {
+        uint32_t size = read_u32(file.data() + begin);
+        if (size < 8 || begin + size > end) {
+            break;
+        }
+        boxes.push_back({std::string(reinterpret_cast<const char *>(file.data() + begin + 4), 4),
+                         begin + 8, size - 8u});
+        begin += size;
+    }
+    return boxes;
+}
+
+static const Box *find(const std::vector<Box> &boxes, const char *type) {
+    for (const Box &box : boxes) {
+        if (box.type == type) {
+            return &box;
+        }
+    }
+    return nullptr;
+}
+
+static bool check_grid(uint32_t width, uint32_t height) {
+    C2HeifGrid grid;
+    grid.width = width;
+    grid.height = height;
+    grid.tile_width = TILE_SIZE;
+    grid.tile_height = TILE_SIZE;
+    grid.columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    grid.rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t count = grid.columns * grid.rows;
+
+    // Tiles as the encoder stores them, length prefixed slices without parameter sets.
+    C2TestStream stream(true, TILE_SIZE, TILE_SIZE);
+    C2NalParser parser(C2CodecType::HEICVideoEncode);
+    std::vector<std::vector<uint8_t>> tiles(count);
+    for (uint32_t idx = 0; idx < count; idx++) {
+        std::vector<uint8_t> au = stream.AccessUnit(true, 1000 + idx * 7, idx == 0);
+        C2AccessUnitInfo info;
+        parser.Parse(au.data(), au.size(), info);
+        for (const C2NalUnit &nal : info.nals) {
+            if (nal.type >= 32 && nal.type <= 35) {
+                continue;
+            }
+            uint8_t length[4] = {static_cast<uint8_t>(nal.size >> 24),
+                                 static_cast<uint8_t>(nal.size >> 16),
+                                 static_cast<uint8_t>(nal.size >> 8),
+                                 static_cast<uint8_t>(nal.size)};
+            tiles[idx].insert(tiles[idx].end(), length, length + 4);
+            tiles[idx].insert(tiles[idx].end(), au.data() + nal.offset,
+                              au.data() + nal.offset + nal.size);
+        }
+    }
+
+    std::string path = "heif_writer_test.heic";
+    bool ok = check(C2HeifWriter::Write(path, grid, parser.GetCodecConfig(), tiles), "write");
+
+    std::vector<uint8_t> file;
+    FILE *input = fopen(path.c_str(), "rb");
+    if (input != nullptr) {
+        uint8_t chunk[65536];
+        size_t size;
+        while ((size = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+            file.insert(file.end(), chunk, chunk + size);
+        }
+        fclose(input);
+    }
+    unlink(path.c_str());
+
+    std::vector<Box> top = children(file, 0, file.size());
+    const Box *ftyp = find(top, "ftyp");
+    const Box *meta = find(top, "meta");
+    const Box *mdat = find(top, "mdat");
+    ok = ok && check(ftyp && meta && mdat, "top level boxes");
+    ok = ok && check(memcmp(file.data() + ftyp->payload, "heic", 4) == 0, "brand");
+    ok = ok && check(mdat->payload + mdat->size == file.size(), "mdat ends the file");
+    if (!ok) {
+        return false;
+    }
+
+    // meta is a full box, its children follow version and flags.
+    std::vector<Box> items = children(file, meta->payload + 4, meta->payload + meta->size);
+    const Box *pitm = find(items, "pitm");
+    const Box *iloc = find(items, "iloc");
+    const Box *iinf = find(items, "iinf");
+    const Box *iref = find(items, "iref");
+    const Box *iprp = find(items, "iprp");
+    ok = ok && check(find(items, "hdlr") && pitm && iloc && iinf && iref && iprp, "meta boxes");
+    if (!ok) {
+        return false;
+    }
+
+    uint32_t primary = read_u16(file.data() + pitm->payload + 4);
+    ok = ok && check(read_u16(file.data() + iinf->payload + 4) == count + 1, "item count");
+
+    std::vector<Box> refs = children(file, iref->payload + 4, iref->payload + iref->size);
+    ok = ok && check(refs.size() == 1 && refs[0].type == "dimg", "dimg reference");
+    ok = ok && check(read_u16(file.data() + refs[0].payload) == primary &&
+                         read_u16(file.data() + refs[0].payload + 2) == count,
+                     "grid derived from every tile");
+
+    std::vector<Box> properties = children(file, iprp->payload, iprp->payload + iprp->size);
+    const Box *ipco = find(properties, "ipco");
+    ok = ok && check(ipco && find(properties, "ipma"), "properties");
+    ok = ok && check(find(children(file, ipco->payload, ipco->payload + ipco->size), "hvcC"),
+                     "hvcC property");
+
+    // Extents of the items, keyed by item ID.
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> extents;
+    const uint8_t *entry = file.data() + iloc->payload + 4;
+    ok = ok && check(entry[0] == 0x44 && entry[1] == 0, "iloc field sizes");
+    uint32_t entries = read_u16(entry + 2);
+    entry += 4;
+    for (uint32_t idx = 0; idx < entries; idx++, entry += 14) {
+        extents[read_u16(entry)] = {read_u32(entry + 6), read_u32(entry + 10)};
+    }
+    ok = ok && check(extents.size() == count + 1, "iloc entries");
+
+    auto grid_extent = extents[primary];
+    const uint8_t *descriptor = file.data() + grid_extent.first;
+    bool large = descriptor[1] & 1;
+    ok = ok && check(grid_extent.first >= mdat->payload, "grid inside mdat");
+    ok = ok && check(descriptor[2] + 1u == grid.rows && descriptor[3] + 1u == grid.columns,
+                     "grid dimensions");
+    ok = ok && check(large ? (read_u32(descriptor + 4) == width &&
+                              read_u32(descriptor + 8) == height)
+                           : (read_u16(descriptor + 4) == width &&
+                              read_u16(descriptor + 6) == height),
+                     "grid output size");
+
+    const uint8_t *tile_refs = file.data() + refs[0].payload + 4;
+    for (uint32_t idx = 0; ok && idx < count; idx++) {
+        auto extent = extents[read_u16(tile_refs + idx * 2)];
+        ok = ok && check(extent.first + extent.second <= file.size() &&
+                             extent.second == tiles[idx].size() &&
+                             memcmp(file.data() + extent.first, tiles[idx].data(),
+                                    extent.second) == 0,
+                         "tile data in raster order");
+    }
+
+    base::LogInfo() << "HEIF grid " << grid.columns << "x" << grid.rows << " for " << width
+                    << "x" << height << " verified, " << file.size() << " bytes";
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    // Exact fit, partial edge tiles and a 48 MP sensor resolution.
+    if (!check_grid(1024, 1024) || !check_grid(1920, 1080) || !check_grid(8064, 6048)) {
+        return 1;
+    }
+
+    // A grid not covering the image is rejected.
+    C2HeifGrid grid = {2000, 1000, TILE_SIZE, TILE_SIZE, 2, 2};
+    std::vector<std::vector<uint8_t>> tiles(4);
+    std::vector<uint8_t> header;
+    if (!check(!C2HeifWriter::BuildHeader(grid, C2CodecConfig(), tiles, header),
+               "uncovered grid rejected")) {
+        return 1;
+    }
+
+    base::LogInfo() << "HEIF writer checks passed";
+    return 0;
+}
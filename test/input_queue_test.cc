@@ -0,0 +1,202 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_input_queue.h"
+#include "src/c2_stats.h"
+
+/** FakeComponent
+ *
+ * Records submitted, dropped and cancelled frames, in-flight frames are
+ * released by hand.
+ **/
+class FakeComponent {
+public:
+    explicit FakeComponent(const C2LatencyBudgetConfig &config)
+        : in_flight_(0),
+          queue_(
+              config, [this](C2InputEntry &entry) { return Submit(entry); },
+              [this](uint64_t index) { Drop(index); }, [this](uint64_t index) { Cancel(index); },
+              [this]() { return in_flight_.load(); }) {
+        queue_.Start();
+    }
+
+    void Push(uint64_t index, uint64_t budget_us) {
+        C2InputEntry entry;
+        entry.index = index;
+        entry.timestamp = index * 33333;
+        entry.deadline = C2Stats::Now() + budget_us;
+        entry.request_sync = false;
+        queue_.Push(std::move(entry));
+    }
+
+    void Stop() { queue_.Stop(); }
+
+    void Release() {
+        in_flight_--;
+        queue_.Notify();
+    }
+
+    std::vector<uint64_t> Submitted() {
+        std::lock_guard<std::mutex> lk(lock_);
+        return submitted_;
+    }
+    std::vector<uint64_t> Dropped() {
+        std::lock_guard<std::mutex> lk(lock_);
+        return dropped_;
+    }
+    std::vector<uint64_t> Cancelled() {
+        std::lock_guard<std::mutex> lk(lock_);
+        return cancelled_;
+    }
+    std::vector<uint64_t> SyncRequests() {
+        std::lock_guard<std::mutex> lk(lock_);
+        return sync_;
+    }
+private:
+    bool Submit(C2InputEntry &entry) {
+        std::lock_guard<std::mutex> lk(lock_);
+        in_flight_++;
+        submitted_.push_back(entry.index);
+        if (entry.request_sync) {
+            sync_.push_back(entry.index);
+        }
+        return true;
+    }
+
+    void Drop(uint64_t index) {
+        std::lock_guard<std::mutex> lk(lock_);
+        dropped_.push_back(index);
+    }
+
+    void Cancel(uint64_t index) {
+        std::lock_guard<std::mutex> lk(lock_);
+        cancelled_.push_back(index);
+    }
+
+    std::atomic<uint32_t> in_flight_;
+    std::mutex lock_;
+    std::vector<uint64_t> submitted_;
+    std::vector<uint64_t> dropped_;
+    std::vector<uint64_t> cancelled_;
+    std::vector<uint64_t> sync_;
+    C2InputQueue queue_;
+};
+
+#define FAR_DEADLINE_US 10000000
+#define SETTLE_US 20000
+
+static bool expect(const std::vector<uint64_t> &value, const std::vector<uint64_t> &expected,
+                   const char *what) {
+    if (value != expected) {
+        base::LogError() << what << ": got " << value.size() << " frames, expected "
+                         << expected.size();
+        return false;
+    }
+    return true;
+}
+
+static bool check_window() {
+    C2LatencyBudgetConfig config;
+    config.max_in_flight = 2;
+    config.queue_depth = 4;
+    FakeComponent component(config);
+
+    for (uint64_t index = 0; index < 5; index++) {
+        component.Push(index, FAR_DEADLINE_US);
+        usleep(1000);
+    }
+    usleep(SETTLE_US);
+    bool ok = expect(component.Submitted(), {0, 1}, "window");
+
+    component.Release();
+    usleep(SETTLE_US);
+    ok = ok && expect(component.Submitted(), {0, 1, 2}, "release");
+    ok = ok && expect(component.Dropped(), {}, "no drops");
+    return ok;
+}
+
+static bool check_deadline() {
+    C2LatencyBudgetConfig config;
+    config.max_in_flight = 1;
+    FakeComponent component(config);
+
+    component.Push(0, FAR_DEADLINE_US);
+    usleep(1000);
+    component.Push(1, 10000);
+    component.Push(2, 10000);
+    component.Push(3, FAR_DEADLINE_US);
+    usleep(SETTLE_US * 2);
+
+    bool ok = expect(component.Dropped(), {1, 2}, "expired");
+    component.Release();
+    usleep(SETTLE_US);
+    ok = ok && expect(component.Submitted(), {0, 3}, "after expiry");
+    ok = ok && expect(component.SyncRequests(), {3}, "sync after gap");
+    return ok;
+}
+
+static bool check_coalesce() {
+    C2LatencyBudgetConfig config;
+    config.max_in_flight = 1;
+    config.policy = C2OverloadPolicy::kCoalesce;
+    FakeComponent component(config);
+
+    for (uint64_t index = 0; index < 4; index++) {
+        component.Push(index, FAR_DEADLINE_US);
+        usleep(1000);
+    }
+    usleep(SETTLE_US);
+    bool ok = expect(component.Dropped(), {1, 2}, "coalesced");
+
+    component.Release();
+    usleep(SETTLE_US);
+    ok = ok && expect(component.Submitted(), {0, 3}, "newest frame");
+    return ok;
+}
+
+static bool check_depth() {
+    C2LatencyBudgetConfig config;
+    config.max_in_flight = 1;
+    config.queue_depth = 2;
+    FakeComponent component(config);
+
+    for (uint64_t index = 0; index < 5; index++) {
+        component.Push(index, FAR_DEADLINE_US);
+        usleep(1000);
+    }
+    usleep(SETTLE_US);
+    return expect(component.Dropped(), {1, 2}, "queue depth");
+}
+
+static bool check_stop() {
+    C2LatencyBudgetConfig config;
+    config.max_in_flight = 1;
+    FakeComponent component(config);
+
+    for (uint64_t index = 0; index < 4; index++) {
+        component.Push(index, FAR_DEADLINE_US);
+        usleep(1000);
+    }
+    usleep(SETTLE_US);
+
+    // Frames still waiting are cancelled, they did not miss their deadline.
+    component.Stop();
+    bool ok = expect(component.Submitted(), {0}, "submitted before stop");
+    ok = ok && expect(component.Cancelled(), {1, 2, 3}, "cancelled on stop");
+    ok = ok && expect(component.Dropped(), {}, "not dropped on stop");
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    if (!check_window() || !check_deadline() || !check_coalesce() || !check_depth() ||
+        !check_stop()) {
+        return 1;
+    }
+
+    base::LogInfo() << "Input queue checks passed";
+    return 0;
+}
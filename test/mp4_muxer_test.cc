@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_stream.h"
+#include "src/c2_mp4_muxer.h"
+
+#define GOP_SIZE 10
+#define NUM_GOPS 3
+
+static uint32_t read32(const uint8_t *data) {
+    return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static bool find_box(const uint8_t *data, size_t size, const char *path[], size_t depth,
+                     const uint8_t **box, size_t *box_size) {
+    size_t position = 0;
+    while (position + 8 <= size) {
+        uint32_t length = read32(data + position);
+        if (length < 8 || position + length > size) {
+            return false;
+        }
+        if (memcmp(data + position + 4, path[0], 4) == 0) {
+            if (depth == 1) {
+                *box = data + position;
+                *box_size = length;
+                return true;
+            }
+            // Full boxes and sample entries carry fields before their children.
+            size_t header = (memcmp(path[0], "stsd", 4) == 0) ? 16
+                            : (memcmp(path[0], "avc1", 4) == 0 || memcmp(path[0], "hvc1", 4) == 0)
+                                ? 86
+                                : 8;
+            return find_box(data + position + header, length - header, path + 1, depth - 1, box,
+                            box_size);
+        }
+        position += length;
+    }
+    return false;
+}
+
+static bool verify(const std::string &path, bool hevc, uint32_t num_fragments,
+                   uint32_t num_frames) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    std::vector<uint8_t> file;
+    uint8_t chunk[65536];
+    size_t count = 0;
+    while ((count = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        file.insert(file.end(), chunk, chunk + count);
+    }
+    fclose(fp);
+
+    const uint8_t *box = nullptr;
+    size_t box_size = 0;
+    const char *config_path[] = {"moov", "trak", "mdia", "minf", "stbl", "stsd",
+                                 hevc ? "hvc1" : "avc1", hevc ? "hvcC" : "avcC"};
+    if (!find_box(file.data(), file.size(), config_path, 8, &box, &box_size)) {
+        base::LogError() << "Missing codec configuration record";
+        return false;
+    }
+
+    // Walk the top level boxes: ftyp, moov and then moof/mdat pairs.
+    size_t position = 0;
+    uint32_t fragments = 0;
+    uint32_t samples = 0;
+    std::vector<uint32_t> sizes;
+    while (position + 8 <= file.size()) {
+        uint32_t length = read32(file.data() + position);
+        const uint8_t *type = file.data() + position + 4;
+        if (length < 8 || position + length > file.size()) {
+            base::LogError() << "Corrupted box at " << position;
+            return false;
+        }
+
+        if (memcmp(type, "moof", 4) == 0) {
+            const char *trun_path[] = {"traf", "trun"};
+            if (!find_box(file.data() + position + 8, length - 8, trun_path, 2, &box, &box_size)) {
+                base::LogError() << "Fragment without trun";
+                return false;
+            }
+            uint32_t sample_count = read32(box + 12);
+            uint32_t data_offset = read32(box + 16);
+            if (data_offset != length + 8) {
+                base::LogError() << "Unexpected data offset " << data_offset;
+                return false;
+            }
+            sizes.clear();
+            for (uint32_t idx = 0; idx < sample_count; idx++) {
+                sizes.push_back(read32(box + 20 + idx * 12 + 4));
+            }
+            samples += sample_count;
+            fragments++;
+        } else if (memcmp(type, "mdat", 4) == 0) {
+            // Every sample must be an exact chain of length prefixed NAL units.
+            size_t offset = position + 8;
+            for (uint32_t size : sizes) {
+                size_t end = offset + size;
+                while (offset < end) {
+                    offset += 4 + read32(file.data() + offset);
+                }
+                if (offset != end) {
+                    base::LogError() << "Sample is not length prefixed correctly";
+                    return false;
+                }
+            }
+            if (offset != position + length) {
+                base::LogError() << "mdat size does not match the trun sample sizes";
+                return false;
+            }
+        }
+        position += length;
+    }
+
+    if (position != file.size() || fragments != num_fragments || samples != num_frames) {
+        base::LogError() << "Unexpected layout: " << fragments << " fragments, " << samples
+                         << " samples";
+        return false;
+    }
+
+    return true;
+}
+
+static bool run(bool hevc) {
+    std::string path = hevc ? "mp4_muxer_test_hevc.mp4" : "mp4_muxer_test_avc.mp4";
+
+    C2Mp4MuxerConfig config;
+    config.path = path;
+    config.hevc = hevc;
+    config.width = 1920;
+    config.height = 1080;
+
+    C2Mp4Muxer muxer(config);
+    if (!muxer.Open()) {
+        return false;
+    }
+
+    C2TestStream stream(hevc, 1920, 1080);
+    C2NalParser parser(hevc ? C2CodecType::H265VideoEncode : C2CodecType::H264VideoEncode);
+
+    for (uint32_t idx = 0; idx < GOP_SIZE * NUM_GOPS; idx++) {
+        bool sync = (idx % GOP_SIZE) == 0;
+        std::vector<uint8_t> au = stream.AccessUnit(sync, sync ? 64 * 1024 : 8 * 1024);
+
+        C2EncodedFrame frame;
+        frame.data = au.data();
+        frame.size = au.size();
+        frame.index = idx;
+        frame.timestamp = idx * 33333;
+        frame.flags = 0;
+        parser.Parse(au.data(), au.size(), frame.au);
+        frame.config = &parser.GetCodecConfig();
+        frame.config_version = parser.GetConfigVersion();
+
+        muxer.OnFrame(frame);
+    }
+    muxer.Close();
+
+    C2HevcSpsInfo info;
+    if (hevc && (!C2Mp4Utils::ParseHevcSps(parser.GetCodecConfig().sps, info) ||
+                 info.width != 1920 || info.height != 1080)) {
+        base::LogError() << "Failed to parse the HEVC SPS";
+        return false;
+    }
+
+    bool success = verify(path, hevc, NUM_GOPS, GOP_SIZE * NUM_GOPS);
+    base::LogInfo() << (hevc ? "HEVC" : "AVC") << " fragmented MP4 "
+                    << (success ? "verified, " : "FAILED, ") << path;
+    return success;
+}
+
+// A resolution switch changes the parameter sets, the file keeps the GOPs before it.
+static bool run_config_change() {
+    std::string path = "mp4_muxer_test_switch.mp4";
+
+    C2Mp4MuxerConfig config;
+    config.path = path;
+    config.hevc = true;
+    config.width = 1920;
+    config.height = 1080;
+
+    C2Mp4Muxer muxer(config);
+    if (!muxer.Open()) {
+        return false;
+    }
+
+    C2TestStream full(true, 1920, 1080);
+    C2TestStream reduced(true, 1280, 720);
+    C2NalParser parser(C2CodecType::H265VideoEncode);
+
+    for (uint32_t idx = 0; idx < GOP_SIZE * NUM_GOPS; idx++) {
+        bool sync = (idx % GOP_SIZE) == 0;
+        C2TestStream &stream = (idx < GOP_SIZE * (NUM_GOPS - 1)) ? full : reduced;
+        std::vector<uint8_t> au = stream.AccessUnit(sync, sync ? 64 * 1024 : 8 * 1024);
+
+        C2EncodedFrame frame;
+        frame.data = au.data();
+        frame.size = au.size();
+        frame.index = idx;
+        frame.timestamp = idx * 33333;
+        frame.flags = 0;
+        parser.Parse(au.data(), au.size(), frame.au);
+        frame.config = &parser.GetCodecConfig();
+        frame.config_version = parser.GetConfigVersion();
+
+        muxer.OnFrame(frame);
+    }
+    muxer.Close();
+
+    bool success = verify(path, true, NUM_GOPS - 1, GOP_SIZE * (NUM_GOPS - 1));
+    base::LogInfo() << "Codec config change " << (success ? "verified, " : "FAILED, ") << path;
+    return success;
+}
+
+int main(int argc, const char *argv[]) {
+    if (!run(false) || !run(true) || !run_config_change()) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_nal_parser.h"
+
+// Build a synthetic H.264 I-frame access unit: AUD, SPS, PPS and an IDR slice
+// with a random payload of the given size, emulation prevention applied.
+static std::vector<uint8_t> make_access_unit(size_t payload_size) {
+    std::vector<uint8_t> au = {0, 0, 0, 1, 0x09, 0xF0,                          // AUD
+                               0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9,  // SPS
+                               0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB,              // PPS
+                               0, 0, 1, 0x65};                                  // IDR
+
+    std::mt19937 rng(1234);
+    size_t zeros = 0;
+    for (size_t idx = 0; idx < payload_size; idx++) {
+        // Bias towards zero bytes so that the scanners see near misses.
+        uint8_t value = (rng() % 8 == 0) ? 0 : static_cast<uint8_t>(rng());
+        if (zeros >= 2 && value <= 3) {
+            au.push_back(0x03);
+            zeros = 0;
+        }
+        au.push_back(value);
+        zeros = (value == 0) ? zeros + 1 : 0;
+    }
+    au.push_back(0x80);
+
+    return au;
+}
+
+template <typename Func>
+static double measure_mbps(const std::vector<uint8_t> &au, int iterations, Func func) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < iterations; idx++) {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return (static_cast<double>(au.size()) * iterations) / (seconds * 1024 * 1024);
+}
+
+int main(int argc, const char *argv[]) {
+    size_t payload_size = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (4 * 1024 * 1024);
+    int iterations = (argc > 2) ? atoi(argv[2]) : 50;
+
+    std::vector<uint8_t> au = make_access_unit(payload_size);
+
+    std::vector<C2NalUnit> scalar_nals, simd_nals;
+    C2NalParser::Split(au.data(), au.size(), false, true, scalar_nals);
+    C2NalParser::Split(au.data(), au.size(), false, false, simd_nals);
+
+    if (scalar_nals.size() != simd_nals.size()) {
+        base::LogError() << "NAL count mismatch, scalar " << scalar_nals.size() << " simd "
+                         << simd_nals.size();
+        return 1;
+    }
+    for (size_t idx = 0; idx < scalar_nals.size(); idx++) {
+        if (scalar_nals[idx].offset != simd_nals[idx].offset ||
+            scalar_nals[idx].size != simd_nals[idx].size) {
+            base::LogError() << "NAL " << idx << " mismatch between scalar and simd scanner";
+            return 1;
+        }
+    }
+
+    C2NalParser parser(C2CodecType::H264VideoEncode);
+    C2AccessUnitInfo info;
+    if (!parser.Parse(au.data(), au.size(), info) || !info.is_sync || !info.has_config ||
+        parser.GetCodecConfig().sps.empty() || parser.GetCodecConfig().pps.empty()) {
+        base::LogError() << "Failed to classify the synthetic IDR access unit";
+        return 1;
+    }
+
+    std::vector<C2NalUnit> nals;
+    nals.reserve(scalar_nals.size());
+
+    double scalar = measure_mbps(au, iterations, [&]() {
+        nals.clear();
+        C2NalParser::Split(au.data(), au.size(), false, true, nals);
+    });
+    double simd = measure_mbps(au, iterations, [&]() {
+        nals.clear();
+        C2NalParser::Split(au.data(), au.size(), false, false, nals);
+    });
+
+    base::LogInfo() << "access unit " << au.size() << " bytes, " << info.nals.size() << " NALs";
+    base::LogInfo() << "scalar scanner: " << scalar << " MB/s";
+    base::LogInfo() << "simd scanner:   " << simd << " MB/s (x" << simd / scalar << ")";
+    return 0;
+}
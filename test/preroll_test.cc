@@ -0,0 +1,231 @@
+#include <C2PlatformSupport.h>
+#include <C2Work.h>
+#include <string.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "src/c2_engine.h"
+#include "src/c2_preroll_sink.h"
+#include "test/c2_test_check.h"
+#include "test/c2_test_stream.h"
+
+#define FRAME_DURATION_US 33333
+#define GOP_SIZE 15
+#define PAYLOAD_SIZE 2000
+
+static C2TestEncoderConfig encoder_config(C2TestConfigMode mode) {
+    C2TestEncoderConfig config;
+    config.config_mode = mode;
+    config.gop_size = GOP_SIZE;
+    config.payload_size = PAYLOAD_SIZE;
+    config.frame_duration_us = FRAME_DURATION_US;
+    return config;
+}
+
+/** RecordingSink
+ *
+ * Keeps a copy of every frame it receives.
+ **/
+class RecordingSink : public IC2OutputSink {
+public:
+    struct Frame {
+        std::vector<uint8_t> data;
+        uint64_t index;
+        uint32_t flags;
+        bool is_sync;
+        bool has_config_record;
+    };
+
+    void OnFrame(const C2EncodedFrame &frame) override {
+        Frame copy;
+        copy.data.assign(frame.data, frame.data + frame.size);
+        copy.index = frame.index;
+        copy.flags = frame.flags;
+        copy.is_sync = frame.au.is_sync;
+        copy.has_config_record = frame.config != nullptr;
+        frames.push_back(copy);
+    }
+
+    std::vector<Frame> frames;
+};
+
+static bool check_window() {
+    C2PreRollConfig config;
+    config.duration_ms = 2000;
+    C2PreRollSink preroll(config);
+    C2TestEncoder encoder(encoder_config(C2TestConfigMode::kInline));
+
+    // Stream joined in the middle of a GOP.
+    encoder.Encode(preroll, false);
+    encoder.Encode(preroll, false);
+    encoder.EncodeFrames(preroll, 10 * 30);
+
+    C2PreRollStats stats;
+    preroll.GetStats(stats);
+    bool ok = check(stats.duration >= config.duration_ms * 1000ull, "window covers duration");
+    ok = ok && check(stats.duration < (config.duration_ms * 1000ull +
+                                       GOP_SIZE * FRAME_DURATION_US),
+                     "at most one extra GOP");
+    ok = ok && check(stats.copied_bytes == stats.bytes, "frames without buffer are copied");
+
+    auto recorder = std::make_shared<RecordingSink>();
+    uint32_t count = preroll.Trigger(recorder, true);
+    ok = ok && check(count == stats.frames && recorder->frames.size() == count, "replayed");
+    ok = ok && check(recorder->frames.front().is_sync, "starts at sync frame");
+
+    uint32_t syncs = 0;
+    for (auto &frame : recorder->frames) {
+        syncs += frame.is_sync ? 1 : 0;
+        ok = ok && check(frame.data == encoder.encoded[frame.index], "replayed data");
+        ok = ok && check(frame.has_config_record, "config attached");
+    }
+    uint64_t first = recorder->frames.front().index;
+    uint64_t last = recorder->frames.back().index;
+    ok = ok && check(syncs == stats.gops && first % GOP_SIZE == 0 && count == last - first + 1,
+                     "whole GOPs");
+
+    // Live frames follow the pre-roll until detached.
+    encoder.EncodeFrames(preroll, 10);
+    ok = ok && check(recorder->frames.size() == count + 10, "follow");
+    preroll.Detach();
+    encoder.EncodeFrames(preroll, 10);
+    ok = ok && check(recorder->frames.size() == count + 10, "detach");
+    return ok;
+}
+
+static bool check_memory_cap() {
+    C2PreRollConfig config;
+    config.duration_ms = 60000;
+    config.max_bytes = 3 * GOP_SIZE * (PAYLOAD_SIZE + 200);
+    C2PreRollSink preroll(config);
+    C2TestEncoder encoder(encoder_config(C2TestConfigMode::kInline));
+    encoder.EncodeFrames(preroll, 20 * GOP_SIZE);
+
+    C2PreRollStats stats;
+    preroll.GetStats(stats);
+    bool ok = check(stats.bytes <= config.max_bytes, "bytes capped");
+    ok = ok && check(stats.gops >= 2 && stats.evicted_gops > 0, "GOPs evicted");
+
+    auto recorder = std::make_shared<RecordingSink>();
+    preroll.Trigger(recorder, false);
+    ok = ok && check(recorder->frames.front().is_sync, "capped window starts at sync frame");
+
+    // A GOP which alone exceeds the cap is discarded as a whole.
+    config.max_bytes = GOP_SIZE * PAYLOAD_SIZE / 2;
+    C2PreRollSink small(config);
+    encoder.EncodeFrames(small, 4 * GOP_SIZE);
+    small.GetStats(stats);
+    ok = ok && check(stats.overflows > 0 && stats.bytes <= config.max_bytes, "overflow");
+    return ok;
+}
+
+static bool check_config_injection() {
+    C2PreRollConfig config;
+    config.duration_ms = 1000;
+    C2PreRollSink preroll(config);
+    C2TestEncoder encoder(encoder_config(C2TestConfigMode::kAttached));
+    encoder.EncodeFrames(preroll, 5 * GOP_SIZE);
+
+    auto recorder = std::make_shared<RecordingSink>();
+    preroll.Trigger(recorder, false);
+    bool ok = check(recorder->frames.size() > 1, "frames replayed");
+    ok = ok && check(recorder->frames[0].flags & C2FrameData::FLAG_CODEC_CONFIG,
+                     "parameter sets ahead of the window");
+    ok = ok && check(recorder->frames[1].is_sync, "sync frame after parameter sets");
+    return ok;
+}
+
+static std::shared_ptr<C2Buffer> linear_buffer(std::shared_ptr<C2BlockPool> &pool,
+                                               const std::vector<uint8_t> &data) {
+    std::shared_ptr<C2LinearBlock> block;
+    C2MemoryUsage usage = {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE};
+    if (pool->fetchLinearBlock(data.size(), usage, &block) != C2_OK) {
+        return nullptr;
+    }
+
+    C2WriteView view = block->map().get();
+    if (view.error() != C2_OK) {
+        return nullptr;
+    }
+    memcpy(view.data(), data.data(), data.size());
+    return C2Buffer::CreateLinearBuffer(block->share(0, data.size(), ::C2Fence()));
+}
+
+// Slices are assembled by the engine, the pre-roll must hold the whole frame
+// and not the buffer of its last slice.
+static bool check_slice_assembly() {
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        return std::static_pointer_cast<C2Component>(std::make_shared<FakeComponent>(name));
+    });
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    C2Factory::SetComponentCreator(nullptr);
+    if (engine == nullptr) {
+        return check(false, "engine created");
+    }
+
+    C2EngineConfig config = {1280, 720, 30.0f, 2000000, GOP_SIZE};
+    C2SliceOutputConfig slice_config = {true, 0, 0};
+    std::shared_ptr<C2BlockPool> pool;
+    bool ok = check(engine->c2_engine_configure(config) &&
+                        engine->c2_engine_slice_output(slice_config),
+                    "slice output configured");
+    ok = ok && check(::android::GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, nullptr, &pool) ==
+                         C2_OK,
+                     "linear pool");
+
+    C2PreRollConfig preroll_config;
+    preroll_config.max_references = 4;
+    auto preroll = std::make_shared<C2PreRollSink>(preroll_config);
+    engine->c2_engine_add_sink(preroll);
+
+    // Each frame is returned as two slices, only the last one completes it.
+    C2TestStream stream(false, 1280, 720);
+    std::map<uint64_t, std::vector<uint8_t>> encoded;
+    for (uint64_t index = 0; ok && index < 2 * GOP_SIZE; index++) {
+        std::vector<uint8_t> first = stream.AccessUnit(index % GOP_SIZE == 0, PAYLOAD_SIZE);
+        std::vector<uint8_t> second = stream.AccessUnit(false, PAYLOAD_SIZE + index, false);
+        std::shared_ptr<C2Buffer> head = linear_buffer(pool, first);
+        std::shared_ptr<C2Buffer> tail = linear_buffer(pool, second);
+        ok = check(head && tail, "slice buffers");
+        if (!ok) {
+            break;
+        }
+
+        uint64_t timestamp = index * FRAME_DURATION_US;
+        engine->FrameAvailable(head, index, timestamp, C2FrameData::FLAG_INCOMPLETE);
+        engine->FrameAvailable(tail, index, timestamp, 0);
+
+        first.insert(first.end(), second.begin(), second.end());
+        encoded[index] = first;
+    }
+
+    C2PreRollStats stats;
+    preroll->GetStats(stats);
+    ok = ok && check(stats.references == 0 && stats.copied_bytes == stats.bytes,
+                     "assembled frames are copied");
+
+    auto recorder = std::make_shared<RecordingSink>();
+    uint32_t count = preroll->Trigger(recorder, false);
+    ok = ok && check(count > 0 && recorder->frames.size() == count, "slices replayed");
+    for (auto &frame : recorder->frames) {
+        ok = ok && check(frame.data == encoded[frame.index], "replayed slice data");
+    }
+
+    C2Engine::free_c2_engine(engine);
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    if (!check_window() || !check_memory_cap() || !check_config_injection() ||
+        !check_slice_assembly()) {
+        return 1;
+    }
+
+    base::LogInfo() << "Pre-roll checks passed";
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_stream.h"
+#include "src/c2_rtp_sink.h"
+
+#define NUM_FRAMES 60
+#define GOP_SIZE 15
+
+/** Depacketizer
+ *
+ * Receiver side of RFC 6184/7798 limited to what the packetizer produces:
+ * single NAL unit packets and FU-A/FU fragments.
+ **/
+class Depacketizer {
+public:
+    Depacketizer(bool hevc) : hevc_(hevc) {}
+
+    // Returns false on a protocol error.
+    bool Push(const uint8_t *packet, size_t size) {
+        if (size < 13 || (packet[0] >> 6) != 2) {
+            return false;
+        }
+
+        uint16_t sequence = (packet[2] << 8) | packet[3];
+        if (started_ && sequence != static_cast<uint16_t>(sequence_ + 1)) {
+            base::LogError() << "Sequence gap " << sequence_ << " -> " << sequence;
+            return false;
+        }
+        started_ = true;
+        sequence_ = sequence;
+        marker_ = (packet[1] & 0x80) != 0;
+        timestamp_ = (packet[4] << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+
+        const uint8_t *payload = packet + 12;
+        size_t length = size - 12;
+
+        uint8_t type = hevc_ ? ((payload[0] >> 1) & 0x3F) : (payload[0] & 0x1F);
+        if (type != (hevc_ ? 49 : 28)) {
+            nals_.emplace_back(payload, payload + length);
+            return true;
+        }
+
+        uint32_t header_size = hevc_ ? 3 : 2;
+        uint8_t fu = payload[header_size - 1];
+        if (fu & 0x80) {
+            fragment_.clear();
+            if (hevc_) {
+                fragment_.push_back((payload[0] & 0x81) | ((fu & 0x3F) << 1));
+                fragment_.push_back(payload[1]);
+            } else {
+                fragment_.push_back((payload[0] & 0xE0) | (fu & 0x1F));
+            }
+        } else if (fragment_.empty()) {
+            return false;
+        }
+
+        fragment_.insert(fragment_.end(), payload + header_size, payload + length);
+        if (fu & 0x40) {
+            nals_.push_back(fragment_);
+            fragment_.clear();
+        }
+        return true;
+    }
+
+    std::vector<std::vector<uint8_t>> &Nals() { return nals_; }
+    bool Marker() const { return marker_; }
+    uint32_t Timestamp() const { return timestamp_; }
+private:
+    bool hevc_;
+    bool started_ = false;
+    bool marker_ = false;
+    uint16_t sequence_ = 0;
+    uint32_t timestamp_ = 0;
+    std::vector<uint8_t> fragment_;
+    std::vector<std::vector<uint8_t>> nals_;
+};
+
+static bool run(bool hevc) {
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    int size = 16 * 1024 * 1024;
+    setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(receiver, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(receiver, (struct sockaddr *)&addr, &addr_len) != 0) {
+        base::LogError() << "Failed to bind receiver socket";
+        return false;
+    }
+
+    C2RtpConfig config;
+    config.port = ntohs(addr.sin_port);
+    config.hevc = hevc;
+
+    C2RtpSink sink(config);
+    if (!sink.Open()) {
+        return false;
+    }
+
+    C2TestStream stream(hevc, 1280, 720);
+    C2NalParser parser(hevc ? C2CodecType::H265VideoEncode : C2CodecType::H264VideoEncode);
+    Depacketizer depacketizer(hevc);
+    uint8_t aud = hevc ? 35 : 9;
+
+    for (uint32_t idx = 0; idx < NUM_FRAMES; idx++) {
+        bool sync = (idx % GOP_SIZE) == 0;
+        // Only the first IDR carries the parameter sets, later ones rely on the resend.
+        std::vector<uint8_t> au = stream.AccessUnit(sync, sync ? 50000 : 3000 + idx * 37, idx == 0);
+
+        C2EncodedFrame frame;
+        frame.data = au.data();
+        frame.size = au.size();
+        frame.index = idx;
+        frame.timestamp = idx * 33333;
+        frame.flags = 0;
+        parser.Parse(au.data(), au.size(), frame.au);
+        frame.config = &parser.GetCodecConfig();
+        frame.config_version = parser.GetConfigVersion();
+
+        std::vector<std::vector<uint8_t>> expected;
+        if (sync && !frame.au.has_config) {
+            for (auto *ps : {&stream.Vps(), &stream.Sps(), &stream.Pps()}) {
+                if (!ps->empty()) {
+                    expected.push_back(*ps);
+                }
+            }
+        }
+        for (const C2NalUnit &nal : frame.au.nals) {
+            if (nal.type != aud) {
+                expected.emplace_back(au.data() + nal.offset, au.data() + nal.offset + nal.size);
+            }
+        }
+
+        sink.OnFrame(frame);
+
+        // Loopback delivery is synchronous, drain everything sent for this frame.
+        uint8_t packet[2048];
+        ssize_t length = 0;
+        while ((length = recv(receiver, packet, sizeof(packet), MSG_DONTWAIT)) > 0) {
+            if (!depacketizer.Push(packet, length)) {
+                base::LogError() << "Invalid packet in frame " << idx;
+                return false;
+            }
+        }
+
+        if (depacketizer.Nals() != expected || !depacketizer.Marker() ||
+            depacketizer.Timestamp() != static_cast<uint32_t>(frame.timestamp * 9 / 100)) {
+            base::LogError() << "Frame " << idx << " does not round trip, got "
+                             << depacketizer.Nals().size() << " NALs, expected "
+                             << expected.size();
+            return false;
+        }
+        depacketizer.Nals().clear();
+    }
+
+    base::LogInfo() << (hevc ? "HEVC" : "AVC") << " RTP round trip OK, " << sink.GetPacketsSent()
+                    << " packets, " << sink.GetBytesSent() << " bytes";
+    close(receiver);
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    if (!run(false) || !run(true)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "base/log.h"
+#include "base/thread_pool.h"
+#include "src/c2_scaler.h"
+
+static std::vector<uint8_t> random_plane(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (auto &value : data) {
+        value = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Vectorized and scalar vertical passes must give the same plane, whole or in stripes.
+static bool check_ratio(uint32_t src_width, uint32_t src_height, uint32_t dst_width,
+                        uint32_t dst_height, base::ThreadPool &pool) {
+    for (uint32_t channels = 1; channels <= 2; channels++) {
+        uint32_t src_stride = src_width * channels + 7;
+        uint32_t dst_stride = dst_width * channels + 5;
+        std::vector<uint8_t> src = random_plane(src_stride * src_height, src_width + channels);
+        std::vector<uint8_t> expected(dst_stride * dst_height, 0xAA);
+        std::vector<uint8_t> result(dst_stride * dst_height, 0xAA);
+
+        C2Scaler::ScalePlane(src.data(), src_stride, src_width, src_height, expected.data(),
+                             dst_stride, dst_width, dst_height, channels, 0, dst_height, true);
+
+        uint32_t stripes = 5;
+        pool.run(stripes, [&](size_t stripe) {
+            C2Scaler::ScalePlane(src.data(), src_stride, src_width, src_height, result.data(),
+                                 dst_stride, dst_width, dst_height, channels,
+                                 dst_height * stripe / stripes,
+                                 dst_height * (stripe + 1) / stripes);
+        });
+
+        if (expected != result) {
+            base::LogError() << "Scaler mismatch " << src_width << "x" << src_height << " -> "
+                             << dst_width << "x" << dst_height << ", channels " << channels;
+            return false;
+        }
+    }
+    return true;
+}
+
+// A flat plane stays flat and a box filter averages exactly.
+static bool check_values() {
+    std::vector<uint8_t> flat(64 * 64, 77), out(32 * 32);
+    C2Scaler::ScalePlane(flat.data(), 64, 64, 64, out.data(), 32, 24, 20, 1, 0, 20);
+    for (uint32_t row = 0; row < 20; row++) {
+        for (uint32_t col = 0; col < 24; col++) {
+            if (out[row * 32 + col] != 77) {
+                base::LogError() << "Bilinear changed a flat plane";
+                return false;
+            }
+        }
+    }
+
+    const uint8_t block[] = {10, 20, 30, 41};
+    uint8_t value = 0;
+    C2Scaler::ScalePlane(block, 2, 2, 2, &value, 1, 1, 1, 1, 0, 1);
+    if (value != 25) {
+        base::LogError() << "Box average " << int(value) << ", expected 25";
+        return false;
+    }
+    return true;
+}
+
+static void benchmark(uint32_t dst_width, uint32_t dst_height, int iterations) {
+    const uint32_t width = 1920, height = 1080;
+    std::vector<uint8_t> src = random_plane(width * height * 3 / 2, 3);
+    std::vector<uint8_t> dst(dst_width * dst_height * 3 / 2);
+
+    double rate[2];
+    for (int scalar = 0; scalar < 2; scalar++) {
+        auto begin = std::chrono::steady_clock::now();
+        for (int idx = 0; idx < iterations; idx++) {
+            C2Scaler::ScaleNV12(src.data(), width, src.data() + width * height, width, width,
+                                height, dst.data(), dst_width, dst.data() + dst_width * dst_height,
+                                dst_width, dst_width, dst_height, scalar != 0);
+        }
+        auto end = std::chrono::steady_clock::now();
+        rate[scalar] = iterations / std::chrono::duration<double>(end - begin).count();
+    }
+
+    base::LogInfo() << "1920x1080 -> " << dst_width << "x" << dst_height << ": scalar "
+                    << rate[1] << " fps, simd " << rate[0] << " fps";
+}
+
+int main(int argc, const char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 50;
+    base::ThreadPool pool(3);
+
+    const uint32_t ratios[][4] = {{1920, 1080, 1280, 720}, {1920, 1080, 640, 360},
+                                  {1920, 1080, 960, 540},  {1280, 720, 854, 480},
+                                  {66, 34, 22, 10},        {40, 30, 40, 30},
+                                  {37, 19, 13, 7},         {64, 64, 16, 16}};
+    for (const auto &ratio : ratios) {
+        if (!check_ratio(ratio[0], ratio[1], ratio[2], ratio[3], pool)) {
+            return 1;
+        }
+    }
+
+    if (!check_values()) {
+        return 1;
+    }
+    base::LogInfo() << "Scaler matches the scalar reference";
+
+    benchmark(1280, 720, iterations);
+    benchmark(640, 360, iterations);
+    return 0;
+}
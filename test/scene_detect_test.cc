@@ -0,0 +1,129 @@
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_scene_detector.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+
+static bool check_sad() {
+    std::mt19937 rng(7);
+    std::vector<uint8_t> a(64 * 20), b(48 * 20);
+    for (int iteration = 0; iteration < 1000; iteration++) {
+        for (auto &value : a) {
+            value = static_cast<uint8_t>(rng());
+        }
+        for (auto &value : b) {
+            value = static_cast<uint8_t>(rng());
+        }
+
+        uint32_t offset = rng() % 16;
+        uint32_t scalar = C2SceneDetector::BlockSADScalar(a.data() + offset, 64, b.data(), 48);
+        uint32_t simd = C2SceneDetector::BlockSAD(a.data() + offset, 64, b.data(), 48);
+        if (scalar != simd) {
+            base::LogError() << "SAD mismatch, scalar " << scalar << " simd " << simd;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool expect(bool value, bool expected, const char *what) {
+    if (value != expected) {
+        base::LogError() << what << ": expected " << (expected ? "static" : "changed");
+        return false;
+    }
+    return true;
+}
+
+static bool check_detector() {
+    std::mt19937 rng(11);
+    std::vector<uint8_t> frame(WIDTH * HEIGHT);
+    for (auto &value : frame) {
+        value = 64 + rng() % 128;
+    }
+
+    C2SceneDetectConfig config;
+    config.enabled = true;
+    config.threshold = 3;
+    config.grid_step = 2;
+    config.max_static_frames = 5;
+    C2SceneDetector detector(config);
+
+    bool ok = expect(detector.IsStatic(frame.data(), WIDTH, WIDTH, HEIGHT), false, "first frame");
+    ok = ok && expect(detector.IsStatic(frame.data(), WIDTH, WIDTH, HEIGHT), true, "same frame");
+
+    // Sensor noise of +-1 stays below the threshold.
+    std::vector<uint8_t> noisy = frame;
+    for (auto &value : noisy) {
+        value += static_cast<int>(rng() % 3) - 1;
+    }
+    ok = ok && expect(detector.IsStatic(noisy.data(), WIDTH, WIDTH, HEIGHT), true, "noise");
+
+    // An object in a sampled block.
+    std::vector<uint8_t> moved = frame;
+    for (uint32_t row = 32; row < 96; row++) {
+        for (uint32_t col = 64; col < 128; col++) {
+            moved[row * WIDTH + col] = 255;
+        }
+    }
+    ok = ok && expect(detector.IsStatic(moved.data(), WIDTH, WIDTH, HEIGHT), false, "object");
+    ok = ok && expect(detector.IsStatic(moved.data(), WIDTH, WIDTH, HEIGHT), true, "new reference");
+
+    // Encoded anyway after max_static_frames.
+    for (uint32_t idx = 1; ok && idx < config.max_static_frames; idx++) {
+        ok = expect(detector.IsStatic(moved.data(), WIDTH, WIDTH, HEIGHT), true, "static run");
+    }
+    ok = ok && expect(detector.IsStatic(moved.data(), WIDTH, WIDTH, HEIGHT), false, "refresh");
+
+    // Slow drift accumulates against the last encoded frame.
+    bool changed = false;
+    std::vector<uint8_t> drift = moved;
+    for (int step = 0; step < 10 && !changed; step++) {
+        for (auto &value : drift) {
+            value = (value < 255) ? value + 1 : value;
+        }
+        changed = !detector.IsStatic(drift.data(), WIDTH, WIDTH, HEIGHT);
+    }
+    ok = ok && expect(!changed, false, "drift");
+
+    return ok;
+}
+
+static void benchmark(int iterations) {
+    std::vector<uint8_t> frame(WIDTH * HEIGHT, 100);
+    C2SceneDetectConfig config;
+    config.enabled = true;
+
+    for (uint32_t step = 1; step <= 4; step *= 2) {
+        config.grid_step = step;
+        C2SceneDetector detector(config);
+        detector.IsStatic(frame.data(), WIDTH, WIDTH, HEIGHT);
+
+        auto begin = std::chrono::steady_clock::now();
+        for (int idx = 0; idx < iterations; idx++) {
+            detector.IsStatic(frame.data(), WIDTH, WIDTH, HEIGHT);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double us = std::chrono::duration<double, std::micro>(end - begin).count() / iterations;
+        base::LogInfo() << "1080p static frame, grid step " << step << ": " << us
+                        << " us per frame";
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+
+    if (!check_sad() || !check_detector()) {
+        return 1;
+    }
+    base::LogInfo() << "Scene detector checks passed";
+
+    benchmark(iterations);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <C2Work.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_segment_sink.h"
+#include "test/c2_test_check.h"
+#include "test/c2_test_stream.h"
+
+#define FRAME_DURATION_US 33333
+#define GOP_SIZE 15
+#define PAYLOAD_SIZE 4000
+#define SEGMENT_MS 1000
+#define NUM_FRAMES 300
+/// Slow consumer of finalized segments, rotations must not wait for it.
+#define FINALIZED_DELAY_US 50000
+
+static std::vector<uint8_t> read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+}
+
+static bool check_segments(const std::string &prefix, C2TestConfigMode mode) {
+    bool inline_config = mode == C2TestConfigMode::kInline;
+    std::mutex lock;
+    std::vector<C2SegmentInfo> segments;
+
+    C2SegmentSinkConfig config;
+    config.prefix = prefix;
+    config.duration_ms = SEGMENT_MS;
+    config.finalized = [&](const C2SegmentInfo &info) {
+        usleep(FINALIZED_DELAY_US);
+        std::lock_guard<std::mutex> lk(lock);
+        segments.push_back(info);
+    };
+
+    C2TestEncoderConfig encoder_config;
+    encoder_config.config_mode = mode;
+    encoder_config.gop_size = GOP_SIZE;
+    encoder_config.payload_size = PAYLOAD_SIZE;
+    encoder_config.frame_duration_us = FRAME_DURATION_US;
+    C2TestEncoder encoder(encoder_config);
+    C2SegmentStats stats;
+    {
+        C2SegmentSink sink(config);
+        encoder.EncodeFrames(sink, NUM_FRAMES);
+        sink.OnEndOfStream();
+        // Frames after the end of stream go to a new segment.
+        encoder.EncodeFrames(sink, GOP_SIZE);
+        sink.GetStats(stats);
+    }
+
+    // Segments of SEGMENT_MS rounded up to whole GOPs, plus the one after EOS.
+    uint64_t gop_us = GOP_SIZE * FRAME_DURATION_US;
+    uint32_t gops = (SEGMENT_MS * 1000 + gop_us - 1) / gop_us;
+    uint32_t expected = (NUM_FRAMES + gops * GOP_SIZE - 1) / (gops * GOP_SIZE) + 1;
+    bool ok = check(segments.size() == expected, "segment count");
+    // A parameter set buffer counts as a write, not as a frame of the segment.
+    uint32_t writes = NUM_FRAMES + GOP_SIZE + (mode == C2TestConfigMode::kBuffer ? 1 : 0);
+    ok = ok && check(stats.frames == writes && stats.write_errors == 0, "stats");
+
+    const std::vector<uint8_t> &annexb = encoder.GetCodecConfig().annexb;
+    std::vector<uint8_t> joined;
+    uint32_t frames = 0;
+    for (size_t idx = 0; ok && idx < segments.size(); idx++) {
+        const C2SegmentInfo &info = segments[idx];
+        std::vector<uint8_t> data = read_file(info.path);
+        std::vector<C2SegmentIndexEntry> entries;
+
+        struct stat st;
+        ok = check(stat(info.path.c_str(), &st) == 0 && st.st_size == (off_t)info.bytes &&
+                       data.size() == info.bytes,
+                   "segment truncated to its data");
+        ok = ok && check(info.number == idx + 1, "segments in order");
+        ok = ok && check(C2SegmentSink::LoadIndex(info.index_path, entries) &&
+                             entries.size() == info.sync_frames && !entries.empty(),
+                         "index of every sync frame");
+        ok = ok && check(entries.front().offset == 0 &&
+                             entries.front().timestamp == info.first_timestamp,
+                         "segment starts at a sync frame");
+
+        // Every entry points to the sync frame, or its parameter sets: those
+        // the sink wrote in front, or the parameter set buffer before it.
+        for (size_t entry = 0; ok && entry < entries.size(); entry++) {
+            uint64_t offset = entries[entry].offset;
+            if (!inline_config && entry == 0) {
+                ok = check(data.size() >= annexb.size() &&
+                               std::equal(annexb.begin(), annexb.end(), data.begin()),
+                           "parameter sets written in front");
+                offset += annexb.size();
+            }
+            const std::vector<uint8_t> &frame =
+                encoder.encoded[entries[entry].timestamp / FRAME_DURATION_US];
+            ok = ok && check(offset + frame.size() <= data.size() &&
+                                 std::equal(frame.begin(), frame.end(), data.begin() + offset),
+                             "index entry points to the frame");
+        }
+
+        // Only the parameter set buffer is part of the encoded stream.
+        bool config_buffer = mode == C2TestConfigMode::kBuffer && idx == 0;
+        size_t skip = (inline_config || config_buffer) ? 0 : annexb.size();
+        joined.insert(joined.end(), data.begin() + std::min(skip, data.size()), data.end());
+        frames += info.frames;
+        unlink(info.path.c_str());
+        unlink(info.index_path.c_str());
+    }
+
+    // Nothing lost or duplicated across rotations.
+    ok = ok && check(joined == encoder.bitstream && frames == NUM_FRAMES + GOP_SIZE,
+                     "segments add up to the stream");
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    std::string prefix = "/tmp/segment_sink_test." + std::to_string(getpid());
+
+    bool ok = check_segments(prefix, C2TestConfigMode::kInline);
+    ok = check_segments(prefix, C2TestConfigMode::kAttached) && ok;
+    ok = check_segments(prefix, C2TestConfigMode::kBuffer) && ok;
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Segment sink checks passed";
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_file_sink.h"
+#include "src/c2_nal_parser.h"
+#include "src/c2_sei.h"
+#include "test/c2_test_check.h"
+#include "test/c2_test_stream.h"
+
+#define PAYLOAD_SIZE 3000
+
+static C2CodecType codec(bool hevc) {
+    return hevc ? C2CodecType::H265VideoEncode : C2CodecType::H264VideoEncode;
+}
+
+static bool check_round_trip(bool hevc) {
+    // Zero runs and 0x01..0x03 bytes exercise the emulation prevention.
+    const C2TimestampSei values[] = {
+        {0, 0, 0},
+        {0x0000000100000002ull, 0x0000000300000000ull, 1},
+        {C2Sei::RealTime(), C2Sei::RealTime() + 12345, 0xffffffffffffffffull},
+    };
+
+    bool ok = true;
+    for (const C2TimestampSei &value : values) {
+        std::vector<uint8_t> nal;
+        C2Sei::WriteTimestamp(hevc, value, nal);
+
+        // A start code may only appear at the head of the unit.
+        ok = ok && check(C2NalParser::FindStartCodeScalar(nal.data(), nal.size(), 4) ==
+                             nal.size(),
+                         "no start code emulation");
+
+        C2AccessUnitInfo info;
+        C2NalParser parser(codec(hevc));
+        ok = ok && check(parser.Parse(nal.data(), nal.size(), info) && info.nals.size() == 1,
+                         "single NAL unit");
+
+        C2TimestampSei parsed = {};
+        ok = ok && check(C2Sei::FindTimestamp(hevc, nal.data(), info, parsed), "found");
+        ok = ok && check(parsed.capture_time == value.capture_time &&
+                             parsed.encode_time == value.encode_time &&
+                             parsed.index == value.index,
+                         "round trip");
+    }
+
+    // Other SEI messages and slices are not taken for the timestamp.
+    C2TestStream stream(hevc, 1280, 720);
+    std::vector<uint8_t> au = stream.AccessUnit(true, PAYLOAD_SIZE);
+    C2AccessUnitInfo info;
+    C2NalParser parser(codec(hevc));
+    parser.Parse(au.data(), au.size(), info);
+    C2TimestampSei parsed;
+    ok = ok && check(!C2Sei::FindTimestamp(hevc, au.data(), info, parsed), "absent");
+
+    const uint8_t other[] = {static_cast<uint8_t>(hevc ? 0x4e : 0x06), 0x01, 0x05, 0x00,
+                             0x00, 0x00, 0x00, 0x00, 0x80};
+    ok = ok && check(!C2Sei::ParseTimestamp(hevc, other, sizeof(other), parsed), "other SEI");
+    return ok;
+}
+
+static bool check_file_sink(bool hevc) {
+    char path[] = "/tmp/sei_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (!check(fd >= 0, "temporary file")) {
+        return false;
+    }
+    close(fd);
+
+    C2TestStream stream(hevc, 1280, 720);
+    C2NalParser parser(codec(hevc));
+    std::vector<uint8_t> expected;
+    uint64_t frames = 10;
+    bool ok = true;
+    {
+        C2FileSink sink(path);
+        for (uint64_t idx = 0; idx < frames; idx++) {
+            std::vector<uint8_t> au = stream.AccessUnit(idx == 0, PAYLOAD_SIZE);
+
+            C2EncodedFrame frame;
+            frame.data = au.data();
+            frame.size = au.size();
+            frame.index = idx;
+            frame.timestamp = idx * 33333;
+            frame.flags = 0;
+            frame.config = nullptr;
+            frame.config_version = 0;
+            parser.Parse(au.data(), au.size(), frame.au);
+
+            // Inserted the way the engine does it, ahead of the first slice.
+            std::vector<uint8_t> sei;
+            C2TimestampSei value = {1000 + idx, 2000 + idx, idx};
+            C2Sei::WriteTimestamp(hevc, value, sei);
+            for (const C2NalUnit &nal : frame.au.nals) {
+                if (C2Sei::IsSlice(hevc, nal.type)) {
+                    frame.sei = sei.data();
+                    frame.sei_size = sei.size();
+                    frame.sei_offset = nal.offset - nal.start_code;
+                    break;
+                }
+            }
+            ok = ok && check(frame.sei != nullptr, "slice found");
+
+            sink.OnFrame(frame);
+            expected.insert(expected.end(), au.begin(), au.begin() + frame.sei_offset);
+            expected.insert(expected.end(), sei.begin(), sei.end());
+            expected.insert(expected.end(), au.begin() + frame.sei_offset, au.end());
+        }
+        sink.OnEndOfStream();
+    }
+
+    std::vector<uint8_t> output;
+    FILE *file = fopen(path, "rb");
+    if (file != nullptr) {
+        uint8_t chunk[4096];
+        size_t size;
+        while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            output.insert(output.end(), chunk, chunk + size);
+        }
+        fclose(file);
+    }
+    unlink(path);
+
+    // Split the written stream back into access units at each timestamp SEI.
+    C2AccessUnitInfo info;
+    C2NalParser reader(codec(hevc));
+    ok = ok && check(reader.Parse(output.data(), output.size(), info), "parse output");
+
+    uint64_t found = 0;
+    for (size_t idx = 0; ok && idx < info.nals.size(); idx++) {
+        const C2NalUnit &nal = info.nals[idx];
+        C2TimestampSei parsed;
+        if (!C2Sei::ParseTimestamp(hevc, output.data() + nal.offset, nal.size, parsed)) {
+            continue;
+        }
+        ok = ok && check(parsed.index == found && parsed.capture_time == 1000 + found,
+                         "SEI of each frame in order");
+        ok = ok && check(idx + 1 < info.nals.size() &&
+                             C2Sei::IsSlice(hevc, info.nals[idx + 1].type),
+                         "SEI right before the slice");
+        found++;
+    }
+    ok = ok && check(found == frames, "one SEI per frame");
+    ok = ok && check(output == expected, "data preserved");
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    for (bool hevc : {false, true}) {
+        if (!check_round_trip(hevc) || !check_file_sink(hevc)) {
+            base::LogError() << (hevc ? "H.265" : "H.264") << " SEI checks failed";
+            return 1;
+        }
+    }
+
+    base::LogInfo() << "SEI checks passed";
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "c2_test_stream.h"
+#include "src/c2_encoder_service.h"
+#include "src/c2_service_client.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define NUM_FRAMES 90
+#define GOP_SIZE 30
+#define PAYLOAD_SIZE 4000
+#define TIMEOUT_MS 2000
+
+// Encoded frame the stand-in component returns for an input index.
+static std::vector<uint8_t> expected_output(uint64_t index) {
+    C2TestStream stream(false, WIDTH, HEIGHT, index + 1);
+    return stream.AccessUnit(index % GOP_SIZE == 0, PAYLOAD_SIZE);
+}
+
+static C2ServiceSessionConfig session_config() {
+    C2ServiceSessionConfig config;
+    config.codec = C2CodecType::H264VideoEncode;
+    config.engine = {WIDTH, HEIGHT, 30.0f, 1000000, GOP_SIZE};
+    config.pixel_format = C2PixelFormat::kNV12;
+    config.input_slots = 3;
+    config.output_slots = 4;
+    return config;
+}
+
+// Encode a stream through the service and compare every returned frame.
+static bool check_stream(C2ServiceClient &client) {
+    uint64_t received = 0;
+    bool valid = true;
+
+    std::thread consumer([&] {
+        C2ServiceFrame frame;
+        while (client.ReceiveFrame(frame, TIMEOUT_MS)) {
+            std::vector<uint8_t> expected = expected_output(frame.index);
+            if (frame.index != received || frame.timestamp != frame.index * 33333 ||
+                frame.size != expected.size() ||
+                memcmp(frame.data, expected.data(), frame.size) != 0 ||
+                frame.sync != (frame.index % GOP_SIZE == 0)) {
+                base::LogError() << "Frame " << received << " mismatch: index " << frame.index
+                                 << ", " << frame.size << " bytes";
+                valid = false;
+            }
+            received++;
+            client.ReleaseFrame(frame);
+        }
+    });
+
+    bool ok = true;
+    for (uint64_t index = 0; ok && index < NUM_FRAMES; index++) {
+        uint32_t slot;
+        uint8_t *data = client.DequeueInput(slot, TIMEOUT_MS);
+        ok = data != nullptr;
+        if (ok) {
+            memset(data, static_cast<int>(index), client.GetInputSize());
+            ok = client.QueueInput(slot, index * 33333);
+        }
+    }
+    ok = ok && client.EndOfStream();
+    consumer.join();
+
+    if (!ok || !valid || received != NUM_FRAMES || client.GetDropped() != 0) {
+        base::LogError() << "Service stream: " << received << " of " << NUM_FRAMES
+                         << " frames, " << client.GetDropped() << " dropped";
+        return false;
+    }
+    return true;
+}
+
+static bool wait_sessions(C2EncoderService &service, uint32_t count) {
+    for (uint32_t wait = 0; wait < TIMEOUT_MS && service.GetSessionCount() != count; wait += 10) {
+        usleep(10000);
+    }
+    return service.GetSessionCount() == count;
+}
+
+int main(int argc, const char *argv[]) {
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        auto component = std::make_shared<FakeComponent>(name);
+        component->SetOutput(expected_output);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+
+    C2EncoderServiceConfig config;
+    config.socket_path = "/tmp/c2_service_test_" + std::to_string(getpid()) + ".sock";
+    config.max_sessions = 1;
+
+    C2EncoderService service(config);
+    bool ok = service.Start();
+
+    C2ServiceClient first, second;
+    ok = ok && first.Open(config.socket_path, session_config());
+    if (ok && second.Open(config.socket_path, session_config())) {
+        base::LogError() << "Session opened above the instance limit";
+        ok = false;
+    }
+
+    ok = ok && check_stream(first);
+
+    // The instance is handed to the next client once the first one is gone.
+    first.Close();
+    ok = ok && wait_sessions(service, 0) && second.Open(config.socket_path, session_config()) &&
+         check_stream(second);
+    second.Close();
+
+    service.Stop();
+    C2Factory::SetComponentCreator(nullptr);
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Encoder service checks passed";
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <C2Buffer.h>
+#include <C2Work.h>
+#include <string.h>
+
+#include <mutex>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "src/c2_frame_source.h"
+#include "src/c2_simulcast.h"
+#include "test/c2_test_check.h"
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define FRAME_DURATION_US 33333
+#define NUM_FRAMES 10
+/// Rejected by the component of the second rung only.
+#define FAILED_FRAME 4
+
+/// Input queued to the component of a rung.
+struct QueuedInput {
+    uint64_t index;
+    uint64_t timestamp;
+    uint32_t width;
+    uint32_t height;
+};
+
+static std::mutex g_lock;
+static std::vector<std::shared_ptr<FakeComponent>> g_components;
+/// Per rung, in the order the rungs were opened.
+static std::vector<std::vector<QueuedInput>> g_inputs;
+
+static std::shared_ptr<C2Component> create_component(const std::string &name) {
+    auto component = std::make_shared<FakeComponent>(name);
+    size_t rung;
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        rung = g_components.size();
+        g_components.push_back(component);
+        g_inputs.emplace_back();
+    }
+
+    component->SetInputFilter([rung](const C2Work &work) {
+        uint64_t index = work.input.ordinal.frameIndex.peeku();
+        if (rung == 1 && index == FAILED_FRAME) {
+            return C2_BAD_VALUE;
+        }
+
+        const C2ConstGraphicBlock &block = work.input.buffers.front()->data().graphicBlocks()[0];
+        QueuedInput input = {index, work.input.ordinal.timestamp.peeku(), block.width(),
+                             block.height()};
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_inputs[rung].push_back(input);
+        return C2_OK;
+    });
+    return std::static_pointer_cast<C2Component>(component);
+}
+
+// Every rung gets a block of its own size, queued with the index and
+// timestamp shared by all rungs, also after one rung failed a frame.
+static bool check_rungs() {
+    C2SimulcastConfig config;
+    config.gop = 30;
+    config.rungs = {{WIDTH, HEIGHT, 4000000}, {WIDTH / 2, HEIGHT / 2, 1500000},
+                    {WIDTH / 4, HEIGHT / 4, 500000}};
+
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        return create_component(name);
+    });
+    C2Simulcast simulcast(config);
+    bool ok = check(simulcast.Open(), "rungs opened");
+    C2Factory::SetComponentCreator(nullptr);
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        ok = ok && check(g_components.size() == config.rungs.size(), "one component per rung");
+    }
+    ok = ok && check(simulcast.Start(), "rungs started");
+
+    std::vector<uint8_t> data(C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, WIDTH, HEIGHT));
+    memset(data.data(), 0x80, data.size());
+    C2StreamBuffer frame = {};
+    C2FrameSource::DescribeFrame(data.data(), C2PixelFormat::kNV12, WIDTH, HEIGHT, frame);
+
+    for (uint64_t index = 0; ok && index < NUM_FRAMES; index++) {
+        frame.timestamp = index * FRAME_DURATION_US;
+        bool queued = simulcast.Queue(&frame);
+        ok = check(queued == (index != FAILED_FRAME), "frame queued unless a rung failed");
+    }
+    ok = ok && check(simulcast.WaitPending(0, 1000), "work returned");
+    simulcast.Stop();
+
+    std::lock_guard<std::mutex> lk(g_lock);
+    for (size_t rung = 0; ok && rung < config.rungs.size(); rung++) {
+        // The other rungs still encode the frame the second one failed.
+        std::vector<uint64_t> expected;
+        for (uint64_t index = 0; index < NUM_FRAMES; index++) {
+            if (rung != 1 || index != FAILED_FRAME) {
+                expected.push_back(index);
+            }
+        }
+
+        const std::vector<QueuedInput> &inputs = g_inputs[rung];
+        ok = check(inputs.size() == expected.size(), "frames queued per rung");
+        for (size_t idx = 0; ok && idx < inputs.size(); idx++) {
+            ok = check(inputs[idx].width == config.rungs[rung].width &&
+                           inputs[idx].height == config.rungs[rung].height,
+                       "block of the rung size");
+            ok = ok && check(inputs[idx].index == expected[idx] &&
+                                 inputs[idx].timestamp == expected[idx] * FRAME_DURATION_US,
+                             "index and timestamp shared by the rungs");
+        }
+    }
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    if (!check_rungs()) {
+        return 1;
+    }
+
+    base::LogInfo() << "Simulcast checks passed";
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/log.h"
+#include "src/c2_engine.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define FRAMERATE 30
+#define BITRATE 8000000
+/// Two macroblock rows of 1080p per slice.
+#define SLICE_MBS 240
+#define MAX_PENDING 2
+
+/** SliceCounter
+ *
+ * Sink accepting slices, counts them per completed frame.
+ **/
+class SliceCounter : public IC2OutputSink {
+public:
+    SliceCounter() : slices(0), frames(0) {}
+
+    void OnFrame(const C2EncodedFrame &frame) override {
+        slices++;
+        frames += frame.last_slice ? 1 : 0;
+    }
+    bool AcceptsSlices() const override { return true; }
+
+    std::atomic<uint64_t> slices;
+    std::atomic<uint64_t> frames;
+};
+
+static bool run(bool slice_output, int frames, C2StatsSnapshot &snapshot, double &slices) {
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    if (engine == nullptr) {
+        return false;
+    }
+
+    C2EngineConfig config = {WIDTH, HEIGHT, FRAMERATE, BITRATE, FRAMERATE};
+    C2SliceOutputConfig slice_config = {slice_output, SLICE_MBS, 0};
+    auto counter = std::make_shared<SliceCounter>();
+    engine->c2_engine_add_sink(counter);
+
+    if (!engine->c2_engine_configure(config) || !engine->c2_engine_slice_output(slice_config) ||
+        !engine->start_c2_engine()) {
+        C2Engine::free_c2_engine(engine);
+        return false;
+    }
+
+    std::vector<uint8_t> nv12(WIDTH * HEIGHT * 3 / 2);
+    C2StreamBuffer buffer = {};
+    buffer.data = nv12.data();
+    buffer.size = nv12.size();
+    buffer.width = WIDTH;
+    buffer.height = HEIGHT;
+    buffer.offset[1] = WIDTH * HEIGHT;
+    buffer.stride[0] = WIDTH;
+    buffer.stride[1] = WIDTH;
+    buffer.planes = 2;
+    buffer.pixel_format = C2PixelFormat::kNV12;
+
+    bool ok = true;
+    uint64_t start = C2Stats::Now();
+    for (int idx = 0; ok && idx < frames; idx++) {
+        // Moving gradient, so that every frame has content to encode.
+        for (size_t pos = 0; pos < nv12.size(); pos++) {
+            nv12[pos] = static_cast<uint8_t>(pos % WIDTH + idx * 4);
+        }
+
+        buffer.timestamp = idx * 1000000ull / FRAMERATE;
+        ok = engine->c2_engine_queue_buffer(&buffer) &&
+             engine->c2_engine_wait_pending(MAX_PENDING, 1000);
+
+        // Real time pacing, latency is meaningless when the encoder is saturated.
+        uint64_t next = start + (idx + 1) * 1000000ull / FRAMERATE;
+        uint64_t now = C2Stats::Now();
+        if (next > now) {
+            usleep(next - now);
+        }
+    }
+
+    ok = ok && engine->c2_engine_wait_pending(0, 2000);
+    engine->stop_c2_engine();
+    engine->c2_engine_stats(snapshot);
+    C2Engine::free_c2_engine(engine);
+
+    slices = counter->frames > 0 ? static_cast<double>(counter->slices) / counter->frames : 0;
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    int frames = (argc > 1) ? atoi(argv[1]) : 300;
+
+    C2StatsSnapshot whole, sliced;
+    double whole_slices, sliced_slices;
+    if (!run(false, frames, whole, whole_slices) || !run(true, frames, sliced, sliced_slices)) {
+        base::LogError() << "Encoding failed";
+        return 1;
+    }
+
+    base::LogInfo() << "whole frames: " << whole_slices << " outputs per frame, first byte p50 "
+                    << whole.first_byte_p50 << " us, p99 " << whole.first_byte_p99
+                    << " us, complete p50 " << whole.latency_p50 << " us";
+    base::LogInfo() << "slice output: " << sliced_slices << " outputs per frame, first byte p50 "
+                    << sliced.first_byte_p50 << " us, p99 " << sliced.first_byte_p99
+                    << " us, complete p50 " << sliced.latency_p50 << " us";
+    base::LogInfo() << "first byte p50 improvement: "
+                    << static_cast<int64_t>(whole.first_byte_p50) -
+                           static_cast<int64_t>(sliced.first_byte_p50)
+                    << " us";
+    return 0;
+}
@@ -0,0 +1,353 @@
+#include <dirent.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "c2_test_stream.h"
+#include "src/c2_engine.h"
+#include "src/c2_frame_source.h"
+
+#define DEFAULT_DURATION_S 60
+#define DEFAULT_ENGINES 8
+#define DEFAULT_INTERVAL_MS 1000
+#define DEFAULT_DRIFT_PERCENT 20
+#define DEFAULT_GROWTH_PERCENT 10
+#define BROKER_BUDGET (256 << 20)
+#define MAX_PENDING 4
+#define PAYLOAD_SIZE 1000
+#define GOP_SIZE 30
+#define PENDING_TIMEOUT_MS 2000
+/// One in this many frames is followed by a random lifecycle event.
+#define EVENT_PERIOD 200
+/// Growth windows compared after the warm-up.
+#define NUM_WINDOWS 4
+/// Descriptors which may come and go with threads and pools.
+#define FD_SLACK 4
+
+struct SoakConfig {
+    uint32_t duration_s = DEFAULT_DURATION_S;
+    uint32_t engines = DEFAULT_ENGINES;
+    uint32_t interval_ms = DEFAULT_INTERVAL_MS;
+    uint32_t drift_percent = DEFAULT_DRIFT_PERCENT;
+    uint32_t growth_percent = DEFAULT_GROWTH_PERCENT;
+    uint32_t seed = 1;
+};
+
+struct SoakSample {
+    uint64_t time;
+    uint64_t rss;
+    uint64_t fds;
+    /// Graphic memory of the blocks held by the engines and the component.
+    uint64_t blocks;
+    double fps;
+};
+
+/// Input geometries switched between on reconfiguration.
+static const uint32_t kSizes[][2] = {{320, 240}, {640, 480}, {352, 288}};
+
+static std::atomic<uint64_t> g_frames(0);
+static std::atomic<uint64_t> g_events(0);
+static std::atomic<uint64_t> g_failures(0);
+
+/** FrameCounter
+ *
+ * Counts the encoded frames of all engines.
+ **/
+class FrameCounter : public IC2OutputSink {
+public:
+    void OnFrame(const C2EncodedFrame &frame) override { g_frames++; }
+};
+
+static void usage(const char *name) {
+    std::cout << "Usage: " << name << " [options]\n"
+              << "  -d, --duration <s>     run time (default " << DEFAULT_DURATION_S << ")\n"
+              << "  -e, --engines <count>  concurrent engines (default " << DEFAULT_ENGINES
+              << ")\n"
+              << "  -i, --interval <ms>    sampling period (default " << DEFAULT_INTERVAL_MS
+              << ")\n"
+              << "  -D, --drift <percent>  allowed throughput loss (default "
+              << DEFAULT_DRIFT_PERCENT << ")\n"
+              << "  -G, --growth <percent> allowed steady memory growth (default "
+              << DEFAULT_GROWTH_PERCENT << ")\n"
+              << "  -s, --seed <value>     seed of the random events (default 1)\n";
+}
+
+static std::vector<uint8_t> output(uint64_t index) {
+    C2TestStream stream(false, kSizes[0][0], kSizes[0][1], index + 1);
+    return stream.AccessUnit(index % GOP_SIZE == 0, PAYLOAD_SIZE);
+}
+
+static uint64_t resident_bytes() {
+    unsigned long size = 0, resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (file != nullptr) {
+        if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+static uint64_t open_fds() {
+    uint64_t count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == nullptr) {
+        return 0;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        count += entry->d_name[0] != '.';
+    }
+    closedir(dir);
+    // The descriptor of the directory itself.
+    return count - 1;
+}
+
+static C2Engine *create_engine(uint32_t size, std::shared_ptr<FrameCounter> &counter) {
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    if (engine == nullptr) {
+        return nullptr;
+    }
+
+    C2EngineConfig config = {kSizes[size][0], kSizes[size][1], 30.0f, 1000000, GOP_SIZE};
+    engine->c2_engine_add_sink(counter);
+    if (!engine->c2_engine_buffer_broker(true) || !engine->c2_engine_configure(config) ||
+        !engine->start_c2_engine()) {
+        C2Engine::free_c2_engine(engine);
+        return nullptr;
+    }
+    return engine;
+}
+
+// Random lifecycle event, returns false if the engine is no longer usable.
+static bool random_event(C2Engine *&engine, uint32_t &size, std::mt19937 &random,
+                         std::shared_ptr<FrameCounter> &counter) {
+    g_events++;
+    switch (random() % 4) {
+        case 0:
+            return engine->stop_c2_engine() && engine->start_c2_engine();
+        case 1:
+            return engine->flush_c2_engine();
+        case 2: {
+            size = random() % (sizeof(kSizes) / sizeof(kSizes[0]));
+            C2EngineConfig config = {kSizes[size][0], kSizes[size][1], 30.0f, 1000000, GOP_SIZE};
+            return engine->stop_c2_engine() && engine->c2_engine_configure(config) &&
+                   engine->start_c2_engine();
+        }
+        default:
+            engine->stop_c2_engine();
+            C2Engine::free_c2_engine(engine);
+            engine = create_engine(size, counter);
+            return engine != nullptr;
+    }
+}
+
+static void run_engine(const SoakConfig &config, uint32_t id, uint64_t deadline,
+                       std::shared_ptr<FrameCounter> counter) {
+    std::mt19937 random(config.seed * 7919 + id);
+    uint32_t size = id % (sizeof(kSizes) / sizeof(kSizes[0]));
+    C2Engine *engine = create_engine(size, counter);
+    if (engine == nullptr) {
+        g_failures++;
+        return;
+    }
+
+    std::vector<uint8_t> frame;
+    C2StreamBuffer buffer = {};
+    for (uint64_t index = 0; C2Stats::Now() < deadline; index++) {
+        uint32_t width = kSizes[size][0], height = kSizes[size][1];
+        frame.resize(C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, width, height));
+        C2FrameSource::DescribeFrame(frame.data(), C2PixelFormat::kNV12, width, height, buffer);
+        buffer.timestamp = index * 33333;
+
+        if (!engine->c2_engine_queue_buffer(&buffer) ||
+            !engine->c2_engine_wait_pending(MAX_PENDING, PENDING_TIMEOUT_MS)) {
+            base::LogError() << "Engine " << id << " failed at frame " << index;
+            g_failures++;
+            break;
+        }
+
+        if (random() % EVENT_PERIOD == 0 && !random_event(engine, size, random, counter)) {
+            base::LogError() << "Engine " << id << " failed a lifecycle event";
+            g_failures++;
+            break;
+        }
+    }
+
+    if (engine != nullptr) {
+        engine->c2_engine_wait_pending(0, PENDING_TIMEOUT_MS);
+        engine->stop_c2_engine();
+        C2Engine::free_c2_engine(engine);
+    }
+}
+
+template <typename Value>
+static double window_mean(const std::vector<SoakSample> &samples, size_t window,
+                          Value SoakSample::*field) {
+    size_t size = samples.size() / NUM_WINDOWS;
+    double sum = 0;
+    for (size_t idx = window * size; idx < (window + 1) * size; idx++) {
+        sum += samples[idx].*field;
+    }
+    return sum / size;
+}
+
+// A leak shows as a mean rising from every window to the next one.
+static bool check_growth(const std::vector<SoakSample> &samples, const char *name,
+                         uint64_t SoakSample::*field, double slack) {
+    double previous = window_mean(samples, 0, field);
+    double first = previous;
+    bool monotonic = true;
+    for (size_t window = 1; window < NUM_WINDOWS; window++) {
+        double mean = window_mean(samples, window, field);
+        monotonic = monotonic && mean > previous;
+        previous = mean;
+    }
+
+    if (monotonic && previous - first > slack) {
+        base::LogError() << name << " keeps growing: " << static_cast<uint64_t>(first) << " -> "
+                         << static_cast<uint64_t>(previous);
+        return false;
+    }
+    return true;
+}
+
+static bool check_drift(const std::vector<SoakSample> &samples, uint32_t percent) {
+    double first = window_mean(samples, 0, &SoakSample::fps);
+    double last = window_mean(samples, NUM_WINDOWS - 1, &SoakSample::fps);
+    if (first <= 0 || last < first * (100 - percent) / 100) {
+        base::LogError() << "Throughput drifted from " << first << " to " << last << " fps";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    SoakConfig config;
+
+    const struct option options[] = {
+        {"duration", required_argument, nullptr, 'd'}, {"engines", required_argument, nullptr, 'e'},
+        {"interval", required_argument, nullptr, 'i'}, {"drift", required_argument, nullptr, 'D'},
+        {"growth", required_argument, nullptr, 'G'},   {"seed", required_argument, nullptr, 's'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "d:e:i:D:G:s:", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'd':
+                config.duration_s = atoi(optarg);
+                break;
+            case 'e':
+                config.engines = std::max(1, atoi(optarg));
+                break;
+            case 'i':
+                config.interval_ms = std::max(10, atoi(optarg));
+                break;
+            case 'D':
+                config.drift_percent = atoi(optarg);
+                break;
+            case 'G':
+                config.growth_percent = atoi(optarg);
+                break;
+            case 's':
+                config.seed = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        auto component = std::make_shared<FakeComponent>(name);
+        component->SetOutput(output);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+    C2BrokerConfig broker_config;
+    broker_config.budget_bytes = BROKER_BUDGET;
+    C2BufferBroker::Instance().Configure(broker_config);
+
+    uint64_t start = C2Stats::Now();
+    uint64_t deadline = start + config.duration_s * 1000000ull;
+    auto counter = std::make_shared<FrameCounter>();
+    std::vector<std::thread> threads;
+    for (uint32_t id = 0; id < config.engines; id++) {
+        threads.emplace_back(run_engine, std::cref(config), id, deadline, counter);
+    }
+
+    // The first fifth warms the caches up and is not judged.
+    std::vector<SoakSample> samples;
+    uint64_t warmup = start + config.duration_s * 200000ull;
+    uint64_t frames = g_frames;
+    uint64_t last = start;
+    while (C2Stats::Now() + config.interval_ms * 1000ull < deadline && g_failures == 0) {
+        usleep(config.interval_ms * 1000);
+
+        C2BrokerUsage usage;
+        C2BufferBroker::Instance().GetUsage(usage);
+        uint64_t now = C2Stats::Now();
+        uint64_t total = g_frames;
+
+        SoakSample sample;
+        sample.time = now - start;
+        sample.rss = resident_bytes();
+        sample.fds = open_fds();
+        sample.blocks = usage.in_use;
+        sample.fps = (total - frames) * 1000000.0 / (now - last);
+        frames = total;
+        last = now;
+
+        base::LogInfo() << "t=" << sample.time / 1000000 << "s rss=" << (sample.rss >> 10)
+                        << "KB fds=" << sample.fds << " blocks=" << (sample.blocks >> 10)
+                        << "KB cached=" << (usage.cached >> 10) << "KB fps=" << sample.fps
+                        << " events=" << g_events;
+        if (now >= warmup) {
+            samples.push_back(sample);
+        }
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    C2Factory::SetComponentCreator(nullptr);
+
+    bool ok = g_failures == 0;
+    if (samples.size() < 2 * NUM_WINDOWS) {
+        base::LogError() << "Only " << samples.size() << " samples, run longer or sample faster";
+        ok = false;
+    } else {
+        double rss = window_mean(samples, 0, &SoakSample::rss);
+        // One block of the largest geometry per engine may be in flight or not.
+        double block = C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, 640, 480);
+        ok = check_growth(samples, "RSS", &SoakSample::rss, rss * config.growth_percent / 100) &&
+             ok;
+        ok = check_growth(samples, "Open fds", &SoakSample::fds, FD_SLACK) && ok;
+        ok = check_growth(samples, "Graphic blocks", &SoakSample::blocks,
+                          block * config.engines) &&
+             ok;
+        ok = check_drift(samples, config.drift_percent) && ok;
+    }
+
+    if (!ok) {
+        base::LogError() << "Soak failed after " << g_frames << " frames, " << g_events
+                         << " events, " << g_failures << " failures";
+        return 1;
+    }
+
+    base::LogInfo() << "Soak passed: " << g_frames << " frames, " << g_events << " events in "
+                    << config.duration_s << " s with " << config.engines << " engines";
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "base/log.h"
+#include "src/c2_stats_publisher.h"
+#include "src/c2_stats_segment.h"
+
+#define NUM_UPDATES 200000
+#define PUBLISH_INTERVAL_MS 10
+#define TIMEOUT_MS 2000
+
+static void fill(C2StatsEngineData &data, uint64_t value) {
+    memset(&data, 0, sizeof(data));
+    data.active = 1;
+    data.updated = value;
+    data.fps = value;
+    data.stats.queued = value;
+    data.stats.completed = value;
+    data.stats.latency_p99 = value;
+    data.stats.first_byte_p99 = value;
+    data.pool_waits = value;
+}
+
+static bool consistent(const C2StatsEngineData &data) {
+    uint64_t value = data.updated;
+    return data.fps == value && data.stats.queued == value && data.stats.completed == value &&
+           data.stats.latency_p99 == value && data.stats.first_byte_p99 == value &&
+           data.pool_waits == value;
+}
+
+// A reader never sees a record half written, however fast it is rewritten.
+static bool check_seqlock(const std::string &name) {
+    C2StatsSegment writer, reader;
+    if (!writer.Create(name) || !reader.Open(name)) {
+        return false;
+    }
+
+    std::atomic<bool> done(false);
+    uint64_t reads = 0, torn = 0, last = 0, backwards = 0;
+    std::thread thread([&] {
+        while (!done) {
+            C2StatsEngineData data;
+            if (!reader.ReadEngine(3, data)) {
+                continue;
+            }
+            reads++;
+            torn += !consistent(data);
+            backwards += data.updated < last;
+            last = data.updated;
+        }
+    });
+
+    C2StatsEngineData data;
+    for (uint64_t value = 1; value <= NUM_UPDATES; value++) {
+        fill(data, value);
+        writer.WriteEngine(3, data);
+    }
+    done = true;
+    thread.join();
+
+    if (torn != 0 || backwards != 0 || !reader.ReadEngine(3, data) ||
+        data.updated != NUM_UPDATES) {
+        base::LogError() << "Seqlock: " << torn << " torn and " << backwards
+                         << " out of order of " << reads << " reads";
+        return false;
+    }
+    return true;
+}
+
+static bool wait_update(C2StatsSegment &segment, uint32_t slot, uint64_t completed) {
+    C2StatsEngineData data;
+    for (uint32_t wait = 0; wait < TIMEOUT_MS; wait += PUBLISH_INTERVAL_MS) {
+        if (segment.ReadEngine(slot, data) && data.active && data.stats.completed >= completed) {
+            return true;
+        }
+        usleep(PUBLISH_INTERVAL_MS * 1000);
+    }
+    return false;
+}
+
+static bool check_publisher(const std::string &name) {
+    C2StatsPublisherConfig config;
+    config.name = name;
+    config.interval_ms = PUBLISH_INTERVAL_MS;
+    C2StatsPublisher::Instance().Configure(config);
+
+    std::atomic<uint64_t> completed(0);
+    auto source = [&](const C2BrokerUsage &usage, C2StatsEngineData &data) {
+        data.stats.completed = completed;
+        data.waiting = 7;
+    };
+    uint32_t first = C2StatsPublisher::Instance().Register("c2.test.encoder", source);
+    uint32_t second = C2StatsPublisher::Instance().Register("c2.test.decoder", source);
+
+    C2StatsSegment segment;
+    bool ok = first != 0 && second != 0 && segment.Open(name);
+
+    // Frames completed between two updates show up as frame rate.
+    completed = 100;
+    ok = ok && wait_update(segment, first - 1, 100);
+    completed = 200;
+    ok = ok && wait_update(segment, second - 1, 200);
+
+    C2StatsEngineData data;
+    C2StatsProcessData process;
+    ok = ok && segment.ReadEngine(second - 1, data) && segment.ReadProcess(process);
+    if (ok && (strcmp(data.name, "c2.test.decoder") != 0 || data.id != second ||
+               data.waiting != 7 || data.fps <= 0 || process.engines != 2)) {
+        base::LogError() << "Published " << data.name << " #" << data.id << ", " << data.fps
+                         << " fps, " << process.engines << " engines";
+        ok = false;
+    }
+
+    // Slots of removed engines are cleared, the segment goes with the last one.
+    C2StatsPublisher::Instance().Unregister(first);
+    ok = ok && segment.ReadEngine(first - 1, data) && !data.active;
+    C2StatsPublisher::Instance().Unregister(second);
+
+    C2StatsSegment removed;
+    if (ok && (removed.Open(name) || !C2StatsPublisher::Instance().GetSegmentName().empty())) {
+        base::LogError() << "Stats segment left behind";
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, const char *argv[]) {
+    std::string name = "/c2_stats_test." + std::to_string(getpid());
+
+    bool ok = check_seqlock(name);
+    ok = check_publisher(name) && ok;
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Stats segment checks passed";
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/log.h"
+#include "base/trace.h"
+
+#define NUM_THREADS 4
+#define FRAMES_PER_THREAD 500
+#define BENCH_EVENTS 1000000
+
+static std::string read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static size_t count(const std::string &text, const std::string &pattern) {
+    size_t found = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+        found++;
+    }
+    return found;
+}
+
+static bool read_varint(const std::string &data, size_t &pos, uint64_t &value) {
+    value = 0;
+    for (uint32_t shift = 0; pos < data.size() && shift < 64; shift += 7) {
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Count the packets of a Perfetto trace carrying a track event, -1 if malformed.
+static int64_t count_track_events(const std::string &data) {
+    int64_t events = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        uint64_t tag, size;
+        if (!read_varint(data, pos, tag) || tag != ((1 << 3) | 2) ||
+            !read_varint(data, pos, size) || pos + size > data.size()) {
+            return -1;
+        }
+
+        std::string packet = data.substr(pos, size);
+        pos += size;
+
+        size_t field = 0;
+        while (field < packet.size()) {
+            uint64_t key, value;
+            if (!read_varint(packet, field, key)) {
+                return -1;
+            }
+            if ((key & 7) == 0) {
+                read_varint(packet, field, value);
+            } else if ((key & 7) == 2 && read_varint(packet, field, value)) {
+                field += value;
+                events += (key >> 3) == 11;
+            } else {
+                return -1;
+            }
+        }
+    }
+    return events;
+}
+
+// Frames queued on one thread and returned on another, like engine and component.
+static void record_stream(uint32_t track) {
+    std::vector<uint64_t> queued;
+    for (uint64_t index = 0; index < FRAMES_PER_THREAD; index++) {
+        {
+            base::TraceScope copy("copy", track, index);
+        }
+        base::trace_begin("in-hardware", track, index);
+        queued.push_back(index);
+    }
+
+    std::thread callback([&] {
+        for (uint64_t index : queued) {
+            base::trace_end("in-hardware", track, index);
+            base::TraceScope callback("callback", track, index);
+            base::TraceScope sink("sink", track, index);
+        }
+    });
+    callback.join();
+}
+
+static bool check_export() {
+    std::vector<uint32_t> tracks;
+    for (uint32_t idx = 0; idx < NUM_THREADS; idx++) {
+        tracks.push_back(base::trace_register_track("c2.test.encoder"));
+    }
+
+    base::trace_start(FRAMES_PER_THREAD * 4);
+    std::vector<std::thread> threads;
+    for (uint32_t track : tracks) {
+        threads.emplace_back(record_stream, track);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    base::trace_stop();
+
+    // Recorded while stopped, not part of the capture.
+    base::trace_begin("in-hardware", tracks[0], FRAMES_PER_THREAD);
+
+    std::string chrome_path = "/tmp/c2_trace_test_" + std::to_string(getpid()) + ".json";
+    std::string perfetto_path = "/tmp/c2_trace_test_" + std::to_string(getpid()) + ".pftrace";
+    bool ok = base::trace_export(chrome_path, base::TraceFormat::Chrome) &&
+              base::trace_export(perfetto_path, base::TraceFormat::Perfetto);
+    std::string chrome = read_file(chrome_path);
+    std::string perfetto = read_file(perfetto_path);
+    unlink(chrome_path.c_str());
+    unlink(perfetto_path.c_str());
+
+    size_t frames = NUM_THREADS * FRAMES_PER_THREAD;
+    size_t complete = count(chrome, "\"ph\":\"X\"");
+    size_t begins = count(chrome, "\"ph\":\"b\"");
+    size_t ends = count(chrome, "\"ph\":\"e\"");
+    int64_t slices = count_track_events(perfetto);
+    if (!ok || complete != frames * 3 || begins != frames || ends != frames ||
+        count(chrome, "c2.test.encoder #") != NUM_THREADS || slices != int64_t(frames * 8) ||
+        base::trace_lost() != 0) {
+        base::LogError() << "Trace export: " << complete << " spans, " << begins << "/" << ends
+                         << " async events, " << slices << " Perfetto slice events, "
+                         << base::trace_lost() << " lost";
+        return false;
+    }
+    return true;
+}
+
+static bool check_lost() {
+    base::trace_start(10);
+    for (uint64_t index = 0; index < 15; index++) {
+        base::TraceScope scope("copy", 0, index);
+    }
+    base::trace_stop();
+
+    if (base::trace_lost() != 5) {
+        base::LogError() << "Expected 5 lost events, got " << base::trace_lost();
+        return false;
+    }
+    return true;
+}
+
+// Cost of one event, a frame records about eight.
+static void bench_record() {
+    base::trace_start(BENCH_EVENTS);
+    uint64_t begin = base::trace_detail::now_ns();
+    for (uint64_t index = 0; index < BENCH_EVENTS / 2; index++) {
+        base::trace_begin("queue", 0, index);
+        base::trace_end("queue", 0, index);
+    }
+    uint64_t elapsed = base::trace_detail::now_ns() - begin;
+    base::trace_stop();
+
+    base::LogInfo() << "Trace event cost: " << static_cast<double>(elapsed) / BENCH_EVENTS
+                    << " ns";
+}
+
+int main(int argc, const char *argv[]) {
+    bool ok = check_export();
+    ok = check_lost() && ok;
+    if (!ok) {
+        return 1;
+    }
+
+    bench_record();
+    base::LogInfo() << "Trace checks passed";
+    return 0;
+}
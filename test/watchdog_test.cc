@@ -0,0 +1,124 @@
+#include <unistd.h>
+
+#include <mutex>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_test_component.h"
+#include "src/c2_engine.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define STALL_MS 100
+#define FRAME_INTERVAL_US 10000
+#define RECOVERY_TIMEOUT_US 3000000
+
+static std::mutex g_lock;
+static std::vector<std::shared_ptr<FakeComponent>> g_components;
+
+static std::shared_ptr<FakeComponent> latest_component() {
+    std::lock_guard<std::mutex> lk(g_lock);
+    return g_components.back();
+}
+
+static bool queue_frame(C2Engine *engine, uint64_t index) {
+    std::shared_ptr<C2GraphicBlock> block =
+        engine->c2_engine_fetch_block(WIDTH, HEIGHT, C2PixelFormat::kNV12);
+    if (!block) {
+        return false;
+    }
+    return engine->c2_engine_queue_block(block, index, index * 33333);
+}
+
+// Hang the component and keep feeding frames until the engine has recovered.
+static bool check_recovery(HangMode mode, uint64_t expected_stalls, size_t expected_instances) {
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_components.clear();
+    }
+
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    if (engine == nullptr) {
+        return false;
+    }
+
+    C2EngineConfig config = {WIDTH, HEIGHT, 30.0f, 500000, 30};
+    C2WatchdogConfig watchdog;
+    watchdog.enabled = true;
+    watchdog.stall_ms = STALL_MS;
+    watchdog.interval_ms = 10;
+    watchdog.recovery = C2RecoveryAction::kRecreate;
+
+    bool ok = engine->c2_engine_configure(config) && engine->c2_engine_watchdog(watchdog) &&
+              engine->start_c2_engine();
+
+    uint64_t index = 0;
+    for (; ok && index < 10; index++) {
+        ok = queue_frame(engine, index);
+    }
+    ok = ok && engine->c2_engine_wait_pending(0, 1000);
+
+    latest_component()->Hang(mode);
+
+    C2StatsSnapshot snapshot = {};
+    uint64_t deadline = C2Stats::Now() + RECOVERY_TIMEOUT_US;
+    while (ok && snapshot.recovered == 0 && C2Stats::Now() < deadline) {
+        ok = queue_frame(engine, index++);
+        usleep(FRAME_INTERVAL_US);
+        engine->c2_engine_stats(snapshot);
+    }
+
+    engine->stop_c2_engine();
+    C2Engine::free_c2_engine(engine);
+
+    size_t instances;
+    uint32_t sync_requests;
+    {
+        std::lock_guard<std::mutex> lk(g_lock);
+        instances = g_components.size();
+        sync_requests = g_components.back()->GetSyncRequests();
+    }
+
+    if (!ok || snapshot.recovered != 1) {
+        base::LogError() << "Hang mode " << static_cast<uint32_t>(mode) << " not recovered";
+        return false;
+    }
+    if (snapshot.stalls != expected_stalls || instances != expected_instances) {
+        base::LogError() << "Hang mode " << static_cast<uint32_t>(mode) << ": " << snapshot.stalls
+                         << " stalls, " << instances << " instances, expected "
+                         << expected_stalls << " and " << expected_instances;
+        return false;
+    }
+    if (sync_requests == 0) {
+        base::LogError() << "No sync frame requested after recovery";
+        return false;
+    }
+
+    base::LogInfo() << "Hang mode " << static_cast<uint32_t>(mode) << ": " << snapshot.stalls
+                    << " stalls, recovered in " << snapshot.recover_time_last / 1000 << " ms, "
+                    << snapshot.dropped << " frames lost";
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        auto component = std::make_shared<FakeComponent>(name);
+        std::lock_guard<std::mutex> lk(g_lock);
+        g_components.push_back(component);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+
+    // Each step of the escalation takes one more stall: flush, restart, recreate.
+    bool ok = check_recovery(HangMode::kUntilFlush, 1, 1) &&
+              check_recovery(HangMode::kUntilRestart, 2, 1) &&
+              check_recovery(HangMode::kForever, 3, 2);
+
+    C2Factory::SetComponentCreator(nullptr);
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Watchdog checks passed";
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_replay_component.h"
+#include "c2_test_component.h"
+#include "c2_test_stream.h"
+#include "src/c2_engine.h"
+#include "src/c2_frame_source.h"
+#include "src/c2_work_log.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define NUM_FRAMES 60
+#define NUM_THREADS 4
+#define RECORDS_PER_THREAD 1000
+#define PAYLOAD_SIZE 1500
+#define SLICE_DELAY_US 5000
+#define FRAME_DELAY_US 20000
+#define TIMEOUT_MS 5000
+/// Frame queued with a sync frame request and a bitrate change.
+#define TUNED_FRAME 10
+#define TUNED_BITRATE 500000
+
+static std::vector<uint8_t> output(uint64_t index) {
+    C2TestStream stream(false, WIDTH, HEIGHT, index + 1);
+    return stream.AccessUnit(index == 0, PAYLOAD_SIZE);
+}
+
+// Records of concurrent writers all land in the file, in time order.
+static bool check_writer(const std::string &path) {
+    C2WorkLogWriter writer;
+    C2EngineConfig config = {WIDTH, HEIGHT, 30.0f, 0, 0};
+    if (!writer.Open(path, "c2.test.encoder", C2ModeType::VideoEncode, config)) {
+        return false;
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < NUM_THREADS; thread++) {
+        threads.emplace_back([&writer, thread] {
+            for (uint64_t idx = 0; idx < RECORDS_PER_THREAD; idx++) {
+                writer.Record(C2WorkLogEvent::kQueue, thread * RECORDS_PER_THREAD + idx, idx, 0,
+                              idx, WIDTH, HEIGHT);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    writer.Close();
+
+    C2WorkLogReader reader;
+    if (!reader.Load(path)) {
+        return false;
+    }
+
+    const std::vector<C2WorkLogRecord> &records = reader.GetRecords();
+    bool ordered = true;
+    uint64_t sum = 0;
+    for (size_t idx = 0; idx < records.size(); idx++) {
+        ordered = ordered && (idx == 0 || records[idx].time >= records[idx - 1].time);
+        sum += records[idx].index;
+    }
+    uint64_t total = NUM_THREADS * RECORDS_PER_THREAD;
+    if (records.size() != total || !ordered || sum != total * (total - 1) / 2 ||
+        std::string(reader.GetHeader().name) != "c2.test.encoder" ||
+        reader.GetHeader().config.width != WIDTH) {
+        base::LogError() << "Read " << records.size() << " records, ordered " << ordered;
+        return false;
+    }
+    return true;
+}
+
+static bool encode(C2Engine *engine, uint32_t frames, C2StatsSnapshot &snapshot) {
+    std::vector<uint8_t> frame(C2FrameSource::GetFrameSize(C2PixelFormat::kNV12, WIDTH, HEIGHT));
+    C2StreamBuffer buffer = {};
+    C2FrameSource::DescribeFrame(frame.data(), C2PixelFormat::kNV12, WIDTH, HEIGHT, buffer);
+
+    bool ok = engine->start_c2_engine();
+    for (uint64_t index = 0; ok && index < frames; index++) {
+        buffer.timestamp = index * 33333;
+        buffer.request_sync = (index == TUNED_FRAME);
+        buffer.bitrate = (index == TUNED_FRAME) ? TUNED_BITRATE : 0;
+        ok = engine->c2_engine_queue_buffer(&buffer);
+    }
+    ok = ok && engine->c2_engine_wait_pending(0, TIMEOUT_MS);
+    engine->stop_c2_engine();
+    engine->c2_engine_stats(snapshot);
+    return ok;
+}
+
+// Work of an engine shows up in its log with the input and output sizes.
+static bool check_record(const std::string &path) {
+    C2Factory::SetComponentCreator([](const std::string &name, C2ModeType mode) {
+        auto component = std::make_shared<FakeComponent>(name);
+        component->SetOutput(output);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    C2EngineConfig config = {WIDTH, HEIGHT, 30.0f, 1000000, 30};
+    C2StatsSnapshot snapshot;
+    bool ok = engine != nullptr && engine->c2_engine_configure(config) &&
+              engine->c2_engine_record_work(path) && encode(engine, NUM_FRAMES, snapshot) &&
+              engine->c2_engine_record_work("");
+    C2Engine::free_c2_engine(engine);
+    C2Factory::SetComponentCreator(nullptr);
+
+    C2WorkLogReader reader;
+    if (!ok || !reader.Load(path)) {
+        return false;
+    }
+
+    uint32_t queued = 0, done = 0, sizes = 0, tunings = 0;
+    for (const C2WorkLogRecord &record : reader.GetRecords()) {
+        if (static_cast<C2WorkLogEvent>(record.event) == C2WorkLogEvent::kQueue) {
+            queued++;
+            sizes += record.width != WIDTH || record.height != HEIGHT;
+            bool tuned = record.tuning_mask == (kTuningSyncFrame | kTuningBitrate) &&
+                         record.bitrate == TUNED_BITRATE;
+            tunings += (record.index == TUNED_FRAME) ? !tuned : (record.tuning_mask != 0);
+        } else if (static_cast<C2WorkLogEvent>(record.event) == C2WorkLogEvent::kDone) {
+            done++;
+            sizes += record.size != output(record.index).size();
+        }
+    }
+    if (queued != NUM_FRAMES || done != NUM_FRAMES || sizes != 0 || tunings != 0 ||
+        reader.GetHeader().config.bitrate != config.bitrate) {
+        base::LogError() << "Recorded " << queued << " queued and " << done << " done, " << sizes
+                         << " wrong sizes, " << tunings << " wrong tunings";
+        return false;
+    }
+    return true;
+}
+
+// The stand-in component returns the work with the recorded slices and timing.
+static bool check_replay() {
+    std::vector<C2WorkLogRecord> records;
+    for (uint64_t index = 0; index < NUM_FRAMES; index++) {
+        uint64_t time = index * 33333;
+        records.push_back({time, index, time, (uint32_t)C2WorkLogEvent::kQueue, 0, 0, WIDTH,
+                           HEIGHT, 0, 0});
+        records.push_back({time + SLICE_DELAY_US, index, time, (uint32_t)C2WorkLogEvent::kDone,
+                           C2FrameData::FLAG_INCOMPLETE, PAYLOAD_SIZE, 0, 0, 0, 0});
+        records.push_back({time + FRAME_DELAY_US, index, time, (uint32_t)C2WorkLogEvent::kDone, 0,
+                           PAYLOAD_SIZE, 0, 0, 0, 0});
+    }
+
+    std::shared_ptr<ReplayComponent> component;
+    C2Factory::SetComponentCreator([&](const std::string &name, C2ModeType mode) {
+        component = std::make_shared<ReplayComponent>(name, records);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+
+    C2Engine *engine = C2Engine::new_c2_engine(C2ModeType::VideoEncode,
+                                               C2CodecType::H264VideoEncode);
+    C2EngineConfig config = {WIDTH, HEIGHT, 30.0f, 1000000, 30};
+    C2StatsSnapshot snapshot;
+    bool ok = engine != nullptr && engine->c2_engine_configure(config) &&
+              encode(engine, NUM_FRAMES, snapshot) && snapshot.completed == NUM_FRAMES;
+
+    // Slices come back in works of their own, each measured.
+    size_t callbacks = component ? component->GetCallbackTimes().size() : 0;
+    C2Engine::free_c2_engine(engine);
+    C2Factory::SetComponentCreator(nullptr);
+
+    if (!ok || callbacks != 2 * NUM_FRAMES || snapshot.latency_p50 < FRAME_DELAY_US ||
+        snapshot.first_byte_p50 < SLICE_DELAY_US || snapshot.first_byte_p50 >= FRAME_DELAY_US) {
+        base::LogError() << "Replayed " << snapshot.completed << " frames, " << callbacks
+                         << " callbacks, latency " << snapshot.latency_p50 << " us, first byte "
+                         << snapshot.first_byte_p50 << " us";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, const char *argv[]) {
+    std::string path = "/tmp/work_log_test." + std::to_string(getpid());
+
+    bool ok = check_writer(path);
+    ok = check_record(path) && ok;
+    ok = check_replay() && ok;
+    unlink(path.c_str());
+    if (!ok) {
+        return 1;
+    }
+
+    base::LogInfo() << "Work log checks passed";
+    return 0;
+}
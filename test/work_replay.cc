@@ -0,0 +1,231 @@
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/log.h"
+#include "c2_replay_component.h"
+#include "src/c2_engine.h"
+#include "src/c2_frame_arena.h"
+
+#define DEFAULT_FRAMERATE 30
+#define PENDING_TIMEOUT_MS 5000
+
+static void usage(const char *name) {
+    std::cout << "Usage: " << name << " -i <log> [options]\n"
+              << "  -i, --input <path>     work log recorded with codec2_test -R\n"
+              << "  -n, --loops <count>    replay the log the given number of times (default 1)\n"
+              << "  -F, --flat-out         queue as soon as possible instead of at the\n"
+              << "                         recorded times\n";
+}
+
+static uint64_t percentile(std::vector<uint64_t> values, uint32_t percent) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * percent / 100)];
+}
+
+static bool parse_codec(const std::string &name, C2CodecType &codec) {
+    if (name == "c2.qti.avc.encoder") {
+        codec = C2CodecType::H264VideoEncode;
+    } else if (name == "c2.qti.hevc.encoder") {
+        codec = C2CodecType::H265VideoEncode;
+    } else if (name == "c2.qti.heic.encoder") {
+        codec = C2CodecType::HEICVideoEncode;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Queue to final completion latency of the recorded work, in microseconds.
+static std::vector<uint64_t> recorded_latencies(const std::vector<C2WorkLogRecord> &records) {
+    std::vector<uint64_t> latencies;
+    for (const auto &completions : ReplayComponent::Plan(records)) {
+        if (!completions.empty() && completions.back().event == C2WorkLogEvent::kDone) {
+            latencies.push_back(completions.back().delay);
+        }
+    }
+    return latencies;
+}
+
+int main(int argc, char *argv[]) {
+    std::string path;
+    uint32_t loops = 1;
+    bool paced = true;
+
+    const struct option options[] = {
+        {"input", required_argument, nullptr, 'i'},
+        {"loops", required_argument, nullptr, 'n'},
+        {"flat-out", no_argument, nullptr, 'F'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt = 0;
+    while ((opt = getopt_long(argc, argv, "i:n:F", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'i':
+                path = optarg;
+                break;
+            case 'n':
+                loops = std::max(1, atoi(optarg));
+                break;
+            case 'F':
+                paced = false;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (path.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    C2WorkLogReader log;
+    C2CodecType codec;
+    if (!log.Load(path)) {
+        return 1;
+    }
+    const C2WorkLogHeader &header = log.GetHeader();
+    if (!parse_codec(header.name, codec)) {
+        base::LogError() << "Cannot replay work of " << header.name;
+        return 1;
+    }
+
+    std::vector<C2WorkLogRecord> queued;
+    for (const C2WorkLogRecord &record : log.GetRecords()) {
+        if (static_cast<C2WorkLogEvent>(record.event) == C2WorkLogEvent::kQueue) {
+            queued.push_back(record);
+        }
+    }
+    if (queued.empty()) {
+        base::LogError() << "No work recorded in " << path;
+        return 1;
+    }
+
+    // Every loop replays the same completions, the plan is repeated.
+    std::vector<C2WorkLogRecord> records;
+    uint64_t duration = log.GetRecords().back().time + 1;
+    for (uint32_t loop = 0; loop < loops; loop++) {
+        for (C2WorkLogRecord record : log.GetRecords()) {
+            record.time += loop * duration;
+            record.index += loop * queued.size();
+            records.push_back(record);
+        }
+    }
+
+    std::shared_ptr<ReplayComponent> component;
+    C2Factory::SetComponentCreator([&](const std::string &name, C2ModeType mode) {
+        component = std::make_shared<ReplayComponent>(name, records);
+        return std::static_pointer_cast<C2Component>(component);
+    });
+
+    C2Engine *engine = C2Engine::new_c2_engine(static_cast<C2ModeType>(header.mode), codec);
+    if (engine == nullptr) {
+        return 1;
+    }
+
+    // Logs of engines never configured carry the size of the input only.
+    C2EngineConfig config = header.config;
+    if (config.width == 0 || config.height == 0) {
+        config.width = queued.front().width;
+        config.height = queued.front().height;
+    }
+    if (config.framerate <= 0) {
+        config.framerate = DEFAULT_FRAMERATE;
+    }
+    if (!engine->c2_engine_configure(config) || !engine->start_c2_engine()) {
+        C2Engine::free_c2_engine(engine);
+        return 1;
+    }
+
+    // Staged the way a capture source would, on aligned hugepage backed memory,
+    // one frame per input size found in the log.
+    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<C2StreamBuffer>> frames;
+    for (const C2WorkLogRecord &record : queued) {
+        uint32_t width = record.width ? record.width : config.width;
+        uint32_t height = record.height ? record.height : config.height;
+        std::shared_ptr<C2StreamBuffer> &frame = frames[{width, height}];
+        if (!frame) {
+            frame = C2FrameArena::Instance().Acquire(C2PixelFormat::kNV12, width, height);
+            if (!frame) {
+                C2Engine::free_c2_engine(engine);
+                return 1;
+            }
+            memset(frame->data, 0, frame->size);
+        }
+    }
+
+    // Time spent in the engine queueing path, the copy into the input block included.
+    std::vector<uint64_t> queue_times;
+    bool ok = true;
+    uint64_t start = C2Stats::Now();
+    for (uint32_t loop = 0; ok && loop < loops; loop++) {
+        for (const C2WorkLogRecord &record : queued) {
+            uint64_t due = start + loop * duration + record.time;
+            uint64_t now = C2Stats::Now();
+            if (paced && due > now) {
+                usleep(due - now);
+            }
+
+            // The recorded input flags and tunings are queued again, linear input
+            // sizes do not apply to the graphic input of the encoders.
+            C2StreamBuffer buffer =
+                *frames[{record.width ? record.width : config.width,
+                         record.height ? record.height : config.height}];
+            buffer.timestamp = record.timestamp;
+            buffer.flags = record.flags;
+            buffer.request_sync = record.tuning_mask & kTuningSyncFrame;
+            buffer.bitrate = (record.tuning_mask & kTuningBitrate) ? record.bitrate : 0;
+            auto begin = std::chrono::steady_clock::now();
+            ok = engine->c2_engine_queue_buffer(&buffer);
+            queue_times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - begin)
+                                      .count());
+            if (!ok) {
+                break;
+            }
+        }
+    }
+
+    ok = ok && engine->c2_engine_wait_pending(0, PENDING_TIMEOUT_MS);
+    engine->stop_c2_engine();
+
+    C2StatsSnapshot snapshot;
+    engine->c2_engine_stats(snapshot);
+    std::vector<uint64_t> callback_times = component->GetCallbackTimes();
+    C2Engine::free_c2_engine(engine);
+    C2Factory::SetComponentCreator(nullptr);
+
+    std::vector<uint64_t> recorded = recorded_latencies(log.GetRecords());
+    uint64_t recorded_p50 = percentile(recorded, 50);
+    uint64_t recorded_p99 = percentile(recorded, 99);
+
+    std::cout << header.name << " " << config.width << "x" << config.height << ", "
+              << snapshot.queued << " frames queued, " << snapshot.completed << " completed, "
+              << snapshot.dropped << " dropped\n"
+              << "queue call     p50 " << percentile(queue_times, 50) / 1000 << " us, p99 "
+              << percentile(queue_times, 99) / 1000 << " us\n"
+              << "callback       p50 " << percentile(callback_times, 50) / 1000 << " us, p99 "
+              << percentile(callback_times, 99) / 1000 << " us\n"
+              << "recorded       p50 " << recorded_p50 << " us, p99 " << recorded_p99 << " us\n"
+              << "replayed       p50 " << snapshot.latency_p50 << " us, p99 "
+              << snapshot.latency_p99 << " us\n"
+              << "overhead       p50 "
+              << static_cast<int64_t>(snapshot.latency_p50) - static_cast<int64_t>(recorded_p50)
+              << " us, p99 "
+              << static_cast<int64_t>(snapshot.latency_p99) - static_cast<int64_t>(recorded_p99)
+              << " us\n";
+    return ok ? 0 : 1;
+}